@@ -11,6 +11,7 @@ C_SRCS += \
 ../lwip-2.0.2/src/core/ipv4/igmp.c \
 ../lwip-2.0.2/src/core/ipv4/ip4.c \
 ../lwip-2.0.2/src/core/ipv4/ip4_addr.c \
+../lwip-2.0.2/src/core/ipv4/ip4_fib.c \
 ../lwip-2.0.2/src/core/ipv4/ip4_frag.c 
 
 OBJS += \
@@ -21,6 +22,7 @@ OBJS += \
 ./lwip-2.0.2/src/core/ipv4/igmp.o \
 ./lwip-2.0.2/src/core/ipv4/ip4.o \
 ./lwip-2.0.2/src/core/ipv4/ip4_addr.o \
+./lwip-2.0.2/src/core/ipv4/ip4_fib.o \
 ./lwip-2.0.2/src/core/ipv4/ip4_frag.o 
 
 C_DEPS += \
@@ -31,6 +33,7 @@ C_DEPS += \
 ./lwip-2.0.2/src/core/ipv4/igmp.d \
 ./lwip-2.0.2/src/core/ipv4/ip4.d \
 ./lwip-2.0.2/src/core/ipv4/ip4_addr.d \
+./lwip-2.0.2/src/core/ipv4/ip4_fib.d \
 ./lwip-2.0.2/src/core/ipv4/ip4_frag.d 
 
 
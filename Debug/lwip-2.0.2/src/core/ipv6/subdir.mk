@@ -10,6 +10,7 @@ C_SRCS += \
 ../lwip-2.0.2/src/core/ipv6/inet6.c \
 ../lwip-2.0.2/src/core/ipv6/ip6.c \
 ../lwip-2.0.2/src/core/ipv6/ip6_addr.c \
+../lwip-2.0.2/src/core/ipv6/ip6_fib.c \
 ../lwip-2.0.2/src/core/ipv6/ip6_frag.c \
 ../lwip-2.0.2/src/core/ipv6/mld6.c \
 ../lwip-2.0.2/src/core/ipv6/nd6.c 
@@ -21,6 +22,7 @@ OBJS += \
 ./lwip-2.0.2/src/core/ipv6/inet6.o \
 ./lwip-2.0.2/src/core/ipv6/ip6.o \
 ./lwip-2.0.2/src/core/ipv6/ip6_addr.o \
+./lwip-2.0.2/src/core/ipv6/ip6_fib.o \
 ./lwip-2.0.2/src/core/ipv6/ip6_frag.o \
 ./lwip-2.0.2/src/core/ipv6/mld6.o \
 ./lwip-2.0.2/src/core/ipv6/nd6.o 
@@ -32,6 +34,7 @@ C_DEPS += \
 ./lwip-2.0.2/src/core/ipv6/inet6.d \
 ./lwip-2.0.2/src/core/ipv6/ip6.d \
 ./lwip-2.0.2/src/core/ipv6/ip6_addr.d \
+./lwip-2.0.2/src/core/ipv6/ip6_fib.d \
 ./lwip-2.0.2/src/core/ipv6/ip6_frag.d \
 ./lwip-2.0.2/src/core/ipv6/mld6.d \
 ./lwip-2.0.2/src/core/ipv6/nd6.d 
@@ -6,16 +6,19 @@
 C_SRCS += \
 ../lwip-2.0.2/test/linux/echo_server.c \
 ../lwip-2.0.2/test/linux/main.c \
+../lwip-2.0.2/test/linux/pbuf_stress.c \
 ../lwip-2.0.2/test/linux/tcp_client.c 
 
 OBJS += \
 ./lwip-2.0.2/test/linux/echo_server.o \
 ./lwip-2.0.2/test/linux/main.o \
+./lwip-2.0.2/test/linux/pbuf_stress.o \
 ./lwip-2.0.2/test/linux/tcp_client.o 
 
 C_DEPS += \
 ./lwip-2.0.2/test/linux/echo_server.d \
 ./lwip-2.0.2/test/linux/main.d \
+./lwip-2.0.2/test/linux/pbuf_stress.d \
 ./lwip-2.0.2/test/linux/tcp_client.d 
 
 
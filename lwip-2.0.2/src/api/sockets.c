@@ -1054,15 +1054,21 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
     } else {
       /* flatten the IO vectors */
       size_t offset = 0;
+#if LWIP_CHECKSUM_ON_COPY
+      /* checksum each IO vector while copying it */
+      u16_t chksum = 0;
       for (i = 0; i < msg->msg_iovlen; i++) {
-        MEMCPY(&((u8_t*)chain_buf->p->payload)[offset], msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
+        if (msg->msg_iov[i].iov_len > 0) {
+          pbuf_fill_chksum(chain_buf->p, (u16_t)offset, msg->msg_iov[i].iov_base,
+            (u16_t)msg->msg_iov[i].iov_len, &chksum);
+        }
         offset += msg->msg_iov[i].iov_len;
       }
-#if LWIP_CHECKSUM_ON_COPY
-      {
-        /* This can be improved by using LWIP_CHKSUM_COPY() and aggregating the checksum for each IO vector */
-        u16_t chksum = ~inet_chksum_pbuf(chain_buf->p);
-        netbuf_set_chksum(chain_buf, chksum);
+      netbuf_set_chksum(chain_buf, chksum);
+#else /* LWIP_CHECKSUM_ON_COPY */
+      for (i = 0; i < msg->msg_iovlen; i++) {
+        MEMCPY(&((u8_t*)chain_buf->p->payload)[offset], msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
+        offset += msg->msg_iov[i].iov_len;
       }
 #endif /* LWIP_CHECKSUM_ON_COPY */
       err = ERR_OK;
@@ -1924,6 +1930,13 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
                                   s, optname, (*(int*)optval?"on":"off")));
       break;
 
+#if LWIP_SO_REUSEPORT
+    case SO_REUSEPORT:
+      LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB(sock, *optlen, int);
+      *(int*)optval = ip_get_option(sock->conn->pcb.ip, SOF_REUSEPORT) ? 1 : 0;
+      break;
+#endif /* LWIP_SO_REUSEPORT */
+
     case SO_TYPE:
       LWIP_SOCKOPT_CHECK_OPTLEN_CONN(sock, *optlen, int);
       switch (NETCONNTYPE_GROUP(netconn_type(sock->conn))) {
@@ -2317,6 +2330,17 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
                   s, optname, (*(const int*)optval?"on":"off")));
       break;
 
+#if LWIP_SO_REUSEPORT
+    case SO_REUSEPORT:
+      LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB(sock, optlen, int);
+      if (*(const int*)optval) {
+        ip_set_option(sock->conn->pcb.ip, SOF_REUSEPORT);
+      } else {
+        ip_reset_option(sock->conn->pcb.ip, SOF_REUSEPORT);
+      }
+      break;
+#endif /* LWIP_SO_REUSEPORT */
+
     /* SO_TYPE is get-only */
     /* SO_ERROR is get-only */
 
@@ -0,0 +1,112 @@
+/*
+ * arena.c
+ *
+ *  Memory arena of the Linux port (MEM_ARENA): huge pages placed on the
+ *  NUMA node of the network interface.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "lwip.h"
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+
+#if MEM_ARENA
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+/* NUMA node for new arena chunks, -1: no preference */
+static int arena_node = -1;
+
+/* NUMA node of the device behind ifname, -1 if unknown */
+static int arena_if_numa_node(const char *ifname)
+{
+  char path[128];
+  FILE *f;
+  int node = -1;
+
+  snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", ifname);
+  f = fopen(path, "r");
+  if (f != NULL)
+  {
+    if (fscanf(f, "%d", &node) != 1)
+    {
+      node = -1;
+    }
+    fclose(f);
+  }
+  return node;
+}
+
+/* Read the arena configuration; call before lwip_init() */
+void linux_arena_init(const char *ifname)
+{
+  const char *env;
+
+  arena_node = arena_if_numa_node(ifname);
+  printf("Memory arena on NUMA node %d\n", arena_node);
+
+  /* pools and heap can be resized without recompiling */
+  env = getenv("LWIP_PBUF_POOL_SIZE");
+  if (env != NULL)
+  {
+    memp_set_num(MEMP_PBUF_POOL, (u32_t)strtoul(env, NULL, 0));
+  }
+  env = getenv("LWIP_MEM_SIZE");
+  if (env != NULL)
+  {
+    mem_set_size((mem_size_t)strtoul(env, NULL, 0));
+  }
+}
+
+/* MEM_ARENA_ALLOC(): size is a multiple of MEM_ARENA_CHUNK_SIZE (2 MB) */
+void *linux_arena_alloc(size_t size)
+{
+  void *mem;
+
+  mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (mem == MAP_FAILED)
+  {
+    /* no huge pages reserved: ask for transparent huge pages */
+    mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+      return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(mem, size, MADV_HUGEPAGE);
+#endif
+  }
+#ifdef SYS_mbind
+  if (arena_node >= 0 && arena_node < (int)(8 * sizeof(unsigned long)))
+  {
+    unsigned long nodemask = 1UL << arena_node;
+    /* the pages are not touched yet, so they get allocated on that node */
+    if (syscall(SYS_mbind, mem, size, MPOL_PREFERRED, &nodemask, 8 * sizeof(nodemask) + 1, 0) != 0)
+    {
+      printf("mbind to NUMA node %d failed\n", arena_node);
+    }
+  }
+#endif
+  return mem;
+}
+
+#endif /* MEM_ARENA */
@@ -27,6 +27,9 @@
 #include <math.h>
 #include <sys/time.h>
 #include "lwip.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/ethernet.h"
 
 extern char* w_pcap_lookupdev(char **errbuf);
 extern void* w_pcap_open(char *dev, char *errbuf);
@@ -42,6 +45,7 @@ static err_t linux_lwip_init(struct netif *netif);
 static err_t linux_link_output(struct netif *netif, struct pbuf *pfirst);
 static u32_t get_default_getway_ip(void);
 static void* netif_packet_capture(void *arg);
+static void linux_rx_copy(struct pbuf *p, const u8_t *frame, u16_t len);
 
 #if LWIP_NETIF_STATUS_CALLBACK
 static void linux_net_status_cb(struct netif *netif);
@@ -190,6 +194,11 @@ _netdev_try:
 
     my_netif.next = NULL;
 
+#if MEM_ARENA
+    // Place pools and heap on the NUMA node of the device
+    linux_arena_init(dev);
+#endif
+
     // Initialize LWIP
     lwip_init();
 
@@ -295,16 +304,102 @@ static void* netif_packet_capture(void *arg)
       /* Timeout elapsed */
       continue;
     }
+#if PBUF_POOL_CLASSES
+    /* best-fit pool buffer (a short chain for frames bigger than all pools) */
+    pnew = pbuf_alloc_bestfit(PBUF_RAW, len);
+#else
     pnew = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+#endif
     if (pnew != NULL)
     {
-      memcpy(pnew->payload, pkt_data, len);
+      linux_rx_copy(pnew, pkt_data, (u16_t)len);
       mynetif->input(pnew, mynetif);
     }
   }
     return NULL;
 }
 
+/*
+ * Copy a received frame into p. The TCP/UDP part of unfragmented IPv4
+ * packets is summed while it is copied: if the IPv4 header and transport
+ * checksums are good, p is marked PBUF_FLAG_CHKSUM_VERIFIED so that the
+ * stack does not read the data a second time to check them.
+ */
+static void linux_rx_copy(struct pbuf *p, const u8_t *frame, u16_t len)
+{
+#if LWIP_CHECKSUM_OFFLOAD && LWIP_CHECKSUM_ON_COPY && LWIP_IPV4
+    const struct eth_hdr *ethhdr = (const struct eth_hdr *)frame;
+    const struct ip_hdr *iphdr = (const struct ip_hdr *)(frame + SIZEOF_ETH_HDR);
+    struct pbuf *q;
+    ip4_addr_t addr;
+    u32_t acc = 0;
+    u16_t start = 0, end = 0, off = 0, qoff, n, hlen, iplen, chksum;
+
+    if ((len >= SIZEOF_ETH_HDR + IP_HLEN) && (ethhdr->type == PP_HTONS(ETHTYPE_IP)) &&
+        (IPH_V(iphdr) == 4))
+    {
+        hlen = (u16_t)(IPH_HL(iphdr) * 4);
+        iplen = lwip_ntohs(IPH_LEN(iphdr));
+        if ((hlen >= IP_HLEN) && (iplen >= hlen) && (SIZEOF_ETH_HDR + iplen <= len) &&
+            ((IPH_OFFSET(iphdr) & PP_HTONS(IP_OFFMASK | IP_MF)) == 0) &&
+            ((IPH_PROTO(iphdr) == IP_PROTO_TCP) || (IPH_PROTO(iphdr) == IP_PROTO_UDP)) &&
+            (inet_chksum(iphdr, hlen) == 0))
+        {
+            start = (u16_t)(SIZEOF_ETH_HDR + hlen);
+            end = (u16_t)(SIZEOF_ETH_HDR + iplen);
+        }
+    }
+
+    /* plain copy before start and after end, copy-and-sum in between */
+    for (q = p; q != NULL; q = q->next)
+    {
+        for (qoff = 0; qoff < q->len; qoff += n, off += n)
+        {
+            u8_t *dst = (u8_t *)q->payload + qoff;
+            n = (u16_t)(q->len - qoff);
+            if (off < start)
+            {
+                n = LWIP_MIN(n, (u16_t)(start - off));
+                MEMCPY(dst, frame + off, n);
+            }
+            else if (off < end)
+            {
+                n = LWIP_MIN(n, (u16_t)(end - off));
+                chksum = LWIP_CHKSUM_COPY(dst, frame + off, n);
+                if (((off - start) & 1) != 0)
+                {
+                    chksum = SWAP_BYTES_IN_WORD(chksum);
+                }
+                acc += chksum;
+            }
+            else
+            {
+                MEMCPY(dst, frame + off, n);
+            }
+        }
+    }
+
+    if (start != 0)
+    {
+        /* add the pseudo header */
+        ip4_addr_copy(addr, iphdr->src);
+        acc += (ip4_addr_get_u32(&addr) & 0xffffUL) + (ip4_addr_get_u32(&addr) >> 16);
+        ip4_addr_copy(addr, iphdr->dest);
+        acc += (ip4_addr_get_u32(&addr) & 0xffffUL) + (ip4_addr_get_u32(&addr) >> 16);
+        acc += (u32_t)lwip_htons((u16_t)IPH_PROTO(iphdr));
+        acc += (u32_t)lwip_htons((u16_t)(end - start));
+        acc = FOLD_U32T(acc);
+        acc = FOLD_U32T(acc);
+        if (acc == 0xffffUL)
+        {
+            p->flags |= PBUF_FLAG_CHKSUM_VERIFIED;
+        }
+    }
+#else
+    pbuf_take(p, frame, len);
+#endif
+}
+
 static err_t linux_lwip_init(struct netif *netif)
 {
     // Setup lwIP arch interface.
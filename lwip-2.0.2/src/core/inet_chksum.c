@@ -10,7 +10,7 @@
  * \#define LWIP_CHKSUM your_checksum_routine
  * 
  * Or you can select from the implementations below by defining
- * LWIP_CHKSUM_ALGORITHM to 1, 2 or 3.
+ * LWIP_CHKSUM_ALGORITHM to 1, 2, 3 or 4.
  */
 
 /*
@@ -255,6 +255,349 @@ lwip_standard_chksum(const void *dataptr, int len)
 }
 #endif
 
+#if (LWIP_CHKSUM_ALGORITHM == 4) /* Alternative version #4 */
+/*
+ * 64-bit accumulator version: 32-bit words are added into a 64-bit sum so
+ * that no carry has to be handled inside the loop. The sum is folded down to
+ * 16 bits only once at the end (2^32 == 1 mod 0xffff, so the result is the
+ * same as summing 16-bit words).
+ *
+ * On x86-64 with gcc or clang, the bulk of the data is summed by SSE2, AVX2
+ * or AVX-512 kernels instead. The widest kernel supported by the CPU is
+ * selected on the first call (CPUID via __builtin_cpu_supports()). Define
+ * LWIP_CHKSUM_SIMD to 0 in lwipopts.h to build the portable version only.
+ */
+#ifndef LWIP_CHKSUM_SIMD
+# if defined(__x86_64__) && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 7)))
+#  define LWIP_CHKSUM_SIMD 1
+# else
+#  define LWIP_CHKSUM_SIMD 0
+# endif
+#endif /* LWIP_CHKSUM_SIMD */
+
+#if LWIP_CHKSUM_SIMD
+#include <immintrin.h>
+#endif /* LWIP_CHKSUM_SIMD */
+
+/** Fold a 64-bit sum to 32 bits, then 32 bits to 16 bits */
+static u16_t
+lwip_chksum_fold64(u64_t sum)
+{
+  u32_t sum32;
+
+  sum = (sum >> 32) + (sum & 0xffffffffUL);
+  sum32 = (u32_t)((sum >> 32) + (sum & 0xffffffffUL));
+  sum32 = FOLD_U32T(sum32);
+  sum32 = FOLD_U32T(sum32);
+  return (u16_t)sum32;
+}
+
+/** Sum all 32-bit words of a 32-bit aligned buffer, len is a multiple of 4 */
+static u64_t
+lwip_chksum_words(const u8_t *pb, size_t len)
+{
+  const u32_t *pl = (const u32_t *)(const void *)pb;
+  u64_t sum0 = 0, sum1 = 0;
+
+  while (len >= 16) {
+    sum0 += pl[0];
+    sum1 += pl[1];
+    sum0 += pl[2];
+    sum1 += pl[3];
+    pl += 4;
+    len -= 16;
+  }
+  while (len > 0) {
+    sum0 += *pl++;
+    len -= 4;
+  }
+  return sum0 + sum1;
+}
+
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2) && !LWIP_CHKSUM_SIMD
+/** Copy and sum 32-bit words, src and dst 32-bit aligned, len a multiple of 4 */
+static u64_t
+lwip_chksum_copy_words(u8_t *dst, const u8_t *src, size_t len)
+{
+  const u32_t *ps = (const u32_t *)(const void *)src;
+  u32_t *pd = (u32_t *)(void *)dst;
+  u64_t sum = 0;
+
+  while (len > 0) {
+    u32_t w = *ps++;
+    *pd++ = w;
+    sum += w;
+    len -= 4;
+  }
+  return sum;
+}
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) && !LWIP_CHKSUM_SIMD */
+
+#if LWIP_CHKSUM_SIMD
+/* The SIMD kernels zero-extend each 32-bit word to a 64-bit lane and add the
+ * lanes; the tail that does not fill a whole vector is left to the next
+ * smaller kernel. The caller passes a multiple of 4 for len. */
+
+static u64_t
+lwip_chksum_sse2(const u8_t *pb, size_t len)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc0 = zero, acc1 = zero;
+
+  while (len >= 32) {
+    __m128i v0 = _mm_loadu_si128((const __m128i *)(const void *)pb);
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(const void *)(pb + 16));
+    acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v0, zero));
+    acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v0, zero));
+    acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v1, zero));
+    acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v1, zero));
+    pb += 32;
+    len -= 32;
+  }
+  acc0 = _mm_add_epi64(acc0, acc1);
+  acc0 = _mm_add_epi64(acc0, _mm_unpackhi_epi64(acc0, acc0));
+  return (u64_t)_mm_cvtsi128_si64(acc0) + lwip_chksum_words(pb, len);
+}
+
+__attribute__((target("avx2"))) static u64_t
+lwip_chksum_avx2(const u8_t *pb, size_t len)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc0 = zero, acc1 = zero;
+  __m128i acc;
+
+  while (len >= 64) {
+    __m256i v0 = _mm256_loadu_si256((const __m256i *)(const void *)pb);
+    __m256i v1 = _mm256_loadu_si256((const __m256i *)(const void *)(pb + 32));
+    acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v0, zero));
+    acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v0, zero));
+    acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v1, zero));
+    acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v1, zero));
+    pb += 64;
+    len -= 64;
+  }
+  acc0 = _mm256_add_epi64(acc0, acc1);
+  acc = _mm_add_epi64(_mm256_castsi256_si128(acc0), _mm256_extracti128_si256(acc0, 1));
+  acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+  return (u64_t)_mm_cvtsi128_si64(acc) + lwip_chksum_sse2(pb, len);
+}
+
+__attribute__((target("avx512f"))) static u64_t
+lwip_chksum_avx512(const u8_t *pb, size_t len)
+{
+  const __m512i zero = _mm512_setzero_si512();
+  __m512i acc0 = zero, acc1 = zero;
+
+  while (len >= 128) {
+    __m512i v0 = _mm512_loadu_si512((const void *)pb);
+    __m512i v1 = _mm512_loadu_si512((const void *)(pb + 64));
+    acc0 = _mm512_add_epi64(acc0, _mm512_unpacklo_epi32(v0, zero));
+    acc1 = _mm512_add_epi64(acc1, _mm512_unpackhi_epi32(v0, zero));
+    acc0 = _mm512_add_epi64(acc0, _mm512_unpacklo_epi32(v1, zero));
+    acc1 = _mm512_add_epi64(acc1, _mm512_unpackhi_epi32(v1, zero));
+    pb += 128;
+    len -= 128;
+  }
+  acc0 = _mm512_add_epi64(acc0, acc1);
+  return (u64_t)_mm512_reduce_add_epi64(acc0) + lwip_chksum_avx2(pb, len);
+}
+
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2)
+/* Copy variants of the kernels above: every vector loaded is stored to dst
+ * and summed. The caller passes a multiple of 16 for len. */
+
+static u64_t
+lwip_chksum_copy_sse2(u8_t *dst, const u8_t *src, size_t len)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc0 = zero, acc1 = zero;
+
+  while (len >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(const void *)src);
+    _mm_storeu_si128((__m128i *)(void *)dst, v);
+    acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v, zero));
+    acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v, zero));
+    src += 16;
+    dst += 16;
+    len -= 16;
+  }
+  acc0 = _mm_add_epi64(acc0, acc1);
+  acc0 = _mm_add_epi64(acc0, _mm_unpackhi_epi64(acc0, acc0));
+  return (u64_t)_mm_cvtsi128_si64(acc0);
+}
+
+__attribute__((target("avx2"))) static u64_t
+lwip_chksum_copy_avx2(u8_t *dst, const u8_t *src, size_t len)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc0 = zero, acc1 = zero;
+  __m128i acc;
+
+  while (len >= 64) {
+    __m256i v0 = _mm256_loadu_si256((const __m256i *)(const void *)src);
+    __m256i v1 = _mm256_loadu_si256((const __m256i *)(const void *)(src + 32));
+    _mm256_storeu_si256((__m256i *)(void *)dst, v0);
+    _mm256_storeu_si256((__m256i *)(void *)(dst + 32), v1);
+    acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v0, zero));
+    acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v0, zero));
+    acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v1, zero));
+    acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v1, zero));
+    src += 64;
+    dst += 64;
+    len -= 64;
+  }
+  acc0 = _mm256_add_epi64(acc0, acc1);
+  acc = _mm_add_epi64(_mm256_castsi256_si128(acc0), _mm256_extracti128_si256(acc0, 1));
+  acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+  return (u64_t)_mm_cvtsi128_si64(acc) + lwip_chksum_copy_sse2(dst, src, len);
+}
+
+__attribute__((target("avx512f"))) static u64_t
+lwip_chksum_copy_avx512(u8_t *dst, const u8_t *src, size_t len)
+{
+  const __m512i zero = _mm512_setzero_si512();
+  __m512i acc0 = zero, acc1 = zero;
+
+  while (len >= 128) {
+    __m512i v0 = _mm512_loadu_si512((const void *)src);
+    __m512i v1 = _mm512_loadu_si512((const void *)(src + 64));
+    _mm512_storeu_si512((void *)dst, v0);
+    _mm512_storeu_si512((void *)(dst + 64), v1);
+    acc0 = _mm512_add_epi64(acc0, _mm512_unpacklo_epi32(v0, zero));
+    acc1 = _mm512_add_epi64(acc1, _mm512_unpackhi_epi32(v0, zero));
+    acc0 = _mm512_add_epi64(acc0, _mm512_unpacklo_epi32(v1, zero));
+    acc1 = _mm512_add_epi64(acc1, _mm512_unpackhi_epi32(v1, zero));
+    src += 128;
+    dst += 128;
+    len -= 128;
+  }
+  acc0 = _mm512_add_epi64(acc0, acc1);
+  return (u64_t)_mm512_reduce_add_epi64(acc0) + lwip_chksum_copy_avx2(dst, src, len);
+}
+
+typedef u64_t (*lwip_chksum_copy_fn)(u8_t *dst, const u8_t *src, size_t len);
+static u64_t lwip_chksum_copy_select(u8_t *dst, const u8_t *src, size_t len);
+
+/** Copy kernel, set together with lwip_chksum_kernel */
+static lwip_chksum_copy_fn lwip_chksum_copy_kernel = lwip_chksum_copy_select;
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
+
+typedef u64_t (*lwip_chksum_kernel_fn)(const u8_t *pb, size_t len);
+static u64_t lwip_chksum_select(const u8_t *pb, size_t len);
+
+/** Bulk kernel, set to the widest one supported by the CPU on first use */
+static lwip_chksum_kernel_fn lwip_chksum_kernel = lwip_chksum_select;
+
+static void
+lwip_chksum_select_kernels(void)
+{
+  lwip_chksum_kernel_fn kernel = lwip_chksum_sse2;
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2)
+  lwip_chksum_copy_fn copy_kernel = lwip_chksum_copy_sse2;
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
+
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    kernel = lwip_chksum_avx512;
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2)
+    copy_kernel = lwip_chksum_copy_avx512;
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
+  } else if (__builtin_cpu_supports("avx2")) {
+    kernel = lwip_chksum_avx2;
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2)
+    copy_kernel = lwip_chksum_copy_avx2;
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
+  }
+  /* all kernels give the same result, so racing callers do no harm */
+  lwip_chksum_kernel = kernel;
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2)
+  lwip_chksum_copy_kernel = copy_kernel;
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
+}
+
+static u64_t
+lwip_chksum_select(const u8_t *pb, size_t len)
+{
+  lwip_chksum_select_kernels();
+  return lwip_chksum_kernel(pb, len);
+}
+#define LWIP_CHKSUM_BULK(pb, len) lwip_chksum_kernel(pb, len)
+
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2)
+static u64_t
+lwip_chksum_copy_select(u8_t *dst, const u8_t *src, size_t len)
+{
+  lwip_chksum_select_kernels();
+  return lwip_chksum_copy_kernel(dst, src, len);
+}
+/* vector loads and stores need no alignment */
+#define LWIP_CHKSUM_COPY_ALIGN    0
+#define LWIP_CHKSUM_COPY_BULK(dst, src, len) lwip_chksum_copy_kernel(dst, src, len)
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
+#else /* LWIP_CHKSUM_SIMD */
+#define LWIP_CHKSUM_BULK(pb, len) lwip_chksum_words(pb, len)
+#define LWIP_CHKSUM_COPY_ALIGN    4
+#define LWIP_CHKSUM_COPY_BULK(dst, src, len) lwip_chksum_copy_words(dst, src, len)
+#endif /* LWIP_CHKSUM_SIMD */
+
+/**
+ * @param dataptr points to start of data to be summed at any boundary
+ * @param len length of data to be summed
+ * @return host order (!) lwip checksum (non-inverted Internet sum)
+ */
+u16_t
+lwip_standard_chksum(const void *dataptr, int len)
+{
+  const u8_t *pb = (const u8_t *)dataptr;
+  u16_t t = 0;
+  u64_t sum = 0;
+  u16_t sum16;
+  size_t bulk;
+  /* starts at odd byte address? */
+  int odd = ((mem_ptr_t)pb & 1);
+
+  if (odd && len > 0) {
+    ((u8_t *)&t)[1] = *pb++;
+    len--;
+  }
+
+  /* get aligned to u32_t */
+  if (((mem_ptr_t)pb & 2) && len > 1) {
+    sum += *(const u16_t *)(const void *)pb;
+    pb += 2;
+    len -= 2;
+  }
+
+  if (len > 3) {
+    bulk = (size_t)len & ~(size_t)3;
+    sum += LWIP_CHKSUM_BULK(pb, bulk);
+    pb += bulk;
+    len -= (int)bulk;
+  }
+
+  /* 16-bit aligned word remaining? */
+  if (len > 1) {
+    sum += *(const u16_t *)(const void *)pb;
+    pb += 2;
+    len -= 2;
+  }
+
+  /* dangling tail byte remaining? */
+  if (len > 0) {
+    ((u8_t *)&t)[0] = *pb;
+  }
+  sum += t;
+
+  sum16 = lwip_chksum_fold64(sum);
+
+  if (odd) {
+    sum16 = SWAP_BYTES_IN_WORD(sum16);
+  }
+
+  return (u16_t)sum16;
+}
+#endif
+
 /** Parts of the pseudo checksum which are common to IPv4 and IPv6 */
 static u16_t
 inet_cksum_pseudo_base(struct pbuf *p, u8_t proto, u16_t proto_len, u32_t acc)
@@ -541,6 +884,81 @@ ip_chksum_pseudo_partial(struct pbuf *p, u8_t proto, u16_t proto_len,
 #endif /* LWIP_IPV4 */
 }
 
+#if LWIP_CHECKSUM_OFFLOAD
+/**
+ * Leave the TCP/UDP checksum of a packet to the netif driver: the checksum
+ * field at 'chksum_offset' from p->payload gets the (non-inverted) pseudo
+ * header sum and p is marked with PBUF_FLAG_CHKSUM_PARTIAL.
+ *
+ * @param p pbuf chain starting with the transport header
+ * @param proto ip protocol (used for checksum of pseudo header)
+ * @param proto_len length of the ip data part (used for checksum of pseudo header)
+ * @param chksum_offset offset of the checksum field in the transport header
+ * @param src source ip address (used for checksum of pseudo header)
+ * @param dest destination ip address (used for checksum of pseudo header)
+ */
+void
+ip_chksum_pseudo_offload(struct pbuf *p, u8_t proto, u16_t proto_len,
+       u16_t chksum_offset, const ip_addr_t *src, const ip_addr_t *dest)
+{
+  u16_t chksum;
+
+  LWIP_ASSERT("checksum field not in first pbuf", chksum_offset + 2 <= p->len);
+  /* no data summed: the result is the inverted pseudo header sum */
+  chksum = (u16_t)~ip_chksum_pseudo_partial(p, proto, proto_len, 0, src, dest);
+  SMEMCPY((u8_t *)p->payload + chksum_offset, &chksum, sizeof(chksum));
+  p->csum_start = 0;
+  p->csum_offset = chksum_offset;
+  p->flags |= PBUF_FLAG_CHKSUM_PARTIAL;
+}
+
+/**
+ * Complete a checksum left to the netif (PBUF_FLAG_CHKSUM_PARTIAL) in
+ * software, for drivers without hardware support and for paths that cannot
+ * pass the packet on as it is (e.g. fragmentation).
+ *
+ * @param p pbuf chain to complete the checksum for
+ */
+void
+inet_chksum_offload_finish(struct pbuf *p)
+{
+  struct pbuf *q;
+  u32_t acc = 0;
+  u16_t offset, chksum;
+  u8_t swapped = 0;
+
+  if ((p->flags & PBUF_FLAG_CHKSUM_PARTIAL) == 0) {
+    return;
+  }
+  LWIP_ASSERT("checksum field not in first pbuf", p->csum_start + p->csum_offset + 2 <= p->len);
+  offset = p->csum_start;
+  for (q = p; q != NULL; q = q->next) {
+    if (offset >= q->len) {
+      offset = (u16_t)(offset - q->len);
+      continue;
+    }
+    acc += LWIP_CHKSUM((u8_t *)q->payload + offset, q->len - offset);
+    acc = FOLD_U32T(acc);
+    if ((q->len - offset) % 2 != 0) {
+      swapped = 1 - swapped;
+      acc = SWAP_BYTES_IN_WORD(acc);
+    }
+    offset = 0;
+  }
+  if (swapped) {
+    acc = SWAP_BYTES_IN_WORD(acc);
+  }
+  acc = FOLD_U32T(acc);
+  chksum = (u16_t)~acc;
+  /* 0 means 'no checksum' for UDP, 0xffff is the same for TCP */
+  if (chksum == 0) {
+    chksum = 0xffff;
+  }
+  SMEMCPY((u8_t *)p->payload + p->csum_start + p->csum_offset, &chksum, sizeof(chksum));
+  p->flags &= (u8_t)~PBUF_FLAG_CHKSUM_PARTIAL;
+}
+#endif /* LWIP_CHECKSUM_OFFLOAD */
+
 /* inet_chksum:
  *
  * Calculates the Internet checksum over a portion of memory. Used primarily for IP
@@ -588,6 +1006,46 @@ inet_chksum_pbuf(struct pbuf *p)
   return (u16_t)~(acc & 0xffffUL);
 }
 
+/**
+ * Update a checksum after a 16-bit value it covers changed from 'old_val' to
+ * 'new_val' (RFC 1624, eqn. 3), instead of summing all the data again.
+ * 'old_val' and 'new_val' may also be sums (~inet_chksum()) over a block of
+ * changed data (e.g. a whole header) that starts at an even offset.
+ *
+ * @param chksum checksum as stored in the protocol header
+ * @param old_val previous value, network byte order
+ * @param new_val new value, network byte order
+ * @return updated checksum (as u16_t) to be saved directly in the protocol header
+ */
+u16_t
+inet_chksum_adjust(u16_t chksum, u16_t old_val, u16_t new_val)
+{
+  u32_t acc = (u32_t)(u16_t)~chksum + (u16_t)~old_val + new_val;
+  acc = FOLD_U32T(acc);
+  acc = FOLD_U32T(acc);
+  return (u16_t)~acc;
+}
+
+/**
+ * Same as inet_chksum_adjust() for a 32-bit value (e.g. a TCP sequence number
+ * or an IPv4 address) at an even offset.
+ *
+ * @param chksum checksum as stored in the protocol header
+ * @param old_val previous value, network byte order
+ * @param new_val new value, network byte order
+ * @return updated checksum (as u16_t) to be saved directly in the protocol header
+ */
+u16_t
+inet_chksum_adjust32(u16_t chksum, u32_t old_val, u32_t new_val)
+{
+  u32_t acc = (u32_t)(u16_t)~chksum;
+  acc += (~old_val & 0xffffUL) + (~old_val >> 16);
+  acc += (new_val & 0xffffUL) + (new_val >> 16);
+  acc = FOLD_U32T(acc);
+  acc = FOLD_U32T(acc);
+  return (u16_t)~acc;
+}
+
 /* These are some implementations for LWIP_CHKSUM_COPY, which copies data
  * like MEMCPY but generates a checksum at the same time. Since this is a
  * performance-sensitive function, you might want to create your own version
@@ -607,3 +1065,60 @@ lwip_chksum_copy(void *dst, const void *src, u16_t len)
   return LWIP_CHKSUM(dst, len);
 }
 #endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 1) */
+
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2) /* Version #2 */
+#if (LWIP_CHKSUM_ALGORITHM != 4)
+#error "LWIP_CHKSUM_COPY_ALGORITHM 2 needs LWIP_CHKSUM_ALGORITHM 4"
+#endif
+/** Single pass: the bulk of the data is summed while it is copied, using the
+ * kernels of LWIP_CHKSUM_ALGORITHM 4. Without SIMD, this needs src and dst to
+ * have the same alignment; otherwise it falls back to MEMCPY + LWIP_CHKSUM.
+ */
+u16_t
+lwip_chksum_copy(void *dst, const void *src, u16_t len)
+{
+  u8_t *pd = (u8_t *)dst;
+  const u8_t *ps = (const u8_t *)src;
+  u16_t head = 0, bulk, rest;
+  u32_t acc = 0, part;
+
+#if LWIP_CHKSUM_COPY_ALIGN
+  if (((mem_ptr_t)pd ^ (mem_ptr_t)ps) & (LWIP_CHKSUM_COPY_ALIGN - 1)) {
+    /* src and dst can never be aligned at the same time */
+    head = len;
+  } else {
+    head = (u16_t)(LWIP_CHKSUM_COPY_ALIGN - ((mem_ptr_t)ps & (LWIP_CHKSUM_COPY_ALIGN - 1)));
+    head &= (LWIP_CHKSUM_COPY_ALIGN - 1);
+    head = LWIP_MIN(head, len);
+  }
+  bulk = (u16_t)((len - head) & ~(LWIP_CHKSUM_COPY_ALIGN - 1));
+#else /* LWIP_CHKSUM_COPY_ALIGN */
+  bulk = (u16_t)(len & ~15);
+#endif /* LWIP_CHKSUM_COPY_ALIGN */
+  rest = (u16_t)(len - head - bulk);
+
+  if (head > 0) {
+    MEMCPY(pd, ps, head);
+    acc = LWIP_CHKSUM(pd, head);
+  }
+  /* bulk and rest start at an odd offset if head is odd */
+  if (bulk > 0) {
+    part = lwip_chksum_fold64(LWIP_CHKSUM_COPY_BULK(pd + head, ps + head, bulk));
+    if (head & 1) {
+      part = SWAP_BYTES_IN_WORD(part);
+    }
+    acc += part;
+  }
+  if (rest > 0) {
+    MEMCPY(pd + head + bulk, ps + head + bulk, rest);
+    part = LWIP_CHKSUM(pd + head + bulk, rest);
+    if (head & 1) {
+      part = SWAP_BYTES_IN_WORD(part);
+    }
+    acc += part;
+  }
+  acc = FOLD_U32T(acc);
+  acc = FOLD_U32T(acc);
+  return (u16_t)acc;
+}
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
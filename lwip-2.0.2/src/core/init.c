@@ -167,6 +167,12 @@ PACK_STRUCT_END
 #if (LWIP_TCP && TCP_LISTEN_BACKLOG && ((TCP_DEFAULT_LISTEN_BACKLOG < 0) || (TCP_DEFAULT_LISTEN_BACKLOG > 0xff)))
   #error "If you want to use TCP backlog, TCP_DEFAULT_LISTEN_BACKLOG must fit into an u8_t"
 #endif
+#if (LWIP_TCP && LWIP_TCP_DCTCP && !LWIP_TCP_ECN)
+  #error "If you want to use DCTCP, you have to define LWIP_TCP_ECN=1 in your lwipopts.h"
+#endif
+#if (LWIP_TCP && LWIP_TCP_TFO && !defined(LWIP_RAND) && !defined(LWIP_HOOK_TCP_TFO_COOKIE))
+  #error "If you want to use TCP Fast Open, your port has to define LWIP_RAND() (or lwipopts.h LWIP_HOOK_TCP_TFO_COOKIE)"
+#endif
 #if (LWIP_NETIF_API && (NO_SYS==1))
   #error "If you want to use NETIF API, you have to define NO_SYS=0 in your lwipopts.h"
 #endif
@@ -194,12 +200,45 @@ PACK_STRUCT_END
 #if (MEM_LIBC_MALLOC && MEM_USE_POOLS)
   #error "MEM_LIBC_MALLOC and MEM_USE_POOLS may not both be simultaneously enabled in your lwipopts.h"
 #endif
+#if (MEM_USE_SLAB && (MEM_LIBC_MALLOC || MEM_USE_POOLS))
+  #error "MEM_USE_SLAB may not be enabled together with MEM_LIBC_MALLOC or MEM_USE_POOLS in your lwipopts.h"
+#endif
+#if (MEM_USE_SLAB && (MEM_SLAB_PAGE_SIZE < 32 || (MEM_SLAB_PAGE_SIZE % MEM_ALIGNMENT) != 0 || MEM_SIZE < MEM_SLAB_PAGE_SIZE))
+  #error "MEM_USE_SLAB needs MEM_SLAB_PAGE_SIZE >= 32, a multiple of MEM_ALIGNMENT and not bigger than MEM_SIZE"
+#endif
+#if (MEM_ARENA && ((MEM_ARENA_CHUNK_SIZE % MEM_ALIGNMENT) != 0))
+  #error "MEM_ARENA_CHUNK_SIZE must be a multiple of MEM_ALIGNMENT"
+#endif
+#if (MEMP_MAGAZINE && MEMP_MEM_MALLOC)
+  #error "MEMP_MAGAZINE may not be enabled together with MEMP_MEM_MALLOC in your lwipopts.h"
+#endif
+#if (MEMP_MAGAZINE && (MEMP_MAGAZINE_SIZE < 1))
+  #error "MEMP_MAGAZINE_SIZE must be at least 1"
+#endif
+#if (MEMP_PRESSURE && (!MEMP_STATS || MEMP_MEM_MALLOC))
+  #error "MEMP_PRESSURE needs MEMP_STATS and may not be enabled together with MEMP_MEM_MALLOC in your lwipopts.h"
+#endif
+#if (MEMP_PRESSURE && ((MEMP_PRESSURE_LOWAT >= MEMP_PRESSURE_HIWAT) || (MEMP_PRESSURE_HIWAT > 100)))
+  #error "MEMP_PRESSURE_LOWAT must be below MEMP_PRESSURE_HIWAT, which may not exceed 100"
+#endif
+#if PBUF_ATOMIC_REF && (!defined __STDC_VERSION__ || (__STDC_VERSION__ < 201112L) || defined __STDC_NO_ATOMICS__)
+  #error "PBUF_ATOMIC_REF requires a C11 compiler with <stdatomic.h>"
+#endif
 #if (MEM_USE_POOLS && !MEMP_USE_CUSTOM_POOLS)
   #error "MEM_USE_POOLS requires custom pools (MEMP_USE_CUSTOM_POOLS) to be enabled in your lwipopts.h"
 #endif
 #if (PBUF_POOL_BUFSIZE <= MEM_ALIGNMENT)
   #error "PBUF_POOL_BUFSIZE must be greater than MEM_ALIGNMENT or the offset may take the full first pbuf"
 #endif
+#if (PBUF_POOL_CLASSES && PBUF_POOL_SMALL_SIZE && ((PBUF_POOL_SMALL_BUFSIZE <= LWIP_MEM_ALIGN_SIZE(PBUF_LINK_ENCAPSULATION_HLEN + PBUF_LINK_HLEN + PBUF_IP_HLEN + PBUF_TRANSPORT_HLEN)) || (PBUF_POOL_SMALL_BUFSIZE >= PBUF_POOL_BUFSIZE)))
+  #error "PBUF_POOL_SMALL_BUFSIZE must be bigger than the protocol headers and smaller than PBUF_POOL_BUFSIZE"
+#endif
+#if (PBUF_POOL_CLASSES && PBUF_POOL_JUMBO_SIZE && (PBUF_POOL_JUMBO_BUFSIZE <= PBUF_POOL_BUFSIZE))
+  #error "PBUF_POOL_JUMBO_BUFSIZE must be bigger than PBUF_POOL_BUFSIZE"
+#endif
+#if (PBUF_POOL_CLASSES && PBUF_POOL_HUGE_SIZE && ((PBUF_POOL_HUGE_BUFSIZE <= PBUF_POOL_BUFSIZE) || (PBUF_POOL_JUMBO_SIZE && (PBUF_POOL_HUGE_BUFSIZE <= PBUF_POOL_JUMBO_BUFSIZE)) || (PBUF_POOL_HUGE_BUFSIZE > 65000)))
+  #error "PBUF_POOL_HUGE_BUFSIZE must be bigger than PBUF_POOL_BUFSIZE and PBUF_POOL_JUMBO_BUFSIZE and at most 65000"
+#endif
 #if (DNS_LOCAL_HOSTLIST && !DNS_LOCAL_HOSTLIST_IS_DYNAMIC && !(defined(DNS_LOCAL_HOSTLIST_INIT)))
   #error "you have to define define DNS_LOCAL_HOSTLIST_INIT {{'host1', 0x123}, {'host2', 0x234}} to initialize DNS_LOCAL_HOSTLIST"
 #endif
@@ -121,4 +121,43 @@ ip_input(struct pbuf *p, struct netif *inp)
 
 #endif /* LWIP_IPV4 && LWIP_IPV6 */
 
+#if LWIP_SO_REUSEPORT
+/**
+ * Weight of a member of a SO_REUSEPORT group for a remote address and port.
+ * Traffic goes to the member with the highest weight (rendezvous hashing),
+ * which does not depend on the order of the pcb lists.
+ *
+ * @param pcb the group member
+ * @param remote_ip remote address of the datagram or connection
+ * @param remote_port remote port of the datagram or connection
+ * @return the weight of pcb, distinct for all pcbs
+ */
+u32_t
+ip_reuseport_weight(const void *pcb, const ip_addr_t *remote_ip, u16_t remote_port)
+{
+  u32_t h = remote_port;
+
+#if LWIP_IPV6
+  if (IP_IS_V6(remote_ip)) {
+    const ip6_addr_t *addr6 = ip_2_ip6(remote_ip);
+    h ^= addr6->addr[0] ^ addr6->addr[1] ^ addr6->addr[2] ^ addr6->addr[3];
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4
+  if (!IP_IS_V6(remote_ip)) {
+    h ^= ip4_addr_get_u32(ip_2_ip4(remote_ip));
+  }
+#endif /* LWIP_IPV4 */
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  /* both mixing steps are invertible: no two pcbs get the same weight */
+  h ^= (u32_t)(mem_ptr_t)pcb;
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  return h;
+}
+#endif /* LWIP_SO_REUSEPORT */
+
 #endif /* LWIP_IPV4 || LWIP_IPV6 */
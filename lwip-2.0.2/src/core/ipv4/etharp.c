@@ -53,6 +53,9 @@
 #include "lwip/dhcp.h"
 #include "lwip/autoip.h"
 #include "netif/ethernet.h"
+#if LWIP_IPV4_FIB
+#include "lwip/ip4_fib.h"
+#endif /* LWIP_IPV4_FIB */
 
 #include <string.h>
 
@@ -101,14 +104,35 @@ struct etharp_entry {
   struct eth_addr ethaddr;
   u16_t ctime;
   u8_t state;
+#if ETHARP_TABLE_HASH_SIZE
+  /** next entry in the same hash bucket or the free list (index + 1) */
+  u16_t hash_next;
+  /** neighbours in the LRU list of dynamic entries (index + 1) */
+  u16_t lru_prev;
+  u16_t lru_next;
+#endif /* ETHARP_TABLE_HASH_SIZE */
 };
 
 static struct etharp_entry arp_table[ARP_TABLE_SIZE];
 
 #if !LWIP_NETIF_HWADDRHINT
-static u8_t etharp_cached_entry;
+static u16_t etharp_cached_entry;
 #endif /* !LWIP_NETIF_HWADDRHINT */
 
+#if ETHARP_TABLE_HASH_SIZE
+/* ARP table index: hash buckets, LRU list of dynamic entries (most recently
+   used first), free list and the number of entries used so far (all indices
+   + 1, 0 means none). */
+static u16_t etharp_hash_table[ETHARP_TABLE_HASH_SIZE];
+static u16_t etharp_lru_head;
+static u16_t etharp_lru_tail;
+static u16_t etharp_free_list;
+static u16_t etharp_used;
+
+/** Hash bucket of an IP address */
+#define ETHARP_HASH(ipaddr) etharp_hash(ip4_addr_get_u32(ipaddr))
+#endif /* ETHARP_TABLE_HASH_SIZE */
+
 /** Try hard to create a new entry - we want the IP address to appear in
     the cache (even if this means removing an active entry or so). */
 #define ETHARP_FLAG_TRY_HARD     1
@@ -126,8 +150,15 @@ static u8_t etharp_cached_entry;
 
 
 /* Some checks, instead of etharp_init(): */
-#if (LWIP_ARP && (ARP_TABLE_SIZE > 0x7f))
-  #error "ARP_TABLE_SIZE must fit in an s8_t, you have to reduce it in your lwipopts.h"
+#if ETHARP_TABLE_HASH_SIZE
+#if (ETHARP_TABLE_HASH_SIZE & (ETHARP_TABLE_HASH_SIZE - 1))
+  #error "ETHARP_TABLE_HASH_SIZE must be a power of two"
+#endif
+#if (LWIP_ARP && (ARP_TABLE_SIZE > 0x7fff))
+  #error "ARP_TABLE_SIZE must fit in an s16_t, you have to reduce it in your lwipopts.h"
+#endif
+#elif (LWIP_ARP && (ARP_TABLE_SIZE > 0x7f))
+  #error "ARP_TABLE_SIZE must fit in an s8_t, you have to reduce it in your lwipopts.h (or set ETHARP_TABLE_HASH_SIZE)"
 #endif
 
 
@@ -165,6 +196,86 @@ free_etharp_q(struct etharp_q_entry *q)
 
 #endif /* ARP_QUEUEING */
 
+#if ETHARP_TABLE_HASH_SIZE
+/** Hash an IPv4 address (network order) to a bucket of etharp_hash_table */
+static u16_t
+etharp_hash(u32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  return (u16_t)(h & (ETHARP_TABLE_HASH_SIZE - 1));
+}
+
+/** Remove an entry from the LRU list if it is on it */
+static void
+etharp_lru_remove(u16_t i)
+{
+  struct etharp_entry *entry = &arp_table[i];
+  if ((entry->lru_prev == 0) && (etharp_lru_head != (u16_t)(i + 1))) {
+    /* not on the list */
+    return;
+  }
+  if (entry->lru_prev != 0) {
+    arp_table[entry->lru_prev - 1].lru_next = entry->lru_next;
+  } else {
+    etharp_lru_head = entry->lru_next;
+  }
+  if (entry->lru_next != 0) {
+    arp_table[entry->lru_next - 1].lru_prev = entry->lru_prev;
+  } else {
+    etharp_lru_tail = entry->lru_prev;
+  }
+  entry->lru_prev = entry->lru_next = 0;
+}
+
+/**
+ * Mark an entry as most recently used. Static entries are never recycled,
+ * so they are kept off the LRU list.
+ *
+ * @param i the ARP table index
+ */
+static void
+etharp_touch_entry(u16_t i)
+{
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+  if (arp_table[i].state == ETHARP_STATE_STATIC) {
+    etharp_lru_remove(i);
+    return;
+  }
+#endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
+  if (etharp_lru_head == (u16_t)(i + 1)) {
+    return;
+  }
+  etharp_lru_remove(i);
+  arp_table[i].lru_prev = 0;
+  arp_table[i].lru_next = etharp_lru_head;
+  if (etharp_lru_head != 0) {
+    arp_table[etharp_lru_head - 1].lru_prev = (u16_t)(i + 1);
+  } else {
+    etharp_lru_tail = (u16_t)(i + 1);
+  }
+  etharp_lru_head = (u16_t)(i + 1);
+}
+
+/** Remove an entry from its hash bucket */
+static void
+etharp_hash_remove(u16_t i)
+{
+  u16_t *link = &etharp_hash_table[ETHARP_HASH(&arp_table[i].ipaddr)];
+  while (*link != 0) {
+    if (*link == (u16_t)(i + 1)) {
+      *link = arp_table[i].hash_next;
+      break;
+    }
+    link = &arp_table[*link - 1].hash_next;
+  }
+  arp_table[i].hash_next = 0;
+}
+#else /* ETHARP_TABLE_HASH_SIZE */
+#define etharp_touch_entry(i)
+#endif /* ETHARP_TABLE_HASH_SIZE */
+
 /** Clean up ARP table entries */
 static void
 etharp_free_entry(int i)
@@ -178,6 +289,13 @@ etharp_free_entry(int i)
     free_etharp_q(arp_table[i].q);
     arp_table[i].q = NULL;
   }
+#if ETHARP_TABLE_HASH_SIZE
+  /* unindex the entry and put it on the free list */
+  etharp_hash_remove((u16_t)i);
+  etharp_lru_remove((u16_t)i);
+  arp_table[i].hash_next = etharp_free_list;
+  etharp_free_list = (u16_t)(i + 1);
+#endif /* ETHARP_TABLE_HASH_SIZE */
   /* recycle entry for re-use */
   arp_table[i].state = ETHARP_STATE_EMPTY;
 #ifdef LWIP_DEBUG
@@ -198,11 +316,22 @@ etharp_free_entry(int i)
 void
 etharp_tmr(void)
 {
+#if ETHARP_TABLE_HASH_SIZE
+  u16_t i, next;
+#else /* ETHARP_TABLE_HASH_SIZE */
   u8_t i;
+#endif /* ETHARP_TABLE_HASH_SIZE */
 
   LWIP_DEBUGF(ETHARP_DEBUG, ("etharp_timer\n"));
   /* remove expired entries from the ARP table */
+#if ETHARP_TABLE_HASH_SIZE
+  /* only dynamic entries are on the LRU list, no need to visit empty ones */
+  for (next = etharp_lru_head; next != 0; ) {
+    i = (u16_t)(next - 1);
+    next = arp_table[i].lru_next;
+#else /* ETHARP_TABLE_HASH_SIZE */
   for (i = 0; i < ARP_TABLE_SIZE; ++i) {
+#endif /* ETHARP_TABLE_HASH_SIZE */
     u8_t state = arp_table[i].state;
     if (state != ETHARP_STATE_EMPTY
 #if ETHARP_SUPPORT_STATIC_ENTRIES
@@ -251,12 +380,71 @@ etharp_tmr(void)
  * @param flags See @ref etharp_state
  * @param netif netif related to this address (used for NETIF_HWADDRHINT)
  *
+ * With ETHARP_TABLE_HASH_SIZE, the address is looked up in its hash bucket
+ * and the least recently used dynamic entry is recycled instead.
+ *
  * @return The ARP entry index that matched or is created, ERR_MEM if no
  * entry is found or could be recycled.
  */
-static s8_t
+static s16_t
 etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif* netif)
 {
+#if ETHARP_TABLE_HASH_SIZE
+  u16_t i;
+
+  LWIP_UNUSED_ARG(netif);
+
+  if (ipaddr != NULL) {
+    for (i = etharp_hash_table[ETHARP_HASH(ipaddr)]; i != 0; i = arp_table[i - 1].hash_next) {
+      if (ip4_addr_cmp(ipaddr, &arp_table[i - 1].ipaddr)
+#if ETHARP_TABLE_MATCH_NETIF
+          && ((netif == NULL) || (netif == arp_table[i - 1].netif))
+#endif /* ETHARP_TABLE_MATCH_NETIF */
+        ) {
+        LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_find_entry: found matching entry %"U16_F"\n", (u16_t)(i - 1)));
+        return (s16_t)(i - 1);
+      }
+    }
+  }
+
+  if ((flags & ETHARP_FLAG_FIND_ONLY) != 0) {
+    return (s16_t)ERR_MEM;
+  }
+  if ((etharp_free_list == 0) && (etharp_used >= ARP_TABLE_SIZE)) {
+    /* table full: recycle the least recently used dynamic entry */
+    if (((flags & ETHARP_FLAG_TRY_HARD) == 0) || (etharp_lru_tail == 0)) {
+      LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_find_entry: no empty entry found and not allowed to recycle\n"));
+      return (s16_t)ERR_MEM;
+    }
+    LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_find_entry: recycling least recently used entry %"U16_F"\n", (u16_t)(etharp_lru_tail - 1)));
+    etharp_free_entry(etharp_lru_tail - 1);
+  }
+  if (etharp_free_list != 0) {
+    i = (u16_t)(etharp_free_list - 1);
+    etharp_free_list = arp_table[i].hash_next;
+    arp_table[i].hash_next = 0;
+  } else {
+    /* take a never used entry */
+    i = etharp_used++;
+  }
+
+  LWIP_ASSERT("arp_table[i].state == ETHARP_STATE_EMPTY",
+    arp_table[i].state == ETHARP_STATE_EMPTY);
+
+  /* IP address given? */
+  if (ipaddr != NULL) {
+    u16_t bucket = ETHARP_HASH(ipaddr);
+    /* set IP address and enter it into the hash table */
+    ip4_addr_copy(arp_table[i].ipaddr, *ipaddr);
+    arp_table[i].hash_next = etharp_hash_table[bucket];
+    etharp_hash_table[bucket] = (u16_t)(i + 1);
+  }
+  arp_table[i].ctime = 0;
+#if ETHARP_TABLE_MATCH_NETIF
+  arp_table[i].netif = netif;
+#endif /* ETHARP_TABLE_MATCH_NETIF*/
+  return (s16_t)i;
+#else /* ETHARP_TABLE_HASH_SIZE */
   s8_t old_pending = ARP_TABLE_SIZE, old_stable = ARP_TABLE_SIZE;
   s8_t empty = ARP_TABLE_SIZE;
   u8_t i = 0;
@@ -400,6 +588,7 @@ etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif* netif)
   arp_table[i].netif = netif;
 #endif /* ETHARP_TABLE_MATCH_NETIF*/
   return (err_t)i;
+#endif /* ETHARP_TABLE_HASH_SIZE */
 }
 
 /**
@@ -423,7 +612,7 @@ etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif* netif)
 static err_t
 etharp_update_arp_entry(struct netif *netif, const ip4_addr_t *ipaddr, struct eth_addr *ethaddr, u8_t flags)
 {
-  s8_t i;
+  s16_t i;
   LWIP_ASSERT("netif->hwaddr_len == ETH_HWADDR_LEN", netif->hwaddr_len == ETH_HWADDR_LEN);
   LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_update_arp_entry: %"U16_F".%"U16_F".%"U16_F".%"U16_F" - %02"X16_F":%02"X16_F":%02"X16_F":%02"X16_F":%02"X16_F":%02"X16_F"\n",
     ip4_addr1_16(ipaddr), ip4_addr2_16(ipaddr), ip4_addr3_16(ipaddr), ip4_addr4_16(ipaddr),
@@ -467,6 +656,7 @@ etharp_update_arp_entry(struct netif *netif, const ip4_addr_t *ipaddr, struct et
   ETHADDR32_COPY(&arp_table[i].ethaddr, ethaddr);
   /* reset time stamp */
   arp_table[i].ctime = 0;
+  etharp_touch_entry(i);
   /* this is where we will send out queued packets! */
 #if ARP_QUEUEING
   while (arp_table[i].q != NULL) {
@@ -529,7 +719,7 @@ etharp_add_static_entry(const ip4_addr_t *ipaddr, struct eth_addr *ethaddr)
 err_t
 etharp_remove_static_entry(const ip4_addr_t *ipaddr)
 {
-  s8_t i;
+  s16_t i;
   LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_remove_static_entry: %"U16_F".%"U16_F".%"U16_F".%"U16_F"\n",
     ip4_addr1_16(ipaddr), ip4_addr2_16(ipaddr), ip4_addr3_16(ipaddr), ip4_addr4_16(ipaddr)));
 
@@ -558,7 +748,7 @@ etharp_remove_static_entry(const ip4_addr_t *ipaddr)
 void
 etharp_cleanup_netif(struct netif *netif)
 {
-  u8_t i;
+  u16_t i;
 
   for (i = 0; i < ARP_TABLE_SIZE; ++i) {
     u8_t state = arp_table[i].state;
@@ -579,11 +769,11 @@ etharp_cleanup_netif(struct netif *netif)
  * @param ip_ret points to return pointer
  * @return table index if found, -1 otherwise
  */
-s8_t
+s16_t
 etharp_find_addr(struct netif *netif, const ip4_addr_t *ipaddr,
          struct eth_addr **eth_ret, const ip4_addr_t **ip_ret)
 {
-  s8_t i;
+  s16_t i;
 
   LWIP_ASSERT("eth_ret != NULL && ip_ret != NULL",
     eth_ret != NULL && ip_ret != NULL);
@@ -609,7 +799,7 @@ etharp_find_addr(struct netif *netif, const ip4_addr_t *ipaddr,
  * @return 1 on valid index, 0 otherwise
  */
 u8_t
-etharp_get_entry(u8_t i, ip4_addr_t **ipaddr, struct netif **netif, struct eth_addr **eth_ret)
+etharp_get_entry(u16_t i, ip4_addr_t **ipaddr, struct netif **netif, struct eth_addr **eth_ret)
 {
   LWIP_ASSERT("ipaddr != NULL", ipaddr != NULL);
   LWIP_ASSERT("netif != NULL", netif != NULL);
@@ -741,12 +931,19 @@ etharp_input(struct pbuf *p, struct netif *netif)
 
 /** Just a small helper function that sends a pbuf to an ethernet address
  * in the arp_table specified by the index 'arp_idx'.
+ * Also used by the IPv4 forwarding flow cache, which validates the entry
+ * via etharp_get_entry() first.
  */
+#if IP_FORWARD && IP_FORWARD_FLOW_CACHE_SIZE && LWIP_NETIF_HWADDRHINT
+err_t
+#else /* IP_FORWARD && IP_FORWARD_FLOW_CACHE_SIZE && LWIP_NETIF_HWADDRHINT */
 static err_t
-etharp_output_to_arp_index(struct netif *netif, struct pbuf *q, u8_t arp_idx)
+#endif /* IP_FORWARD && IP_FORWARD_FLOW_CACHE_SIZE && LWIP_NETIF_HWADDRHINT */
+etharp_output_to_arp_index(struct netif *netif, struct pbuf *q, u16_t arp_idx)
 {
   LWIP_ASSERT("arp_table[arp_idx].state >= ETHARP_STATE_STABLE",
               arp_table[arp_idx].state >= ETHARP_STATE_STABLE);
+  etharp_touch_entry(arp_idx);
   /* if arp table entry is about to expire: re-request it,
      but only if its state is ETHARP_STATE_STABLE to prevent flooding the
      network with ARP requests if this address is used frequently. */
@@ -816,7 +1013,7 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
     dest = &mcastaddr;
   /* unicast destination IP address? */
   } else {
-    s8_t i;
+    s16_t i;
     /* outside local network? if so, this can neither be a global broadcast nor
        a subnet broadcast. */
     if (!ip4_addr_netcmp(ipaddr, netif_ip4_addr(netif), netif_ip4_netmask(netif)) &&
@@ -836,6 +1033,14 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
         dst_addr = LWIP_HOOK_ETHARP_GET_GW(netif, ipaddr);
         if (dst_addr == NULL)
 #endif /* LWIP_HOOK_ETHARP_GET_GW */
+#if LWIP_IPV4_FIB
+        {
+          /* next hop of the route the packet was sent on (normally
+             remembered from the ip4_route() call for this packet) */
+          dst_addr = ip4_fib_gateway(netif, ipaddr);
+        }
+        if (dst_addr == NULL)
+#endif /* LWIP_IPV4_FIB */
         {
           /* interface has default gateway? */
           if (!ip4_addr_isany_val(*netif_ip4_gw(netif))) {
@@ -852,7 +1057,7 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
 #if LWIP_NETIF_HWADDRHINT
     if (netif->addr_hint != NULL) {
       /* per-pcb cached entry was given */
-      u8_t etharp_cached_entry = *(netif->addr_hint);
+      u16_t etharp_cached_entry = *(netif->addr_hint);
       if (etharp_cached_entry < ARP_TABLE_SIZE) {
 #endif /* LWIP_NETIF_HWADDRHINT */
         if ((arp_table[etharp_cached_entry].state >= ETHARP_STATE_STABLE) &&
@@ -869,6 +1074,14 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
     }
 #endif /* LWIP_NETIF_HWADDRHINT */
 
+#if ETHARP_TABLE_HASH_SIZE
+    /* the hashed lookup is cheap enough for the critical path */
+    i = etharp_find_entry(dst_addr, ETHARP_FLAG_FIND_ONLY, netif);
+    if ((i >= 0) && (arp_table[i].state >= ETHARP_STATE_STABLE)) {
+      ETHARP_SET_HINT(netif, (u16_t)i);
+      return etharp_output_to_arp_index(netif, q, (u16_t)i);
+    }
+#else /* ETHARP_TABLE_HASH_SIZE */
     /* find stable entry: do this here since this is a critical path for
        throughput and etharp_find_entry() is kind of slow */
     for (i = 0; i < ARP_TABLE_SIZE; i++) {
@@ -882,6 +1095,7 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
         return etharp_output_to_arp_index(netif, q, i);
       }
     }
+#endif /* ETHARP_TABLE_HASH_SIZE */
     /* no stable entry found, use the (slower) query function:
        queue on destination Ethernet address belonging to ipaddr */
     return etharp_query(netif, dst_addr, q);
@@ -932,7 +1146,7 @@ etharp_query(struct netif *netif, const ip4_addr_t *ipaddr, struct pbuf *q)
   struct eth_addr * srcaddr = (struct eth_addr *)netif->hwaddr;
   err_t result = ERR_MEM;
   int is_new_entry = 0;
-  s8_t i; /* ARP entry index */
+  s16_t i; /* ARP entry index */
 
   /* non-unicast address? */
   if (ip4_addr_isbroadcast(ipaddr, netif) ||
@@ -961,6 +1175,7 @@ etharp_query(struct netif *netif, const ip4_addr_t *ipaddr, struct pbuf *q)
     arp_table[i].state = ETHARP_STATE_PENDING;
     /* record network interface for re-sending arp request in etharp_tmr */
     arp_table[i].netif = netif;
+    etharp_touch_entry(i);
   }
 
   /* { i is either a STABLE or (new or existing) PENDING entry } */
@@ -989,6 +1204,7 @@ etharp_query(struct netif *netif, const ip4_addr_t *ipaddr, struct pbuf *q)
   if (arp_table[i].state >= ETHARP_STATE_STABLE) {
     /* we have a valid IP->Ethernet address mapping */
     ETHARP_SET_HINT(netif, i);
+    etharp_touch_entry(i);
     /* send the packet */
     result = ethernet_output(netif, q, srcaddr, &(arp_table[i].ethaddr), ETHTYPE_IP);
   /* pending entry? (either just created or already pending */
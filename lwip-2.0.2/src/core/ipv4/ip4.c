@@ -56,6 +56,12 @@
 #include "lwip/autoip.h"
 #include "lwip/stats.h"
 #include "lwip/prot/dhcp.h"
+#if LWIP_IPV4_FIB
+#include "lwip/ip4_fib.h"
+#endif /* LWIP_IPV4_FIB */
+#if IP_FORWARD && IP_FORWARD_FLOW_CACHE_SIZE
+#include "lwip/etharp.h"
+#endif /* IP_FORWARD && IP_FORWARD_FLOW_CACHE_SIZE */
 
 #include <string.h>
 
@@ -140,10 +146,11 @@ ip4_route_src(const ip4_addr_t *dest, const ip4_addr_t *src)
 #endif /* LWIP_HOOK_IP4_ROUTE_SRC */
 
 /**
- * Finds the appropriate network interface for a given IP address. It
- * searches the list of network interfaces linearly. A match is found
- * if the masked IP address of the network interface equals the masked
- * IP address given to the function.
+ * Finds the appropriate network interface for a given IP address. With
+ * LWIP_IPV4_FIB, this is the longest prefix match in the forwarding table
+ * (see ip4_fib_lookup()). Otherwise, the list of network interfaces is
+ * searched linearly and a match is found if the masked IP address of the
+ * network interface equals the masked IP address given to the function.
  *
  * @param dest the destination IP address for which to find the route
  * @return the netif on which to send to reach dest
@@ -160,6 +167,17 @@ ip4_route(const ip4_addr_t *dest)
   }
 #endif /* LWIP_MULTICAST_TX_OPTIONS */
 
+#if LWIP_IPV4_FIB
+  {
+    /* longest prefix match over the connected and static routes */
+    struct ip4_fib_entry *route = ip4_fib_lookup(dest);
+    if (route != NULL) {
+      /* return netif on which to forward IP packet */
+      netif = route->netif;
+      return netif;
+    }
+  }
+#else /* LWIP_IPV4_FIB */
   /* iterate through netifs */
   for (netif = netif_list; netif != NULL; netif = netif->next) {
     /* is the netif up, does it have a link and a valid address? */
@@ -176,6 +194,7 @@ ip4_route(const ip4_addr_t *dest)
       }
     }
   }
+#endif /* LWIP_IPV4_FIB */
 
 #if LWIP_NETIF_LOOPBACK && !LWIP_HAVE_LOOPIF
   /* loopif is disabled, looopback traffic is passed through any netif */
@@ -255,6 +274,136 @@ ip4_canforward(struct pbuf *p)
   return 1;
 }
 
+#if IP_FORWARD_FLOW_CACHE_SIZE
+#if !LWIP_IPV4_FIB
+#error IP_FORWARD_FLOW_CACHE_SIZE needs LWIP_IPV4_FIB
+#endif
+#if (IP_FORWARD_FLOW_CACHE_SIZE & (IP_FORWARD_FLOW_CACHE_SIZE - 1)) != 0
+#error IP_FORWARD_FLOW_CACHE_SIZE must be a power of two
+#endif
+
+/** Ethernet netifs can send to the cached ARP entry of the next hop */
+#define IP4_FLOW_CACHE_ARP      (LWIP_ARP && LWIP_NETIF_HWADDRHINT)
+
+/** A cached forwarding decision */
+struct ip4_flow {
+  ip4_addr_t src;
+  ip4_addr_t dest;
+  /** the netif to send on (NULL: no route), valid while gen equals ip4_fib_gen */
+  struct netif *netif;
+  u32_t gen;
+#if IP4_FLOW_CACHE_ARP
+  /** the address etharp_output() resolves for dest (any: none) */
+  ip4_addr_t nexthop;
+  /** ARP entry hint updated by etharp_output(), only trusted while the
+      entry still holds nexthop */
+  u16_t arp_idx;
+#endif /* IP4_FLOW_CACHE_ARP */
+};
+
+static struct ip4_flow ip4_flows[IP_FORWARD_FLOW_CACHE_SIZE];
+
+#if IP4_FLOW_CACHE_ARP
+/**
+ * Determine the next hop of a flow the same way etharp_output() does: the
+ * destination itself if it is on the link, the gateway of its route or the
+ * default gateway of the netif otherwise.
+ *
+ * @param flow the flow cache entry (with a netif)
+ */
+static void
+ip4_flow_nexthop(struct ip4_flow *flow)
+{
+  const ip4_addr_t *nexthop = &flow->dest;
+
+  if (!ip4_addr_netcmp(&flow->dest, netif_ip4_addr(flow->netif), netif_ip4_netmask(flow->netif)) &&
+      !ip4_addr_islinklocal(&flow->dest)) {
+#ifdef LWIP_HOOK_ETHARP_GET_GW
+    nexthop = LWIP_HOOK_ETHARP_GET_GW(flow->netif, &flow->dest);
+    if (nexthop == NULL)
+#endif /* LWIP_HOOK_ETHARP_GET_GW */
+    {
+      nexthop = ip4_fib_gateway(flow->netif, &flow->dest);
+      if (nexthop == NULL) {
+        nexthop = netif_ip4_gw(flow->netif);
+      }
+    }
+  }
+  ip4_addr_copy(flow->nexthop, *nexthop);
+}
+#endif /* IP4_FLOW_CACHE_ARP */
+
+/**
+ * Find the forwarding decision for a pair of addresses. Stale or colliding
+ * entries are overwritten by a fresh route lookup.
+ *
+ * @param src source address of the packet to forward
+ * @param dest destination address of the packet to forward
+ * @return the flow cache entry, netif is NULL if there is no route
+ */
+static struct ip4_flow *
+ip4_flow_lookup(const ip4_addr_t *src, const ip4_addr_t *dest)
+{
+  struct ip4_flow *flow;
+  u32_t d = ip4_addr_get_u32(dest);
+  /* rotate one address so both directions of a flow use different slots */
+  u32_t h = ip4_addr_get_u32(src) ^ ((d << 16) | (d >> 16));
+
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  flow = &ip4_flows[h & (IP_FORWARD_FLOW_CACHE_SIZE - 1)];
+  if ((flow->netif != NULL) && (flow->gen == ip4_fib_gen) &&
+      ip4_addr_cmp(&flow->dest, dest) && ip4_addr_cmp(&flow->src, src) &&
+      netif_is_up(flow->netif) && netif_is_link_up(flow->netif)) {
+    return flow;
+  }
+  ip4_addr_copy(flow->src, *src);
+  ip4_addr_copy(flow->dest, *dest);
+  flow->netif = ip4_route_src(dest, src);
+  flow->gen = ip4_fib_gen;
+#if IP4_FLOW_CACHE_ARP
+  if (flow->netif != NULL) {
+    ip4_flow_nexthop(flow);
+  }
+  flow->arp_idx = ARP_TABLE_SIZE;
+#endif /* IP4_FLOW_CACHE_ARP */
+  return flow;
+}
+
+#if IP4_FLOW_CACHE_ARP
+/**
+ * Send a forwarded packet on an etharp_output() netif. If the ARP entry of
+ * the flow still resolves its next hop, the packet goes straight to
+ * ethernet_output(); otherwise etharp_output() resolves the next hop and
+ * updates the entry hint of the flow. An entry recycled for another
+ * address is never trusted, even if it is stable.
+ *
+ * @param flow the flow cache entry of the packet
+ * @param netif the netif to send on
+ * @param p the packet to send (p->payload points to IP header)
+ */
+static void
+ip4_flow_output(struct ip4_flow *flow, struct netif *netif, struct pbuf *p)
+{
+  ip4_addr_t *ipaddr;
+  struct netif *arp_netif;
+  struct eth_addr *ethaddr;
+
+  if (etharp_get_entry(flow->arp_idx, &ipaddr, &arp_netif, &ethaddr) &&
+      (arp_netif == netif) && ip4_addr_cmp(ipaddr, &flow->nexthop)) {
+    etharp_output_to_arp_index(netif, p, flow->arp_idx);
+    return;
+  }
+  /* etharp_output() only sets the hint to a stable entry of the next hop */
+  flow->arp_idx = ARP_TABLE_SIZE;
+  NETIF_SET_HWADDRHINT(netif, &flow->arp_idx);
+  netif->output(netif, p, ip4_current_dest_addr());
+  NETIF_SET_HWADDRHINT(netif, NULL);
+}
+#endif /* IP4_FLOW_CACHE_ARP */
+#endif /* IP_FORWARD_FLOW_CACHE_SIZE */
+
 /**
  * Forwards an IP packet. It finds an appropriate route for the
  * packet, decrements the TTL value of the packet, adjusts the
@@ -268,6 +417,9 @@ static void
 ip4_forward(struct pbuf *p, struct ip_hdr *iphdr, struct netif *inp)
 {
   struct netif *netif;
+#if IP_FORWARD_FLOW_CACHE_SIZE
+  struct ip4_flow *flow;
+#endif /* IP_FORWARD_FLOW_CACHE_SIZE */
 
   PERF_START;
   LWIP_UNUSED_ARG(inp);
@@ -285,7 +437,12 @@ ip4_forward(struct pbuf *p, struct ip_hdr *iphdr, struct netif *inp)
   }
 
   /* Find network interface where to forward this IP packet to. */
+#if IP_FORWARD_FLOW_CACHE_SIZE
+  flow = ip4_flow_lookup(ip4_current_src_addr(), ip4_current_dest_addr());
+  netif = flow->netif;
+#else /* IP_FORWARD_FLOW_CACHE_SIZE */
   netif = ip4_route_src(ip4_current_dest_addr(), ip4_current_src_addr());
+#endif /* IP_FORWARD_FLOW_CACHE_SIZE */
   if (netif == NULL) {
     LWIP_DEBUGF(IP_DEBUG, ("ip4_forward: no forwarding route for %"U16_F".%"U16_F".%"U16_F".%"U16_F" found\n",
       ip4_addr1_16(ip4_current_dest_addr()), ip4_addr2_16(ip4_current_dest_addr()),
@@ -316,12 +473,9 @@ ip4_forward(struct pbuf *p, struct ip_hdr *iphdr, struct netif *inp)
     return;
   }
 
-  /* Incrementally update the IP checksum. */
-  if (IPH_CHKSUM(iphdr) >= PP_HTONS(0xffffU - 0x100)) {
-    IPH_CHKSUM_SET(iphdr, IPH_CHKSUM(iphdr) + PP_HTONS(0x100) + 1);
-  } else {
-    IPH_CHKSUM_SET(iphdr, IPH_CHKSUM(iphdr) + PP_HTONS(0x100));
-  }
+  /* Incrementally update the IP checksum (TTL is the upper byte of its word). */
+  IPH_CHKSUM_SET(iphdr, inet_chksum_adjust(IPH_CHKSUM(iphdr),
+    lwip_htons((u16_t)((IPH_TTL(iphdr) + 1) << 8)), lwip_htons((u16_t)(IPH_TTL(iphdr) << 8))));
 
   LWIP_DEBUGF(IP_DEBUG, ("ip4_forward: forwarding packet to %"U16_F".%"U16_F".%"U16_F".%"U16_F"\n",
     ip4_addr1_16(ip4_current_dest_addr()), ip4_addr2_16(ip4_current_dest_addr()),
@@ -349,6 +503,12 @@ ip4_forward(struct pbuf *p, struct ip_hdr *iphdr, struct netif *inp)
     return;
   }
   /* transmit pbuf on chosen interface */
+#if IP_FORWARD_FLOW_CACHE_SIZE && IP4_FLOW_CACHE_ARP
+  if (netif->output == etharp_output) {
+    ip4_flow_output(flow, netif, p);
+    return;
+  }
+#endif /* IP_FORWARD_FLOW_CACHE_SIZE && IP4_FLOW_CACHE_ARP */
   netif->output(netif, p, ip4_current_dest_addr());
   return;
 return_noroute:
@@ -442,7 +602,7 @@ ip4_input(struct pbuf *p, struct netif *inp)
   /* verify checksum */
 #if CHECKSUM_CHECK_IP
   IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_IP) {
-    if (inet_chksum(iphdr, iphdr_hlen) != 0) {
+    if (!PBUF_CHKSUM_VERIFIED(p) && (inet_chksum(iphdr, iphdr_hlen) != 0)) {
 
       LWIP_DEBUGF(IP_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
         ("Checksum (0x%"X16_F") failed, IP packet dropped.\n", inet_chksum(iphdr, iphdr_hlen)));
@@ -1017,7 +1177,7 @@ ip4_output(struct pbuf *p, const ip4_addr_t *src, const ip4_addr_t *dest,
  */
 err_t
 ip4_output_hinted(struct pbuf *p, const ip4_addr_t *src, const ip4_addr_t *dest,
-          u8_t ttl, u8_t tos, u8_t proto, u8_t *addr_hint)
+          u8_t ttl, u8_t tos, u8_t proto, u16_t *addr_hint)
 {
   struct netif *netif;
   err_t err;
@@ -0,0 +1,433 @@
+/**
+ * @file
+ * IPv4 forwarding table: longest prefix match over connected and static
+ * routes, stored in a path-compressed binary trie.
+ *
+ * @defgroup ip4_fib IPv4 routing table
+ * @ingroup ip4
+ * Routes are kept in a binary trie in which every node carries the common
+ * prefix of its subtree, so a lookup visits at most one node per distinct
+ * prefix length on the path to the destination (and never more than 33).
+ * The subnet of every netif is entered as a connected route automatically;
+ * additional routes, optionally via a next-hop gateway, are added with
+ * ip4_fib_add().
+ *
+ * All functions must be called from the lwIP core context (tcpip_thread or
+ * with the core locked). Every change increments ip4_fib_gen, which
+ * callers caching routing decisions (e.g. TCP connections) use to
+ * revalidate their cache.
+ */
+
+/*
+ * Copyright (c) 2026 The lwIP contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_IPV4 && LWIP_IPV4_FIB /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/ip4_fib.h"
+#include "lwip/def.h"
+#include "lwip/memp.h"
+#include "lwip/debug.h"
+
+#include <string.h>
+
+/** netmask for a prefix length, in host byte order */
+#define IP4_FIB_MASK(len)      (((len) == 0) ? 0 : (0xffffffffUL << (32 - (len))))
+/** bit 'pos' of a host order address, counting from the most significant */
+#define IP4_FIB_BIT(addr, pos) ((u8_t)(((addr) >> (31 - (pos))) & 1))
+
+u32_t ip4_fib_gen;
+
+/** root of the trie */
+static struct ip4_fib_entry *ip4_fib_root;
+
+/** The result of the last lookup, valid while ip4_fib_last_gen equals
+ * ip4_fib_gen: a packet sent off-link is looked up by ip4_route() and
+ * again by etharp_output() for its next hop. */
+static ip4_addr_t ip4_fib_last_dest;
+static struct ip4_fib_entry *ip4_fib_last_route;
+static u32_t ip4_fib_last_gen = 0xffffffffUL;
+
+/** Returns the number of leading bits two host order addresses share */
+static u8_t
+ip4_fib_common_len(u32_t a, u32_t b)
+{
+  u32_t diff = a ^ b;
+  u8_t len = 0;
+  while ((len < 32) && !(diff & 0x80000000UL)) {
+    diff <<= 1;
+    len++;
+  }
+  return len;
+}
+
+/** Returns the prefix length of a (contiguous) netmask */
+static u8_t
+ip4_fib_mask_len(const ip4_addr_t *netmask)
+{
+  return ip4_fib_common_len(lwip_ntohl(ip4_addr_get_u32(netmask)), 0xffffffffUL);
+}
+
+/** A route can only be used when its netif could also be found by the
+ * netif_list scan: up, link up and with an address */
+static int
+ip4_fib_usable(const struct ip4_fib_entry *entry)
+{
+  return netif_is_up(entry->netif) && netif_is_link_up(entry->netif) &&
+    !ip4_addr_isany_val(*netif_ip4_addr(entry->netif));
+}
+
+/**
+ * Enter a route into the trie.
+ *
+ * @param prefix network prefix in host byte order (host bits cleared)
+ * @param prefix_len length of the prefix
+ * @param gw next-hop gateway or NULL for an on-link route
+ * @param netif the netif to send on
+ * @param flags IP4_FIB_FLAG_* of the new route
+ * @param replace overwrite an existing route for the same prefix?
+ * @return ERR_OK if the route was entered, ERR_MEM if the trie is full,
+ *         ERR_VAL if a route existed and replace was not set
+ */
+static err_t
+ip4_fib_insert(u32_t prefix, u8_t prefix_len, const ip4_addr_t *gw,
+               struct netif *netif, u8_t flags, u8_t replace)
+{
+  struct ip4_fib_entry **link = &ip4_fib_root;
+  struct ip4_fib_entry *entry, *leaf, *branch;
+  u8_t common = prefix_len;
+
+  while ((entry = *link) != NULL) {
+    common = ip4_fib_common_len(prefix, entry->prefix);
+    common = LWIP_MIN(common, LWIP_MIN(prefix_len, entry->prefix_len));
+    if (common < entry->prefix_len) {
+      /* the new prefix branches off above this node */
+      break;
+    }
+    if (entry->prefix_len == prefix_len) {
+      /* node for this prefix exists already */
+      if ((entry->flags & IP4_FIB_FLAG_ROUTE) && !replace) {
+        return ERR_VAL;
+      }
+      leaf = entry;
+      goto set_route;
+    }
+    link = &entry->child[IP4_FIB_BIT(prefix, entry->prefix_len)];
+  }
+
+  leaf = (struct ip4_fib_entry *)memp_malloc(MEMP_IP4_FIB_NODE);
+  if (leaf == NULL) {
+    LWIP_DEBUGF(IP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("ip4_fib_insert: out of trie nodes\n"));
+    return ERR_MEM;
+  }
+  memset(leaf, 0, sizeof(struct ip4_fib_entry));
+  leaf->prefix = prefix;
+  leaf->prefix_len = prefix_len;
+
+  if (entry == NULL) {
+    /* new leaf */
+    *link = leaf;
+  } else if (common == prefix_len) {
+    /* the new prefix covers the existing subtree */
+    leaf->child[IP4_FIB_BIT(entry->prefix, prefix_len)] = entry;
+    *link = leaf;
+  } else {
+    /* both prefixes diverge at bit 'common': insert a branch node */
+    branch = (struct ip4_fib_entry *)memp_malloc(MEMP_IP4_FIB_NODE);
+    if (branch == NULL) {
+      LWIP_DEBUGF(IP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("ip4_fib_insert: out of trie nodes\n"));
+      memp_free(MEMP_IP4_FIB_NODE, leaf);
+      return ERR_MEM;
+    }
+    memset(branch, 0, sizeof(struct ip4_fib_entry));
+    branch->prefix = prefix & IP4_FIB_MASK(common);
+    branch->prefix_len = common;
+    branch->child[IP4_FIB_BIT(entry->prefix, common)] = entry;
+    branch->child[IP4_FIB_BIT(prefix, common)] = leaf;
+    *link = branch;
+  }
+
+set_route:
+  if (gw != NULL) {
+    ip4_addr_copy(leaf->gw, *gw);
+  } else {
+    ip4_addr_set_any(&leaf->gw);
+  }
+  leaf->netif = netif;
+  leaf->flags = (u8_t)(flags | IP4_FIB_FLAG_ROUTE);
+  ip4_fib_gen++;
+  return ERR_OK;
+}
+
+/**
+ * Remove the route of a node, freeing the node (and its parent branch node)
+ * if they are not needed any more.
+ *
+ * @param link the pointer to the node
+ * @param parent_link the pointer to the parent node or NULL for the root
+ */
+static void
+ip4_fib_unlink(struct ip4_fib_entry **link, struct ip4_fib_entry **parent_link)
+{
+  struct ip4_fib_entry *entry = *link;
+  struct ip4_fib_entry *parent;
+
+  entry->flags = 0;
+  entry->netif = NULL;
+  ip4_fib_gen++;
+  if ((entry->child[0] != NULL) && (entry->child[1] != NULL)) {
+    /* still needed as branch node */
+    return;
+  }
+  *link = (entry->child[0] != NULL) ? entry->child[0] : entry->child[1];
+  memp_free(MEMP_IP4_FIB_NODE, entry);
+  if ((*link == NULL) && (parent_link != NULL)) {
+    parent = *parent_link;
+    if (!(parent->flags & IP4_FIB_FLAG_ROUTE)) {
+      /* branch node with a single child left: collapse it */
+      *parent_link = (parent->child[0] != NULL) ? parent->child[0] : parent->child[1];
+      memp_free(MEMP_IP4_FIB_NODE, parent);
+    }
+  }
+}
+
+/**
+ * Remove the first route found in a subtree that belongs to a netif and has
+ * all of 'flags' set.
+ *
+ * @return 1 if a route was removed, 0 otherwise
+ */
+static u8_t
+ip4_fib_purge(struct ip4_fib_entry **link, struct ip4_fib_entry **parent_link,
+              struct netif *netif, u8_t flags)
+{
+  struct ip4_fib_entry *entry = *link;
+  if (entry == NULL) {
+    return 0;
+  }
+  if ((entry->netif == netif) && ((entry->flags & flags) == flags)) {
+    ip4_fib_unlink(link, parent_link);
+    return 1;
+  }
+  if (ip4_fib_purge(&entry->child[0], link, netif, flags)) {
+    return 1;
+  }
+  return ip4_fib_purge(&entry->child[1], link, netif, flags);
+}
+
+/**
+ * @ingroup ip4_fib
+ * Add a route or replace the route for the same prefix.
+ *
+ * @param prefix the destination network (host bits are ignored)
+ * @param prefix_len the length of the network prefix (0..32, 0 for a
+ *        default route)
+ * @param gw the next-hop gateway or NULL/IP4_ADDR_ANY if the destinations
+ *        are on-link
+ * @param netif the netif to send on
+ * @return ERR_OK on success, ERR_ARG for invalid arguments or ERR_MEM if no
+ *         trie node could be allocated (see MEMP_NUM_IP4_FIB_NODE)
+ */
+err_t
+ip4_fib_add(const ip4_addr_t *prefix, u8_t prefix_len, const ip4_addr_t *gw, struct netif *netif)
+{
+  LWIP_ERROR("ip4_fib_add: invalid prefix", (prefix != NULL) && (prefix_len <= 32), return ERR_ARG;);
+  LWIP_ERROR("ip4_fib_add: invalid netif", netif != NULL, return ERR_ARG;);
+
+  return ip4_fib_insert(lwip_ntohl(ip4_addr_get_u32(prefix)) & IP4_FIB_MASK(prefix_len),
+    prefix_len, gw, netif, 0, 1);
+}
+
+/**
+ * @ingroup ip4_fib
+ * Remove the route for a prefix.
+ *
+ * @param prefix the destination network (host bits are ignored)
+ * @param prefix_len the length of the network prefix
+ * @return ERR_OK on success or ERR_VAL if no route for this prefix exists
+ */
+err_t
+ip4_fib_remove(const ip4_addr_t *prefix, u8_t prefix_len)
+{
+  struct ip4_fib_entry **link = &ip4_fib_root;
+  struct ip4_fib_entry **parent_link = NULL;
+  struct ip4_fib_entry *entry;
+  u32_t addr;
+
+  LWIP_ERROR("ip4_fib_remove: invalid prefix", (prefix != NULL) && (prefix_len <= 32), return ERR_ARG;);
+
+  addr = lwip_ntohl(ip4_addr_get_u32(prefix)) & IP4_FIB_MASK(prefix_len);
+  while (((entry = *link) != NULL) && (entry->prefix_len <= prefix_len) &&
+         ((addr & IP4_FIB_MASK(entry->prefix_len)) == entry->prefix)) {
+    if (entry->prefix_len == prefix_len) {
+      if (!(entry->flags & IP4_FIB_FLAG_ROUTE)) {
+        break;
+      }
+      ip4_fib_unlink(link, parent_link);
+      return ERR_OK;
+    }
+    parent_link = link;
+    link = &entry->child[IP4_FIB_BIT(addr, entry->prefix_len)];
+  }
+  return ERR_VAL;
+}
+
+/**
+ * @ingroup ip4_fib
+ * Find the most specific usable route to a destination. Routes whose netif
+ * is down, has no link or no address are skipped in favour of less specific
+ * ones.
+ *
+ * @param dest the destination address
+ * @return the route or NULL if no route matches
+ */
+struct ip4_fib_entry *
+ip4_fib_lookup(const ip4_addr_t *dest)
+{
+  u32_t addr;
+  struct ip4_fib_entry *entry = ip4_fib_root;
+  struct ip4_fib_entry *best = NULL;
+
+  if ((ip4_fib_last_gen == ip4_fib_gen) && ip4_addr_cmp(&ip4_fib_last_dest, dest)) {
+    return ip4_fib_last_route;
+  }
+
+  addr = lwip_ntohl(ip4_addr_get_u32(dest));
+  while ((entry != NULL) && ((addr & IP4_FIB_MASK(entry->prefix_len)) == entry->prefix)) {
+    if ((entry->flags & IP4_FIB_FLAG_ROUTE) && ip4_fib_usable(entry)) {
+      best = entry;
+    }
+    if (entry->prefix_len == 32) {
+      break;
+    }
+    entry = entry->child[IP4_FIB_BIT(addr, entry->prefix_len)];
+  }
+
+  ip4_addr_copy(ip4_fib_last_dest, *dest);
+  ip4_fib_last_route = best;
+  ip4_fib_last_gen = ip4_fib_gen;
+  return best;
+}
+
+/**
+ * Get the address to resolve on the link when sending to a destination
+ * outside the netif's subnet. Right after ip4_route() for the same
+ * destination, this reuses its lookup instead of walking the trie again.
+ *
+ * @param netif the netif the packet is sent on
+ * @param dest the destination address
+ * @return the gateway of the matching route, dest itself for on-link routes
+ *         or NULL if the route does not go through netif (use its default
+ *         gateway then)
+ */
+const ip4_addr_t *
+ip4_fib_gateway(struct netif *netif, const ip4_addr_t *dest)
+{
+  struct ip4_fib_entry *entry = ip4_fib_lookup(dest);
+  if ((entry == NULL) || (entry->netif != netif)) {
+    return NULL;
+  }
+  if (ip4_addr_isany_val(entry->gw)) {
+    return dest;
+  }
+  return &entry->gw;
+}
+
+/** Enter the connected routes of a netif, keeping existing routes for the
+ * same prefixes (the netif_list scan also prefers the first netif) */
+static void
+ip4_fib_netif_connect(struct netif *netif)
+{
+  u8_t mask_len;
+
+  if (!ip4_addr_isany_val(*netif_ip4_addr(netif))) {
+    /* the local subnet */
+    mask_len = ip4_fib_mask_len(netif_ip4_netmask(netif));
+    ip4_fib_insert(lwip_ntohl(ip4_addr_get_u32(netif_ip4_addr(netif))) & IP4_FIB_MASK(mask_len),
+      mask_len, NULL, netif, IP4_FIB_FLAG_CONNECTED, 0);
+    if (((netif->flags & NETIF_FLAG_BROADCAST) == 0) && !ip4_addr_isany_val(*netif_ip4_gw(netif))) {
+      /* the peer of a point to point interface */
+      ip4_fib_insert(lwip_ntohl(ip4_addr_get_u32(netif_ip4_gw(netif))), 32, NULL, netif,
+        IP4_FIB_FLAG_CONNECTED, 0);
+    }
+  }
+}
+
+/**
+ * Update the connected routes of a netif after its address, netmask or
+ * gateway changed.
+ *
+ * @param netif the netif that changed (may not yet be on netif_list)
+ */
+void
+ip4_fib_netif_update(struct netif *netif)
+{
+  struct netif *n;
+  u8_t listed = 0;
+
+  while (ip4_fib_purge(&ip4_fib_root, NULL, netif, IP4_FIB_FLAG_ROUTE | IP4_FIB_FLAG_CONNECTED));
+
+  /* re-enter all connected routes: subnets shadowed by the old address of
+     this netif become visible again */
+  for (n = netif_list; n != NULL; n = n->next) {
+    ip4_fib_netif_connect(n);
+    if (n == netif) {
+      listed = 1;
+    }
+  }
+  if (!listed) {
+    ip4_fib_netif_connect(netif);
+  }
+  ip4_fib_gen++;
+}
+
+/**
+ * Remove all routes of a netif that is being removed.
+ *
+ * @param netif the netif that was removed from netif_list
+ */
+void
+ip4_fib_netif_remove(struct netif *netif)
+{
+  struct netif *n;
+
+  while (ip4_fib_purge(&ip4_fib_root, NULL, netif, IP4_FIB_FLAG_ROUTE));
+
+  /* connected routes of other netifs may have been shadowed by this one */
+  for (n = netif_list; n != NULL; n = n->next) {
+    if (n != netif) {
+      ip4_fib_netif_connect(n);
+    }
+  }
+  ip4_fib_gen++;
+}
+
+#endif /* LWIP_IPV4 && LWIP_IPV4_FIB */
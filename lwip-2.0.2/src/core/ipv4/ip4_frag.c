@@ -77,6 +77,21 @@
 #define IP_REASS_FREE_OLDEST 1
 #endif /* IP_REASS_FREE_OLDEST */
 
+#if IP_REASS_HASH_SIZE
+#if IP_REASS_HASH_SIZE & (IP_REASS_HASH_SIZE - 1)
+#error IP_REASS_HASH_SIZE must be a power of two
+#endif
+#if !IP_REASS_CHECK_OVERLAP
+#error IP_REASS_HASH_SIZE needs IP_REASS_CHECK_OVERLAP
+#endif
+#define IP_REASS_NUM_BUCKETS IP_REASS_HASH_SIZE
+#else /* IP_REASS_HASH_SIZE */
+#if IP_REASS_MAX_PBUFS_PER_SRC
+#error IP_REASS_MAX_PBUFS_PER_SRC needs IP_REASS_HASH_SIZE
+#endif
+#define IP_REASS_NUM_BUCKETS 1
+#endif /* IP_REASS_HASH_SIZE */
+
 #define IP_REASS_FLAG_LASTFRAG 0x01
 
 /** This is a helper struct which holds the starting
@@ -106,14 +121,45 @@ PACK_STRUCT_END
    ip4_addr_cmp(&(iphdrA)->dest, &(iphdrB)->dest) && \
    IPH_ID(iphdrA) == IPH_ID(iphdrB)) ? 1 : 0
 
+#if IP_REASS_HASH_SIZE
+#define IP_REASS_DATAGRAM_MATCH(iphdrA, iphdrB) \
+  ((IP_ADDRESSES_AND_ID_MATCH(iphdrA, iphdrB)) && (IPH_PROTO(iphdrA) == IPH_PROTO(iphdrB)))
+#define ip_reass_bucket(iphdr) ip_reass_hash(ip4_addr_get_u32(&(iphdr)->src) ^ \
+  ip4_addr_get_u32(&(iphdr)->dest) ^ ((u32_t)IPH_ID(iphdr) << 8) ^ IPH_PROTO(iphdr))
+#else /* IP_REASS_HASH_SIZE */
+#define IP_REASS_DATAGRAM_MATCH(iphdrA, iphdrB) IP_ADDRESSES_AND_ID_MATCH(iphdrA, iphdrB)
+#define ip_reass_bucket(iphdr) 0
+#endif /* IP_REASS_HASH_SIZE */
+
+#if IP_REASS_MAX_PBUFS_PER_SRC
+/** pbufs enqueued by the sources hashing into the bucket of 'iphdr' */
+#define IP_REASS_SRC_PBUFCOUNT(iphdr) \
+  ip_reass_src_pbufcount[ip_reass_hash(ip4_addr_get_u32(&(iphdr)->src))]
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+
 /* global variables */
-static struct ip_reassdata *reassdatagrams;
+static struct ip_reassdata *reassdatagrams[IP_REASS_NUM_BUCKETS];
 static u16_t ip_reass_pbufcount;
+#if IP_REASS_MAX_PBUFS_PER_SRC
+static u16_t ip_reass_src_pbufcount[IP_REASS_HASH_SIZE];
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
 
 /* function prototypes */
 static void ip_reass_dequeue_datagram(struct ip_reassdata *ipr, struct ip_reassdata *prev);
 static int ip_reass_free_complete_datagram(struct ip_reassdata *ipr, struct ip_reassdata *prev);
 
+#if IP_REASS_HASH_SIZE
+/** Hash a datagram key into a bucket index */
+static u16_t
+ip_reass_hash(u32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  return (u16_t)(h & (IP_REASS_HASH_SIZE - 1));
+}
+#endif /* IP_REASS_HASH_SIZE */
+
 /**
  * Reassembly timer base function
  * for both NO_SYS == 0 and 1 (!).
@@ -123,28 +169,32 @@ static int ip_reass_free_complete_datagram(struct ip_reassdata *ipr, struct ip_r
 void
 ip_reass_tmr(void)
 {
-  struct ip_reassdata *r, *prev = NULL;
-
-  r = reassdatagrams;
-  while (r != NULL) {
-    /* Decrement the timer. Once it reaches 0,
-     * clean up the incomplete fragment assembly */
-    if (r->timer > 0) {
-      r->timer--;
-      LWIP_DEBUGF(IP_REASS_DEBUG, ("ip_reass_tmr: timer dec %"U16_F"\n",(u16_t)r->timer));
-      prev = r;
-      r = r->next;
-    } else {
-      /* reassembly timed out */
-      struct ip_reassdata *tmp;
-      LWIP_DEBUGF(IP_REASS_DEBUG, ("ip_reass_tmr: timer timed out\n"));
-      tmp = r;
-      /* get the next pointer before freeing */
-      r = r->next;
-      /* free the helper struct and all enqueued pbufs */
-      ip_reass_free_complete_datagram(tmp, prev);
-     }
-   }
+  struct ip_reassdata *r, *prev;
+  u16_t i;
+
+  for (i = 0; i < IP_REASS_NUM_BUCKETS; i++) {
+    prev = NULL;
+    r = reassdatagrams[i];
+    while (r != NULL) {
+      /* Decrement the timer. Once it reaches 0,
+       * clean up the incomplete fragment assembly */
+      if (r->timer > 0) {
+        r->timer--;
+        LWIP_DEBUGF(IP_REASS_DEBUG, ("ip_reass_tmr: timer dec %"U16_F"\n",(u16_t)r->timer));
+        prev = r;
+        r = r->next;
+      } else {
+        /* reassembly timed out */
+        struct ip_reassdata *tmp;
+        LWIP_DEBUGF(IP_REASS_DEBUG, ("ip_reass_tmr: timer timed out\n"));
+        tmp = r;
+        /* get the next pointer before freeing */
+        r = r->next;
+        /* free the helper struct and all enqueued pbufs */
+        ip_reass_free_complete_datagram(tmp, prev);
+      }
+    }
+  }
 }
 
 /**
@@ -201,6 +251,9 @@ ip_reass_free_complete_datagram(struct ip_reassdata *ipr, struct ip_reassdata *p
     pbufs_freed += clen;
     pbuf_free(pcur);
   }
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  IP_REASS_SRC_PBUFCOUNT(&ipr->iphdr) -= pbufs_freed;
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
   /* Then, unchain the struct ip_reassdata from the list and free it. */
   ip_reass_dequeue_datagram(ipr, prev);
   LWIP_ASSERT("ip_reass_pbufcount >= clen", ip_reass_pbufcount >= pbufs_freed);
@@ -228,32 +281,35 @@ ip_reass_remove_oldest_datagram(struct ip_hdr *fraghdr, int pbufs_needed)
   struct ip_reassdata *r, *oldest, *prev, *oldest_prev;
   int pbufs_freed = 0, pbufs_freed_current;
   int other_datagrams;
+  u16_t i;
 
   /* Free datagrams until being allowed to enqueue 'pbufs_needed' pbufs,
    * but don't free the datagram that 'fraghdr' belongs to! */
   do {
     oldest = NULL;
-    prev = NULL;
     oldest_prev = NULL;
     other_datagrams = 0;
-    r = reassdatagrams;
-    while (r != NULL) {
-      if (!IP_ADDRESSES_AND_ID_MATCH(&r->iphdr, fraghdr)) {
-        /* Not the same datagram as fraghdr */
-        other_datagrams++;
-        if (oldest == NULL) {
-          oldest = r;
-          oldest_prev = prev;
-        } else if (r->timer <= oldest->timer) {
-          /* older than the previous oldest */
-          oldest = r;
-          oldest_prev = prev;
+    for (i = 0; i < IP_REASS_NUM_BUCKETS; i++) {
+      prev = NULL;
+      r = reassdatagrams[i];
+      while (r != NULL) {
+        if (!IP_REASS_DATAGRAM_MATCH(&r->iphdr, fraghdr)) {
+          /* Not the same datagram as fraghdr */
+          other_datagrams++;
+          if (oldest == NULL) {
+            oldest = r;
+            oldest_prev = prev;
+          } else if (r->timer <= oldest->timer) {
+            /* older than the previous oldest */
+            oldest = r;
+            oldest_prev = prev;
+          }
         }
+        if (r->next != NULL) {
+          prev = r;
+        }
+        r = r->next;
       }
-      if (r->next != NULL) {
-        prev = r;
-      }
-      r = r->next;
     }
     if (oldest != NULL) {
       pbufs_freed_current = ip_reass_free_complete_datagram(oldest, oldest_prev);
@@ -297,8 +353,8 @@ ip_reass_enqueue_new_datagram(struct ip_hdr *fraghdr, int clen)
   ipr->timer = IP_REASS_MAXAGE;
 
   /* enqueue the new structure to the front of the list */
-  ipr->next = reassdatagrams;
-  reassdatagrams = ipr;
+  ipr->next = reassdatagrams[ip_reass_bucket(fraghdr)];
+  reassdatagrams[ip_reass_bucket(fraghdr)] = ipr;
   /* copy the ip header for later tests and input */
   /* @todo: no ip options supported? */
   SMEMCPY(&(ipr->iphdr), fraghdr, IP_HLEN);
@@ -312,10 +368,12 @@ ip_reass_enqueue_new_datagram(struct ip_hdr *fraghdr, int clen)
 static void
 ip_reass_dequeue_datagram(struct ip_reassdata *ipr, struct ip_reassdata *prev)
 {
+  struct ip_reassdata **head = &reassdatagrams[ip_reass_bucket(&ipr->iphdr)];
+
   /* dequeue the reass struct  */
-  if (reassdatagrams == ipr) {
+  if (*head == ipr) {
     /* it was the first in the list */
-    reassdatagrams = ipr->next;
+    *head = ipr->next;
   } else {
     /* it wasn't the first, so it must have a valid 'prev' */
     LWIP_ASSERT("sanity check linked list", prev != NULL);
@@ -359,9 +417,20 @@ ip_reass_chain_frag_into_datagram_and_validate(struct ip_reassdata *ipr, struct
   iprh->start = offset;
   iprh->end = offset + len;
 
+  q = ipr->p;
+#if IP_REASS_HASH_SIZE
+  if ((ipr->p_last != NULL) &&
+      (((struct ip_reass_helper*)ipr->p_last->payload)->end <= iprh->start)) {
+    /* fragments mostly arrive in order: append behind the one with the
+     * highest offset without walking the list */
+    iprh_prev = (struct ip_reass_helper*)ipr->p_last->payload;
+    q = NULL;
+  }
+#endif /* IP_REASS_HASH_SIZE */
+
   /* Iterate through until we either get to the end of the list (append),
    * or we find one with a larger offset (insert). */
-  for (q = ipr->p; q != NULL;) {
+  for (; q != NULL;) {
     iprh_tmp = (struct ip_reass_helper*)q->payload;
     if (iprh->start < iprh_tmp->start) {
       /* the new pbuf should be inserted before this */
@@ -422,9 +491,21 @@ ip_reass_chain_frag_into_datagram_and_validate(struct ip_reassdata *ipr, struct
       /* this is the first fragment we ever received for this ip datagram */
       ipr->p = new_p;
     }
+#if IP_REASS_HASH_SIZE
+    ipr->p_last = new_p;
+#endif /* IP_REASS_HASH_SIZE */
   }
 
   /* At this point, the validation part begins: */
+#if IP_REASS_HASH_SIZE
+  ipr->recvd_len += len;
+  LWIP_UNUSED_ARG(valid);
+  /* Fragments don't overlap, so all are there once they add up to the end
+   * of the last one and that is the end of the datagram. */
+  return ((ipr->flags & IP_REASS_FLAG_LASTFRAG) != 0) &&
+         (ipr->recvd_len == ipr->datagram_len) &&
+         (((struct ip_reass_helper*)ipr->p_last->payload)->end == ipr->datagram_len);
+#else /* IP_REASS_HASH_SIZE */
   /* If we already received the last fragment */
   if ((ipr->flags & IP_REASS_FLAG_LASTFRAG) != 0) {
     /* and had no holes so far */
@@ -466,8 +547,12 @@ ip_reass_chain_frag_into_datagram_and_validate(struct ip_reassdata *ipr, struct
   }
   /* If we come here, not all fragments were received, yet! */
   return 0; /* not yet valid! */
+#endif /* IP_REASS_HASH_SIZE */
 #if IP_REASS_CHECK_OVERLAP
 freepbuf:
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  IP_REASS_SRC_PBUFCOUNT(&ipr->iphdr) -= pbuf_clen(new_p);
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
   ip_reass_pbufcount -= pbuf_clen(new_p);
   pbuf_free(new_p);
   return 0;
@@ -483,7 +568,7 @@ freepbuf:
 struct pbuf *
 ip4_reass(struct pbuf *p)
 {
-  struct pbuf *r;
+  struct pbuf *r, *q;
   struct ip_hdr *fraghdr;
   struct ip_reassdata *ipr;
   struct ip_reass_helper *iprh;
@@ -505,6 +590,15 @@ ip4_reass(struct pbuf *p)
 
   /* Check if we are allowed to enqueue more datagrams. */
   clen = pbuf_clen(p);
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  if ((IP_REASS_SRC_PBUFCOUNT(fraghdr) + clen) > IP_REASS_MAX_PBUFS_PER_SRC) {
+    /* Don't free other datagrams for a source that is over its quota */
+    LWIP_DEBUGF(IP_REASS_DEBUG,("ip4_reass: source over quota: pbufct=%d, clen=%d, MAX=%d\n",
+      IP_REASS_SRC_PBUFCOUNT(fraghdr), clen, IP_REASS_MAX_PBUFS_PER_SRC));
+    IPFRAG_STATS_INC(ip_frag.memerr);
+    goto nullreturn;
+  }
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
   if ((ip_reass_pbufcount + clen) > IP_REASS_MAX_PBUFS) {
 #if IP_REASS_FREE_OLDEST
     if (!ip_reass_remove_oldest_datagram(fraghdr, clen) ||
@@ -523,11 +617,11 @@ ip4_reass(struct pbuf *p)
 
   /* Look for the datagram the fragment belongs to in the current datagram queue,
    * remembering the previous in the queue for later dequeueing. */
-  for (ipr = reassdatagrams; ipr != NULL; ipr = ipr->next) {
+  for (ipr = reassdatagrams[ip_reass_bucket(fraghdr)]; ipr != NULL; ipr = ipr->next) {
     /* Check if the incoming fragment matches the one currently present
        in the reassembly buffer. If so, we proceed with copying the
        fragment into the buffer. */
-    if (IP_ADDRESSES_AND_ID_MATCH(&ipr->iphdr, fraghdr)) {
+    if (IP_REASS_DATAGRAM_MATCH(&ipr->iphdr, fraghdr)) {
       LWIP_DEBUGF(IP_REASS_DEBUG, ("ip4_reass: matching previous fragment ID=%"X16_F"\n",
         lwip_ntohs(IPH_ID(fraghdr))));
       IPFRAG_STATS_INC(ip_frag.cachehit);
@@ -555,6 +649,9 @@ ip4_reass(struct pbuf *p)
   /* Track the current number of pbufs current 'in-flight', in order to limit
   the number of fragments that may be enqueued at any one time */
   ip_reass_pbufcount += clen;
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  IP_REASS_SRC_PBUFCOUNT(fraghdr) += clen;
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
 
   /* At this point, we have either created a new entry or pointing
    * to an existing one */
@@ -593,21 +690,40 @@ ip4_reass(struct pbuf *p)
 
     p = ipr->p;
 
-    /* chain together the pbufs contained within the reass_data list. */
+    /* chain together the pbufs contained within the reass_data list,
+     * walking every pbuf only once (pbuf_cat() would walk 'p' each time) */
+    q = p;
+    while (q->next != NULL) {
+      q = q->next;
+    }
     while (r != NULL) {
       iprh = (struct ip_reass_helper*)r->payload;
 
       /* hide the ip header for every succeeding fragment */
       pbuf_header(r, -IP_HLEN);
-      pbuf_cat(p, r);
+      q->next = r;
+      q = r;
+      while (q->next != NULL) {
+        q = q->next;
+      }
       r = iprh->next_pbuf;
     }
+    /* then fix up the total lengths */
+    len = ipr->datagram_len;
+    for (q = p; q != NULL; q = q->next) {
+      q->tot_len = len;
+      len -= q->len;
+    }
+    LWIP_ASSERT("reassembled length mismatch", len == 0);
+#if IP_REASS_MAX_PBUFS_PER_SRC
+    IP_REASS_SRC_PBUFCOUNT(fraghdr) -= pbuf_clen(p);
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
 
     /* find the previous entry in the linked list */
-    if (ipr == reassdatagrams) {
+    if (ipr == reassdatagrams[ip_reass_bucket(&ipr->iphdr)]) {
       ipr_prev = NULL;
     } else {
-      for (ipr_prev = reassdatagrams; ipr_prev != NULL; ipr_prev = ipr_prev->next) {
+      for (ipr_prev = reassdatagrams[ip_reass_bucket(&ipr->iphdr)]; ipr_prev != NULL; ipr_prev = ipr_prev->next) {
         if (ipr_prev->next == ipr) {
           break;
         }
@@ -622,6 +738,11 @@ ip4_reass(struct pbuf *p)
 
     MIB2_STATS_INC(mib2.ipreasmoks);
 
+#if LWIP_CHECKSUM_OFFLOAD
+    /* a driver can only have verified single fragments */
+    p->flags &= (u8_t)~PBUF_FLAG_CHKSUM_VERIFIED;
+#endif /* LWIP_CHECKSUM_OFFLOAD */
+
     /* Return the pbuf chain */
     return p;
   }
@@ -690,7 +811,7 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
   u16_t newpbuflen = 0;
   u16_t left_to_copy;
 #endif
-  struct ip_hdr *original_iphdr;
+  struct ip_hdr template_iphdr;
   struct ip_hdr *iphdr;
   const u16_t nfb = (netif->mtu - IP_HLEN) / 8;
   u16_t left, fragsize;
@@ -698,9 +819,11 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
   int last;
   u16_t poff = IP_HLEN;
   u16_t tmp;
+#if CHECKSUM_GEN_IP
+  u16_t chksum;
+#endif /* CHECKSUM_GEN_IP */
 
-  original_iphdr = (struct ip_hdr *)p->payload;
-  iphdr = original_iphdr;
+  iphdr = (struct ip_hdr *)p->payload;
   LWIP_ERROR("ip4_frag() does not support IP options", IPH_HL(iphdr) * 4 == IP_HLEN, return ERR_VAL);
 
   /* Save original offset */
@@ -708,6 +831,22 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
   ofo = tmp & IP_OFFMASK;
   LWIP_ERROR("ip_frag(): MF already set", (tmp & IP_MF) == 0, return ERR_VAL);
 
+#if LWIP_CHECKSUM_OFFLOAD
+  /* the fragments cannot be checksummed by the driver */
+  inet_chksum_offload_finish(p);
+#endif /* LWIP_CHECKSUM_OFFLOAD */
+
+  /* All fragments share one header template: its checksum is computed once
+   * and only adjusted for the length and offset of each fragment. */
+  SMEMCPY(&template_iphdr, iphdr, IP_HLEN);
+  IPH_CHKSUM_SET(&template_iphdr, 0);
+#if CHECKSUM_GEN_IP
+  chksum = 0;
+  IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_IP) {
+    chksum = inet_chksum(&template_iphdr, IP_HLEN);
+  }
+#endif /* CHECKSUM_GEN_IP */
+
   left = p->tot_len - IP_HLEN;
 
   while (left) {
@@ -728,7 +867,7 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
       goto memerr;
     }
     /* fill in the IP header */
-    SMEMCPY(rambuf->payload, original_iphdr, IP_HLEN);
+    SMEMCPY(rambuf->payload, &template_iphdr, IP_HLEN);
     iphdr = (struct ip_hdr*)rambuf->payload;
 #else /* LWIP_NETIF_TX_SINGLE_PBUF */
     /* When not using a static buffer, create a chain of pbufs.
@@ -742,7 +881,7 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
     }
     LWIP_ASSERT("this needs a pbuf in one piece!",
                 (p->len >= (IP_HLEN)));
-    SMEMCPY(rambuf->payload, original_iphdr, IP_HLEN);
+    SMEMCPY(rambuf->payload, &template_iphdr, IP_HLEN);
     iphdr = (struct ip_hdr *)rambuf->payload;
 
     left_to_copy = fragsize;
@@ -796,10 +935,11 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
     }
     IPH_OFFSET_SET(iphdr, lwip_htons(tmp));
     IPH_LEN_SET(iphdr, lwip_htons(fragsize + IP_HLEN));
-    IPH_CHKSUM_SET(iphdr, 0);
 #if CHECKSUM_GEN_IP
     IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_IP) {
-      IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+      IPH_CHKSUM_SET(iphdr, inet_chksum_adjust(inet_chksum_adjust(chksum,
+        IPH_OFFSET(&template_iphdr), IPH_OFFSET(iphdr)),
+        IPH_LEN(&template_iphdr), IPH_LEN(iphdr)));
     }
 #endif /* CHECKSUM_GEN_IP */
 
@@ -50,6 +50,7 @@
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
 #include "lwip/ip6_frag.h"
+#include "lwip/ip6_fib.h"
 #include "lwip/icmp6.h"
 #include "lwip/raw.h"
 #include "lwip/udp.h"
@@ -85,6 +86,9 @@ ip6_route(const ip6_addr_t *src, const ip6_addr_t *dest)
 {
   struct netif *netif;
   s8_t i;
+#if LWIP_IPV6_FIB
+  struct ip6_fib_entry *route;
+#endif /* LWIP_IPV6_FIB */
 
   /* If single netif configuration, fast return. */
   if ((netif_list != NULL) && (netif_list->next == NULL)) {
@@ -134,6 +138,14 @@ ip6_route(const ip6_addr_t *src, const ip6_addr_t *dest)
   }
 #endif
 
+#if LWIP_IPV6_FIB
+  /* Routes more specific than an on-link /64 take precedence. */
+  route = ip6_fib_lookup(dest);
+  if ((route != NULL) && (route->prefix_len > 64)) {
+    return route->netif;
+  }
+#endif /* LWIP_IPV6_FIB */
+
   /* See if the destination subnet matches a configured address. */
   for (netif = netif_list; netif != NULL; netif = netif->next) {
     if (!netif_is_up(netif) || !netif_is_link_up(netif)) {
@@ -147,6 +159,12 @@ ip6_route(const ip6_addr_t *src, const ip6_addr_t *dest)
     }
   }
 
+#if LWIP_IPV6_FIB
+  if (route != NULL) {
+    return route->netif;
+  }
+#endif /* LWIP_IPV6_FIB */
+
   /* Get the netif for a suitable router. */
   netif = nd6_find_route(dest);
   if ((netif != NULL) && netif_is_up(netif) && netif_is_link_up(netif)) {
@@ -994,7 +1012,7 @@ ip6_output(struct pbuf *p, const ip6_addr_t *src, const ip6_addr_t *dest,
  */
 err_t
 ip6_output_hinted(struct pbuf *p, const ip6_addr_t *src, const ip6_addr_t *dest,
-          u8_t hl, u8_t tc, u8_t nexth, u8_t *addr_hint)
+          u8_t hl, u8_t tc, u8_t nexth, u16_t *addr_hint)
 {
   struct netif *netif;
   struct ip6_hdr *ip6hdr;
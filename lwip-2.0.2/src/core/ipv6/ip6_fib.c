@@ -0,0 +1,312 @@
+/**
+ * @file
+ * IPv6 static routes, stored in a path-compressed binary trie for longest
+ * prefix matching.
+ *
+ * @defgroup ip6_fib IPv6 routing table
+ * @ingroup ip6
+ * Static routes added with ip6_fib_add() complement the on-link prefixes and
+ * default routers learned through neighbor discovery: ip6_route() prefers
+ * routes more specific than the /64 on-link subnets, and
+ * nd6_get_next_hop_addr_or_queue() sends packets for a route through its
+ * next-hop router. Every change clears the ND6 destination cache.
+ *
+ * All functions must be called from the lwIP core context.
+ */
+
+/*
+ * Copyright (c) 2026 The lwIP contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_IPV6 && LWIP_IPV6_FIB /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/ip6_fib.h"
+#include "lwip/nd6.h"
+#include "lwip/def.h"
+#include "lwip/memp.h"
+#include "lwip/debug.h"
+
+#include <string.h>
+
+/** bit 'pos' of an IPv6 address, counting from the most significant */
+#define IP6_FIB_BIT(ip6addr, pos) \
+  ((u8_t)((lwip_ntohl((ip6addr)->addr[(pos) >> 5]) >> (31 - ((pos) & 31))) & 1))
+
+/** root of the trie */
+static struct ip6_fib_entry *ip6_fib_root;
+
+/** Returns the number of leading bits two addresses share, at most 'max' */
+static u8_t
+ip6_fib_common_len(const ip6_addr_t *a, const ip6_addr_t *b, u8_t max)
+{
+  u8_t len = 0;
+  u8_t i;
+  u32_t diff;
+
+  for (i = 0; i < 4; i++) {
+    diff = lwip_ntohl(a->addr[i] ^ b->addr[i]);
+    if (diff != 0) {
+      while (!(diff & 0x80000000UL)) {
+        diff <<= 1;
+        len++;
+      }
+      break;
+    }
+    len += 32;
+  }
+  return LWIP_MIN(len, max);
+}
+
+/** Clear the bits of an address after 'len' */
+static void
+ip6_fib_mask(ip6_addr_t *addr, u8_t len)
+{
+  u8_t i;
+  for (i = 0; i < 4; i++) {
+    if (len >= 32) {
+      len -= 32;
+    } else {
+      addr->addr[i] &= lwip_htonl(len ? (0xffffffffUL << (32 - len)) : 0);
+      len = 0;
+    }
+  }
+}
+
+/**
+ * @ingroup ip6_fib
+ * Add a route or replace the route for the same prefix.
+ *
+ * @param prefix the destination network (host bits are ignored)
+ * @param prefix_len the length of the network prefix (0..128, 0 for a
+ *        default route)
+ * @param gw the next-hop router or NULL/IP6_ADDR_ANY if the destinations
+ *        are on-link
+ * @param netif the netif to send on
+ * @return ERR_OK on success, ERR_ARG for invalid arguments or ERR_MEM if no
+ *         trie node could be allocated (see MEMP_NUM_IP6_FIB_NODE)
+ */
+err_t
+ip6_fib_add(const ip6_addr_t *prefix, u8_t prefix_len, const ip6_addr_t *gw, struct netif *netif)
+{
+  struct ip6_fib_entry **link = &ip6_fib_root;
+  struct ip6_fib_entry *entry, *leaf, *branch;
+  ip6_addr_t addr;
+  u8_t common = 0;
+
+  LWIP_ERROR("ip6_fib_add: invalid prefix", (prefix != NULL) && (prefix_len <= 128), return ERR_ARG;);
+  LWIP_ERROR("ip6_fib_add: invalid netif", netif != NULL, return ERR_ARG;);
+
+  ip6_addr_copy(addr, *prefix);
+  ip6_fib_mask(&addr, prefix_len);
+
+  while ((entry = *link) != NULL) {
+    common = ip6_fib_common_len(&addr, &entry->prefix, LWIP_MIN(prefix_len, entry->prefix_len));
+    if (common < entry->prefix_len) {
+      /* the new prefix branches off above this node */
+      break;
+    }
+    if (entry->prefix_len == prefix_len) {
+      /* node for this prefix exists already */
+      leaf = entry;
+      goto set_route;
+    }
+    link = &entry->child[IP6_FIB_BIT(&addr, entry->prefix_len)];
+  }
+
+  leaf = (struct ip6_fib_entry *)memp_malloc(MEMP_IP6_FIB_NODE);
+  if (leaf == NULL) {
+    LWIP_DEBUGF(IP6_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("ip6_fib_add: out of trie nodes\n"));
+    return ERR_MEM;
+  }
+  memset(leaf, 0, sizeof(struct ip6_fib_entry));
+  ip6_addr_copy(leaf->prefix, addr);
+  leaf->prefix_len = prefix_len;
+
+  if (entry == NULL) {
+    /* new leaf */
+    *link = leaf;
+  } else if (common == prefix_len) {
+    /* the new prefix covers the existing subtree */
+    leaf->child[IP6_FIB_BIT(&entry->prefix, prefix_len)] = entry;
+    *link = leaf;
+  } else {
+    /* both prefixes diverge at bit 'common': insert a branch node */
+    branch = (struct ip6_fib_entry *)memp_malloc(MEMP_IP6_FIB_NODE);
+    if (branch == NULL) {
+      LWIP_DEBUGF(IP6_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("ip6_fib_add: out of trie nodes\n"));
+      memp_free(MEMP_IP6_FIB_NODE, leaf);
+      return ERR_MEM;
+    }
+    memset(branch, 0, sizeof(struct ip6_fib_entry));
+    ip6_addr_copy(branch->prefix, addr);
+    ip6_fib_mask(&branch->prefix, common);
+    branch->prefix_len = common;
+    branch->child[IP6_FIB_BIT(&entry->prefix, common)] = entry;
+    branch->child[IP6_FIB_BIT(&addr, common)] = leaf;
+    *link = branch;
+  }
+
+set_route:
+  if (gw != NULL) {
+    ip6_addr_set(&leaf->gw, gw);
+  } else {
+    ip6_addr_set_any(&leaf->gw);
+  }
+  leaf->netif = netif;
+  /* cached next hops may have changed */
+  nd6_clear_destination_cache();
+  return ERR_OK;
+}
+
+/**
+ * Remove the route of a node, freeing the node (and its parent branch node)
+ * if they are not needed any more.
+ *
+ * @param link the pointer to the node
+ * @param parent_link the pointer to the parent node or NULL for the root
+ */
+static void
+ip6_fib_unlink(struct ip6_fib_entry **link, struct ip6_fib_entry **parent_link)
+{
+  struct ip6_fib_entry *entry = *link;
+  struct ip6_fib_entry *parent;
+
+  entry->netif = NULL;
+  nd6_clear_destination_cache();
+  if ((entry->child[0] != NULL) && (entry->child[1] != NULL)) {
+    /* still needed as branch node */
+    return;
+  }
+  *link = (entry->child[0] != NULL) ? entry->child[0] : entry->child[1];
+  memp_free(MEMP_IP6_FIB_NODE, entry);
+  if ((*link == NULL) && (parent_link != NULL)) {
+    parent = *parent_link;
+    if (parent->netif == NULL) {
+      /* branch node with a single child left: collapse it */
+      *parent_link = (parent->child[0] != NULL) ? parent->child[0] : parent->child[1];
+      memp_free(MEMP_IP6_FIB_NODE, parent);
+    }
+  }
+}
+
+/**
+ * @ingroup ip6_fib
+ * Remove the route for a prefix.
+ *
+ * @param prefix the destination network (host bits are ignored)
+ * @param prefix_len the length of the network prefix
+ * @return ERR_OK on success or ERR_VAL if no route for this prefix exists
+ */
+err_t
+ip6_fib_remove(const ip6_addr_t *prefix, u8_t prefix_len)
+{
+  struct ip6_fib_entry **link = &ip6_fib_root;
+  struct ip6_fib_entry **parent_link = NULL;
+  struct ip6_fib_entry *entry;
+
+  LWIP_ERROR("ip6_fib_remove: invalid prefix", (prefix != NULL) && (prefix_len <= 128), return ERR_ARG;);
+
+  while (((entry = *link) != NULL) && (entry->prefix_len <= prefix_len) &&
+         (ip6_fib_common_len(prefix, &entry->prefix, entry->prefix_len) == entry->prefix_len)) {
+    if (entry->prefix_len == prefix_len) {
+      if (entry->netif == NULL) {
+        break;
+      }
+      ip6_fib_unlink(link, parent_link);
+      return ERR_OK;
+    }
+    parent_link = link;
+    link = &entry->child[IP6_FIB_BIT(prefix, entry->prefix_len)];
+  }
+  return ERR_VAL;
+}
+
+/**
+ * @ingroup ip6_fib
+ * Find the most specific route to a destination whose netif is up and has
+ * a link.
+ *
+ * @param dest the destination address
+ * @return the route or NULL if no route matches
+ */
+struct ip6_fib_entry *
+ip6_fib_lookup(const ip6_addr_t *dest)
+{
+  struct ip6_fib_entry *entry = ip6_fib_root;
+  struct ip6_fib_entry *best = NULL;
+
+  while ((entry != NULL) &&
+         (ip6_fib_common_len(dest, &entry->prefix, entry->prefix_len) == entry->prefix_len)) {
+    if ((entry->netif != NULL) && netif_is_up(entry->netif) && netif_is_link_up(entry->netif)) {
+      best = entry;
+    }
+    if (entry->prefix_len == 128) {
+      break;
+    }
+    entry = entry->child[IP6_FIB_BIT(dest, entry->prefix_len)];
+  }
+  return best;
+}
+
+/**
+ * Remove the first route found in a subtree that uses a netif.
+ *
+ * @return 1 if a route was removed, 0 otherwise
+ */
+static u8_t
+ip6_fib_purge(struct ip6_fib_entry **link, struct ip6_fib_entry **parent_link, struct netif *netif)
+{
+  struct ip6_fib_entry *entry = *link;
+  if (entry == NULL) {
+    return 0;
+  }
+  if (entry->netif == netif) {
+    ip6_fib_unlink(link, parent_link);
+    return 1;
+  }
+  if (ip6_fib_purge(&entry->child[0], link, netif)) {
+    return 1;
+  }
+  return ip6_fib_purge(&entry->child[1], link, netif);
+}
+
+/**
+ * Remove all routes of a netif that is being removed.
+ *
+ * @param netif the netif that is removed
+ */
+void
+ip6_fib_netif_remove(struct netif *netif)
+{
+  while (ip6_fib_purge(&ip6_fib_root, NULL, netif));
+}
+
+#endif /* LWIP_IPV6 && LWIP_IPV6_FIB */
@@ -49,6 +49,7 @@
 #include "lwip/pbuf.h"
 #include "lwip/memp.h"
 #include "lwip/stats.h"
+#include "lwip/inet_chksum.h"
 
 #include <string.h>
 
@@ -74,6 +75,25 @@
 #define IPV6_FRAG_REQROOM ((s16_t)(sizeof(struct ip6_reass_helper) - IP6_FRAG_HLEN))
 #endif
 
+#if IP_REASS_HASH_SIZE
+#if IP_REASS_HASH_SIZE & (IP_REASS_HASH_SIZE - 1)
+#error IP_REASS_HASH_SIZE must be a power of two
+#endif
+#if !IP_REASS_CHECK_OVERLAP
+#error IP_REASS_HASH_SIZE needs IP_REASS_CHECK_OVERLAP
+#endif
+#define IP_REASS_NUM_BUCKETS IP_REASS_HASH_SIZE
+#define IP6_REASS_BUCKET(ipr) ((ipr)->bucket)
+/** XOR the words of an IPv6 address */
+#define IP6_REASS_ADDR_FOLD(a) ((a)->addr[0] ^ (a)->addr[1] ^ (a)->addr[2] ^ (a)->addr[3])
+#else /* IP_REASS_HASH_SIZE */
+#if IP_REASS_MAX_PBUFS_PER_SRC
+#error IP_REASS_MAX_PBUFS_PER_SRC needs IP_REASS_HASH_SIZE
+#endif
+#define IP_REASS_NUM_BUCKETS 1
+#define IP6_REASS_BUCKET(ipr) 0
+#endif /* IP_REASS_HASH_SIZE */
+
 #define IP_REASS_FLAG_LASTFRAG 0x01
 
 /** This is a helper struct which holds the starting
@@ -98,8 +118,11 @@ PACK_STRUCT_END
 #endif
 
 /* static variables */
-static struct ip6_reassdata *reassdatagrams;
+static struct ip6_reassdata *reassdatagrams[IP_REASS_NUM_BUCKETS];
 static u16_t ip6_reass_pbufcount;
+#if IP_REASS_MAX_PBUFS_PER_SRC
+static u16_t ip6_reass_src_pbufcount[IP_REASS_HASH_SIZE];
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
 
 /* Forward declarations. */
 static void ip6_reass_free_complete_datagram(struct ip6_reassdata *ipr);
@@ -107,32 +130,47 @@ static void ip6_reass_free_complete_datagram(struct ip6_reassdata *ipr);
 static void ip6_reass_remove_oldest_datagram(struct ip6_reassdata *ipr, int pbufs_needed);
 #endif /* IP_REASS_FREE_OLDEST */
 
+#if IP_REASS_HASH_SIZE
+/** Hash a datagram key into a bucket index */
+static u16_t
+ip6_reass_hash(u32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  return (u16_t)(h & (IP_REASS_HASH_SIZE - 1));
+}
+#endif /* IP_REASS_HASH_SIZE */
+
 void
 ip6_reass_tmr(void)
 {
   struct ip6_reassdata *r, *tmp;
+  u16_t i;
 
 #if !IPV6_FRAG_COPYHEADER
   LWIP_ASSERT("sizeof(struct ip6_reass_helper) <= IP6_FRAG_HLEN, set IPV6_FRAG_COPYHEADER to 1",
     sizeof(struct ip6_reass_helper) <= IP6_FRAG_HLEN);
 #endif /* !IPV6_FRAG_COPYHEADER */
 
-  r = reassdatagrams;
-  while (r != NULL) {
-    /* Decrement the timer. Once it reaches 0,
-     * clean up the incomplete fragment assembly */
-    if (r->timer > 0) {
-      r->timer--;
-      r = r->next;
-    } else {
-      /* reassembly timed out */
-      tmp = r;
-      /* get the next pointer before freeing */
-      r = r->next;
-      /* free the helper struct and all enqueued pbufs */
-      ip6_reass_free_complete_datagram(tmp);
-     }
-   }
+  for (i = 0; i < IP_REASS_NUM_BUCKETS; i++) {
+    r = reassdatagrams[i];
+    while (r != NULL) {
+      /* Decrement the timer. Once it reaches 0,
+       * clean up the incomplete fragment assembly */
+      if (r->timer > 0) {
+        r->timer--;
+        r = r->next;
+      } else {
+        /* reassembly timed out */
+        tmp = r;
+        /* get the next pointer before freeing */
+        r = r->next;
+        /* free the helper struct and all enqueued pbufs */
+        ip6_reass_free_complete_datagram(tmp);
+      }
+    }
+  }
 }
 
 /**
@@ -188,11 +226,15 @@ ip6_reass_free_complete_datagram(struct ip6_reassdata *ipr)
     pbuf_free(pcur);
   }
 
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  ip6_reass_src_pbufcount[ipr->src_bucket] -= pbufs_freed;
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+
   /* Then, unchain the struct ip6_reassdata from the list and free it. */
-  if (ipr == reassdatagrams) {
-    reassdatagrams = ipr->next;
+  if (ipr == reassdatagrams[IP6_REASS_BUCKET(ipr)]) {
+    reassdatagrams[IP6_REASS_BUCKET(ipr)] = ipr->next;
   } else {
-    prev = reassdatagrams;
+    prev = reassdatagrams[IP6_REASS_BUCKET(ipr)];
     while (prev != NULL) {
       if (prev->next == ipr) {
         break;
@@ -223,28 +265,26 @@ static void
 ip6_reass_remove_oldest_datagram(struct ip6_reassdata *ipr, int pbufs_needed)
 {
   struct ip6_reassdata *r, *oldest;
+  u16_t i;
 
   /* Free datagrams until being allowed to enqueue 'pbufs_needed' pbufs,
    * but don't free the current datagram! */
   do {
-    r = oldest = reassdatagrams;
-    while (r != NULL) {
-      if (r != ipr) {
-        if (r->timer <= oldest->timer) {
+    oldest = NULL;
+    for (i = 0; i < IP_REASS_NUM_BUCKETS; i++) {
+      for (r = reassdatagrams[i]; r != NULL; r = r->next) {
+        if ((r != ipr) && ((oldest == NULL) || (r->timer <= oldest->timer))) {
           /* older than the previous oldest */
           oldest = r;
         }
       }
-      r = r->next;
     }
-    if (oldest == ipr) {
+    if (oldest == NULL) {
       /* nothing to free, ipr is the only element on the list */
       return;
     }
-    if (oldest != NULL) {
-      ip6_reass_free_complete_datagram(oldest);
-    }
-  } while (((ip6_reass_pbufcount + pbufs_needed) > IP_REASS_MAX_PBUFS) && (reassdatagrams != NULL));
+    ip6_reass_free_complete_datagram(oldest);
+  } while ((ip6_reass_pbufcount + pbufs_needed) > IP_REASS_MAX_PBUFS);
 }
 #endif /* IP_REASS_FREE_OLDEST */
 
@@ -265,6 +305,10 @@ ip6_reass(struct pbuf *p)
   u16_t clen;
   u8_t valid = 1;
   struct pbuf *q;
+  struct ip6_reassdata **head;
+#if IP_REASS_HASH_SIZE
+  u16_t bucket;
+#endif /* IP_REASS_HASH_SIZE */
 
   IP6_FRAG_STATS_INC(ip6_frag.recv);
 
@@ -288,9 +332,26 @@ ip6_reass(struct pbuf *p)
   len -= (u16_t)(((u8_t*)p->payload - (const u8_t*)ip6_current_header()) - IP6_HLEN);
   len -= IP6_FRAG_HLEN;
 
+#if IP_REASS_HASH_SIZE
+  bucket = ip6_reass_hash(IP6_REASS_ADDR_FOLD(ip6_current_src_addr()) ^
+                          IP6_REASS_ADDR_FOLD(ip6_current_dest_addr()) ^ frag_hdr->_identification);
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  if ((ip6_reass_src_pbufcount[ip6_reass_hash(IP6_REASS_ADDR_FOLD(ip6_current_src_addr()))] + clen) >
+      IP_REASS_MAX_PBUFS_PER_SRC) {
+    /* Don't free other datagrams for a source that is over its quota */
+    IP6_FRAG_STATS_INC(ip6_frag.memerr);
+    IP6_FRAG_STATS_INC(ip6_frag.drop);
+    goto nullreturn;
+  }
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+  head = &reassdatagrams[bucket];
+#else /* IP_REASS_HASH_SIZE */
+  head = &reassdatagrams[0];
+#endif /* IP_REASS_HASH_SIZE */
+
   /* Look for the datagram the fragment belongs to in the current datagram queue,
    * remembering the previous in the queue for later dequeueing. */
-  for (ipr = reassdatagrams, ipr_prev = NULL; ipr != NULL; ipr = ipr->next) {
+  for (ipr = *head, ipr_prev = NULL; ipr != NULL; ipr = ipr->next) {
     /* Check if the incoming fragment matches the one currently present
        in the reassembly buffer. If so, we proceed with copying the
        fragment into the buffer. */
@@ -313,7 +374,7 @@ ip6_reass(struct pbuf *p)
       ipr = (struct ip6_reassdata *)memp_malloc(MEMP_IP6_REASSDATA);
       if (ipr != NULL) {
         /* re-search ipr_prev since it might have been removed */
-        for (ipr_prev = reassdatagrams; ipr_prev != NULL; ipr_prev = ipr_prev->next) {
+        for (ipr_prev = *head; ipr_prev != NULL; ipr_prev = ipr_prev->next) {
           if (ipr_prev->next == ipr) {
             break;
           }
@@ -331,8 +392,14 @@ ip6_reass(struct pbuf *p)
     ipr->timer = IP_REASS_MAXAGE;
 
     /* enqueue the new structure to the front of the list */
-    ipr->next = reassdatagrams;
-    reassdatagrams = ipr;
+    ipr->next = *head;
+    *head = ipr;
+#if IP_REASS_HASH_SIZE
+    ipr->bucket = bucket;
+#if IP_REASS_MAX_PBUFS_PER_SRC
+    ipr->src_bucket = ip6_reass_hash(IP6_REASS_ADDR_FOLD(ip6_current_src_addr()));
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
 
     /* Use the current IPv6 header for src/dest address reference.
      * Eventually, we will replace it when we get the first fragment
@@ -357,7 +424,7 @@ ip6_reass(struct pbuf *p)
     ip6_reass_remove_oldest_datagram(ipr, clen);
     if ((ip6_reass_pbufcount + clen) <= IP_REASS_MAX_PBUFS) {
       /* re-search ipr_prev since it might have been removed */
-      for (ipr_prev = reassdatagrams; ipr_prev != NULL; ipr_prev = ipr_prev->next) {
+      for (ipr_prev = *head; ipr_prev != NULL; ipr_prev = ipr_prev->next) {
         if (ipr_prev->next == ipr) {
           break;
         }
@@ -392,9 +459,19 @@ ip6_reass(struct pbuf *p)
   iprh->end = (offset & IP6_FRAG_OFFSET_MASK) + len;
 
   /* find the right place to insert this pbuf */
+  q = ipr->p;
+#if IP_REASS_HASH_SIZE
+  if ((ipr->p_last != NULL) &&
+      (((struct ip6_reass_helper*)ipr->p_last->payload)->end <= iprh->start)) {
+    /* fragments mostly arrive in order: append behind the one with the
+     * highest offset without walking the list */
+    iprh_prev = (struct ip6_reass_helper*)ipr->p_last->payload;
+    q = NULL;
+  }
+#endif /* IP_REASS_HASH_SIZE */
   /* Iterate through until we either get to the end of the list (append),
    * or we find on with a larger offset (insert). */
-  for (q = ipr->p; q != NULL;) {
+  for (; q != NULL;) {
     iprh_tmp = (struct ip6_reass_helper*)q->payload;
     if (iprh->start < iprh_tmp->start) {
 #if IP_REASS_CHECK_OVERLAP
@@ -468,11 +545,17 @@ ip6_reass(struct pbuf *p)
       /* this is the first fragment we ever received for this ip datagram */
       ipr->p = p;
     }
+#if IP_REASS_HASH_SIZE
+    ipr->p_last = p;
+#endif /* IP_REASS_HASH_SIZE */
   }
 
   /* Track the current number of pbufs current 'in-flight', in order to limit
   the number of fragments that may be enqueued at any one time */
   ip6_reass_pbufcount += clen;
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  ip6_reass_src_pbufcount[ipr->src_bucket] += clen;
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
 
   /* Remember IPv6 header if this is the first fragment. */
   if (iprh->start == 0) {
@@ -491,6 +574,13 @@ ip6_reass(struct pbuf *p)
     ipr->datagram_len = iprh->end;
   }
 
+#if IP_REASS_HASH_SIZE
+  /* Fragments don't overlap, so all are there once they add up to the end
+   * of the last one and that is the end of the datagram. */
+  ipr->recvd_len += len;
+  valid = (ipr->datagram_len != 0) && (ipr->recvd_len == ipr->datagram_len) &&
+          (((struct ip6_reass_helper*)ipr->p_last->payload)->end == ipr->datagram_len);
+#else /* IP_REASS_HASH_SIZE */
   /* Additional validity tests: we have received first and last fragment. */
   iprh_tmp = (struct ip6_reass_helper*)ipr->p->payload;
   if (iprh_tmp->start != 0) {
@@ -512,12 +602,18 @@ ip6_reass(struct pbuf *p)
     iprh_prev = iprh;
     q = iprh->next_pbuf;
   }
+#endif /* IP_REASS_HASH_SIZE */
 
   if (valid) {
     /* All fragments have been received */
     struct ip6_hdr* iphdr_ptr;
 
-    /* chain together the pbufs contained within the ip6_reassdata list. */
+    /* chain together the pbufs contained within the ip6_reassdata list,
+     * walking every pbuf only once (pbuf_cat() would walk ipr->p each time) */
+    q = ipr->p;
+    while (q->next != NULL) {
+      q = q->next;
+    }
     iprh = (struct ip6_reass_helper*) ipr->p->payload;
     while (iprh != NULL) {
       struct pbuf* next_pbuf = iprh->next_pbuf;
@@ -535,7 +631,11 @@ ip6_reass(struct pbuf *p)
           LWIP_ASSERT("no room for struct ip6_reass_helper", hdrerr == 0);
         }
 #endif
-        pbuf_cat(ipr->p, next_pbuf);
+        q->next = next_pbuf;
+        q = next_pbuf;
+        while (q->next != NULL) {
+          q = q->next;
+        }
       }
       else {
         iprh_tmp = NULL;
@@ -543,6 +643,15 @@ ip6_reass(struct pbuf *p)
 
       iprh = iprh_tmp;
     }
+    /* then fix up the total lengths */
+    len = 0;
+    for (q = ipr->p; q != NULL; q = q->next) {
+      len += q->len;
+    }
+    for (q = ipr->p; q != NULL; q = q->next) {
+      q->tot_len = len;
+      len -= q->len;
+    }
 
 #if IPV6_FRAG_COPYHEADER
     if (IPV6_FRAG_REQROOM > 0) {
@@ -577,14 +686,17 @@ ip6_reass(struct pbuf *p)
     frag_hdr->_identification = 0;
 
     /* release the sources allocate for the fragment queue entry */
-    if (reassdatagrams == ipr) {
+    if (*head == ipr) {
       /* it was the first in the list */
-      reassdatagrams = ipr->next;
+      *head = ipr->next;
     } else {
       /* it wasn't the first, so it must have a valid 'prev' */
       LWIP_ASSERT("sanity check linked list", ipr_prev != NULL);
       ipr_prev->next = ipr->next;
     }
+#if IP_REASS_MAX_PBUFS_PER_SRC
+    ip6_reass_src_pbufcount[ipr->src_bucket] -= pbuf_clen(p);
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
     memp_free(MEMP_IP6_REASSDATA, ipr);
 
     /* adjust the number of pbufs currently queued for reassembly. */
@@ -598,6 +710,11 @@ ip6_reass(struct pbuf *p)
       return NULL;
     }
 
+#if LWIP_CHECKSUM_OFFLOAD
+    /* a driver can only have verified single fragments */
+    p->flags &= (u8_t)~PBUF_FLAG_CHKSUM_VERIFIED;
+#endif /* LWIP_CHECKSUM_OFFLOAD */
+
     /* Return the pbuf chain */
     return p;
   }
@@ -659,7 +776,6 @@ ip6_frag_free_pbuf_custom(struct pbuf *p)
 err_t
 ip6_frag(struct pbuf *p, struct netif *netif, const ip6_addr_t *dest)
 {
-  struct ip6_hdr *original_ip6hdr;
   struct ip6_hdr *ip6hdr;
   struct ip6_frag_hdr *frag_hdr;
   struct pbuf *rambuf;
@@ -669,6 +785,11 @@ ip6_frag(struct pbuf *p, struct netif *netif, const ip6_addr_t *dest)
   u16_t left_to_copy;
 #endif
   static u32_t identification;
+  /* IPv6 and Fragment Header shared by all fragments */
+  struct {
+    struct ip6_hdr ip6hdr;
+    struct ip6_frag_hdr frag_hdr;
+  } template_hdr;
   u16_t nfb;
   u16_t left, cop;
   u16_t mtu;
@@ -678,15 +799,28 @@ ip6_frag(struct pbuf *p, struct netif *netif, const ip6_addr_t *dest)
 
   identification++;
 
-  original_ip6hdr = (struct ip6_hdr *)p->payload;
-
   mtu = nd6_get_destination_mtu(dest, netif);
 
+#if LWIP_CHECKSUM_OFFLOAD
+  /* the fragments cannot be checksummed by the driver */
+  inet_chksum_offload_finish(p);
+#endif /* LWIP_CHECKSUM_OFFLOAD */
+
   /* @todo we assume there are no options in the unfragmentable part (IPv6 header). */
   left = p->tot_len - IP6_HLEN;
 
   nfb = (mtu - (IP6_HLEN + IP6_FRAG_HLEN)) & IP6_FRAG_OFFSET_MASK;
 
+  /* Set up the headers once, only offset and length differ per fragment */
+  LWIP_ASSERT("this needs a pbuf in one piece!", (p->len >= (IP6_HLEN)));
+  LWIP_ASSERT("sizeof(template_hdr) == IP6_HLEN + IP6_FRAG_HLEN",
+    sizeof(template_hdr) == IP6_HLEN + IP6_FRAG_HLEN);
+  SMEMCPY(&template_hdr.ip6hdr, p->payload, IP6_HLEN);
+  template_hdr.frag_hdr._nexth = IP6H_NEXTH(&template_hdr.ip6hdr);
+  template_hdr.frag_hdr.reserved = 0;
+  template_hdr.frag_hdr._identification = lwip_htonl(identification);
+  IP6H_NEXTH_SET(&template_hdr.ip6hdr, IP6_NEXTH_FRAGMENT);
+
   while (left) {
     last = (left <= nfb);
 
@@ -708,10 +842,6 @@ ip6_frag(struct pbuf *p, struct netif *netif, const ip6_addr_t *dest)
       IP6_FRAG_STATS_INC(ip6_frag.memerr);
       return ERR_MEM;
     }
-    /* fill in the IP header */
-    SMEMCPY(rambuf->payload, original_ip6hdr, IP6_HLEN);
-    ip6hdr = (struct ip6_hdr *)rambuf->payload;
-    frag_hdr = (struct ip6_frag_hdr *)((u8_t*)rambuf->payload + IP6_HLEN);
 #else
     /* When not using a static buffer, create a chain of pbufs.
      * The first will be a PBUF_RAM holding the link, IPv6, and Fragment header.
@@ -723,23 +853,16 @@ ip6_frag(struct pbuf *p, struct netif *netif, const ip6_addr_t *dest)
       IP6_FRAG_STATS_INC(ip6_frag.memerr);
       return ERR_MEM;
     }
-    LWIP_ASSERT("this needs a pbuf in one piece!",
-                (p->len >= (IP6_HLEN)));
-    SMEMCPY(rambuf->payload, original_ip6hdr, IP6_HLEN);
-    ip6hdr = (struct ip6_hdr *)rambuf->payload;
-    frag_hdr = (struct ip6_frag_hdr *)((u8_t*)rambuf->payload + IP6_HLEN);
-
-    /* Can just adjust p directly for needed offset. */
-    p->payload = (u8_t *)p->payload + poff;
-    p->len -= poff;
-    p->tot_len -= poff;
 
+    /* Point into p at the current offset, p itself is left untouched */
     left_to_copy = cop;
     while (left_to_copy) {
       struct pbuf_custom_ref *pcr;
-      newpbuflen = (left_to_copy < p->len) ? left_to_copy : p->len;
+      u16_t plen = p->len - poff;
+      newpbuflen = LWIP_MIN(left_to_copy, plen);
       /* Is this pbuf already empty? */
       if (!newpbuflen) {
+        poff = 0;
         p = p->next;
         continue;
       }
@@ -750,7 +873,8 @@ ip6_frag(struct pbuf *p, struct netif *netif, const ip6_addr_t *dest)
         return ERR_MEM;
       }
       /* Mirror this pbuf, although we might not need all of it. */
-      newpbuf = pbuf_alloced_custom(PBUF_RAW, newpbuflen, PBUF_REF, &pcr->pc, p->payload, newpbuflen);
+      newpbuf = pbuf_alloced_custom(PBUF_RAW, newpbuflen, PBUF_REF, &pcr->pc,
+        (u8_t*)p->payload + poff, newpbuflen);
       if (newpbuf == NULL) {
         ip6_frag_free_pbuf_custom_ref(pcr);
         pbuf_free(rambuf);
@@ -767,19 +891,18 @@ ip6_frag(struct pbuf *p, struct netif *netif, const ip6_addr_t *dest)
       pbuf_cat(rambuf, newpbuf);
       left_to_copy -= newpbuflen;
       if (left_to_copy) {
+        poff = 0;
         p = p->next;
       }
     }
-    poff = newpbuflen;
+    poff += newpbuflen;
 #endif /* LWIP_NETIF_TX_SINGLE_PBUF */
 
     /* Set headers */
-    frag_hdr->_nexth = original_ip6hdr->_nexth;
-    frag_hdr->reserved = 0;
+    SMEMCPY(rambuf->payload, &template_hdr, IP6_HLEN + IP6_FRAG_HLEN);
+    ip6hdr = (struct ip6_hdr *)rambuf->payload;
+    frag_hdr = (struct ip6_frag_hdr *)((u8_t*)rambuf->payload + IP6_HLEN);
     frag_hdr->_fragment_offset = lwip_htons((fragment_offset & IP6_FRAG_OFFSET_MASK) | (last ? 0 : IP6_FRAG_MORE_FLAG));
-    frag_hdr->_identification = lwip_htonl(identification);
-
-    IP6H_NEXTH_SET(ip6hdr, IP6_NEXTH_FRAGMENT);
     IP6H_PLEN_SET(ip6hdr, cop + IP6_FRAG_HLEN);
 
     /* No need for separate header pbuf - we allowed room for it in rambuf
@@ -61,6 +61,7 @@
 #include "lwip/ip.h"
 #include "lwip/stats.h"
 #include "lwip/dns.h"
+#include "lwip/ip6_fib.h"
 
 #include <string.h>
 
@@ -71,6 +72,26 @@
 #if LWIP_IPV6_DUP_DETECT_ATTEMPTS > IP6_ADDR_TENTATIVE_COUNT_MASK
 #error LWIP_IPV6_DUP_DETECT_ATTEMPTS > IP6_ADDR_TENTATIVE_COUNT_MASK
 #endif
+#if LWIP_ND6_DESTINATION_HASH_SIZE
+#if LWIP_ND6_DESTINATION_HASH_SIZE & (LWIP_ND6_DESTINATION_HASH_SIZE - 1)
+#error LWIP_ND6_DESTINATION_HASH_SIZE must be a power of two
+#endif
+#if LWIP_ND6_NUM_DESTINATIONS > 0x7fff
+#error LWIP_ND6_NUM_DESTINATIONS > 0x7fff
+#endif
+#elif LWIP_ND6_NUM_DESTINATIONS > 0x7f
+#error LWIP_ND6_NUM_DESTINATIONS > 0x7f needs LWIP_ND6_DESTINATION_HASH_SIZE
+#endif
+#if LWIP_ND6_NEIGHBOR_HASH_SIZE
+#if LWIP_ND6_NEIGHBOR_HASH_SIZE & (LWIP_ND6_NEIGHBOR_HASH_SIZE - 1)
+#error LWIP_ND6_NEIGHBOR_HASH_SIZE must be a power of two
+#endif
+#if LWIP_ND6_NUM_NEIGHBORS > 0x7fff
+#error LWIP_ND6_NUM_NEIGHBORS > 0x7fff
+#endif
+#elif LWIP_ND6_NUM_NEIGHBORS > 0x7f
+#error LWIP_ND6_NUM_NEIGHBORS > 0x7f needs LWIP_ND6_NEIGHBOR_HASH_SIZE
+#endif
 
 /* Router tables. */
 struct nd6_neighbor_cache_entry neighbor_cache[LWIP_ND6_NUM_NEIGHBORS];
@@ -83,8 +104,33 @@ u32_t reachable_time = LWIP_ND6_REACHABLE_TIME;
 u32_t retrans_timer = LWIP_ND6_RETRANS_TIMER; /* @todo implement this value in timer */
 
 /* Index for cache entries. */
-static u8_t nd6_cached_neighbor_index;
-static u8_t nd6_cached_destination_index;
+static u16_t nd6_cached_neighbor_index;
+static u16_t nd6_cached_destination_index;
+
+#if LWIP_ND6_DESTINATION_HASH_SIZE
+/* Destination cache index: hash buckets, LRU list, free list and the number
+   of entries used so far (all indices + 1, 0 means none). */
+static u16_t nd6_dest_hash_table[LWIP_ND6_DESTINATION_HASH_SIZE];
+static u16_t nd6_dest_lru_head;
+static u16_t nd6_dest_lru_tail;
+static u16_t nd6_dest_free;
+static u16_t nd6_dest_used;
+#endif /* LWIP_ND6_DESTINATION_HASH_SIZE */
+
+#if LWIP_ND6_NEIGHBOR_HASH_SIZE
+/** Number of slots of the neighbor state timer wheel (a power of two) */
+#define ND6_NEIGHBOR_TIMER_SLOTS 32
+/* Neighbor cache index: hash buckets, LRU list, free list, the number of
+   entries used so far and the timer wheel (all indices + 1, 0 means none). */
+static u16_t nd6_neighbor_hash_table[LWIP_ND6_NEIGHBOR_HASH_SIZE];
+static u16_t nd6_neighbor_lru_head;
+static u16_t nd6_neighbor_lru_tail;
+static u16_t nd6_neighbor_free;
+static u16_t nd6_neighbor_used;
+static u16_t nd6_neighbor_timer_wheel[ND6_NEIGHBOR_TIMER_SLOTS];
+/* nd6_tmr() ticks since startup */
+static u32_t nd6_tmr_ticks;
+#endif /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
 
 /* Multicast address holder. */
 static ip6_addr_t multicast_address;
@@ -93,19 +139,45 @@ static ip6_addr_t multicast_address;
 static u8_t nd6_ra_buffer[sizeof(struct prefix_option)];
 
 /* Forward declarations. */
-static s8_t nd6_find_neighbor_cache_entry(const ip6_addr_t *ip6addr);
-static s8_t nd6_new_neighbor_cache_entry(void);
-static void nd6_free_neighbor_cache_entry(s8_t i);
-static s8_t nd6_find_destination_cache_entry(const ip6_addr_t *ip6addr);
-static s8_t nd6_new_destination_cache_entry(void);
+static s16_t nd6_find_neighbor_cache_entry(const ip6_addr_t *ip6addr);
+static s16_t nd6_new_neighbor_cache_entry(void);
+static void nd6_free_neighbor_cache_entry(s16_t i);
+#if LWIP_ND6_NEIGHBOR_HASH_SIZE
+static void nd6_link_neighbor_cache_entry(s16_t i);
+static void nd6_unlink_neighbor_cache_entry(s16_t i);
+static void nd6_touch_neighbor_cache_entry(s16_t i);
+static void nd6_schedule_neighbor_cache_entry(s16_t i);
+static void nd6_unschedule_neighbor_cache_entry(s16_t i);
+static void nd6_neighbor_timer_expired(s16_t i);
+#else /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
+#define nd6_link_neighbor_cache_entry(i)
+#define nd6_touch_neighbor_cache_entry(i)
+#define nd6_schedule_neighbor_cache_entry(i)
+#endif /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
+static s16_t nd6_find_destination_cache_entry(const ip6_addr_t *ip6addr);
+static s16_t nd6_new_destination_cache_entry(void);
+static void nd6_free_destination_cache_entry(s16_t i);
+#if LWIP_ND6_DESTINATION_HASH_SIZE
+static void nd6_link_destination_cache_entry(s16_t i);
+static void nd6_touch_destination_cache_entry(s16_t i);
+#else /* LWIP_ND6_DESTINATION_HASH_SIZE */
+#define nd6_link_destination_cache_entry(i)
+#define nd6_touch_destination_cache_entry(i)
+#endif /* LWIP_ND6_DESTINATION_HASH_SIZE */
+#if LWIP_IPV6_FIB
+/** Routes more specific than the /64 on-link prefixes take precedence */
+#define ND6_FIB_ROUTE_ALLOWS_ONLINK(route) (((route) == NULL) || ((route)->prefix_len <= 64))
+#else /* LWIP_IPV6_FIB */
+#define ND6_FIB_ROUTE_ALLOWS_ONLINK(route) 1
+#endif /* LWIP_IPV6_FIB */
 static s8_t nd6_is_prefix_in_netif(const ip6_addr_t *ip6addr, struct netif *netif);
 static s8_t nd6_select_router(const ip6_addr_t *ip6addr, struct netif *netif);
 static s8_t nd6_get_router(const ip6_addr_t *router_addr, struct netif *netif);
 static s8_t nd6_new_router(const ip6_addr_t *router_addr, struct netif *netif);
 static s8_t nd6_get_onlink_prefix(ip6_addr_t *prefix, struct netif *netif);
 static s8_t nd6_new_onlink_prefix(ip6_addr_t *prefix, struct netif *netif);
-static s8_t nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif);
-static err_t nd6_queue_packet(s8_t neighbor_index, struct pbuf *q);
+static s16_t nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif);
+static err_t nd6_queue_packet(s16_t neighbor_index, struct pbuf *q);
 
 #define ND6_SEND_FLAG_MULTICAST_DEST 0x01
 #define ND6_SEND_FLAG_ALLNODES_DEST 0x02
@@ -121,7 +193,7 @@ static void nd6_free_q(struct nd6_q_entry *q);
 #else /* LWIP_ND6_QUEUEING */
 #define nd6_free_q(q) pbuf_free(q)
 #endif /* LWIP_ND6_QUEUEING */
-static void nd6_send_q(s8_t i);
+static void nd6_send_q(s16_t i);
 
 
 /**
@@ -134,7 +206,8 @@ void
 nd6_input(struct pbuf *p, struct netif *inp)
 {
   u8_t msg_type;
-  s8_t i;
+  s16_t i;
+  s16_t dest_idx;
 
   ND6_STATS_INC(nd6.recv);
 
@@ -265,6 +338,8 @@ nd6_input(struct pbuf *p, struct netif *inp)
       neighbor_cache[i].netif = inp;
       neighbor_cache[i].state = ND6_REACHABLE;
       neighbor_cache[i].counter.reachable_time = reachable_time;
+      nd6_schedule_neighbor_cache_entry(i);
+      nd6_touch_neighbor_cache_entry(i);
 
       /* Send queued packets, if any. */
       if (neighbor_cache[i].q != NULL) {
@@ -356,6 +431,7 @@ nd6_input(struct pbuf *p, struct netif *inp)
           /* Delay probe in case we get confirmation of reachability from upper layer (TCP). */
           neighbor_cache[i].state = ND6_DELAY;
           neighbor_cache[i].counter.delay_time = LWIP_ND6_DELAY_FIRST_PROBE_TIME / ND6_TMR_INTERVAL;
+          nd6_schedule_neighbor_cache_entry(i);
         }
       } else {
         /* Add their IPv6 address and link-layer address to neighbor cache.
@@ -372,11 +448,13 @@ nd6_input(struct pbuf *p, struct netif *inp)
         neighbor_cache[i].netif = inp;
         MEMCPY(neighbor_cache[i].lladdr, lladdr_opt->addr, inp->hwaddr_len);
         ip6_addr_set(&(neighbor_cache[i].next_hop_address), ip6_current_src_addr());
+        nd6_link_neighbor_cache_entry(i);
 
         /* Receiving a message does not prove reachability: only in one direction.
          * Delay probe in case we get confirmation of reachability from upper layer (TCP). */
         neighbor_cache[i].state = ND6_DELAY;
         neighbor_cache[i].counter.delay_time = LWIP_ND6_DELAY_FIRST_PROBE_TIME / ND6_TMR_INTERVAL;
+        nd6_schedule_neighbor_cache_entry(i);
       }
 
       /* Create an aligned copy. */
@@ -485,6 +563,7 @@ nd6_input(struct pbuf *p, struct netif *inp)
           SMEMCPY(default_router_list[i].neighbor_entry->lladdr, lladdr_opt->addr, inp->hwaddr_len);
           default_router_list[i].neighbor_entry->state = ND6_REACHABLE;
           default_router_list[i].neighbor_entry->counter.reachable_time = reachable_time;
+          nd6_schedule_neighbor_cache_entry((s16_t)(default_router_list[i].neighbor_entry - neighbor_cache));
         }
         break;
       }
@@ -613,15 +692,15 @@ nd6_input(struct pbuf *p, struct netif *inp)
     ip6_addr_set(&tmp, &(redir_hdr->destination_address));
 
     /* Find dest address in cache */
-    i = nd6_find_destination_cache_entry(&tmp);
-    if (i < 0) {
+    dest_idx = nd6_find_destination_cache_entry(&tmp);
+    if (dest_idx < 0) {
       /* Destination not in cache, drop packet. */
       pbuf_free(p);
       return;
     }
 
     /* Set the new target address. */
-    ip6_addr_set(&(destination_cache[i].next_hop_addr), &(redir_hdr->target_address));
+    ip6_addr_set(&(destination_cache[dest_idx].next_hop_addr), &(redir_hdr->target_address));
 
     /* If Link-layer address of other router is given, try to add to neighbor cache. */
     if (lladdr_opt != NULL) {
@@ -636,11 +715,13 @@ nd6_input(struct pbuf *p, struct netif *inp)
             neighbor_cache[i].netif = inp;
             MEMCPY(neighbor_cache[i].lladdr, lladdr_opt->addr, inp->hwaddr_len);
             ip6_addr_set(&(neighbor_cache[i].next_hop_address), &tmp);
+            nd6_link_neighbor_cache_entry(i);
 
             /* Receiving a message does not prove reachability: only in one direction.
              * Delay probe in case we get confirmation of reachability from upper layer (TCP). */
             neighbor_cache[i].state = ND6_DELAY;
             neighbor_cache[i].counter.delay_time = LWIP_ND6_DELAY_FIRST_PROBE_TIME / ND6_TMR_INTERVAL;
+            nd6_schedule_neighbor_cache_entry(i);
           }
         }
         if (i >= 0) {
@@ -650,6 +731,7 @@ nd6_input(struct pbuf *p, struct netif *inp)
              * Delay probe in case we get confirmation of reachability from upper layer (TCP). */
             neighbor_cache[i].state = ND6_DELAY;
             neighbor_cache[i].counter.delay_time = LWIP_ND6_DELAY_FIRST_PROBE_TIME / ND6_TMR_INTERVAL;
+            nd6_schedule_neighbor_cache_entry(i);
           }
         }
       }
@@ -679,8 +761,8 @@ nd6_input(struct pbuf *p, struct netif *inp)
     ip6_addr_set(&tmp, &(ip6hdr->dest));
 
     /* Look for entry in destination cache. */
-    i = nd6_find_destination_cache_entry(&tmp);
-    if (i < 0) {
+    dest_idx = nd6_find_destination_cache_entry(&tmp);
+    if (dest_idx < 0) {
       /* Destination not in cache, drop packet. */
       pbuf_free(p);
       return;
@@ -688,7 +770,7 @@ nd6_input(struct pbuf *p, struct netif *inp)
 
     /* Change the Path MTU. */
     pmtu = lwip_htonl(icmp6hdr->data);
-    destination_cache[i].pmtu = (u16_t)LWIP_MIN(pmtu, 0xFFFF);
+    destination_cache[dest_idx].pmtu = (u16_t)LWIP_MIN(pmtu, 0xFFFF);
 
     break; /* ICMP6_TYPE_PTB */
   }
@@ -715,10 +797,25 @@ nd6_input(struct pbuf *p, struct netif *inp)
 void
 nd6_tmr(void)
 {
-  s8_t i;
+  s16_t i;
   struct netif *netif;
 
   /* Process neighbor entries. */
+#if LWIP_ND6_NEIGHBOR_HASH_SIZE
+  /* Only entries whose state timer expires now need work. Restart the slot
+     after each one since processing may recycle other entries. */
+  nd6_tmr_ticks++;
+  i = (s16_t)nd6_neighbor_timer_wheel[nd6_tmr_ticks & (ND6_NEIGHBOR_TIMER_SLOTS - 1)] - 1;
+  while (i >= 0) {
+    if (neighbor_cache[i].timer_expire == nd6_tmr_ticks) {
+      nd6_unschedule_neighbor_cache_entry(i);
+      nd6_neighbor_timer_expired(i);
+      i = (s16_t)nd6_neighbor_timer_wheel[nd6_tmr_ticks & (ND6_NEIGHBOR_TIMER_SLOTS - 1)] - 1;
+    } else {
+      i = (s16_t)neighbor_cache[i].timer_next - 1;
+    }
+  }
+#else /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
   for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
     switch (neighbor_cache[i].state) {
     case ND6_INCOMPLETE:
@@ -774,11 +871,14 @@ nd6_tmr(void)
       break;
     }
   }
+#endif /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
 
-  /* Process destination entries. */
+#if !LWIP_ND6_DESTINATION_HASH_SIZE
+  /* Process destination entries (the hashed cache replaces by LRU instead). */
   for (i = 0; i < LWIP_ND6_NUM_DESTINATIONS; i++) {
     destination_cache[i].age++;
   }
+#endif /* !LWIP_ND6_DESTINATION_HASH_SIZE */
 
   /* Process router entries. */
   for (i = 0; i < LWIP_ND6_NUM_ROUTERS; i++) {
@@ -1116,6 +1216,197 @@ nd6_send_rs(struct netif *netif)
 }
 #endif /* LWIP_IPV6_SEND_ROUTER_SOLICIT */
 
+#if LWIP_ND6_DESTINATION_HASH_SIZE || LWIP_ND6_NEIGHBOR_HASH_SIZE
+/** Hash an IPv6 address for the destination and neighbor cache indices */
+static u32_t
+nd6_addr_hash(const ip6_addr_t *ip6addr)
+{
+  u32_t h = ip6addr->addr[0] ^ ip6addr->addr[1] ^ ip6addr->addr[2] ^ ip6addr->addr[3];
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  return h;
+}
+#endif /* LWIP_ND6_DESTINATION_HASH_SIZE || LWIP_ND6_NEIGHBOR_HASH_SIZE */
+
+#if LWIP_ND6_NEIGHBOR_HASH_SIZE
+/** Hash bucket of a neighbor address */
+#define nd6_neighbor_hash(ip6addr) \
+  ((u16_t)(nd6_addr_hash(ip6addr) & (LWIP_ND6_NEIGHBOR_HASH_SIZE - 1)))
+
+/** Remove an entry from the LRU list if it is on it */
+static void
+nd6_lru_remove_neighbor_cache_entry(s16_t i)
+{
+  struct nd6_neighbor_cache_entry *entry = &neighbor_cache[i];
+  if ((entry->lru_prev == 0) && (nd6_neighbor_lru_head != (u16_t)(i + 1))) {
+    return;
+  }
+  if (entry->lru_prev != 0) {
+    neighbor_cache[entry->lru_prev - 1].lru_next = entry->lru_next;
+  } else {
+    nd6_neighbor_lru_head = entry->lru_next;
+  }
+  if (entry->lru_next != 0) {
+    neighbor_cache[entry->lru_next - 1].lru_prev = entry->lru_prev;
+  } else {
+    nd6_neighbor_lru_tail = entry->lru_prev;
+  }
+  entry->lru_prev = entry->lru_next = 0;
+}
+
+/** Mark an entry most recently used */
+static void
+nd6_touch_neighbor_cache_entry(s16_t i)
+{
+  struct nd6_neighbor_cache_entry *entry = &neighbor_cache[i];
+  if (nd6_neighbor_lru_head == (u16_t)(i + 1)) {
+    return;
+  }
+  nd6_lru_remove_neighbor_cache_entry(i);
+  entry->lru_next = nd6_neighbor_lru_head;
+  if (nd6_neighbor_lru_head != 0) {
+    neighbor_cache[nd6_neighbor_lru_head - 1].lru_prev = (u16_t)(i + 1);
+  } else {
+    nd6_neighbor_lru_tail = (u16_t)(i + 1);
+  }
+  nd6_neighbor_lru_head = (u16_t)(i + 1);
+}
+
+/**
+ * Enter an entry whose address was just set into the hash table and mark
+ * it most recently used.
+ *
+ * @param i the neighbor cache entry index
+ */
+static void
+nd6_link_neighbor_cache_entry(s16_t i)
+{
+  u16_t bucket = nd6_neighbor_hash(&neighbor_cache[i].next_hop_address);
+  neighbor_cache[i].hash_next = nd6_neighbor_hash_table[bucket];
+  nd6_neighbor_hash_table[bucket] = (u16_t)(i + 1);
+  nd6_touch_neighbor_cache_entry(i);
+}
+
+/** Remove an entry from the timer wheel if it is scheduled */
+static void
+nd6_unschedule_neighbor_cache_entry(s16_t i)
+{
+  struct nd6_neighbor_cache_entry *entry = &neighbor_cache[i];
+  u16_t *slot = &nd6_neighbor_timer_wheel[entry->timer_expire & (ND6_NEIGHBOR_TIMER_SLOTS - 1)];
+  if ((entry->timer_prev == 0) && (*slot != (u16_t)(i + 1))) {
+    return;
+  }
+  if (entry->timer_prev != 0) {
+    neighbor_cache[entry->timer_prev - 1].timer_next = entry->timer_next;
+  } else {
+    *slot = entry->timer_next;
+  }
+  if (entry->timer_next != 0) {
+    neighbor_cache[entry->timer_next - 1].timer_prev = entry->timer_prev;
+  }
+  entry->timer_prev = entry->timer_next = 0;
+}
+
+/**
+ * (Re-)arm the state timer of an entry after its state or counter changed.
+ * INCOMPLETE and PROBE entries are processed every tick, REACHABLE and
+ * DELAY entries when their counter runs out, other states need no timer.
+ *
+ * @param i the neighbor cache entry index
+ */
+static void
+nd6_schedule_neighbor_cache_entry(s16_t i)
+{
+  struct nd6_neighbor_cache_entry *entry = &neighbor_cache[i];
+  u16_t *slot;
+  u32_t ticks;
+
+  nd6_unschedule_neighbor_cache_entry(i);
+  switch (entry->state) {
+  case ND6_INCOMPLETE:
+  case ND6_PROBE:
+    ticks = 1;
+    break;
+  case ND6_REACHABLE:
+    ticks = (entry->counter.reachable_time + ND6_TMR_INTERVAL - 1) / ND6_TMR_INTERVAL;
+    break;
+  case ND6_DELAY:
+    ticks = entry->counter.delay_time;
+    break;
+  default:
+    return;
+  }
+  entry->timer_expire = nd6_tmr_ticks + LWIP_MAX(ticks, 1);
+  slot = &nd6_neighbor_timer_wheel[entry->timer_expire & (ND6_NEIGHBOR_TIMER_SLOTS - 1)];
+  entry->timer_next = *slot;
+  if (*slot != 0) {
+    neighbor_cache[*slot - 1].timer_prev = (u16_t)(i + 1);
+  }
+  *slot = (u16_t)(i + 1);
+}
+
+/** Remove an entry from the hash table, the LRU list and the timer wheel */
+static void
+nd6_unlink_neighbor_cache_entry(s16_t i)
+{
+  u16_t *link = &nd6_neighbor_hash_table[nd6_neighbor_hash(&neighbor_cache[i].next_hop_address)];
+  while (*link != 0) {
+    if (*link == (u16_t)(i + 1)) {
+      *link = neighbor_cache[i].hash_next;
+      break;
+    }
+    link = &neighbor_cache[*link - 1].hash_next;
+  }
+  neighbor_cache[i].hash_next = 0;
+  nd6_lru_remove_neighbor_cache_entry(i);
+  nd6_unschedule_neighbor_cache_entry(i);
+}
+
+/**
+ * The state timer of a neighbor cache entry expired: does what the
+ * periodic sweep of nd6_tmr() does for entries without a hash index.
+ *
+ * @param i the neighbor cache entry index
+ */
+static void
+nd6_neighbor_timer_expired(s16_t i)
+{
+  switch (neighbor_cache[i].state) {
+  case ND6_INCOMPLETE:
+  case ND6_PROBE:
+    if ((neighbor_cache[i].counter.probes_sent >= LWIP_ND6_MAX_MULTICAST_SOLICIT) &&
+        (!neighbor_cache[i].isrouter)) {
+      /* Retries exceeded. */
+      nd6_free_neighbor_cache_entry(i);
+      return;
+    }
+    /* Send a NS for this entry. */
+    neighbor_cache[i].counter.probes_sent++;
+    nd6_send_neighbor_cache_probe(&neighbor_cache[i],
+      (neighbor_cache[i].state == ND6_INCOMPLETE) ? ND6_SEND_FLAG_MULTICAST_DEST : 0);
+    break;
+  case ND6_REACHABLE:
+    /* Send queued packets, if any are left. Should have been sent already. */
+    if (neighbor_cache[i].q != NULL) {
+      nd6_send_q(i);
+    }
+    /* Change to stale state. */
+    neighbor_cache[i].state = ND6_STALE;
+    neighbor_cache[i].counter.stale_time = 0;
+    break;
+  case ND6_DELAY:
+    /* Change to PROBE state. */
+    neighbor_cache[i].state = ND6_PROBE;
+    neighbor_cache[i].counter.probes_sent = 0;
+    break;
+  default:
+    break;
+  }
+  nd6_schedule_neighbor_cache_entry(i);
+}
+#endif /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
+
 /**
  * Search for a neighbor cache entry
  *
@@ -1123,15 +1414,24 @@ nd6_send_rs(struct netif *netif)
  * @return The neighbor cache entry index that matched, -1 if no
  * entry is found
  */
-static s8_t
+static s16_t
 nd6_find_neighbor_cache_entry(const ip6_addr_t *ip6addr)
 {
-  s8_t i;
+#if LWIP_ND6_NEIGHBOR_HASH_SIZE
+  u16_t i;
+  for (i = nd6_neighbor_hash_table[nd6_neighbor_hash(ip6addr)]; i != 0; i = neighbor_cache[i - 1].hash_next) {
+    if (ip6_addr_cmp(ip6addr, &(neighbor_cache[i - 1].next_hop_address))) {
+      return (s16_t)(i - 1);
+    }
+  }
+#else /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
+  s16_t i;
   for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
     if (ip6_addr_cmp(ip6addr, &(neighbor_cache[i].next_hop_address))) {
       return i;
     }
   }
+#endif /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
   return -1;
 }
 
@@ -1139,14 +1439,45 @@ nd6_find_neighbor_cache_entry(const ip6_addr_t *ip6addr)
  * Create a new neighbor cache entry.
  *
  * If no unused entry is found, will try to recycle an old entry
- * according to ad-hoc "age" heuristic.
+ * according to ad-hoc "age" heuristic (or the least recently used one
+ * that is not a router, with LWIP_ND6_NEIGHBOR_HASH_SIZE).
+ * The caller must call nd6_link_neighbor_cache_entry() after setting
+ * the address of the new entry.
  *
  * @return The neighbor cache entry index that was created, -1 if no
  * entry could be created
  */
-static s8_t
+static s16_t
 nd6_new_neighbor_cache_entry(void)
 {
+#if LWIP_ND6_NEIGHBOR_HASH_SIZE
+  s16_t i;
+  u16_t j;
+
+  if ((nd6_neighbor_free == 0) && (nd6_neighbor_used >= LWIP_ND6_NUM_NEIGHBORS)) {
+    /* We need to recycle an entry. Do not recycle routers. */
+    for (j = nd6_neighbor_lru_tail; j != 0; j = neighbor_cache[j - 1].lru_prev) {
+      if (!neighbor_cache[j - 1].isrouter) {
+        break;
+      }
+    }
+    if (j == 0) {
+      /* No more entries to try. */
+      return -1;
+    }
+    nd6_free_neighbor_cache_entry((s16_t)(j - 1));
+  }
+  if (nd6_neighbor_free != 0) {
+    /* reuse a freed entry */
+    i = (s16_t)(nd6_neighbor_free - 1);
+    nd6_neighbor_free = neighbor_cache[i].hash_next;
+    neighbor_cache[i].hash_next = 0;
+  } else {
+    /* take a never used entry */
+    i = (s16_t)nd6_neighbor_used++;
+  }
+  return i;
+#else /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
   s8_t i;
   s8_t j;
   u32_t time;
@@ -1243,6 +1574,7 @@ nd6_new_neighbor_cache_entry(void)
 
   /* No more entries to try. */
   return -1;
+#endif /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
 }
 
 /**
@@ -1252,7 +1584,7 @@ nd6_new_neighbor_cache_entry(void)
  * @param i the neighbor cache entry index to free
  */
 static void
-nd6_free_neighbor_cache_entry(s8_t i)
+nd6_free_neighbor_cache_entry(s16_t i)
 {
   if ((i < 0) || (i >= LWIP_ND6_NUM_NEIGHBORS)) {
     return;
@@ -1268,6 +1600,14 @@ nd6_free_neighbor_cache_entry(s8_t i)
     neighbor_cache[i].q = NULL;
   }
 
+#if LWIP_ND6_NEIGHBOR_HASH_SIZE
+  if (neighbor_cache[i].state != ND6_NO_ENTRY) {
+    /* unindex the entry and put it on the free list */
+    nd6_unlink_neighbor_cache_entry(i);
+    neighbor_cache[i].hash_next = nd6_neighbor_free;
+    nd6_neighbor_free = (u16_t)(i + 1);
+  }
+#endif /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
   neighbor_cache[i].state = ND6_NO_ENTRY;
   neighbor_cache[i].isrouter = 0;
   neighbor_cache[i].netif = NULL;
@@ -1275,6 +1615,86 @@ nd6_free_neighbor_cache_entry(s8_t i)
   ip6_addr_set_zero(&(neighbor_cache[i].next_hop_address));
 }
 
+#if LWIP_ND6_DESTINATION_HASH_SIZE
+/** Hash bucket of a destination address */
+#define nd6_destination_hash(ip6addr) \
+  ((u16_t)(nd6_addr_hash(ip6addr) & (LWIP_ND6_DESTINATION_HASH_SIZE - 1)))
+
+/** Remove an entry from the LRU list */
+static void
+nd6_lru_remove_destination_cache_entry(s16_t i)
+{
+  struct nd6_destination_cache_entry *entry = &destination_cache[i];
+  if (entry->lru_prev != 0) {
+    destination_cache[entry->lru_prev - 1].lru_next = entry->lru_next;
+  } else {
+    nd6_dest_lru_head = entry->lru_next;
+  }
+  if (entry->lru_next != 0) {
+    destination_cache[entry->lru_next - 1].lru_prev = entry->lru_prev;
+  } else {
+    nd6_dest_lru_tail = entry->lru_prev;
+  }
+  entry->lru_prev = entry->lru_next = 0;
+}
+
+/** Insert an entry at the most recently used end of the LRU list */
+static void
+nd6_lru_insert_destination_cache_entry(s16_t i)
+{
+  struct nd6_destination_cache_entry *entry = &destination_cache[i];
+  entry->lru_prev = 0;
+  entry->lru_next = nd6_dest_lru_head;
+  if (nd6_dest_lru_head != 0) {
+    destination_cache[nd6_dest_lru_head - 1].lru_prev = (u16_t)(i + 1);
+  } else {
+    nd6_dest_lru_tail = (u16_t)(i + 1);
+  }
+  nd6_dest_lru_head = (u16_t)(i + 1);
+}
+
+/**
+ * Enter an entry whose destination address was just set into the hash
+ * table and mark it most recently used.
+ *
+ * @param i the destination cache entry index
+ */
+static void
+nd6_link_destination_cache_entry(s16_t i)
+{
+  u16_t bucket = nd6_destination_hash(&destination_cache[i].destination_addr);
+  destination_cache[i].hash_next = nd6_dest_hash_table[bucket];
+  nd6_dest_hash_table[bucket] = (u16_t)(i + 1);
+  nd6_lru_insert_destination_cache_entry(i);
+}
+
+/** Remove an entry from the hash table and the LRU list */
+static void
+nd6_unlink_destination_cache_entry(s16_t i)
+{
+  u16_t *link = &nd6_dest_hash_table[nd6_destination_hash(&destination_cache[i].destination_addr)];
+  while (*link != 0) {
+    if (*link == (u16_t)(i + 1)) {
+      *link = destination_cache[i].hash_next;
+      break;
+    }
+    link = &destination_cache[*link - 1].hash_next;
+  }
+  destination_cache[i].hash_next = 0;
+  nd6_lru_remove_destination_cache_entry(i);
+}
+
+/** Mark an entry most recently used */
+static void
+nd6_touch_destination_cache_entry(s16_t i)
+{
+  if (nd6_dest_lru_head != (u16_t)(i + 1)) {
+    nd6_lru_remove_destination_cache_entry(i);
+    nd6_lru_insert_destination_cache_entry(i);
+  }
+}
+#endif /* LWIP_ND6_DESTINATION_HASH_SIZE */
+
 /**
  * Search for a destination cache entry
  *
@@ -1282,15 +1702,24 @@ nd6_free_neighbor_cache_entry(s8_t i)
  * @return The destination cache entry index that matched, -1 if no
  * entry is found
  */
-static s8_t
+static s16_t
 nd6_find_destination_cache_entry(const ip6_addr_t *ip6addr)
 {
-  s8_t i;
+#if LWIP_ND6_DESTINATION_HASH_SIZE
+  u16_t i;
+  for (i = nd6_dest_hash_table[nd6_destination_hash(ip6addr)]; i != 0; i = destination_cache[i - 1].hash_next) {
+    if (ip6_addr_cmp(ip6addr, &(destination_cache[i - 1].destination_addr))) {
+      return (s16_t)(i - 1);
+    }
+  }
+#else /* LWIP_ND6_DESTINATION_HASH_SIZE */
+  s16_t i;
   for (i = 0; i < LWIP_ND6_NUM_DESTINATIONS; i++) {
     if (ip6_addr_cmp(ip6addr, &(destination_cache[i].destination_addr))) {
       return i;
     }
   }
+#endif /* LWIP_ND6_DESTINATION_HASH_SIZE */
   return -1;
 }
 
@@ -1301,10 +1730,29 @@ nd6_find_destination_cache_entry(const ip6_addr_t *ip6addr)
  * @return The destination cache entry index that was created, -1 if no
  * entry was created
  */
-static s8_t
+static s16_t
 nd6_new_destination_cache_entry(void)
 {
-  s8_t i, j;
+#if LWIP_ND6_DESTINATION_HASH_SIZE
+  s16_t i;
+
+  if (nd6_dest_free != 0) {
+    /* reuse a freed entry */
+    i = (s16_t)(nd6_dest_free - 1);
+    nd6_dest_free = destination_cache[i].hash_next;
+    destination_cache[i].hash_next = 0;
+  } else if (nd6_dest_used < LWIP_ND6_NUM_DESTINATIONS) {
+    /* take a never used entry */
+    i = (s16_t)nd6_dest_used++;
+  } else {
+    /* recycle the least recently used entry */
+    i = (s16_t)(nd6_dest_lru_tail - 1);
+    nd6_unlink_destination_cache_entry(i);
+    ip6_addr_set_any(&destination_cache[i].destination_addr);
+  }
+  return i;
+#else /* LWIP_ND6_DESTINATION_HASH_SIZE */
+  s16_t i, j;
   u32_t age;
 
   /* Find an empty entry. */
@@ -1324,6 +1772,25 @@ nd6_new_destination_cache_entry(void)
   }
 
   return j;
+#endif /* LWIP_ND6_DESTINATION_HASH_SIZE */
+}
+
+/**
+ * Invalidate a destination cache entry.
+ *
+ * @param i the destination cache entry index
+ */
+static void
+nd6_free_destination_cache_entry(s16_t i)
+{
+#if LWIP_ND6_DESTINATION_HASH_SIZE
+  if (!ip6_addr_isany(&destination_cache[i].destination_addr)) {
+    nd6_unlink_destination_cache_entry(i);
+  }
+  destination_cache[i].hash_next = nd6_dest_free;
+  nd6_dest_free = (u16_t)(i + 1);
+#endif /* LWIP_ND6_DESTINATION_HASH_SIZE */
+  ip6_addr_set_any(&destination_cache[i].destination_addr);
 }
 
 /**
@@ -1340,6 +1807,12 @@ nd6_clear_destination_cache(void)
   for (i = 0; i < LWIP_ND6_NUM_DESTINATIONS; i++) {
     ip6_addr_set_any(&destination_cache[i].destination_addr);
   }
+#if LWIP_ND6_DESTINATION_HASH_SIZE
+  memset(nd6_dest_hash_table, 0, sizeof(nd6_dest_hash_table));
+  nd6_dest_lru_head = nd6_dest_lru_tail = 0;
+  nd6_dest_free = 0;
+  nd6_dest_used = 0;
+#endif /* LWIP_ND6_DESTINATION_HASH_SIZE */
 }
 
 /**
@@ -1490,7 +1963,7 @@ nd6_new_router(const ip6_addr_t *router_addr, struct netif *netif)
 {
   s8_t router_index;
   s8_t free_router_index;
-  s8_t neighbor_index;
+  s16_t neighbor_index;
 
   /* Do we have a neighbor entry for this router? */
   neighbor_index = nd6_find_neighbor_cache_entry(router_addr);
@@ -1502,10 +1975,12 @@ nd6_new_router(const ip6_addr_t *router_addr, struct netif *netif)
       return -1;
     }
     ip6_addr_set(&(neighbor_cache[neighbor_index].next_hop_address), router_addr);
+    nd6_link_neighbor_cache_entry(neighbor_index);
     neighbor_cache[neighbor_index].netif = netif;
     neighbor_cache[neighbor_index].q = NULL;
     neighbor_cache[neighbor_index].state = ND6_INCOMPLETE;
     neighbor_cache[neighbor_index].counter.probes_sent = 1;
+    nd6_schedule_neighbor_cache_entry(neighbor_index);
     nd6_send_neighbor_cache_probe(&neighbor_cache[neighbor_index], ND6_SEND_FLAG_MULTICAST_DEST);
   }
 
@@ -1605,18 +2080,22 @@ nd6_new_onlink_prefix(ip6_addr_t *prefix, struct netif *netif)
  *         suitable next hop was found, ERR_MEM if no cache entry
  *         could be created
  */
-static s8_t
+static s16_t
 nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
 {
 #ifdef LWIP_HOOK_ND6_GET_GW
   const ip6_addr_t *next_hop_addr;
 #endif /* LWIP_HOOK_ND6_GET_GW */
-  s8_t i;
+  s16_t i;
+  s16_t dest_idx;
+#if LWIP_IPV6_FIB
+  struct ip6_fib_entry *route;
+#endif /* LWIP_IPV6_FIB */
 
 #if LWIP_NETIF_HWADDRHINT
   if (netif->addr_hint != NULL) {
     /* per-pcb cached entry was given */
-    u8_t addr_hint = *(netif->addr_hint);
+    u16_t addr_hint = *(netif->addr_hint);
     if (addr_hint < LWIP_ND6_NUM_DESTINATIONS) {
       nd6_cached_destination_index = addr_hint;
     }
@@ -1630,16 +2109,16 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
     ND6_STATS_INC(nd6.cachehit);
   } else {
     /* Search destination cache. */
-    i = nd6_find_destination_cache_entry(ip6addr);
-    if (i >= 0) {
+    dest_idx = nd6_find_destination_cache_entry(ip6addr);
+    if (dest_idx >= 0) {
       /* found destination entry. make it our new cached index. */
-      nd6_cached_destination_index = i;
+      nd6_cached_destination_index = (u16_t)dest_idx;
     } else {
       /* Not found. Create a new destination entry. */
-      i = nd6_new_destination_cache_entry();
-      if (i >= 0) {
+      dest_idx = nd6_new_destination_cache_entry();
+      if (dest_idx >= 0) {
         /* got new destination entry. make it our new cached index. */
-        nd6_cached_destination_index = i;
+        nd6_cached_destination_index = (u16_t)dest_idx;
       } else {
         /* Could not create a destination cache entry. */
         return ERR_MEM;
@@ -1647,13 +2126,34 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
 
       /* Copy dest address to destination cache. */
       ip6_addr_set(&(destination_cache[nd6_cached_destination_index].destination_addr), ip6addr);
+      nd6_link_destination_cache_entry(dest_idx);
+
+#if LWIP_IPV6_FIB
+      route = NULL;
+      if (!ip6_addr_islinklocal(ip6addr)) {
+        route = ip6_fib_lookup(ip6addr);
+        if ((route != NULL) && (route->netif != netif)) {
+          route = NULL;
+        }
+      }
+#endif /* LWIP_IPV6_FIB */
 
       /* Now find the next hop. is it a neighbor? */
       if (ip6_addr_islinklocal(ip6addr) ||
-          nd6_is_prefix_in_netif(ip6addr, netif)) {
+          (ND6_FIB_ROUTE_ALLOWS_ONLINK(route) && nd6_is_prefix_in_netif(ip6addr, netif))) {
         /* Destination in local link. */
         destination_cache[nd6_cached_destination_index].pmtu = netif->mtu;
         ip6_addr_copy(destination_cache[nd6_cached_destination_index].next_hop_addr, destination_cache[nd6_cached_destination_index].destination_addr);
+#if LWIP_IPV6_FIB
+      } else if (route != NULL) {
+        /* Next hop for destination given by a static route. */
+        destination_cache[nd6_cached_destination_index].pmtu = netif->mtu;
+        if (ip6_addr_isany(&route->gw)) {
+          ip6_addr_copy(destination_cache[nd6_cached_destination_index].next_hop_addr, destination_cache[nd6_cached_destination_index].destination_addr);
+        } else {
+          ip6_addr_copy(destination_cache[nd6_cached_destination_index].next_hop_addr, route->gw);
+        }
+#endif /* LWIP_IPV6_FIB */
 #ifdef LWIP_HOOK_ND6_GET_GW
       } else if ((next_hop_addr = LWIP_HOOK_ND6_GET_GW(netif, ip6addr)) != NULL) {
         /* Next hop for destination provided by hook function. */
@@ -1665,7 +2165,7 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
         i = nd6_select_router(ip6addr, netif);
         if (i < 0) {
           /* No router found. */
-          ip6_addr_set_any(&(destination_cache[nd6_cached_destination_index].destination_addr));
+          nd6_free_destination_cache_entry(dest_idx);
           return ERR_RTE;
         }
         destination_cache[nd6_cached_destination_index].pmtu = netif->mtu; /* Start with netif mtu, correct through ICMPv6 if necessary */
@@ -1691,13 +2191,13 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
     i = nd6_find_neighbor_cache_entry(&(destination_cache[nd6_cached_destination_index].next_hop_addr));
     if (i >= 0) {
       /* Found a matching record, make it new cached entry. */
-      nd6_cached_neighbor_index = i;
+      nd6_cached_neighbor_index = (u16_t)i;
     } else {
       /* Neighbor not in cache. Make a new entry. */
       i = nd6_new_neighbor_cache_entry();
       if (i >= 0) {
         /* got new neighbor entry. make it our new cached index. */
-        nd6_cached_neighbor_index = i;
+        nd6_cached_neighbor_index = (u16_t)i;
       } else {
         /* Could not create a neighbor cache entry. */
         return ERR_MEM;
@@ -1706,18 +2206,21 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
       /* Initialize fields. */
       ip6_addr_copy(neighbor_cache[i].next_hop_address,
                    destination_cache[nd6_cached_destination_index].next_hop_addr);
+      nd6_link_neighbor_cache_entry(i);
       neighbor_cache[i].isrouter = 0;
       neighbor_cache[i].netif = netif;
       neighbor_cache[i].state = ND6_INCOMPLETE;
       neighbor_cache[i].counter.probes_sent = 1;
+      nd6_schedule_neighbor_cache_entry(i);
       nd6_send_neighbor_cache_probe(&neighbor_cache[i], ND6_SEND_FLAG_MULTICAST_DEST);
     }
   }
 
   /* Reset this destination's age. */
   destination_cache[nd6_cached_destination_index].age = 0;
+  nd6_touch_destination_cache_entry((s16_t)nd6_cached_destination_index);
 
-  return nd6_cached_neighbor_index;
+  return (s16_t)nd6_cached_neighbor_index;
 }
 
 /**
@@ -1728,13 +2231,16 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
  * @return ERR_OK if succeeded, ERR_MEM if out of memory
  */
 static err_t
-nd6_queue_packet(s8_t neighbor_index, struct pbuf *q)
+nd6_queue_packet(s16_t neighbor_index, struct pbuf *q)
 {
   err_t result = ERR_MEM;
   struct pbuf *p;
   int copy_needed = 0;
 #if LWIP_ND6_QUEUEING
   struct nd6_q_entry *new_entry, *r;
+#if LWIP_ND6_QUEUE_LEN
+  u16_t qlen;
+#endif /* LWIP_ND6_QUEUE_LEN */
 #endif /* LWIP_ND6_QUEUEING */
 
   if ((neighbor_index < 0) || (neighbor_index >= LWIP_ND6_NUM_NEIGHBORS)) {
@@ -1799,10 +2305,25 @@ nd6_queue_packet(s8_t neighbor_index, struct pbuf *q)
       if (neighbor_cache[neighbor_index].q != NULL) {
         /* queue was already existent, append the new entry to the end */
         r = neighbor_cache[neighbor_index].q;
+#if LWIP_ND6_QUEUE_LEN
+        qlen = 1;
+#endif /* LWIP_ND6_QUEUE_LEN */
         while (r->next != NULL) {
           r = r->next;
+#if LWIP_ND6_QUEUE_LEN
+          qlen++;
+#endif /* LWIP_ND6_QUEUE_LEN */
         }
         r->next = new_entry;
+#if LWIP_ND6_QUEUE_LEN
+        if (qlen >= LWIP_ND6_QUEUE_LEN) {
+          /* queue is full, free oldest packet (as per RFC recommendation) */
+          r = neighbor_cache[neighbor_index].q;
+          neighbor_cache[neighbor_index].q = r->next;
+          r->next = NULL;
+          nd6_free_q(r);
+        }
+#endif /* LWIP_ND6_QUEUE_LEN */
       } else {
         /* queue did not exist, first item in queue */
         neighbor_cache[neighbor_index].q = new_entry;
@@ -1860,7 +2381,7 @@ nd6_free_q(struct nd6_q_entry *q)
  * @param i the neighbor to send packets to
  */
 static void
-nd6_send_q(s8_t i)
+nd6_send_q(s16_t i)
 {
   struct ip6_hdr *ip6hdr;
   ip6_addr_t dest;
@@ -1929,20 +2450,22 @@ nd6_send_q(s8_t i)
 err_t
 nd6_get_next_hop_addr_or_queue(struct netif *netif, struct pbuf *q, const ip6_addr_t *ip6addr, const u8_t **hwaddrp)
 {
-  s8_t i;
+  s16_t i;
 
   /* Get next hop record. */
   i = nd6_get_next_hop_entry(ip6addr, netif);
   if (i < 0) {
     /* failed to get a next hop neighbor record. */
-    return i;
+    return (err_t)i;
   }
+  nd6_touch_neighbor_cache_entry(i);
 
   /* Now that we have a destination record, send or queue the packet. */
   if (neighbor_cache[i].state == ND6_STALE) {
     /* Switch to delay state. */
     neighbor_cache[i].state = ND6_DELAY;
     neighbor_cache[i].counter.delay_time = LWIP_ND6_DELAY_FIRST_PROBE_TIME / ND6_TMR_INTERVAL;
+    nd6_schedule_neighbor_cache_entry(i);
   }
   /* @todo should we send or queue if PROBE? send for now, to let unicast NS pass. */
   if ((neighbor_cache[i].state == ND6_REACHABLE) ||
@@ -1970,7 +2493,7 @@ nd6_get_next_hop_addr_or_queue(struct netif *netif, struct pbuf *q, const ip6_ad
 u16_t
 nd6_get_destination_mtu(const ip6_addr_t *ip6addr, struct netif *netif)
 {
-  s8_t i;
+  s16_t i;
 
   i = nd6_find_destination_cache_entry(ip6addr);
   if (i >= 0) {
@@ -2000,25 +2523,26 @@ nd6_get_destination_mtu(const ip6_addr_t *ip6addr, struct netif *netif)
 void
 nd6_reachability_hint(const ip6_addr_t *ip6addr)
 {
-  s8_t i;
+  s16_t i;
+  s16_t dest_idx;
 
   /* Find destination in cache. */
   if (ip6_addr_cmp(ip6addr, &(destination_cache[nd6_cached_destination_index].destination_addr))) {
-    i = nd6_cached_destination_index;
+    dest_idx = (s16_t)nd6_cached_destination_index;
     ND6_STATS_INC(nd6.cachehit);
   } else {
-    i = nd6_find_destination_cache_entry(ip6addr);
+    dest_idx = nd6_find_destination_cache_entry(ip6addr);
   }
-  if (i < 0) {
+  if (dest_idx < 0) {
     return;
   }
 
   /* Find next hop neighbor in cache. */
-  if (ip6_addr_cmp(&(destination_cache[i].next_hop_addr), &(neighbor_cache[nd6_cached_neighbor_index].next_hop_address))) {
-    i = nd6_cached_neighbor_index;
+  if (ip6_addr_cmp(&(destination_cache[dest_idx].next_hop_addr), &(neighbor_cache[nd6_cached_neighbor_index].next_hop_address))) {
+    i = (s16_t)nd6_cached_neighbor_index;
     ND6_STATS_INC(nd6.cachehit);
   } else {
-    i = nd6_find_neighbor_cache_entry(&(destination_cache[i].next_hop_addr));
+    i = nd6_find_neighbor_cache_entry(&(destination_cache[dest_idx].next_hop_addr));
   }
   if (i < 0) {
     return;
@@ -2032,6 +2556,7 @@ nd6_reachability_hint(const ip6_addr_t *ip6addr)
   /* Set reachability state. */
   neighbor_cache[i].state = ND6_REACHABLE;
   neighbor_cache[i].counter.reachable_time = reachable_time;
+  nd6_schedule_neighbor_cache_entry(i);
 }
 #endif /* LWIP_ND6_TCP_REACHABILITY_HINTS */
 
@@ -2043,7 +2568,7 @@ nd6_reachability_hint(const ip6_addr_t *ip6addr)
 void
 nd6_cleanup_netif(struct netif *netif)
 {
-  u8_t i;
+  u16_t i;
   s8_t router_index;
   for (i = 0; i < LWIP_ND6_NUM_PREFIXES; i++) {
     if (prefix_list[i].netif == netif) {
@@ -2060,7 +2585,7 @@ nd6_cleanup_netif(struct netif *netif)
         }
       }
       neighbor_cache[i].isrouter = 0;
-      nd6_free_neighbor_cache_entry(i);
+      nd6_free_neighbor_cache_entry((s16_t)i);
     }
   }
 }
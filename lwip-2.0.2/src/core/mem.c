@@ -7,6 +7,10 @@
  * If you want to use the standard C library malloc() instead, define
  * MEM_LIBC_MALLOC to 1 in your lwipopts.h
  *
+ * To let mem_malloc() use pages dedicated to fixed size classes (constant time
+ * allocation and bounded fragmentation without configuring pools), define
+ * MEM_USE_SLAB to 1 and MEM_SLAB_PAGE_SIZE to the page size to split the heap into.
+ *
  * To let mem_malloc() use pools (prevents fragmentation and is much faster than
  * a heap but might waste some memory), define MEM_USE_POOLS to 1, define
  * MEMP_USE_CUSTOM_POOLS to 1 and create a file "lwippools.h" that includes a list
@@ -62,10 +66,95 @@
 
 #include <string.h>
 
-#if MEM_LIBC_MALLOC
+#if MEM_LIBC_MALLOC || MEM_ARENA
 #include <stdlib.h> /* for malloc()/free() */
 #endif
 
+#if MEM_ARENA
+/** Unused rest of the chunk the arena currently allocates from */
+static u8_t *mem_arena_next;
+static size_t mem_arena_left;
+/** Size of the heap, see mem_set_size() */
+static mem_size_t mem_heap_size = MEM_SIZE;
+/** The heap, allocated from the arena by the first mem_init() */
+static u8_t *mem_heap;
+
+/**
+ * Allocate memory for a pool or the heap from the arena. The arena gets
+ * memory from the port in chunks of MEM_ARENA_CHUNK_SIZE bytes (or a
+ * multiple for big requests) through MEM_ARENA_ALLOC(). Arena memory is
+ * never freed.
+ *
+ * @param size number of bytes needed
+ * @return memory aligned to MEM_ALIGNMENT or NULL if there is no memory
+ */
+void *
+mem_arena_alloc(size_t size)
+{
+  u8_t *mem;
+  size_t chunk;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  size = (size + MEM_ALIGNMENT - 1) & ~(size_t)(MEM_ALIGNMENT - 1);
+  SYS_ARCH_PROTECT(lev);
+  if (size > mem_arena_left) {
+    /* start a new chunk, the rest of the current one is not used */
+    chunk = ((size + MEM_ALIGNMENT - 1 + MEM_ARENA_CHUNK_SIZE - 1) / MEM_ARENA_CHUNK_SIZE) * MEM_ARENA_CHUNK_SIZE;
+    mem = (u8_t *)MEM_ARENA_ALLOC(chunk);
+    if (mem == NULL) {
+      SYS_ARCH_UNPROTECT(lev);
+      LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("mem_arena_alloc: could not get %"SZT_F" bytes\n", chunk));
+      return NULL;
+    }
+    mem_arena_next = (u8_t *)LWIP_MEM_ALIGN(mem);
+    mem_arena_left = chunk - (size_t)(mem_arena_next - mem);
+  }
+  mem = mem_arena_next;
+  mem_arena_next += size;
+  mem_arena_left -= size;
+  SYS_ARCH_UNPROTECT(lev);
+  return mem;
+}
+
+/**
+ * Set the size of the heap. Must be called before lwip_init() (or mem_init()),
+ * the default is MEM_SIZE. Has no effect with MEM_LIBC_MALLOC or MEM_USE_POOLS.
+ * With MEM_USE_SLAB, sizes of more than 0xffff pages are rejected.
+ *
+ * @param size size of the heap in bytes
+ */
+void
+mem_set_size(mem_size_t size)
+{
+  LWIP_ASSERT("mem_set_size: heap is already set up", mem_heap == NULL);
+#if MEM_USE_SLAB && !MEM_LIBC_MALLOC && !MEM_USE_POOLS
+  /* pages are numbered with u16_t */
+  if (size / MEM_SLAB_PAGE_SIZE > 0xffff) {
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
+                ("mem_set_size: %"SZT_F" bytes is more than 65535 pages, keeping %"SZT_F" bytes\n",
+                 (size_t)size, (size_t)mem_heap_size));
+    return;
+  }
+#endif /* MEM_USE_SLAB && !MEM_LIBC_MALLOC && !MEM_USE_POOLS */
+  mem_heap_size = size;
+}
+
+/** Get the heap from the arena (only once, later calls return the same memory).
+ * On failure, the heap size is set to 0 so that all allocations fail. */
+static u8_t *
+mem_arena_heap(size_t size)
+{
+  if (mem_heap == NULL) {
+    mem_heap = (u8_t *)mem_arena_alloc(size);
+    LWIP_ASSERT("mem_init: no memory for the heap", mem_heap != NULL);
+    if (mem_heap == NULL) {
+      mem_heap_size = 0;
+    }
+  }
+  return mem_heap;
+}
+#endif /* MEM_ARENA */
+
 #if MEM_LIBC_MALLOC || MEM_USE_POOLS
 
 /** mem_init is not used when using pools instead of a heap or using
@@ -253,7 +342,471 @@ mem_free(void *rmem)
   memp_free(hmem->poolnr, hmem);
 }
 
-#else /* MEM_USE_POOLS */
+#elif MEM_USE_SLAB
+/* lwIP heap implemented as size-class slabs */
+
+/** Descriptor of one heap page (kept outside the page so that all of the
+ * page is usable and block addresses stay aligned) */
+struct mem_slab_page {
+  /** next/previous page in the free page list or in the partial list of the
+   *  size class this page belongs to */
+  struct mem_slab_page *next;
+  struct mem_slab_page *prev;
+  /** list of freed blocks */
+  void *free;
+  /** blocks in use (size class page) or number of pages (first page of a run,
+   *  first and last page of a free run) */
+  u16_t used;
+  /** blocks from this index on were never used */
+  u16_t bump;
+  /** size class, or one of the MEM_SLAB_PAGE_xxx values below */
+  u8_t cls;
+};
+
+/** page belongs to a run of free pages */
+#define MEM_SLAB_PAGE_FREE  0xff
+/** page starts a run of pages of a big allocation */
+#define MEM_SLAB_PAGE_RUN   0xfe
+/** page belongs to a run of pages of a big allocation, but not the first one */
+#define MEM_SLAB_PAGE_CONT  0xfd
+
+#if MEM_ARENA
+#define MEM_SLAB_NUM_PAGES  mem_slab_num_pages
+#else /* MEM_ARENA */
+#define MEM_SLAB_NUM_PAGES  (MEM_SIZE / MEM_SLAB_PAGE_SIZE)
+#endif /* MEM_ARENA */
+#if MEM_SIZE / MEM_SLAB_PAGE_SIZE > 0xffff
+#error "MEM_SIZE is too big for MEM_USE_SLAB: at most 0xffff pages of MEM_SLAB_PAGE_SIZE"
+#endif
+/** Number of free run lists: list i holds the free runs of 2^i up to
+ * 2^(i+1) - 1 pages */
+#define MEM_SLAB_RUN_LISTS  16
+/** Granularity of the size to class lookup table */
+#define MEM_SLAB_GRANULE    8
+/** Biggest request served from a size class: the biggest class used */
+#define MEM_SLAB_MAX_SMALL  mem_slab_sizes[MEM_SLAB_NUM_CLASSES - 1]
+
+#if MEM_ARENA
+/** the heap, split into pages, and the page descriptors come from the arena */
+#define LWIP_RAM_HEAP_POINTER mem_arena_heap((size_t)MEM_SLAB_NUM_PAGES * (MEM_SLAB_PAGE_SIZE + sizeof(struct mem_slab_page)))
+#endif /* MEM_ARENA */
+#ifndef LWIP_RAM_HEAP_POINTER
+/** the heap, split into pages */
+LWIP_DECLARE_MEMORY_ALIGNED(ram_heap, MEM_SLAB_NUM_PAGES * MEM_SLAB_PAGE_SIZE);
+#define LWIP_RAM_HEAP_POINTER ram_heap
+#endif /* LWIP_RAM_HEAP_POINTER */
+
+#define MEM_SLAB_CLASS_SIZE(size) size,
+static const u16_t mem_slab_sizes[] = {
+  MEM_SLAB_CLASSES(MEM_SLAB_CLASS_SIZE)
+};
+#if LWIP_STATS && MEM_STATS && (defined(LWIP_DEBUG) || LWIP_STATS_DISPLAY)
+#define MEM_SLAB_CLASS_NAME(size) "HEAP_" #size,
+static const char *const mem_slab_names[] = {
+  MEM_SLAB_CLASSES(MEM_SLAB_CLASS_NAME)
+};
+#endif /* LWIP_STATS && MEM_STATS && (defined(LWIP_DEBUG) || LWIP_STATS_DISPLAY) */
+
+/** pointer to the heap (ram_heap): for alignment, ram is now a pointer instead of an array */
+static u8_t *ram;
+#if MEM_ARENA
+static u16_t mem_slab_num_pages;
+/** page descriptors, placed behind the pages */
+static struct mem_slab_page *mem_slab_pages;
+#else /* MEM_ARENA */
+static struct mem_slab_page mem_slab_pages[MEM_SLAB_NUM_PAGES];
+#endif /* MEM_ARENA */
+/** runs of pages not in use, by length (see MEM_SLAB_RUN_LISTS) */
+static struct mem_slab_page *mem_slab_free_runs[MEM_SLAB_RUN_LISTS];
+/** per size class: pages with at least one unused block */
+static struct mem_slab_page *mem_slab_partial[MEM_SLAB_NUM_CLASSES];
+/** per size class: aligned block size and number of blocks per page */
+static u16_t mem_slab_size[MEM_SLAB_NUM_CLASSES];
+static u16_t mem_slab_per_page[MEM_SLAB_NUM_CLASSES];
+/** smallest size class for a request of up to (index * MEM_SLAB_GRANULE) bytes
+ * (the classes used are no bigger than half a page) */
+static u8_t mem_slab_class_of[(MEM_SLAB_PAGE_SIZE / 2 + MEM_SLAB_GRANULE - 1) / MEM_SLAB_GRANULE + 1];
+
+#define MEM_SLAB_PAGE_IDX(page)  ((u16_t)((page) - mem_slab_pages))
+#define MEM_SLAB_PAGE_MEM(page)  (&ram[(mem_size_t)MEM_SLAB_PAGE_IDX(page) * MEM_SLAB_PAGE_SIZE])
+
+static void
+mem_slab_link(struct mem_slab_page **list, struct mem_slab_page *page)
+{
+  page->prev = NULL;
+  page->next = *list;
+  if (*list != NULL) {
+    (*list)->prev = page;
+  }
+  *list = page;
+}
+
+static void
+mem_slab_unlink(struct mem_slab_page **list, struct mem_slab_page *page)
+{
+  if (page->prev != NULL) {
+    page->prev->next = page->next;
+  } else {
+    LWIP_ASSERT("page is list head", *list == page);
+    *list = page->next;
+  }
+  if (page->next != NULL) {
+    page->next->prev = page->prev;
+  }
+}
+
+/** Index of the free run list for a run of npages pages */
+static u8_t
+mem_slab_run_list(u16_t npages)
+{
+  u8_t list = 0;
+  while (npages > 1) {
+    npages >>= 1;
+    list++;
+  }
+  return list;
+}
+
+/** Put the free run of npages pages starting at page on its list. The first
+ * and the last page of a free run hold its length, so that a run freed next
+ * to it can be merged. */
+static void
+mem_slab_link_run(struct mem_slab_page *page, u16_t npages)
+{
+  page->used = npages;
+  page[npages - 1].used = npages;
+  mem_slab_link(&mem_slab_free_runs[mem_slab_run_list(npages)], page);
+}
+
+static void
+mem_slab_unlink_run(struct mem_slab_page *page)
+{
+  mem_slab_unlink(&mem_slab_free_runs[mem_slab_run_list(page->used)], page);
+}
+
+/**
+ * Take a run of npages pages from the free runs. Every run on the lists
+ * above the one of npages is long enough, so the first one found is taken;
+ * only if there is none, the list of npages itself is searched.
+ *
+ * @return first page of the run, NULL if there is no free run long enough
+ */
+static struct mem_slab_page *
+mem_slab_take_pages(u16_t npages)
+{
+  struct mem_slab_page *page = NULL;
+  u8_t list = mem_slab_run_list(npages);
+  u8_t i;
+  u16_t len;
+
+  /* a power of two fits every run on its own list */
+  for (i = (u8_t)(((npages & (npages - 1)) == 0) ? list : list + 1);
+       (i < MEM_SLAB_RUN_LISTS) && (page == NULL); i++) {
+    page = mem_slab_free_runs[i];
+  }
+  if (page == NULL) {
+    page = mem_slab_free_runs[list];
+    while ((page != NULL) && (page->used < npages)) {
+      page = page->next;
+    }
+    if (page == NULL) {
+      return NULL;
+    }
+  }
+  mem_slab_unlink_run(page);
+  len = page->used;
+  if (len > npages) {
+    /* the rest stays free */
+    mem_slab_link_run(&page[npages], (u16_t)(len - npages));
+  }
+  return page;
+}
+
+/** Give npages pages starting at page back, merged with free neighbours */
+static void
+mem_slab_release_pages(struct mem_slab_page *page, u16_t npages)
+{
+  u16_t i, next;
+
+  for (i = 0; i < npages; i++) {
+    page[i].cls = MEM_SLAB_PAGE_FREE;
+  }
+  if ((page > mem_slab_pages) && (page[-1].cls == MEM_SLAB_PAGE_FREE)) {
+    /* page[-1] is the last page of a free run */
+    struct mem_slab_page *prev = page - page[-1].used;
+    mem_slab_unlink_run(prev);
+    npages = (u16_t)(npages + prev->used);
+    page = prev;
+  }
+  next = (u16_t)(MEM_SLAB_PAGE_IDX(page) + npages);
+  if ((next < MEM_SLAB_NUM_PAGES) && (mem_slab_pages[next].cls == MEM_SLAB_PAGE_FREE)) {
+    /* mem_slab_pages[next] is the first page of a free run */
+    mem_slab_unlink_run(&mem_slab_pages[next]);
+    npages = (u16_t)(npages + mem_slab_pages[next].used);
+  }
+  mem_slab_link_run(page, npages);
+}
+
+/**
+ * Split the heap into pages and set up the size classes
+ */
+void
+mem_init(void)
+{
+  u16_t i;
+  u8_t cls;
+
+  LWIP_ASSERT("Sanity check alignment",
+    (MEM_SLAB_PAGE_SIZE & (MEM_ALIGNMENT-1)) == 0);
+
+#if MEM_ARENA
+  /* mem_set_size() keeps the number of pages within u16_t */
+  mem_slab_num_pages = (u16_t)(mem_heap_size / MEM_SLAB_PAGE_SIZE);
+#endif /* MEM_ARENA */
+  /* align the heap */
+  ram = (u8_t *)LWIP_MEM_ALIGN(LWIP_RAM_HEAP_POINTER);
+#if MEM_ARENA
+  if (ram == NULL) {
+    mem_slab_num_pages = 0;
+  }
+  mem_slab_pages = (struct mem_slab_page *)(void *)&ram[(mem_size_t)MEM_SLAB_NUM_PAGES * MEM_SLAB_PAGE_SIZE];
+#endif /* MEM_ARENA */
+
+  /* all pages form one free run, used from its lowest page on */
+  memset(mem_slab_free_runs, 0, sizeof(mem_slab_free_runs));
+  for (i = 0; i < MEM_SLAB_NUM_PAGES; i++) {
+    mem_slab_pages[i].cls = MEM_SLAB_PAGE_FREE;
+  }
+  if (MEM_SLAB_NUM_PAGES > 0) {
+    mem_slab_link_run(&mem_slab_pages[0], MEM_SLAB_NUM_PAGES);
+  }
+
+  for (cls = 0; cls < MEM_SLAB_NUM_CLASSES; cls++) {
+    mem_slab_partial[cls] = NULL;
+    mem_slab_size[cls] = LWIP_MEM_ALIGN_SIZE(mem_slab_sizes[cls]);
+    mem_slab_per_page[cls] = (u16_t)(MEM_SLAB_PAGE_SIZE / mem_slab_size[cls]);
+#if LWIP_STATS && MEM_STATS && (defined(LWIP_DEBUG) || LWIP_STATS_DISPLAY)
+    lwip_stats.mem_slab[cls].name = mem_slab_names[cls];
+#endif
+  }
+  cls = 0;
+  for (i = 0; i <= (MEM_SLAB_MAX_SMALL + MEM_SLAB_GRANULE - 1) / MEM_SLAB_GRANULE; i++) {
+    while (mem_slab_size[cls] < i * MEM_SLAB_GRANULE) {
+      cls++;
+    }
+    LWIP_ASSERT("size class lookup out of range", (cls < MEM_SLAB_NUM_CLASSES) &&
+      (i < LWIP_ARRAYSIZE(mem_slab_class_of)));
+    mem_slab_class_of[i] = cls;
+  }
+
+  MEM_STATS_AVAIL(avail, MEM_SLAB_NUM_PAGES * MEM_SLAB_PAGE_SIZE);
+}
+
+/**
+ * Allocate a block of memory with a minimum of 'size' bytes.
+ *
+ * @param size is the minimum size of the requested block in bytes.
+ * @return pointer to allocated memory or NULL if no free memory was found.
+ *
+ * Note that the returned value will always be aligned (as defined by MEM_ALIGNMENT).
+ */
+void *
+mem_malloc(mem_size_t size)
+{
+  struct mem_slab_page *page;
+  void *ret;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  if (size == 0) {
+    return NULL;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  if (size <= MEM_SLAB_MAX_SMALL) {
+    /* small block: take it from a page of its size class */
+    u8_t cls = mem_slab_class_of[(size + MEM_SLAB_GRANULE - 1) / MEM_SLAB_GRANULE];
+    page = mem_slab_partial[cls];
+    if (page == NULL) {
+      page = mem_slab_take_pages(1);
+      if (page == NULL) {
+        SYS_ARCH_UNPROTECT(lev);
+        LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("mem_malloc: could not allocate %"S16_F" bytes\n", (s16_t)size));
+        MEM_STATS_INC(err);
+        MEM_SLAB_STATS_INC(err, cls);
+        return NULL;
+      }
+      page->cls = cls;
+      page->free = NULL;
+      page->used = 0;
+      page->bump = 0;
+      mem_slab_link(&mem_slab_partial[cls], page);
+      MEM_SLAB_STATS_ADD_AVAIL(cls, mem_slab_per_page[cls]);
+    }
+    if (page->free != NULL) {
+      ret = page->free;
+      page->free = *(void **)ret;
+    } else {
+      ret = MEM_SLAB_PAGE_MEM(page) + (mem_size_t)page->bump * mem_slab_size[cls];
+      page->bump++;
+    }
+    page->used++;
+    if (page->used == mem_slab_per_page[cls]) {
+      /* page is full */
+      mem_slab_unlink(&mem_slab_partial[cls], page);
+    }
+    MEM_STATS_INC_USED(used, mem_slab_size[cls]);
+    MEM_SLAB_STATS_INC_USED(cls);
+  } else {
+    /* big block: a run of free pages */
+    u16_t npages = (u16_t)((size + MEM_SLAB_PAGE_SIZE - 1) / MEM_SLAB_PAGE_SIZE);
+    u16_t i;
+    page = mem_slab_take_pages(npages);
+    if (page == NULL) {
+      SYS_ARCH_UNPROTECT(lev);
+      LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("mem_malloc: could not allocate %"S16_F" bytes\n", (s16_t)size));
+      MEM_STATS_INC(err);
+      return NULL;
+    }
+    for (i = 1; i < npages; i++) {
+      page[i].cls = MEM_SLAB_PAGE_CONT;
+    }
+    page->cls = MEM_SLAB_PAGE_RUN;
+    page->used = npages;
+    ret = MEM_SLAB_PAGE_MEM(page);
+    MEM_STATS_INC_USED(used, (mem_size_t)npages * MEM_SLAB_PAGE_SIZE);
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  LWIP_ASSERT("mem_malloc: allocated memory properly aligned.",
+    ((mem_ptr_t)ret % MEM_ALIGNMENT) == 0);
+  return ret;
+}
+
+/** Get the descriptor of the page containing rmem, NULL for illegal pointers */
+static struct mem_slab_page *
+mem_slab_page_of(void *rmem)
+{
+  if (((u8_t *)rmem < ram) ||
+      ((u8_t *)rmem >= ram + (mem_size_t)MEM_SLAB_NUM_PAGES * MEM_SLAB_PAGE_SIZE)) {
+    return NULL;
+  }
+  return &mem_slab_pages[(mem_size_t)((u8_t *)rmem - ram) / MEM_SLAB_PAGE_SIZE];
+}
+
+/**
+ * Put memory back on the heap
+ *
+ * @param rmem is the pointer as returned by a previous call to mem_malloc()
+ */
+void
+mem_free(void *rmem)
+{
+  struct mem_slab_page *page;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  if (rmem == NULL) {
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_LEVEL_SERIOUS, ("mem_free(p == NULL) was called.\n"));
+    return;
+  }
+  LWIP_ASSERT("mem_free: sanity check alignment", (((mem_ptr_t)rmem) & (MEM_ALIGNMENT-1)) == 0);
+
+  page = mem_slab_page_of(rmem);
+  if (page == NULL) {
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SEVERE, ("mem_free: illegal memory\n"));
+    LWIP_ASSERT("mem_free: illegal memory", 0);
+    SYS_ARCH_PROTECT(lev);
+    MEM_STATS_INC(illegal);
+    SYS_ARCH_UNPROTECT(lev);
+    return;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  if (page->cls < MEM_SLAB_NUM_CLASSES) {
+    u8_t cls = page->cls;
+    LWIP_ASSERT("mem_free: not the start of a block",
+      (((u8_t *)rmem - MEM_SLAB_PAGE_MEM(page)) % mem_slab_size[cls]) == 0);
+    LWIP_ASSERT("mem_free: block already freed", page->used > 0);
+    if (page->used == mem_slab_per_page[cls]) {
+      /* page was full */
+      mem_slab_link(&mem_slab_partial[cls], page);
+    }
+    *(void **)rmem = page->free;
+    page->free = rmem;
+    page->used--;
+    if (page->used == 0) {
+      /* last block freed: the page can be used for any size class again */
+      mem_slab_unlink(&mem_slab_partial[cls], page);
+      mem_slab_release_pages(page, 1);
+      MEM_SLAB_STATS_SUB_AVAIL(cls, mem_slab_per_page[cls]);
+    }
+    MEM_STATS_DEC_USED(used, mem_slab_size[cls]);
+    MEM_SLAB_STATS_DEC_USED(cls);
+  } else if ((page->cls == MEM_SLAB_PAGE_RUN) && ((u8_t *)rmem == MEM_SLAB_PAGE_MEM(page))) {
+    u16_t npages = page->used;
+    mem_slab_release_pages(page, npages);
+    MEM_STATS_DEC_USED(used, (mem_size_t)npages * MEM_SLAB_PAGE_SIZE);
+  } else {
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SEVERE, ("mem_free: illegal memory: not allocated\n"));
+    LWIP_ASSERT("mem_free: illegal memory: not allocated", 0);
+    MEM_STATS_INC(illegal);
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Shrink memory returned by mem_malloc().
+ *
+ * Blocks of a size class keep their size, runs of pages give back the pages
+ * not needed any more.
+ *
+ * @param rmem pointer to memory allocated by mem_malloc the is to be shrinked
+ * @param newsize required size after shrinking (needs to be smaller than or
+ *                equal to the previous size)
+ * @return for compatibility reasons: is always == rmem, at the moment
+ *         or NULL if newsize is > old size, in which case rmem is NOT touched
+ *         or freed!
+ */
+void *
+mem_trim(void *rmem, mem_size_t newsize)
+{
+  struct mem_slab_page *page;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_ASSERT("mem_trim: sanity check alignment", (((mem_ptr_t)rmem) & (MEM_ALIGNMENT-1)) == 0);
+  page = mem_slab_page_of(rmem);
+  if (page == NULL) {
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SEVERE, ("mem_trim: illegal memory\n"));
+    SYS_ARCH_PROTECT(lev);
+    MEM_STATS_INC(illegal);
+    SYS_ARCH_UNPROTECT(lev);
+    return rmem;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  if (page->cls < MEM_SLAB_NUM_CLASSES) {
+    if (newsize > mem_slab_size[page->cls]) {
+      /* not supported */
+      rmem = NULL;
+    }
+  } else if (page->cls == MEM_SLAB_PAGE_RUN) {
+    u16_t npages = (u16_t)((newsize + MEM_SLAB_PAGE_SIZE - 1) / MEM_SLAB_PAGE_SIZE);
+    if (npages > page->used) {
+      /* not supported */
+      rmem = NULL;
+    } else if ((npages > 0) && (npages < page->used)) {
+      mem_slab_release_pages(&page[npages], (u16_t)(page->used - npages));
+      MEM_STATS_DEC_USED(used, (mem_size_t)(page->used - npages) * MEM_SLAB_PAGE_SIZE);
+      page->used = npages;
+    }
+  } else {
+    LWIP_ASSERT("mem_trim: illegal memory: not allocated", 0);
+    MEM_STATS_INC(illegal);
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  return rmem;
+}
+
+#else /* MEM_USE_SLAB */
 /* lwIP replacement for your libc malloc() */
 
 /**
@@ -279,7 +832,13 @@ struct mem {
 /* some alignment macros: we define them here for better source code layout */
 #define MIN_SIZE_ALIGNED     LWIP_MEM_ALIGN_SIZE(MIN_SIZE)
 #define SIZEOF_STRUCT_MEM    LWIP_MEM_ALIGN_SIZE(sizeof(struct mem))
+#if MEM_ARENA
+#define MEM_SIZE_ALIGNED     LWIP_MEM_ALIGN_SIZE(mem_heap_size)
+/** the heap comes from the arena */
+#define LWIP_RAM_HEAP_POINTER mem_arena_heap(MEM_SIZE_ALIGNED + (2U*SIZEOF_STRUCT_MEM))
+#else /* MEM_ARENA */
 #define MEM_SIZE_ALIGNED     LWIP_MEM_ALIGN_SIZE(MEM_SIZE)
+#endif /* MEM_ARENA */
 
 /** If you want to relocate the heap to external memory, simply define
  * LWIP_RAM_HEAP_POINTER as a void-pointer to that location.
@@ -388,6 +947,12 @@ mem_init(void)
 
   /* align the heap */
   ram = (u8_t *)LWIP_MEM_ALIGN(LWIP_RAM_HEAP_POINTER);
+#if MEM_ARENA
+  if (ram == NULL) {
+    /* no heap: the heap size is 0 now, so mem_malloc() always fails */
+    return;
+  }
+#endif /* MEM_ARENA */
   /* initialize the start of the heap */
   mem = (struct mem *)(void *)ram;
   mem->next = MEM_SIZE_ALIGNED;
@@ -741,7 +1306,7 @@ mem_malloc_adjust_lfree:
   return NULL;
 }
 
-#endif /* MEM_USE_POOLS */
+#endif /* MEM_USE_SLAB */
 
 #if MEM_LIBC_MALLOC && (!LWIP_STATS || !MEM_STATS)
 void *
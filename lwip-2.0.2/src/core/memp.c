@@ -46,6 +46,7 @@
 #include "lwip/opt.h"
 
 #include "lwip/memp.h"
+#include "lwip/mem.h"
 #include "lwip/sys.h"
 #include "lwip/stats.h"
 
@@ -58,6 +59,7 @@
 #include "lwip/tcp.h"
 #include "lwip/priv/tcp_priv.h"
 #include "lwip/ip4_frag.h"
+#include "lwip/ip4_fib.h"
 #include "lwip/netbuf.h"
 #include "lwip/api.h"
 #include "lwip/priv/tcpip_priv.h"
@@ -73,6 +75,7 @@
 #include "lwip/dns.h"
 #include "lwip/priv/nd6_priv.h"
 #include "lwip/ip6_frag.h"
+#include "lwip/ip6_fib.h"
 #include "lwip/mld6.h"
 
 #define LWIP_MEMPOOL(name,num,size,desc) LWIP_MEMPOOL_DECLARE(name,num,size,desc)
@@ -202,7 +205,8 @@ memp_overflow_init_element(struct memp *p, const struct memp_desc *desc)
 static void
 memp_overflow_check_all(void)
 {
-  u16_t i, j;
+  u16_t i;
+  u32_t j;
   struct memp *p;
   SYS_ARCH_DECL_PROTECT(old_level);
   SYS_ARCH_PROTECT(old_level);
@@ -220,6 +224,60 @@ memp_overflow_check_all(void)
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 #endif /* MEMP_OVERFLOW_CHECK */
 
+#if MEMP_MAGAZINE
+/** Per-thread cache of free elements of one pool: the elements are linked
+ * through their struct memp. The 'previous' magazine is always either full
+ * or empty, so a thread alternating between allocating and freeing around a
+ * magazine boundary does not go to the pool every time (see Bonwick & Adams,
+ * "Magazines and Vmem", USENIX 2001). */
+struct memp_magazine {
+  struct memp *loaded;
+  struct memp *previous;
+  u16_t loaded_cnt;
+  u16_t previous_cnt;
+  /** value of memp_magazine_drain[] when this magazine last saw it */
+  u16_t drain;
+};
+
+static LWIP_THREAD_LOCAL struct memp_magazine memp_magazines[MEMP_MAX];
+
+/** Elements per magazine of each pool: MEMP_MAGAZINE_SIZE, but at most an
+ * eighth of the pool, so one thread never caches more than a quarter of it.
+ * 0 for pools too small to be cached. */
+static u16_t memp_magazine_size[MEMP_MAX];
+
+/** Incremented when a thread finds a pool empty: all other threads give
+ * back the elements they cache at their next memp_malloc()/memp_free() */
+static volatile u16_t memp_magazine_drain[MEMP_MAX];
+#endif /* MEMP_MAGAZINE */
+
+#if MEMP_PRESSURE
+/** Memory pressure watermarks of one pool in elements (high == 0: not watched) */
+struct memp_watermarks {
+  mem_size_t low;
+  mem_size_t high;
+};
+
+static struct memp_watermarks memp_watermarks[MEMP_MAX];
+static memp_pressure_fn memp_pressure_callback;
+
+/** Current pressure level: 0 .. MEMP_PRESSURE_MAX */
+u8_t memp_pressure_level;
+/** Set when a watched pool reached its high watermark, cleared when all
+ * watched pools are back at or below their low watermark */
+u8_t memp_pressure_active;
+
+/** Pools watched by default: the ones holding packet data. The PBUF_POOL
+ * size classes are left out, allocations fall back to the other classes. */
+static const memp_t memp_pressure_default_pools[] = {
+  MEMP_PBUF,
+  MEMP_PBUF_POOL,
+#if LWIP_TCP
+  MEMP_TCP_SEG,
+#endif /* LWIP_TCP */
+};
+#endif /* MEMP_PRESSURE */
+
 /**
  * Initialize custom memory pool.
  * Related functions: memp_malloc_pool, memp_free_pool
@@ -232,9 +290,25 @@ memp_init_pool(const struct memp_desc *desc)
 #if MEMP_MEM_MALLOC
   LWIP_UNUSED_ARG(desc);
 #else
-  int i;
+  u32_t i;
   struct memp *memp;
 
+#if MEM_ARENA
+  if (desc->base == NULL) {
+    /* first initialization: get the memory from the arena */
+    struct memp_desc *arena_desc = LWIP_CONST_CAST(struct memp_desc *, desc);
+    arena_desc->base = (u8_t *)mem_arena_alloc((size_t)desc->num * (MEMP_SIZE + desc->size
+#if MEMP_OVERFLOW_CHECK
+      + MEMP_SANITY_REGION_AFTER_ALIGNED
+#endif
+      ));
+    LWIP_ASSERT("memp_init_pool: no memory for the pool", desc->base != NULL);
+    if (desc->base == NULL) {
+      arena_desc->num = 0;
+    }
+  }
+#endif /* MEM_ARENA */
+
   *desc->tab = NULL;
   memp = (struct memp*)LWIP_MEM_ALIGN(desc->base);
   /* create a linked list of memp elements */
@@ -261,6 +335,26 @@ memp_init_pool(const struct memp_desc *desc)
 #endif /* MEMP_STATS && (defined(LWIP_DEBUG) || LWIP_STATS_DISPLAY) */
 }
 
+#if MEM_ARENA && !MEMP_MEM_MALLOC
+/**
+ * Set the number of elements of a pool. Must be called before lwip_init()
+ * (or memp_init()), the default is the number given in lwipopts.h.
+ *
+ * @param type the pool to resize
+ * @param num number of elements
+ */
+void
+memp_set_num(memp_t type, u32_t num)
+{
+  struct memp_desc *desc;
+
+  LWIP_ERROR("memp_set_num: type < MEMP_MAX", (type < MEMP_MAX), return;);
+  desc = LWIP_CONST_CAST(struct memp_desc *, memp_pools[type]);
+  LWIP_ASSERT("memp_set_num: pool is already set up", desc->base == NULL);
+  desc->num = num;
+}
+#endif /* MEM_ARENA && !MEMP_MEM_MALLOC */
+
 /**
  * Initializes lwIP built-in pools.
  * Related functions: memp_malloc, memp_free
@@ -281,12 +375,265 @@ memp_init(void)
 #endif
   }
 
+#if MEMP_MAGAZINE
+  /* elements cached by this thread belonged to the old pools */
+  memset(memp_magazines, 0, sizeof(memp_magazines));
+  for (i = 0; i < MEMP_MAX; i++) {
+    memp_magazine_size[i] = (u16_t)LWIP_MIN(MEMP_MAGAZINE_SIZE, memp_pools[i]->num / 8);
+    memp_magazine_drain[i] = 0;
+  }
+#endif /* MEMP_MAGAZINE */
+
+#if MEMP_PRESSURE
+  memset(memp_watermarks, 0, sizeof(memp_watermarks));
+  for (i = 0; i < LWIP_ARRAYSIZE(memp_pressure_default_pools); i++) {
+    mem_size_t num = memp_pools[memp_pressure_default_pools[i]]->stats->avail;
+    memp_set_watermarks(memp_pressure_default_pools[i],
+      (mem_size_t)((u64_t)num * MEMP_PRESSURE_LOWAT / 100),
+      (mem_size_t)((u64_t)num * MEMP_PRESSURE_HIWAT / 100));
+  }
+  memp_pressure_level = 0;
+  memp_pressure_active = 0;
+#endif /* MEMP_PRESSURE */
+
 #if MEMP_OVERFLOW_CHECK >= 2
   /* check everything a first time to see if it worked */
   memp_overflow_check_all();
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 }
 
+#if MEMP_MAGAZINE
+/**
+ * Fill the (empty) loaded magazine with up to memp_magazine_size[type]
+ * elements from the pool. If the pool is empty, ask the other threads to
+ * give back the elements they cache.
+ *
+ * @return the number of elements taken from the pool
+ */
+static u16_t
+memp_magazine_refill(memp_t type, struct memp_magazine *mag)
+{
+  const struct memp_desc *desc = memp_pools[type];
+  struct memp *memp, *last = NULL;
+  u16_t cnt = 0;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  SYS_ARCH_PROTECT(old_level);
+  memp = *desc->tab;
+  mag->loaded = memp;
+  while ((memp != NULL) && (cnt < memp_magazine_size[type])) {
+    last = memp;
+    memp = memp->next;
+    cnt++;
+  }
+  if (last != NULL) {
+    last->next = NULL;
+  }
+  *desc->tab = memp;
+  if (cnt == 0) {
+    memp_magazine_drain[type]++;
+    mag->drain = memp_magazine_drain[type];
+#if MEMP_STATS
+    desc->stats->err++;
+#endif /* MEMP_STATS */
+  }
+  SYS_ARCH_UNPROTECT(old_level);
+
+  mag->loaded_cnt = cnt;
+  return cnt;
+}
+
+/**
+ * Put a magazine of 'cnt' elements back into the pool of type 'type'.
+ */
+static void
+memp_magazine_return(memp_t type, struct memp *first, u16_t cnt)
+{
+  const struct memp_desc *desc = memp_pools[type];
+  struct memp *last = first;
+  struct memp *old_first;
+  u16_t i;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  /* find the end of the list before locking the pool */
+  for (i = 1; i < cnt; i++) {
+    last = last->next;
+  }
+  LWIP_ASSERT("magazine count mismatch", last->next == NULL);
+
+  SYS_ARCH_PROTECT(old_level);
+  old_first = *desc->tab;
+  last->next = old_first;
+  *desc->tab = first;
+#if MEMP_SANITY_CHECK
+  LWIP_ASSERT("memp sanity", memp_sanity(desc));
+#endif /* MEMP_SANITY_CHECK */
+  SYS_ARCH_UNPROTECT(old_level);
+
+#ifdef LWIP_HOOK_MEMP_AVAILABLE
+  if (old_first == NULL) {
+    LWIP_HOOK_MEMP_AVAILABLE(type);
+  }
+#else /* LWIP_HOOK_MEMP_AVAILABLE */
+  LWIP_UNUSED_ARG(old_first);
+#endif /* LWIP_HOOK_MEMP_AVAILABLE */
+}
+
+/**
+ * Return both magazines of the calling thread for pool 'type' to the pool.
+ */
+static void
+memp_magazine_empty(memp_t type, struct memp_magazine *mag)
+{
+  if (mag->loaded_cnt > 0) {
+    memp_magazine_return(type, mag->loaded, mag->loaded_cnt);
+  }
+  if (mag->previous_cnt > 0) {
+    memp_magazine_return(type, mag->previous, mag->previous_cnt);
+  }
+  mag->loaded = mag->previous = NULL;
+  mag->loaded_cnt = mag->previous_cnt = 0;
+}
+
+/**
+ * Give back the cached elements of pool 'type' if another thread found the
+ * pool empty since the calling thread last looked.
+ */
+static void
+memp_magazine_check_drain(memp_t type, struct memp_magazine *mag)
+{
+  u16_t drain = memp_magazine_drain[type];
+
+  if (mag->drain != drain) {
+    mag->drain = drain;
+    memp_magazine_empty(type, mag);
+  }
+}
+
+#if MEMP_STATS
+/**
+ * Count elements handed out from (n > 0) or given back to (n < 0) the
+ * magazines: elements cached in magazines do not count as used. Only this
+ * function changes the counters of cached pools, with atomic operations, so
+ * the fast path does not take SYS_ARCH_PROTECT.
+ */
+static void
+memp_magazine_stats(const struct memp_desc *desc, s16_t n)
+{
+  mem_size_t used = LWIP_ATOMIC_ADD(&desc->stats->used, (mem_size_t)n);
+  mem_size_t max = desc->stats->max;
+
+  while ((used > max) && !LWIP_ATOMIC_CAS(&desc->stats->max, &max, used)) {
+    /* another thread raised max meanwhile: compare with its value */
+  }
+}
+#endif /* MEMP_STATS */
+
+/**
+ * Get an element of pool 'type' from the calling thread's magazines,
+ * refilling them from the pool if they are empty.
+ */
+static void *
+#if !MEMP_OVERFLOW_CHECK
+memp_magazine_malloc(memp_t type)
+#else
+memp_magazine_malloc_fn(memp_t type, const char* file, const int line)
+#endif
+{
+  struct memp_magazine *mag = &memp_magazines[type];
+  struct memp *memp;
+
+  memp_magazine_check_drain(type, mag);
+  if (mag->loaded_cnt == 0) {
+    if (mag->previous_cnt > 0) {
+      /* previous is full: swap */
+      memp = mag->loaded;
+      mag->loaded = mag->previous;
+      mag->loaded_cnt = mag->previous_cnt;
+      mag->previous = memp;
+      mag->previous_cnt = 0;
+    } else if (memp_magazine_refill(type, mag) == 0) {
+      LWIP_DEBUGF(MEMP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("memp_malloc: out of memory in pool %s\n", memp_pools[type]->desc));
+      return NULL;
+    }
+  }
+  memp = mag->loaded;
+  mag->loaded = memp->next;
+  mag->loaded_cnt--;
+
+#if MEMP_OVERFLOW_CHECK
+#if MEMP_OVERFLOW_CHECK == 1
+  memp_overflow_check_element_overflow(memp, memp_pools[type]);
+  memp_overflow_check_element_underflow(memp, memp_pools[type]);
+#endif /* MEMP_OVERFLOW_CHECK == 1 */
+  memp->next = NULL;
+  memp->file = file;
+  memp->line = line;
+#endif /* MEMP_OVERFLOW_CHECK */
+#if MEMP_STATS
+  memp_magazine_stats(memp_pools[type], 1);
+#endif /* MEMP_STATS */
+  LWIP_ASSERT("memp_malloc: memp properly aligned",
+              ((mem_ptr_t)memp % MEM_ALIGNMENT) == 0);
+  /* cast through u8_t* to get rid of alignment warnings */
+  return ((u8_t*)memp + MEMP_SIZE);
+}
+
+/**
+ * Put an element of pool 'type' into the calling thread's magazines,
+ * returning a full magazine to the pool if both are full.
+ */
+static void
+memp_magazine_free(memp_t type, void *mem)
+{
+  struct memp_magazine *mag = &memp_magazines[type];
+  struct memp *memp;
+
+  LWIP_ASSERT("memp_free: mem properly aligned",
+              ((mem_ptr_t)mem % MEM_ALIGNMENT) == 0);
+
+  /* cast through void* to get rid of alignment warnings */
+  memp = (struct memp *)(void *)((u8_t*)mem - MEMP_SIZE);
+#if MEMP_OVERFLOW_CHECK == 1
+  memp_overflow_check_element_overflow(memp, memp_pools[type]);
+  memp_overflow_check_element_underflow(memp, memp_pools[type]);
+#endif /* MEMP_OVERFLOW_CHECK == 1 */
+#if MEMP_STATS
+  memp_magazine_stats(memp_pools[type], -1);
+#endif /* MEMP_STATS */
+
+  memp_magazine_check_drain(type, mag);
+  if (mag->loaded_cnt == memp_magazine_size[type]) {
+    if (mag->previous_cnt > 0) {
+      LWIP_ASSERT("previous magazine is full", mag->previous_cnt == memp_magazine_size[type]);
+      memp_magazine_return(type, mag->previous, mag->previous_cnt);
+    }
+    /* loaded is full, previous is empty now: swap */
+    mag->previous = mag->loaded;
+    mag->previous_cnt = mag->loaded_cnt;
+    mag->loaded = NULL;
+    mag->loaded_cnt = 0;
+  }
+  memp->next = mag->loaded;
+  mag->loaded = memp;
+  mag->loaded_cnt++;
+}
+
+/**
+ * Return all elements cached by the calling thread to their pools.
+ * Must be called by every thread using memp_malloc() before it exits.
+ */
+void
+memp_magazine_flush(void)
+{
+  u16_t i;
+
+  for (i = 0; i < MEMP_MAX; i++) {
+    memp_magazine_empty((memp_t)i, &memp_magazines[i]);
+  }
+}
+#endif /* MEMP_MAGAZINE */
+
 static void*
 #if !MEMP_OVERFLOW_CHECK
 do_memp_malloc_pool(const struct memp_desc *desc)
@@ -394,6 +741,17 @@ memp_malloc_fn(memp_t type, const char* file, const int line)
   memp_overflow_check_all();
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 
+#if MEMP_MAGAZINE
+  if (memp_magazine_size[type] > 0) {
+#if !MEMP_OVERFLOW_CHECK
+    return memp_magazine_malloc(type);
+#else
+    return memp_magazine_malloc_fn(type, file, line);
+#endif
+  }
+  /* pools too small to be cached are used directly */
+#endif /* MEMP_MAGAZINE */
+
 #if !MEMP_OVERFLOW_CHECK
   memp = do_memp_malloc_pool(memp_pools[type]);
 #else
@@ -482,6 +840,13 @@ memp_free(memp_t type, void *mem)
   memp_overflow_check_all();
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 
+#if MEMP_MAGAZINE
+  if (memp_magazine_size[type] > 0) {
+    memp_magazine_free(type, mem);
+    return;
+  }
+#endif /* MEMP_MAGAZINE */
+
 #ifdef LWIP_HOOK_MEMP_AVAILABLE
   old_first = *memp_pools[type]->tab;
 #endif
@@ -494,3 +859,110 @@ memp_free(memp_t type, void *mem)
   }
 #endif
 }
+
+#if MEMP_PRESSURE
+/**
+ * Set the memory pressure watermarks of a pool. Call after lwip_init(),
+ * which sets the defaults (MEMP_PRESSURE_LOWAT/MEMP_PRESSURE_HIWAT).
+ *
+ * @param type the pool to watch
+ * @param low number of used elements up to which the pool is not under pressure
+ * @param high number of used elements at which the pressure is at its maximum,
+ *        0 to stop watching the pool
+ */
+void
+memp_set_watermarks(memp_t type, mem_size_t low, mem_size_t high)
+{
+  LWIP_ERROR("memp_set_watermarks: type < MEMP_MAX", (type < MEMP_MAX), return;);
+  LWIP_ERROR("memp_set_watermarks: low < high", (high == 0) || (low < high), return;);
+
+  memp_watermarks[type].low = low;
+  memp_watermarks[type].high = high;
+}
+
+/**
+ * Set the function called (from the stack thread) whenever the memory
+ * pressure level changes.
+ *
+ * @param fn callback function, NULL to disable
+ */
+void
+memp_pressure_set_callback(memp_pressure_fn fn)
+{
+  memp_pressure_callback = fn;
+}
+
+/**
+ * Update memp_pressure_level and memp_pressure_active from the fill level of
+ * the watched pools. The 'used' counters are read without locking the pools:
+ * the result is an estimate, which is all that is needed here.
+ */
+void
+memp_pressure_update(void)
+{
+  const struct memp_watermarks *wm;
+  mem_size_t used;
+  memp_t fullest = MEMP_MAX;
+  u8_t level = 0, pool_level;
+  u8_t above_low = 0;
+  u16_t i;
+
+  for (i = 0; i < MEMP_MAX; i++) {
+    wm = &memp_watermarks[i];
+    if (wm->high == 0) {
+      continue;
+    }
+    used = memp_pools[i]->stats->used;
+    if (used <= wm->low) {
+      pool_level = 0;
+    } else if (used >= wm->high) {
+      pool_level = MEMP_PRESSURE_MAX;
+    } else {
+      pool_level = (u8_t)(((u64_t)(used - wm->low) * MEMP_PRESSURE_MAX) / (u64_t)(wm->high - wm->low));
+    }
+    if (used > wm->low) {
+      above_low = 1;
+    }
+    if ((fullest == MEMP_MAX) || (pool_level > level)) {
+      fullest = (memp_t)i;
+      level = pool_level;
+    }
+  }
+
+  if (level == MEMP_PRESSURE_MAX) {
+    if (!memp_pressure_active) {
+      LWIP_DEBUGF(MEMP_DEBUG | LWIP_DBG_STATE, ("memp_pressure: pool %s at its high watermark\n", memp_pools[fullest]->desc));
+    }
+    memp_pressure_active = 1;
+  } else if (!above_low) {
+    if (memp_pressure_active) {
+      LWIP_DEBUGF(MEMP_DEBUG | LWIP_DBG_STATE, ("memp_pressure: all pools below their low watermark\n"));
+    }
+    memp_pressure_active = 0;
+  }
+
+  if (level != memp_pressure_level) {
+    memp_pressure_level = level;
+    if (memp_pressure_callback != NULL) {
+      memp_pressure_callback(fullest, level);
+    }
+  }
+}
+
+/**
+ * Memory pressure timer: updates the pressure level and lets TCP react.
+ * Called every MEMP_PRESSURE_INTERVAL milliseconds.
+ */
+void
+memp_pressure_tmr(void)
+{
+#if LWIP_TCP
+  u8_t prev_level = memp_pressure_level;
+#endif /* LWIP_TCP */
+
+  memp_pressure_update();
+#if LWIP_TCP
+  tcp_memp_pressure(prev_level);
+#endif /* LWIP_TCP */
+}
+#endif /* MEMP_PRESSURE */
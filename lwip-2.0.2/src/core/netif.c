@@ -88,6 +88,12 @@
 #if LWIP_IPV6
 #include "lwip/nd6.h"
 #endif
+#if LWIP_IPV4_FIB
+#include "lwip/ip4_fib.h"
+#endif /* LWIP_IPV4_FIB */
+#if LWIP_IPV6 && LWIP_IPV6_FIB
+#include "lwip/ip6_fib.h"
+#endif /* LWIP_IPV6 && LWIP_IPV6_FIB */
 
 #if LWIP_NETIF_STATUS_CALLBACK
 #define NETIF_STATUS_CALLBACK(n) do{ if (n->status_callback) { (n->status_callback)(n); }}while(0)
@@ -308,6 +314,9 @@ netif_add(struct netif *netif,
 
   /* call user specified initialization function for netif */
   if (init(netif) != ERR_OK) {
+#if LWIP_IPV4_FIB
+    ip4_fib_netif_remove(netif);
+#endif /* LWIP_IPV4_FIB */
     return NULL;
   }
 
@@ -315,6 +324,10 @@ netif_add(struct netif *netif,
   netif->next = netif_list;
   netif_list = netif;
   mib2_netif_added(netif);
+#if LWIP_IPV4_FIB
+  /* init() may have changed the netif flags (point to point or not) */
+  ip4_fib_netif_update(netif);
+#endif /* LWIP_IPV4_FIB */
 
 #if LWIP_IGMP
   /* start IGMP processing */
@@ -452,6 +465,12 @@ netif_remove(struct netif *netif)
       return; /* netif is not on the list */
     }
   }
+#if LWIP_IPV4_FIB
+  ip4_fib_netif_remove(netif);
+#endif /* LWIP_IPV4_FIB */
+#if LWIP_IPV6 && LWIP_IPV6_FIB
+  ip6_fib_netif_remove(netif);
+#endif /* LWIP_IPV6 && LWIP_IPV6_FIB */
   mib2_netif_removed(netif);
 #if LWIP_NETIF_REMOVE_CALLBACK
   if (netif->remove_callback) {
@@ -530,6 +549,9 @@ netif_set_ipaddr(struct netif *netif, const ip4_addr_t *ipaddr)
     IP_SET_TYPE_VAL(netif->ip_addr, IPADDR_TYPE_V4);
     mib2_add_ip4(netif);
     mib2_add_route_ip4(0, netif);
+#if LWIP_IPV4_FIB
+    ip4_fib_netif_update(netif);
+#endif /* LWIP_IPV4_FIB */
 
     netif_issue_reports(netif, NETIF_REPORT_TYPE_IPV4);
 
@@ -558,6 +580,9 @@ netif_set_gw(struct netif *netif, const ip4_addr_t *gw)
 {
   ip4_addr_set(ip_2_ip4(&netif->gw), gw);
   IP_SET_TYPE_VAL(netif->gw, IPADDR_TYPE_V4);
+#if LWIP_IPV4_FIB
+  ip4_fib_netif_update(netif);
+#endif /* LWIP_IPV4_FIB */
   LWIP_DEBUGF(NETIF_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("netif: GW address of interface %c%c set to %"U16_F".%"U16_F".%"U16_F".%"U16_F"\n",
     netif->name[0], netif->name[1],
     ip4_addr1_16(netif_ip4_gw(netif)),
@@ -584,6 +609,9 @@ netif_set_netmask(struct netif *netif, const ip4_addr_t *netmask)
   ip4_addr_set(ip_2_ip4(&netif->netmask), netmask);
   IP_SET_TYPE_VAL(netif->netmask, IPADDR_TYPE_V4);
   mib2_add_route_ip4(0, netif);
+#if LWIP_IPV4_FIB
+  ip4_fib_netif_update(netif);
+#endif /* LWIP_IPV4_FIB */
   LWIP_DEBUGF(NETIF_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("netif: netmask of interface %c%c set to %"U16_F".%"U16_F".%"U16_F".%"U16_F"\n",
     netif->name[0], netif->name[1],
     ip4_addr1_16(netif_ip4_netmask(netif)),
@@ -611,6 +639,9 @@ netif_set_default(struct netif *netif)
     mib2_add_route_ip4(1, netif);
   }
   netif_default = netif;
+#if LWIP_IPV4_FIB
+  ip4_fib_invalidate();
+#endif /* LWIP_IPV4_FIB */
   LWIP_DEBUGF(NETIF_DEBUG, ("netif: setting default interface %c%c\n",
            netif ? netif->name[0] : '\'', netif ? netif->name[1] : '\''));
 }
@@ -625,6 +656,9 @@ netif_set_up(struct netif *netif)
 {
   if (!(netif->flags & NETIF_FLAG_UP)) {
     netif->flags |= NETIF_FLAG_UP;
+#if LWIP_IPV4_FIB
+    ip4_fib_invalidate();
+#endif /* LWIP_IPV4_FIB */
 
     MIB2_COPY_SYSUPTIME_TO(&netif->ts);
 
@@ -683,6 +717,9 @@ netif_set_down(struct netif *netif)
 {
   if (netif->flags & NETIF_FLAG_UP) {
     netif->flags &= ~NETIF_FLAG_UP;
+#if LWIP_IPV4_FIB
+    ip4_fib_invalidate();
+#endif /* LWIP_IPV4_FIB */
     MIB2_COPY_SYSUPTIME_TO(&netif->ts);
 
 #if LWIP_IPV4 && LWIP_ARP
@@ -736,6 +773,9 @@ netif_set_link_up(struct netif *netif)
 {
   if (!(netif->flags & NETIF_FLAG_LINK_UP)) {
     netif->flags |= NETIF_FLAG_LINK_UP;
+#if LWIP_IPV4_FIB
+    ip4_fib_invalidate();
+#endif /* LWIP_IPV4_FIB */
 
 #if LWIP_DHCP
     dhcp_network_changed(netif);
@@ -761,6 +801,9 @@ netif_set_link_down(struct netif *netif )
 {
   if (netif->flags & NETIF_FLAG_LINK_UP) {
     netif->flags &= ~NETIF_FLAG_LINK_UP;
+#if LWIP_IPV4_FIB
+    ip4_fib_invalidate();
+#endif /* LWIP_IPV4_FIB */
     NETIF_LINK_CALLBACK(netif);
   }
 }
@@ -844,6 +887,13 @@ netif_loop_output(struct netif *netif, struct pbuf *p)
     MIB2_STATS_NETIF_INC(stats_if, ifoutdiscards);
     return err;
   }
+#if LWIP_CHECKSUM_OFFLOAD
+  /* a checksum left to the driver is never computed for looped packets:
+     they cannot be corrupted on the way, so skip the check on input */
+  if (r->flags & PBUF_FLAG_CHKSUM_PARTIAL) {
+    r->flags = (u8_t)((r->flags & ~PBUF_FLAG_CHKSUM_PARTIAL) | PBUF_FLAG_CHKSUM_VERIFIED);
+  }
+#endif /* LWIP_CHECKSUM_OFFLOAD */
 
   /* Put the packet on a linked list which gets emptied through calling
      netif_poll(). */
@@ -125,12 +125,87 @@ void eth_rx_irq()
 #endif
 
 #include <string.h>
+#if PBUF_ATOMIC_REF
+#include <stdatomic.h>
+#if ATOMIC_SHORT_LOCK_FREE != 2
+/* C++ and pre-C11 code sees pbuf->ref as a plain u16_t (LWIP_PBUF_REF_T) */
+#error "PBUF_ATOMIC_REF requires lock-free 16-bit atomics"
+#endif
+#endif
 
 #define SIZEOF_STRUCT_PBUF        LWIP_MEM_ALIGN_SIZE(sizeof(struct pbuf))
 /* Since the pool is created in memp, PBUF_POOL_BUFSIZE will be automatically
    aligned there. Therefore, PBUF_POOL_BUFSIZE_ALIGNED can be used here. */
 #define PBUF_POOL_BUFSIZE_ALIGNED LWIP_MEM_ALIGN_SIZE(PBUF_POOL_BUFSIZE)
 
+#if PBUF_ATOMIC_REF
+/* a new pbuf is not yet visible to other threads */
+#define PBUF_REF_INIT(p)          atomic_store_explicit(&(p)->ref, 1, memory_order_relaxed)
+#else /* PBUF_ATOMIC_REF */
+#define PBUF_REF_INIT(p)          (p)->ref = 1
+#endif /* PBUF_ATOMIC_REF */
+
+#if PBUF_POOL_CLASSES
+/** A pool backing PBUF_POOL pbufs */
+struct pbuf_pool_class {
+  memp_t pool;
+  u16_t bufsize;
+};
+
+/** The PBUF_POOL pools, ascending by buffer size */
+static const struct pbuf_pool_class pbuf_pool_classes[] = {
+#if PBUF_POOL_SMALL_SIZE
+  { MEMP_PBUF_POOL_SMALL, LWIP_MEM_ALIGN_SIZE(PBUF_POOL_SMALL_BUFSIZE) },
+#endif /* PBUF_POOL_SMALL_SIZE */
+  { MEMP_PBUF_POOL, PBUF_POOL_BUFSIZE_ALIGNED },
+#if PBUF_POOL_JUMBO_SIZE
+  { MEMP_PBUF_POOL_JUMBO, LWIP_MEM_ALIGN_SIZE(PBUF_POOL_JUMBO_BUFSIZE) },
+#endif /* PBUF_POOL_JUMBO_SIZE */
+#if PBUF_POOL_HUGE_SIZE
+  { MEMP_PBUF_POOL_HUGE, LWIP_MEM_ALIGN_SIZE(PBUF_POOL_HUGE_BUFSIZE) },
+#endif /* PBUF_POOL_HUGE_SIZE */
+};
+#define PBUF_POOL_NUM_CLASSES ((s16_t)LWIP_ARRAYSIZE(pbuf_pool_classes))
+/** Class of the PBUF_POOL pool: pbuf_alloc() uses no smaller classes, as
+ * callers may fill a PBUF_POOL pbuf up to PBUF_POOL_BUFSIZE */
+#define PBUF_POOL_CLASS_DEFAULT ((PBUF_POOL_SMALL_SIZE > 0) ? 1 : 0)
+
+/**
+ * Take one buffer for a PBUF_POOL pbuf from the smallest pool (starting at
+ * class 'smallest') that holds 'needed' bytes. If that pool is empty, bigger
+ * pools are tried first, then smaller ones down to class 'smallest' (the
+ * caller chains further pbufs for the rest).
+ *
+ * @param needed number of bytes the buffer should hold
+ * @param smallest index of the smallest class that may be used
+ * @param bufsize returns the buffer size of the pool used
+ * @return the pbuf (with p->pool set) or NULL if all pools are empty
+ */
+static struct pbuf *
+pbuf_pool_alloc(u32_t needed, s16_t smallest, u16_t *bufsize)
+{
+  struct pbuf *p;
+  s16_t fit, n, i;
+
+  for (fit = smallest; fit < PBUF_POOL_NUM_CLASSES - 1; fit++) {
+    if (pbuf_pool_classes[fit].bufsize >= needed) {
+      break;
+    }
+  }
+  /* try the best fit, then the bigger pools, then the smaller ones */
+  for (n = 0; n < PBUF_POOL_NUM_CLASSES - smallest; n++) {
+    i = (n < PBUF_POOL_NUM_CLASSES - fit) ? (s16_t)(fit + n) : (s16_t)(PBUF_POOL_NUM_CLASSES - 1 - n);
+    p = (struct pbuf *)memp_malloc(pbuf_pool_classes[i].pool);
+    if (p != NULL) {
+      p->pool = (u8_t)pbuf_pool_classes[i].pool;
+      *bufsize = pbuf_pool_classes[i].bufsize;
+      return p;
+    }
+  }
+  return NULL;
+}
+#endif /* PBUF_POOL_CLASSES */
+
 #if !LWIP_TCP || !TCP_QUEUE_OOSEQ || !PBUF_POOL_FREE_OOSEQ
 #define PBUF_POOL_IS_EMPTY()
 #else /* !LWIP_TCP || !TCP_QUEUE_OOSEQ || !PBUF_POOL_FREE_OOSEQ */
@@ -164,9 +239,18 @@ static
 void
 pbuf_free_ooseq(void)
 {
+#if !MEMP_PRESSURE
   struct tcp_pcb* pcb;
+#endif /* !MEMP_PRESSURE */
   SYS_ARCH_SET(pbuf_free_ooseq_pending, 0);
 
+#if MEMP_PRESSURE
+  /* the pool ran dry: trim the ooseq queues of all PCBs as at the high
+     watermark instead of freeing one whole queue */
+  LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_free_ooseq: trimming out-of-sequence pbufs\n"));
+  memp_pressure_update();
+  tcp_trim_ooseq(MEMP_PRESSURE_MAX);
+#else /* MEMP_PRESSURE */
   for (pcb = tcp_active_pcbs; NULL != pcb; pcb = pcb->next) {
     if (NULL != pcb->ooseq) {
       /** Free the ooseq pbufs of one PCB only */
@@ -176,6 +260,7 @@ pbuf_free_ooseq(void)
       return;
     }
   }
+#endif /* MEMP_PRESSURE */
 }
 
 #if !NO_SYS
@@ -244,12 +329,18 @@ pbuf_pool_is_empty(void)
  * @return the allocated pbuf. If multiple pbufs where allocated, this
  * is the first pbuf of a pbuf chain.
  */
+#if !PBUF_POOL_CLASSES
 struct pbuf *
 pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+#else /* !PBUF_POOL_CLASSES */
+static struct pbuf *
+pbuf_alloc_classes(pbuf_layer layer, u16_t length, pbuf_type type, s16_t smallest)
+#endif /* !PBUF_POOL_CLASSES */
 {
   struct pbuf *p, *q, *r;
   u16_t offset;
   s32_t rem_len; /* remaining length */
+  u16_t bufsize; /* buffer size of the PBUF_POOL pbuf just allocated */
   LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_alloc(length=%"U16_F")\n", length));
 
   /* determine header offset */
@@ -282,7 +373,12 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
   switch (type) {
   case PBUF_POOL:
     /* allocate head of pbuf chain into p */
+#if PBUF_POOL_CLASSES
+    p = pbuf_pool_alloc((u32_t)LWIP_MEM_ALIGN_SIZE(offset) + length, smallest, &bufsize);
+#else /* PBUF_POOL_CLASSES */
     p = (struct pbuf *)memp_malloc(MEMP_PBUF_POOL);
+    bufsize = PBUF_POOL_BUFSIZE_ALIGNED;
+#endif /* PBUF_POOL_CLASSES */
     LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_alloc: allocated pbuf %p\n", (void *)p));
     if (p == NULL) {
       PBUF_POOL_IS_EMPTY();
@@ -298,14 +394,14 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
     /* the total length of the pbuf chain is the requested size */
     p->tot_len = length;
     /* set the length of the first pbuf in the chain */
-    p->len = LWIP_MIN(length, PBUF_POOL_BUFSIZE_ALIGNED - LWIP_MEM_ALIGN_SIZE(offset));
+    p->len = LWIP_MIN(length, bufsize - LWIP_MEM_ALIGN_SIZE(offset));
     LWIP_ASSERT("check p->payload + p->len does not overflow pbuf",
                 ((u8_t*)p->payload + p->len <=
-                 (u8_t*)p + SIZEOF_STRUCT_PBUF + PBUF_POOL_BUFSIZE_ALIGNED));
+                 (u8_t*)p + SIZEOF_STRUCT_PBUF + bufsize));
     LWIP_ASSERT("PBUF_POOL_BUFSIZE must be bigger than MEM_ALIGNMENT",
-      (PBUF_POOL_BUFSIZE_ALIGNED - LWIP_MEM_ALIGN_SIZE(offset)) > 0 );
+      (bufsize - LWIP_MEM_ALIGN_SIZE(offset)) > 0 );
     /* set reference count (needed here in case we fail) */
-    p->ref = 1;
+    PBUF_REF_INIT(p);
 
     /* now allocate the tail of the pbuf chain */
 
@@ -315,7 +411,11 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
     rem_len = length - p->len;
     /* any remaining pbufs to be allocated? */
     while (rem_len > 0) {
+#if PBUF_POOL_CLASSES
+      q = pbuf_pool_alloc((u32_t)rem_len, smallest, &bufsize);
+#else /* PBUF_POOL_CLASSES */
       q = (struct pbuf *)memp_malloc(MEMP_PBUF_POOL);
+#endif /* PBUF_POOL_CLASSES */
       if (q == NULL) {
         PBUF_POOL_IS_EMPTY();
         /* free chain so far allocated */
@@ -332,14 +432,14 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
       LWIP_ASSERT("rem_len < max_u16_t", rem_len < 0xffff);
       q->tot_len = (u16_t)rem_len;
       /* this pbuf length is pool size, unless smaller sized tail */
-      q->len = LWIP_MIN((u16_t)rem_len, PBUF_POOL_BUFSIZE_ALIGNED);
+      q->len = LWIP_MIN((u16_t)rem_len, bufsize);
       q->payload = (void *)((u8_t *)q + SIZEOF_STRUCT_PBUF);
       LWIP_ASSERT("pbuf_alloc: pbuf q->payload properly aligned",
               ((mem_ptr_t)q->payload % MEM_ALIGNMENT) == 0);
-      LWIP_ASSERT("check p->payload + p->len does not overflow pbuf",
-                  ((u8_t*)p->payload + p->len <=
-                   (u8_t*)p + SIZEOF_STRUCT_PBUF + PBUF_POOL_BUFSIZE_ALIGNED));
-      q->ref = 1;
+      LWIP_ASSERT("check q->payload + q->len does not overflow pbuf",
+                  ((u8_t*)q->payload + q->len <=
+                   (u8_t*)q + SIZEOF_STRUCT_PBUF + bufsize));
+      PBUF_REF_INIT(q);
       /* calculate remaining length to be allocated */
       rem_len -= q->len;
       /* remember this pbuf for linkage in next iteration */
@@ -397,13 +497,38 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
     return NULL;
   }
   /* set reference count */
-  p->ref = 1;
+  PBUF_REF_INIT(p);
   /* set flags */
   p->flags = 0;
   LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_alloc(length=%"U16_F") == %p\n", length, (void *)p));
   return p;
 }
 
+#if PBUF_POOL_CLASSES
+struct pbuf *
+pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+{
+  return pbuf_alloc_classes(layer, length, type, PBUF_POOL_CLASS_DEFAULT);
+}
+
+/**
+ * @ingroup pbuf
+ * Allocates a PBUF_POOL pbuf (chain) like pbuf_alloc(), but may also take
+ * buffers from the pools smaller than PBUF_POOL_BUFSIZE (PBUF_POOL_CLASSES).
+ * Only use it if the pbuf is never filled beyond 'length' (e.g. a received
+ * frame of known length): the buffers may be smaller than PBUF_POOL_BUFSIZE.
+ *
+ * @param layer flag to define header size
+ * @param length size of the pbuf's payload
+ * @return the allocated pbuf
+ */
+struct pbuf *
+pbuf_alloc_bestfit(pbuf_layer layer, u16_t length)
+{
+  return pbuf_alloc_classes(layer, length, PBUF_POOL, 0);
+}
+#endif /* PBUF_POOL_CLASSES */
+
 #if LWIP_SUPPORT_CUSTOM_PBUF
 /**
  * @ingroup pbuf
@@ -468,7 +593,7 @@ pbuf_alloced_custom(pbuf_layer l, u16_t length, pbuf_type type, struct pbuf_cust
   p->pbuf.flags = PBUF_FLAG_IS_CUSTOM;
   p->pbuf.len = p->pbuf.tot_len = length;
   p->pbuf.type = type;
-  p->pbuf.ref = 1;
+  PBUF_REF_INIT(&p->pbuf);
   return &p->pbuf;
 }
 #endif /* LWIP_SUPPORT_CUSTOM_PBUF */
@@ -634,6 +759,11 @@ pbuf_header_impl(struct pbuf *p, s16_t header_size_increment, u8_t force)
   /* modify pbuf length fields */
   p->len += header_size_increment;
   p->tot_len += header_size_increment;
+#if LWIP_CHECKSUM_OFFLOAD
+  if (p->flags & PBUF_FLAG_CHKSUM_PARTIAL) {
+    p->csum_start += header_size_increment;
+  }
+#endif /* LWIP_CHECKSUM_OFFLOAD */
 
   LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_header: old %p new %p (%"S16_F")\n",
     (void *)payload, (void *)p->payload, header_size_increment));
@@ -738,6 +868,18 @@ pbuf_free(struct pbuf *p)
    * obtain a zero reference count after decrementing*/
   while (p != NULL) {
     u16_t ref;
+#if PBUF_ATOMIC_REF
+    /* acquire: see all writes done by threads that dropped their reference */
+    ref = atomic_load_explicit(&p->ref, memory_order_acquire);
+    /* all pbufs in a chain are referenced at least once */
+    LWIP_ASSERT("pbuf_free: p->ref > 0", ref > 0);
+    if (ref == 1) {
+      /* ours is the only reference, nobody else can change ref any more */
+      ref = 0;
+    } else {
+      ref = (u16_t)(atomic_fetch_sub_explicit(&p->ref, 1, memory_order_acq_rel) - 1);
+    }
+#else /* PBUF_ATOMIC_REF */
     SYS_ARCH_DECL_PROTECT(old_level);
     /* Since decrementing ref cannot be guaranteed to be a single machine operation
      * we must protect it. We put the new ref into a local variable to prevent
@@ -748,6 +890,7 @@ pbuf_free(struct pbuf *p)
     /* decrease reference count (number of pointers to pbuf) */
     ref = --(p->ref);
     SYS_ARCH_UNPROTECT(old_level);
+#endif /* PBUF_ATOMIC_REF */
     /* this pbuf is no longer referenced to? */
     if (ref == 0) {
       /* remember next pbuf in chain for next iteration */
@@ -765,7 +908,11 @@ pbuf_free(struct pbuf *p)
       {
         /* is this a pbuf from the pool? */
         if (type == PBUF_POOL) {
+#if PBUF_POOL_CLASSES
+          memp_free((memp_t)p->pool, p);
+#else /* PBUF_POOL_CLASSES */
           memp_free(MEMP_PBUF_POOL, p);
+#endif /* PBUF_POOL_CLASSES */
         /* is this a ROM or RAM referencing pbuf? */
         } else if (type == PBUF_ROM || type == PBUF_REF) {
           memp_free(MEMP_PBUF, p);
@@ -821,8 +968,20 @@ pbuf_ref(struct pbuf *p)
 {
   /* pbuf given? */
   if (p != NULL) {
+#if PBUF_ATOMIC_REF
+    u16_t ref = atomic_load_explicit(&p->ref, memory_order_relaxed);
+    if (ref == 1) {
+      /* only the caller holds p: publishing it to another thread (e.g. via
+         an mbox) orders this store */
+      atomic_store_explicit(&p->ref, 2, memory_order_relaxed);
+    } else {
+      ref = atomic_fetch_add_explicit(&p->ref, 1, memory_order_relaxed);
+      LWIP_ASSERT("pbuf ref overflow", (u16_t)(ref + 1) > 0);
+    }
+#else /* PBUF_ATOMIC_REF */
     SYS_ARCH_INC(p->ref, 1);
     LWIP_ASSERT("pbuf ref overflow", p->ref > 0);
+#endif /* PBUF_ATOMIC_REF */
   }
 }
 
@@ -956,6 +1115,14 @@ pbuf_copy(struct pbuf *p_to, const struct pbuf *p_from)
   LWIP_ERROR("pbuf_copy: target not big enough to hold source", ((p_to != NULL) &&
              (p_from != NULL) && (p_to->tot_len >= p_from->tot_len)), return ERR_ARG;);
 
+#if LWIP_CHECKSUM_OFFLOAD
+  /* the data keeps its offsets, so does the checksum offload state */
+  p_to->flags = (u8_t)((p_to->flags & ~(PBUF_FLAG_CHKSUM_VERIFIED | PBUF_FLAG_CHKSUM_PARTIAL)) |
+    (p_from->flags & (PBUF_FLAG_CHKSUM_VERIFIED | PBUF_FLAG_CHKSUM_PARTIAL)));
+  p_to->csum_start = p_from->csum_start;
+  p_to->csum_offset = p_from->csum_offset;
+#endif /* LWIP_CHECKSUM_OFFLOAD */
+
   /* iterate through pbuf chain */
   do
   {
@@ -1284,6 +1451,59 @@ pbuf_fill_chksum(struct pbuf *p, u16_t start_offset, const void *dataptr,
   *chksum = FOLD_U32T(acc);
   return ERR_OK;
 }
+
+/**
+ * Same as pbuf_copy_partial() but updates the checksum while copying, the
+ * data is only read once (see LWIP_CHKSUM_COPY).
+ *
+ * @param buf the pbuf from which to copy data
+ * @param dataptr the application supplied buffer
+ * @param len length of data to copy (dataptr must be big enough)
+ * @param offset offset into the packet buffer from where to begin copying len bytes
+ * @param chksum pointer to the checksum which is updated with the checksum
+ *        of the data copied to dataptr
+ * @return the number of bytes copied, or 0 on failure
+ */
+u16_t
+pbuf_copy_partial_chksum(const struct pbuf *buf, void *dataptr, u16_t len,
+                         u16_t offset, u16_t *chksum)
+{
+  const struct pbuf *p;
+  u16_t buf_copy_len;
+  u16_t copy_chksum;
+  u16_t copied_total = 0;
+  u32_t acc;
+
+  LWIP_ERROR("pbuf_copy_partial_chksum: invalid buf", (buf != NULL), return 0;);
+  LWIP_ERROR("pbuf_copy_partial_chksum: invalid dataptr", (dataptr != NULL), return 0;);
+  LWIP_ERROR("pbuf_copy_partial_chksum: invalid chksum", (chksum != NULL), return 0;);
+
+  acc = *chksum;
+  for (p = buf; len != 0 && p != NULL; p = p->next) {
+    if ((offset != 0) && (offset >= p->len)) {
+      /* don't copy from this buffer -> on to the next */
+      offset -= p->len;
+    } else {
+      /* copy from this buffer. maybe only partially. */
+      buf_copy_len = p->len - offset;
+      if (buf_copy_len > len) {
+        buf_copy_len = len;
+      }
+      copy_chksum = LWIP_CHKSUM_COPY(&((char*)dataptr)[copied_total],
+                                     &((char*)p->payload)[offset], buf_copy_len);
+      if ((copied_total & 1) != 0) {
+        copy_chksum = SWAP_BYTES_IN_WORD(copy_chksum);
+      }
+      acc += copy_chksum;
+      copied_total += buf_copy_len;
+      len -= buf_copy_len;
+      offset = 0;
+    }
+  }
+  acc = FOLD_U32T(acc);
+  *chksum = (u16_t)FOLD_U32T(acc);
+  return copied_total;
+}
 #endif /* LWIP_CHECKSUM_ON_COPY */
 
 /**
@@ -158,6 +158,11 @@ stats_display(void)
   UDP_STATS_DISPLAY();
   TCP_STATS_DISPLAY();
   MEM_STATS_DISPLAY();
+#if MEM_USE_SLAB
+  for (i = 0; i < MEM_SLAB_NUM_CLASSES; i++) {
+    MEM_SLAB_STATS_DISPLAY(i);
+  }
+#endif /* MEM_USE_SLAB */
   for (i = 0; i < MEMP_MAX; i++) {
     MEMP_STATS_DISPLAY(i);
   }
@@ -59,6 +59,12 @@
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
 #include "lwip/nd6.h"
+#if LWIP_TCP_RACK || LWIP_TCP_INFO || LWIP_TCP_ACK_POLICY
+#include "lwip/sys.h"
+#endif /* LWIP_TCP_RACK || LWIP_TCP_INFO || LWIP_TCP_ACK_POLICY */
+#if LWIP_TCP_ACK_POLICY && LWIP_TIMERS
+#include "lwip/timeouts.h"
+#endif /* LWIP_TCP_ACK_POLICY && LWIP_TIMERS */
 
 #include <string.h>
 
@@ -611,6 +617,11 @@ tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
           if (!ip_get_option(pcb, SOF_REUSEADDR) ||
               !ip_get_option(cpcb, SOF_REUSEADDR))
 #endif /* SO_REUSE */
+#if LWIP_SO_REUSEPORT
+          /* Members of a REUSEPORT group share the port, too. */
+          if (!ip_get_option(pcb, SOF_REUSEPORT) ||
+              !ip_get_option(cpcb, SOF_REUSEPORT))
+#endif /* LWIP_SO_REUSEPORT */
           {
             /* @todo: check accept_any_ip_version */
             if ((IP_IS_V6(ipaddr) == IP_IS_V6_VAL(cpcb->local_ip)) &&
@@ -708,7 +719,12 @@ tcp_listen_with_backlog_and_err(struct tcp_pcb *pcb, u8_t backlog, err_t *err)
        this port is only used once for every local IP. */
     for (lpcb = tcp_listen_pcbs.listen_pcbs; lpcb != NULL; lpcb = lpcb->next) {
       if ((lpcb->local_port == pcb->local_port) &&
-          ip_addr_cmp(&lpcb->local_ip, &pcb->local_ip)) {
+          ip_addr_cmp(&lpcb->local_ip, &pcb->local_ip)
+#if LWIP_SO_REUSEPORT
+          /* except by the listeners of a REUSEPORT group */
+          && (!ip_get_option(pcb, SOF_REUSEPORT) || !ip_get_option(lpcb, SOF_REUSEPORT))
+#endif /* LWIP_SO_REUSEPORT */
+          ) {
         /* this address/port is already used */
         lpcb = NULL;
         res = ERR_USE;
@@ -762,11 +778,18 @@ done:
 u32_t
 tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb)
 {
-  u32_t new_right_edge = pcb->rcv_nxt + pcb->rcv_wnd;
+#if MEMP_PRESSURE
+  /* under memory pressure, open the window only partially (the right edge
+     never moves back, so a shrinking window is used up by incoming data) */
+  tcpwnd_size_t wnd = (tcpwnd_size_t)MEMP_PRESSURE_SCALE(pcb->rcv_wnd);
+#else /* MEMP_PRESSURE */
+  tcpwnd_size_t wnd = pcb->rcv_wnd;
+#endif /* MEMP_PRESSURE */
+  u32_t new_right_edge = pcb->rcv_nxt + wnd;
 
   if (TCP_SEQ_GEQ(new_right_edge, pcb->rcv_ann_right_edge + LWIP_MIN((TCP_WND / 2), pcb->mss))) {
     /* we can advertise more window */
-    pcb->rcv_ann_wnd = pcb->rcv_wnd;
+    pcb->rcv_ann_wnd = wnd;
     return new_right_edge - pcb->rcv_ann_right_edge;
   } else {
     if (TCP_SEQ_GT(pcb->rcv_nxt, pcb->rcv_ann_right_edge)) {
@@ -917,10 +940,10 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
       return ERR_BUF;
     }
   } else {
-#if SO_REUSE
-    if (ip_get_option(pcb, SOF_REUSEADDR)) {
-      /* Since SOF_REUSEADDR allows reusing a local address, we have to make sure
-         now that the 5-tuple is unique. */
+#if SO_REUSE || LWIP_SO_REUSEPORT
+    if (ip_get_option(pcb, SOF_REUSEADDR | SOF_REUSEPORT)) {
+      /* Since SOF_REUSEADDR and SOF_REUSEPORT allow reusing a local address,
+         we have to make sure now that the 5-tuple is unique. */
       struct tcp_pcb *cpcb;
       int i;
       /* Don't check listen- and bound-PCBs, check active- and TIME-WAIT PCBs. */
@@ -936,7 +959,7 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
         }
       }
     }
-#endif /* SO_REUSE */
+#endif /* SO_REUSE || LWIP_SO_REUSEPORT */
   }
 
   iss = tcp_next_iss(pcb);
@@ -945,6 +968,12 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
   pcb->lastack = iss - 1;
   pcb->snd_wl2 = iss - 1;
   pcb->snd_lbb = iss - 1;
+#if LWIP_TCP_ECN
+  pcb->ecn_recover = iss;
+#if LWIP_TCP_DCTCP
+  pcb->dctcp_next_seq = iss;
+#endif /* LWIP_TCP_DCTCP */
+#endif /* LWIP_TCP_ECN */
   /* Start with a window that does not need scaling. When window scaling is
      enabled and used, the window is enlarged when both sides agree on scaling. */
   pcb->rcv_wnd = pcb->rcv_ann_wnd = TCPWND_MIN16(TCP_WND);
@@ -963,8 +992,21 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
   LWIP_UNUSED_ARG(connected);
 #endif /* LWIP_CALLBACK_API */
 
+#if LWIP_TCP_TFO
+  if (pcb->tfo_flags & TCP_TFO_ENABLE) {
+    /* send the cached cookie, or an empty one to request a cookie */
+    pcb->tfo_cookie_len = tcp_tfo_cookie_get(&pcb->remote_ip, pcb->tfo_cookie);
+    pcb->tfo_flags |= TCP_TFO_OPT;
+  }
+#endif /* LWIP_TCP_TFO */
+
   /* Send a SYN together with the MSS option. */
+#if LWIP_TCP_ECN
+  /* ECN-setup SYN (RFC 3168 6.1.1) */
+  ret = tcp_enqueue_flags(pcb, TCP_SYN | TCP_ECE | TCP_CWR);
+#else /* LWIP_TCP_ECN */
   ret = tcp_enqueue_flags(pcb, TCP_SYN);
+#endif /* LWIP_TCP_ECN */
   if (ret == ERR_OK) {
     /* SYN segment was enqueued, changed the pcbs state now */
     pcb->state = SYN_SENT;
@@ -974,7 +1016,14 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
     TCP_REG_ACTIVE(pcb);
     MIB2_STATS_INC(mib2.tcpactiveopens);
 
-    tcp_output(pcb);
+#if LWIP_TCP_TFO
+    /* With a cookie, hold the SYN back so that data written by the application
+       before the next tcp_output() (or the fast timer) is sent along with it */
+    if (pcb->tfo_cookie_len == 0)
+#endif /* LWIP_TCP_TFO */
+    {
+      tcp_output(pcb);
+    }
   }
   return ret;
 }
@@ -1078,6 +1127,18 @@ tcp_slowtmr_start:
                                        " ssthresh %"TCPWNDSIZE_F"\n",
                                        pcb->cwnd, pcb->ssthresh));
 
+#if LWIP_TCP_TFO
+          if (pcb->state == SYN_SENT) {
+            /* retransmit the SYN without data, the data follows once connected */
+            tcp_tfo_split_syn(pcb, pcb->unacked);
+          }
+#endif /* LWIP_TCP_TFO */
+#if LWIP_TCP_RACK
+          /* the RTO ends any reordering wait or probe episode */
+          pcb->rack_flags &= (u8_t)~(TCP_RACK_REO_TIMER | TCP_RACK_TLP_TIMER |
+                                     TCP_RACK_TLP_INFLIGHT | TCP_RACK_TLP_REXMIT);
+#endif /* LWIP_TCP_RACK */
+
           /* The following needs to be called AFTER cwnd is set to one
              mss - STJ */
           tcp_rexmit_rto(pcb);
@@ -1246,6 +1307,98 @@ tcp_slowtmr_start:
   }
 }
 
+#if LWIP_TCP_ACK_POLICY
+#if LWIP_TIMERS
+/** Is the delayed ACK timeout scheduled, and when does it expire? */
+static u8_t tcp_delack_tmr_active;
+static u32_t tcp_delack_tmr_due;
+
+static void tcp_delack_tmr(void *arg);
+
+/** Make sure the delayed ACK timeout fires no later than 'due' */
+static void
+tcp_delack_tmr_schedule(u32_t due)
+{
+  u32_t now = sys_now();
+  if (tcp_delack_tmr_active) {
+    if ((s32_t)(due - tcp_delack_tmr_due) >= 0) {
+      /* the running timeout fires early enough */
+      return;
+    }
+    sys_untimeout(tcp_delack_tmr, NULL);
+  }
+  tcp_delack_tmr_active = 1;
+  tcp_delack_tmr_due = due;
+  sys_timeout(((s32_t)(due - now) > 0) ? (due - now) : 0, tcp_delack_tmr, NULL);
+}
+
+/** Sends the delayed ACKs that are due and re-arms for the next one */
+static void
+tcp_delack_tmr(void *arg)
+{
+  struct tcp_pcb *pcb;
+  u32_t now = sys_now();
+  u32_t next = 0;
+  u8_t pending = 0;
+  LWIP_UNUSED_ARG(arg);
+
+  tcp_delack_tmr_active = 0;
+tcp_delack_tmr_start:
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    if (pcb->flags & TF_ACK_DELAY) {
+      if ((s32_t)(now - pcb->delack_due) >= 0) {
+        LWIP_DEBUGF(TCP_DEBUG, ("tcp_delack_tmr: delayed ACK\n"));
+        tcp_ack_now(pcb);
+        tcp_active_pcbs_changed = 0;
+        tcp_output(pcb);
+        pcb->flags &= ~(TF_ACK_DELAY | TF_ACK_NOW);
+        if (tcp_active_pcbs_changed) {
+          /* application callbacks may have changed the list: restart */
+          pending = 0;
+          goto tcp_delack_tmr_start;
+        }
+      } else if (!pending || ((s32_t)(pcb->delack_due - next) < 0)) {
+        next = pcb->delack_due;
+        pending = 1;
+      }
+    }
+  }
+  if (pending) {
+    tcp_delack_tmr_schedule(next);
+  }
+}
+#endif /* LWIP_TIMERS */
+
+/**
+ * Called for every received segment that should be acknowledged (replaces
+ * the tcp_ack() macro when LWIP_TCP_ACK_POLICY is enabled):
+ * - during quick-ACK mode, every segment is acknowledged immediately
+ * - otherwise an ACK is sent at least every TCP_ACK_EVERY_SEGS segments
+ * - the remaining segments are acknowledged TCP_DELACK_TIMEOUT ms after the
+ *   first of them was received
+ *
+ * @param pcb the tcp_pcb that received a segment
+ */
+void
+tcp_ack_delayed(struct tcp_pcb *pcb)
+{
+  if (pcb->quickack > 0) {
+    pcb->quickack--;
+    pcb->flags &= ~TF_ACK_DELAY;
+    pcb->flags |= TF_ACK_NOW;
+  } else if (++pcb->delack_segs >= TCP_ACK_EVERY_SEGS) {
+    pcb->flags &= ~TF_ACK_DELAY;
+    pcb->flags |= TF_ACK_NOW;
+  } else if (!(pcb->flags & TF_ACK_DELAY)) {
+    pcb->flags |= TF_ACK_DELAY;
+    pcb->delack_due = sys_now() + TCP_DELACK_TIMEOUT;
+#if LWIP_TIMERS
+    tcp_delack_tmr_schedule(pcb->delack_due);
+#endif /* LWIP_TIMERS */
+  }
+}
+#endif /* LWIP_TCP_ACK_POLICY */
+
 /**
  * Is called every TCP_FAST_INTERVAL (250 ms) and process data previously
  * "refused" by upper layer (application) and sends delayed ACKs.
@@ -1267,12 +1420,29 @@ tcp_fasttmr_start:
       struct tcp_pcb *next;
       pcb->last_timer = tcp_timer_ctr;
       /* send delayed ACKs */
-      if (pcb->flags & TF_ACK_DELAY) {
+      if ((pcb->flags & TF_ACK_DELAY)
+#if LWIP_TCP_ACK_POLICY
+          && ((s32_t)(sys_now() - pcb->delack_due) >= 0)
+#endif /* LWIP_TCP_ACK_POLICY */
+         ) {
         LWIP_DEBUGF(TCP_DEBUG, ("tcp_fasttmr: delayed ACK\n"));
         tcp_ack_now(pcb);
         tcp_output(pcb);
         pcb->flags &= ~(TF_ACK_DELAY | TF_ACK_NOW);
       }
+#if LWIP_TCP_TFO
+      /* send a Fast Open SYN held back by tcp_connect() */
+      if ((pcb->state == SYN_SENT) && (pcb->unacked == NULL) && (pcb->unsent != NULL)) {
+        tcp_output(pcb);
+      }
+#endif /* LWIP_TCP_TFO */
+#if LWIP_TCP_RACK
+      /* RACK reordering timer or tail loss probe due? */
+      if ((pcb->rack_flags & (TCP_RACK_REO_TIMER | TCP_RACK_TLP_TIMER)) &&
+          ((s32_t)(sys_now() - pcb->rack_timer) >= 0)) {
+        tcp_rack_timeout(pcb);
+      }
+#endif /* LWIP_TCP_RACK */
       /* send pending FIN */
       if (pcb->flags & TF_CLOSEPEND) {
         LWIP_DEBUGF(TCP_DEBUG, ("tcp_fasttmr: pending FIN\n"));
@@ -1311,6 +1481,96 @@ tcp_txnow(void)
   }
 }
 
+#if MEMP_PRESSURE
+#if TCP_QUEUE_OOSEQ
+/** Highest memory pressure level the ooseq queues were trimmed for since
+ * the pressure went away */
+static u8_t tcp_ooseq_trim_level;
+
+/**
+ * Free queued out-of-sequence segments of all active pcbs in proportion to
+ * the memory pressure level: half of every queue at MEMP_PRESSURE_MAX.
+ * The tail is freed first, those segments would be needed last.
+ * The number to free is rounded down, so queues too short for the level
+ * are left alone - except at MEMP_PRESSURE_MAX, where memory is needed
+ * right now and at least one segment is freed.
+ *
+ * @param level memory pressure level (> 0)
+ */
+void
+tcp_trim_ooseq(u8_t level)
+{
+  struct tcp_pcb *pcb;
+  struct tcp_seg *seg;
+  u32_t cnt, drop, keep;
+
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    cnt = 0;
+    for (seg = pcb->ooseq; seg != NULL; seg = seg->next) {
+      cnt++;
+    }
+    if (cnt == 0) {
+      continue;
+    }
+    drop = (cnt * level) / (2 * MEMP_PRESSURE_MAX);
+    if ((drop == 0) && (level >= MEMP_PRESSURE_MAX)) {
+      drop = 1;
+    }
+    if (drop == 0) {
+      continue;
+    }
+    keep = cnt - drop;
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_trim_ooseq: keeping %"U32_F" of %"U32_F" out-of-sequence segments\n", keep, cnt));
+    if (keep == 0) {
+      tcp_segs_free(pcb->ooseq);
+      pcb->ooseq = NULL;
+    } else {
+      for (seg = pcb->ooseq; keep > 1; keep--) {
+        seg = seg->next;
+      }
+      tcp_segs_free(seg->next);
+      seg->next = NULL;
+    }
+  }
+}
+#endif /* TCP_QUEUE_OOSEQ */
+
+/**
+ * React to the memory pressure level having been updated: trim the ooseq
+ * queues when the pressure rises and announce the windows held back before
+ * when it decreases. Trimming again at a steady level would drain the
+ * queues one timer tick at a time, which the level does not ask for.
+ *
+ * @param prev_level memory pressure level before the update
+ */
+void
+tcp_memp_pressure(u8_t prev_level)
+{
+  struct tcp_pcb *pcb;
+
+#if TCP_QUEUE_OOSEQ
+  if (memp_pressure_level == 0) {
+    tcp_ooseq_trim_level = 0;
+  } else if (memp_pressure_level > tcp_ooseq_trim_level) {
+    tcp_trim_ooseq(memp_pressure_level);
+    tcp_ooseq_trim_level = memp_pressure_level;
+  }
+#endif /* TCP_QUEUE_OOSEQ */
+
+  if (memp_pressure_level < prev_level) {
+    for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+      /* the application may have read everything already, so this may be
+         the only chance to send a window update */
+      if (((pcb->state == ESTABLISHED) || (pcb->state == FIN_WAIT_1) || (pcb->state == FIN_WAIT_2)) &&
+          (tcp_update_rcv_ann_wnd(pcb) >= TCP_WND_UPDATE_THRESHOLD)) {
+        tcp_ack_now(pcb);
+        tcp_output(pcb);
+      }
+    }
+  }
+}
+#endif /* MEMP_PRESSURE */
+
 /** Pass pcb->refused_data to the recv callback */
 err_t
 tcp_process_refused_data(struct tcp_pcb *pcb)
@@ -1632,6 +1892,13 @@ tcp_alloc(u8_t prio)
     connection is established. To avoid these complications, we set ssthresh to the
     largest effective cwnd (amount of in-flight data) that the sender can have. */
     pcb->ssthresh = TCP_SND_BUF;
+#if LWIP_TCP_DCTCP
+    /* start conservatively: react to the first marks like classic ECN */
+    pcb->dctcp_alpha = TCP_DCTCP_ALPHA_MAX;
+#endif /* LWIP_TCP_DCTCP */
+#if LWIP_TCP_ACK_POLICY
+    pcb->quickack = TCP_QUICKACK_SEGS;
+#endif /* LWIP_TCP_ACK_POLICY */
 
 #if LWIP_CALLBACK_API
     pcb->recv = tcp_recv_null;
@@ -1911,6 +2178,153 @@ tcp_next_iss(struct tcp_pcb *pcb)
 #endif /* LWIP_HOOK_TCP_ISN */
 }
 
+#if LWIP_TCP_TFO
+/** Client side cache of Fast Open cookies received from servers */
+struct tcp_tfo_cookie_entry {
+  ip_addr_t addr;
+  u32_t last_used;
+  u8_t len;
+  u8_t cookie[TCP_TFO_COOKIE_MAX_LEN];
+};
+static struct tcp_tfo_cookie_entry tcp_tfo_cookies[TCP_TFO_COOKIE_CACHE_SIZE];
+static u32_t tcp_tfo_cookie_ctr;
+
+#ifndef LWIP_HOOK_TCP_TFO_COOKIE
+static u32_t tcp_tfo_key[4];
+static u8_t tcp_tfo_key_valid;
+
+/* murmur3 style mixing step */
+static u32_t
+tcp_tfo_mix(u32_t h, u32_t v)
+{
+  v *= 0xcc9e2d51UL;
+  v = (v << 15) | (v >> 17);
+  v *= 0x1b873593UL;
+  h ^= v;
+  h = (h << 13) | (h >> 19);
+  return h * 5 + 0xe6546b64UL;
+}
+
+/* murmur3 finalizer */
+static u32_t
+tcp_tfo_fmix(u32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6bUL;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35UL;
+  h ^= h >> 16;
+  return h;
+}
+#endif /* LWIP_HOOK_TCP_TFO_COOKIE */
+
+/**
+ * Generates the Fast Open cookie a listener hands out to a client.
+ *
+ * @param addr the client IP address
+ * @param cookie buffer of TCP_TFO_COOKIE_LEN bytes receiving the cookie
+ */
+void
+tcp_tfo_cookie_gen(const ip_addr_t *addr, u8_t *cookie)
+{
+#ifdef LWIP_HOOK_TCP_TFO_COOKIE
+  LWIP_HOOK_TCP_TFO_COOKIE(addr, cookie);
+#else /* LWIP_HOOK_TCP_TFO_COOKIE */
+  u32_t h0, h1;
+  u8_t i;
+
+  if (!tcp_tfo_key_valid) {
+    for (i = 0; i < 4; i++) {
+      tcp_tfo_key[i] = LWIP_RAND();
+    }
+    tcp_tfo_key_valid = 1;
+  }
+  h0 = tcp_tfo_key[0];
+  h1 = tcp_tfo_key[1];
+#if LWIP_IPV6
+  if (IP_IS_V6(addr)) {
+    for (i = 0; i < 4; i++) {
+      h0 = tcp_tfo_mix(h0, ip_2_ip6(addr)->addr[i] ^ tcp_tfo_key[2]);
+      h1 = tcp_tfo_mix(h1, ip_2_ip6(addr)->addr[i] ^ tcp_tfo_key[3]);
+    }
+  } else
+#endif /* LWIP_IPV6 */
+  {
+#if LWIP_IPV4
+    h0 = tcp_tfo_mix(h0, ip4_addr_get_u32(ip_2_ip4(addr)) ^ tcp_tfo_key[2]);
+    h1 = tcp_tfo_mix(h1, ip4_addr_get_u32(ip_2_ip4(addr)) ^ tcp_tfo_key[3]);
+#endif /* LWIP_IPV4 */
+  }
+  h0 = tcp_tfo_fmix(h0 ^ h1);
+  h1 = tcp_tfo_fmix(h1 + h0);
+  for (i = 0; i < 4; i++) {
+    cookie[i] = (u8_t)(h0 >> (8 * i));
+    cookie[i + 4] = (u8_t)(h1 >> (8 * i));
+  }
+#endif /* LWIP_HOOK_TCP_TFO_COOKIE */
+}
+
+/**
+ * Looks up the Fast Open cookie cached for a server.
+ *
+ * @param addr the server IP address
+ * @param cookie buffer of TCP_TFO_COOKIE_MAX_LEN bytes receiving the cookie
+ * @return length of the cookie or 0 if none is cached
+ */
+u8_t
+tcp_tfo_cookie_get(const ip_addr_t *addr, u8_t *cookie)
+{
+  u8_t i;
+
+  for (i = 0; i < TCP_TFO_COOKIE_CACHE_SIZE; i++) {
+    struct tcp_tfo_cookie_entry *e = &tcp_tfo_cookies[i];
+    if ((e->len != 0) && ip_addr_cmp(&e->addr, addr)) {
+      e->last_used = ++tcp_tfo_cookie_ctr;
+      MEMCPY(cookie, e->cookie, e->len);
+      return e->len;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Stores (or with len == 0, forgets) the Fast Open cookie of a server.
+ * When the cache is full, the least recently used entry is replaced.
+ */
+void
+tcp_tfo_cookie_set(const ip_addr_t *addr, const u8_t *cookie, u8_t len)
+{
+  struct tcp_tfo_cookie_entry *e = NULL;
+  u8_t i;
+
+  LWIP_ASSERT("tcp_tfo_cookie_set: cookie too long", len <= TCP_TFO_COOKIE_MAX_LEN);
+  for (i = 0; i < TCP_TFO_COOKIE_CACHE_SIZE; i++) {
+    struct tcp_tfo_cookie_entry *cur = &tcp_tfo_cookies[i];
+    if ((cur->len != 0) && ip_addr_cmp(&cur->addr, addr)) {
+      e = cur;
+      break;
+    }
+    if ((e == NULL) || ((e->len != 0) &&
+        ((cur->len == 0) || ((u32_t)(cur->last_used - e->last_used) > 0x7fffffffUL)))) {
+      /* remember a free or the least recently used entry */
+      e = cur;
+    }
+  }
+  if (len == 0) {
+    if ((e != NULL) && (e->len != 0) && ip_addr_cmp(&e->addr, addr)) {
+      e->len = 0;
+    }
+    return;
+  }
+  if (e != NULL) {
+    ip_addr_copy(e->addr, *addr);
+    MEMCPY(e->cookie, cookie, len);
+    e->len = len;
+    e->last_used = ++tcp_tfo_cookie_ctr;
+  }
+}
+#endif /* LWIP_TCP_TFO */
+
 #if TCP_CALCULATE_EFF_SEND_MSS
 /**
  * Calculates the effective send mss that can be used for a specific IP address
@@ -2031,6 +2445,166 @@ tcp_netif_ip_addr_changed(const ip_addr_t* old_addr, const ip_addr_t* new_addr)
   }
 }
 
+#if LWIP_TCP_INFO
+/**
+ * Classifies what currently limits sending on a connection and charges the
+ * time since the last call to the previous classification.
+ *
+ * @param pcb the tcp_pcb to update
+ */
+void
+tcp_info_update_limit(struct tcp_pcb *pcb)
+{
+  u32_t now = sys_now();
+  u32_t elapsed = now - pcb->info_limit_ts;
+  u8_t limit;
+
+  switch (pcb->info_limit) {
+    case TCP_INFO_LIMIT_APP:
+      pcb->info_app_limited += elapsed;
+      break;
+    case TCP_INFO_LIMIT_CWND:
+      pcb->info_cwnd_limited += elapsed;
+      break;
+    case TCP_INFO_LIMIT_RWND:
+      pcb->info_rwnd_limited += elapsed;
+      break;
+    default:
+      break;
+  }
+
+  if (pcb->unsent == NULL) {
+    limit = (pcb->unacked != NULL) ? TCP_INFO_LIMIT_APP : TCP_INFO_LIMIT_IDLE;
+  } else {
+    u32_t needed = lwip_ntohl(pcb->unsent->tcphdr->seqno) - pcb->lastack + pcb->unsent->len;
+    if (needed > pcb->snd_wnd) {
+      limit = TCP_INFO_LIMIT_RWND;
+    } else if (needed > pcb->cwnd) {
+      limit = TCP_INFO_LIMIT_CWND;
+    } else {
+      /* held back by Nagle or waiting for the next tcp_output() */
+      limit = TCP_INFO_LIMIT_APP;
+    }
+  }
+  pcb->info_limit = limit;
+  pcb->info_limit_ts = now;
+}
+
+/**
+ * Accounts acknowledged data and samples the delivery rate about once per RTT.
+ *
+ * @param pcb the tcp_pcb the ACK arrived for
+ * @param acked number of bytes acknowledged
+ */
+void
+tcp_info_acked(struct tcp_pcb *pcb, u32_t acked)
+{
+  u32_t now = sys_now();
+  u32_t elapsed = now - pcb->info_rate_ts;
+  u32_t interval = (u32_t)(pcb->sa >> 3) * TCP_SLOW_INTERVAL;
+
+  pcb->info_bytes_acked += acked;
+  pcb->info_rate_acked += acked;
+#if LWIP_TCP_RACK
+  if (pcb->rack_flags & TCP_RACK_RTT_VALID) {
+    interval = pcb->rack_srtt;
+  }
+#endif /* LWIP_TCP_RACK */
+  if ((elapsed > 0) && (elapsed >= interval)) {
+    if (pcb->info_rate_acked < 0xffffffffUL / 1000) {
+      pcb->info_delivery_rate = pcb->info_rate_acked * 1000 / elapsed;
+    } else {
+      pcb->info_delivery_rate = pcb->info_rate_acked / elapsed * 1000;
+    }
+    pcb->info_rate_acked = 0;
+    pcb->info_rate_ts = now;
+  }
+}
+
+/**
+ * @ingroup tcp_raw
+ * Fills in the statistics of a connection.
+ *
+ * @param pcb the tcp_pcb to query (not a listening pcb)
+ * @param info the structure to fill in
+ * @return ERR_OK, or ERR_VAL if called for a listening pcb
+ */
+err_t
+tcp_get_info(struct tcp_pcb *pcb, struct tcp_info_lwip *info)
+{
+  struct tcp_seg *seg;
+
+  LWIP_ERROR("tcp_get_info: invalid arguments", (pcb != NULL) && (info != NULL), return ERR_ARG);
+  LWIP_ERROR("tcp_get_info: called for listen-pcb", pcb->state != LISTEN, return ERR_VAL);
+
+  tcp_info_update_limit(pcb);
+
+  info->state = (u8_t)pcb->state;
+  info->dupacks = pcb->dupacks;
+  info->nrtx = pcb->nrtx;
+  info->mss = pcb->mss;
+  info->srtt = (u32_t)(pcb->sa >> 3) * TCP_SLOW_INTERVAL;
+#if LWIP_TCP_RACK
+  if (pcb->rack_flags & TCP_RACK_RTT_VALID) {
+    info->srtt = pcb->rack_srtt;
+  }
+#endif /* LWIP_TCP_RACK */
+  info->rttvar = (u32_t)(pcb->sv >> 2) * TCP_SLOW_INTERVAL;
+  info->rto = (u32_t)pcb->rto * TCP_SLOW_INTERVAL;
+  info->cwnd = pcb->cwnd;
+  info->ssthresh = pcb->ssthresh;
+  info->snd_wnd = pcb->snd_wnd;
+  info->rcv_wnd = pcb->rcv_wnd;
+  info->bytes_in_flight = pcb->snd_nxt - pcb->lastack;
+  info->bytes_sent = pcb->info_bytes_sent;
+  info->bytes_retrans = pcb->info_bytes_retrans;
+  info->bytes_acked = pcb->info_bytes_acked;
+  info->bytes_received = pcb->info_bytes_received;
+  info->retransmits = pcb->info_retrans;
+  info->ooseq_segs = 0;
+  info->ooseq_bytes = 0;
+#if TCP_QUEUE_OOSEQ
+  for (seg = pcb->ooseq; seg != NULL; seg = seg->next) {
+    info->ooseq_segs++;
+    info->ooseq_bytes += seg->len;
+  }
+#else /* TCP_QUEUE_OOSEQ */
+  LWIP_UNUSED_ARG(seg);
+#endif /* TCP_QUEUE_OOSEQ */
+  info->app_limited = pcb->info_app_limited;
+  info->cwnd_limited = pcb->info_cwnd_limited;
+  info->rwnd_limited = pcb->info_rwnd_limited;
+  info->delivery_rate = pcb->info_delivery_rate;
+  return ERR_OK;
+}
+
+/**
+ * @ingroup tcp_raw
+ * Calls fn with the statistics of every active and TIME_WAIT connection.
+ * The callback must not close, abort or otherwise free any pcb.
+ *
+ * @param fn callback called once per connection
+ * @param arg passed to fn
+ */
+void
+tcp_info_foreach(tcp_info_fn fn, void *arg)
+{
+  struct tcp_pcb *pcb;
+  struct tcp_info_lwip info;
+
+  LWIP_ERROR("tcp_info_foreach: invalid callback", fn != NULL, return);
+
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    tcp_get_info(pcb, &info);
+    fn(arg, pcb, &info);
+  }
+  for (pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
+    tcp_get_info(pcb, &info);
+    fn(arg, pcb, &info);
+  }
+}
+#endif /* LWIP_TCP_INFO */
+
 const char*
 tcp_debug_state_str(enum tcp_state s)
 {
@@ -58,6 +58,11 @@
 #if LWIP_ND6_TCP_REACHABILITY_HINTS
 #include "lwip/nd6.h"
 #endif /* LWIP_ND6_TCP_REACHABILITY_HINTS */
+#if LWIP_TCP_RACK || LWIP_TCP_INFO
+#include "lwip/sys.h"
+#endif /* LWIP_TCP_RACK || LWIP_TCP_INFO */
+
+#include <string.h>
 
 #if LWIP_LINUX
 #include "lwip.h"
@@ -83,6 +88,13 @@ static u8_t flags;
 static u8_t recv_flags;
 static struct pbuf *recv_data;
 
+#if LWIP_TCP_TFO
+/* Fast Open option of the current segment (set by tcp_parseopt) */
+static u8_t tcp_tfo_rcvd;
+static u8_t tcp_tfo_rcvd_len;
+static u8_t tcp_tfo_rcvd_cookie[TCP_TFO_COOKIE_MAX_LEN];
+#endif /* LWIP_TCP_TFO */
+
 struct tcp_pcb *tcp_input_pcb;
 
 /* Forward declarations. */
@@ -92,6 +104,43 @@ static void tcp_parseopt(struct tcp_pcb *pcb);
 
 static void tcp_listen_input(struct tcp_pcb_listen *pcb);
 static void tcp_timewait_input(struct tcp_pcb *pcb);
+#if LWIP_TCP_TFO
+static void tcp_tfo_accept(struct tcp_pcb_listen *lpcb, struct tcp_pcb *npcb);
+#endif /* LWIP_TCP_TFO */
+
+#if LWIP_SO_REUSEPORT
+/**
+ * Pick the listener of the SO_REUSEPORT group of 'lpcb' that gets the
+ * current connection request.
+ *
+ * @param lpcb the listener matching the segment
+ * @param prev in: the pcb before lpcb on tcp_listen_pcbs,
+ *             out: the pcb before the returned listener
+ * @return the group member with the highest weight for the segment source
+ */
+static struct tcp_pcb_listen *
+tcp_listen_reuseport_select(struct tcp_pcb_listen *lpcb, struct tcp_pcb **prev)
+{
+  struct tcp_pcb_listen *ipcb, *best = lpcb;
+  struct tcp_pcb *iprev = NULL;
+  u32_t weight, best_weight = ip_reuseport_weight(lpcb, ip_current_src_addr(), tcphdr->src);
+
+  for (ipcb = tcp_listen_pcbs.listen_pcbs; ipcb != NULL; ipcb = ipcb->next) {
+    if ((ipcb != lpcb) && (ipcb->local_port == lpcb->local_port) &&
+        ip_get_option(ipcb, SOF_REUSEPORT) &&
+        ip_addr_cmp(&ipcb->local_ip, &lpcb->local_ip)) {
+      weight = ip_reuseport_weight(ipcb, ip_current_src_addr(), tcphdr->src);
+      if (weight > best_weight) {
+        best = ipcb;
+        best_weight = weight;
+        *prev = iprev;
+      }
+    }
+    iprev = (struct tcp_pcb *)ipcb;
+  }
+  return best;
+}
+#endif /* LWIP_SO_REUSEPORT */
 
 /**
  * The initial input processing of TCP. It verifies the TCP header, demultiplexes
@@ -144,8 +193,8 @@ tcp_input(struct pbuf *p, struct netif *inp)
 
 #if CHECKSUM_CHECK_TCP
   IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_TCP) {
-    /* Verify TCP checksum. */
-    u16_t chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
+    /* Verify TCP checksum (unless the netif driver did). */
+    u16_t chksum = PBUF_CHKSUM_VERIFIED(p) ? 0 : ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
                                ip_current_src_addr(), ip_current_dest_addr());
     if (chksum != 0) {
         LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packet discarded due to failing checksum 0x%04"X16_F"\n",
@@ -313,6 +362,12 @@ tcp_input(struct pbuf *p, struct netif *inp)
       prev = lpcb_prev;
     }
 #endif /* SO_REUSE */
+#if LWIP_SO_REUSEPORT
+    if ((lpcb != NULL) && ip_get_option(lpcb, SOF_REUSEPORT)) {
+      /* spread connection requests over the group of the listener */
+      lpcb = tcp_listen_reuseport_select(lpcb, &prev);
+    }
+#endif /* LWIP_SO_REUSEPORT */
     if (lpcb != NULL) {
       /* Move this PCB to the front of the list so that subsequent
          lookups will be faster (we exploit locality in TCP segment
@@ -328,7 +383,15 @@ tcp_input(struct pbuf *p, struct netif *inp)
       }
 
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for LISTENing connection.\n"));
+#if LWIP_TCP_TFO
+      /* the SYN may carry Fast Open data */
+      inseg.p = p;
+      inseg.len = p->tot_len;
+#endif /* LWIP_TCP_TFO */
       tcp_listen_input(lpcb);
+#if LWIP_TCP_TFO
+      inseg.p = NULL;
+#endif /* LWIP_TCP_TFO */
       pbuf_free(p);
       return;
     }
@@ -614,6 +677,12 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
     npcb->snd_nxt = iss;
     npcb->lastack = iss;
     npcb->snd_lbb = iss;
+#if LWIP_TCP_ECN
+    npcb->ecn_recover = iss;
+#if LWIP_TCP_DCTCP
+    npcb->dctcp_next_seq = iss;
+#endif /* LWIP_TCP_DCTCP */
+#endif /* LWIP_TCP_ECN */
     npcb->snd_wl1 = seqno - 1;/* initialise to seqno-1 to force window update */
     npcb->callback_arg = pcb->callback_arg;
 #if LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG
@@ -630,23 +699,131 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
     npcb->snd_wnd = tcphdr->wnd;
     npcb->snd_wnd_max = npcb->snd_wnd;
 
+#if LWIP_TCP_TFO
+    if (tcp_tfo_rcvd) {
+      u8_t cookie[TCP_TFO_COOKIE_LEN];
+      tcp_tfo_cookie_gen(&npcb->remote_ip, cookie);
+      if ((tcp_tfo_rcvd_len == TCP_TFO_COOKIE_LEN) &&
+          (memcmp(tcp_tfo_rcvd_cookie, cookie, TCP_TFO_COOKIE_LEN) == 0)) {
+        /* valid cookie: take the data in the SYN right away */
+        if ((inseg.len > 0) && (inseg.len <= npcb->rcv_wnd)) {
+          LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_input: accepting %"U16_F" bytes of Fast Open data\n", inseg.len));
+          npcb->rcv_nxt += inseg.len;
+#if LWIP_TCP_INFO
+          npcb->info_bytes_received += inseg.len;
+#endif /* LWIP_TCP_INFO */
+          npcb->rcv_wnd -= inseg.len;
+          npcb->rcv_ann_wnd = npcb->rcv_wnd;
+          npcb->rcv_ann_right_edge = npcb->rcv_nxt;
+          npcb->tfo_flags |= TCP_TFO_ACCEPTED;
+        }
+      } else {
+        /* cookie request or invalid cookie: hand out a cookie in the SYN-ACK */
+        MEMCPY(npcb->tfo_cookie, cookie, TCP_TFO_COOKIE_LEN);
+        npcb->tfo_cookie_len = TCP_TFO_COOKIE_LEN;
+        npcb->tfo_flags |= TCP_TFO_OPT;
+      }
+    }
+#endif /* LWIP_TCP_TFO */
+
 #if TCP_CALCULATE_EFF_SEND_MSS
     npcb->mss = tcp_eff_send_mss(npcb->mss, &npcb->local_ip, &npcb->remote_ip);
 #endif /* TCP_CALCULATE_EFF_SEND_MSS */
 
     MIB2_STATS_INC(mib2.tcppassiveopens);
 
+#if LWIP_TCP_ECN
+    /* An ECN-setup SYN has both ECE and CWR set, answer with ECE only */
+    if (TCPH_ECN_FLAGS(tcphdr) == (TCP_ECE | TCP_CWR)) {
+      npcb->flags |= TF_ECN;
+    }
+#endif /* LWIP_TCP_ECN */
+
     /* Send a SYN|ACK together with the MSS option. */
+#if LWIP_TCP_ECN
+    rc = tcp_enqueue_flags(npcb, (npcb->flags & TF_ECN) ?
+                           (TCP_SYN | TCP_ACK | TCP_ECE) : (TCP_SYN | TCP_ACK));
+#else /* LWIP_TCP_ECN */
     rc = tcp_enqueue_flags(npcb, TCP_SYN | TCP_ACK);
+#endif /* LWIP_TCP_ECN */
     if (rc != ERR_OK) {
       tcp_abandon(npcb, 0);
       return;
     }
     tcp_output(npcb);
+#if LWIP_TCP_TFO
+    if (npcb->tfo_flags & TCP_TFO_ACCEPTED) {
+      tcp_tfo_accept(pcb, npcb);
+    }
+#endif /* LWIP_TCP_TFO */
   }
   return;
 }
 
+#if LWIP_TCP_TFO
+/**
+ * Called by tcp_listen_input() for a SYN carrying data with a valid Fast Open
+ * cookie: the connection is passed to the accept callback and the data to
+ * the recv callback without waiting for the handshake to complete.
+ *
+ * @param lpcb the listening pcb that received the SYN
+ * @param npcb the new pcb (in state SYN_RCVD)
+ */
+static void
+tcp_tfo_accept(struct tcp_pcb_listen *lpcb, struct tcp_pcb *npcb)
+{
+  err_t err;
+
+  LWIP_UNUSED_ARG(lpcb); /* only used with LWIP_CALLBACK_API */
+  tcp_backlog_accepted(npcb);
+  TCP_EVENT_ACCEPT(lpcb, npcb, npcb->callback_arg, ERR_OK, err);
+  if (err != ERR_OK) {
+    /* If the accept function returns with an error, we abort
+     * the connection. */
+    if (err != ERR_ABRT) {
+      tcp_abort(npcb);
+    }
+    return;
+  }
+  /* the recv callback takes over a reference to the SYN's pbuf */
+  pbuf_ref(inseg.p);
+  TCP_EVENT_RECV(npcb, inseg.p, ERR_OK, err);
+  if ((err != ERR_OK) && (err != ERR_ABRT)) {
+    npcb->refused_data = inseg.p;
+  }
+}
+
+/**
+ * Fast Open processing of a SYN-ACK on the client: caches the cookie sent by
+ * the server and, if the data in our SYN was not acknowledged, moves it to a
+ * segment of its own so that it is sent again once the connection is up.
+ *
+ * @param pcb the tcp_pcb in state SYN_SENT
+ * @return ERR_OK, or ERR_MEM if the data of the SYN could not be requeued
+ */
+static err_t
+tcp_tfo_input_synack(struct tcp_pcb *pcb)
+{
+  if (!(pcb->tfo_flags & TCP_TFO_OPT)) {
+    return ERR_OK;
+  }
+  if ((pcb->tfo_flags & TCP_TFO_SYN_DATA) && (ackno == pcb->lastack + 1)) {
+    err_t err = tcp_tfo_split_syn(pcb, (pcb->unacked != NULL) ? pcb->unacked : pcb->unsent);
+    if (err != ERR_OK) {
+      return err;
+    }
+  }
+  if (tcp_tfo_rcvd && (tcp_tfo_rcvd_len != 0)) {
+    tcp_tfo_cookie_set(&pcb->remote_ip, tcp_tfo_rcvd_cookie, tcp_tfo_rcvd_len);
+  } else if (!tcp_tfo_rcvd && (pcb->tfo_cookie_len != 0)) {
+    /* the server does not do Fast Open (any more) */
+    tcp_tfo_cookie_set(&pcb->remote_ip, NULL, 0);
+  }
+  pcb->tfo_flags &= (u8_t)~(TCP_TFO_OPT | TCP_TFO_SYN_DATA);
+  return ERR_OK;
+}
+#endif /* LWIP_TCP_TFO */
+
 /**
  * Called by tcp_input() when a segment arrives for a connection in
  * TIME_WAIT.
@@ -772,7 +949,18 @@ tcp_process(struct tcp_pcb *pcb)
      pcb->snd_nxt, lwip_ntohl(pcb->unacked->tcphdr->seqno)));
     /* received SYN ACK with expected sequence number? */
     if ((flags & TCP_ACK) && (flags & TCP_SYN)
-        && (ackno == pcb->lastack + 1)) {
+        && ((ackno == pcb->lastack + 1)
+#if LWIP_TCP_TFO
+            /* ... or acknowledging the data in our SYN, too */
+            || ((pcb->tfo_flags & TCP_TFO_SYN_DATA) && (ackno == pcb->snd_nxt))
+#endif /* LWIP_TCP_TFO */
+           )) {
+#if LWIP_TCP_TFO
+      if (tcp_tfo_input_synack(pcb) != ERR_OK) {
+        /* could not requeue the data of our SYN, wait for the SYN-ACK to be retransmitted */
+        break;
+      }
+#endif /* LWIP_TCP_TFO */
       pcb->rcv_nxt = seqno + 1;
       pcb->rcv_ann_right_edge = pcb->rcv_nxt;
       pcb->lastack = ackno;
@@ -780,6 +968,12 @@ tcp_process(struct tcp_pcb *pcb)
       pcb->snd_wnd_max = pcb->snd_wnd;
       pcb->snd_wl1 = seqno - 1; /* initialise to seqno - 1 to force window update */
       pcb->state = ESTABLISHED;
+#if LWIP_TCP_ECN
+      /* ECN-setup SYN-ACK has ECE set and CWR cleared */
+      if (TCPH_ECN_FLAGS(tcphdr) == TCP_ECE) {
+        pcb->flags |= TF_ECN;
+      }
+#endif /* LWIP_TCP_ECN */
 
 #if TCP_CALCULATE_EFF_SEND_MSS
       pcb->mss = tcp_eff_send_mss(pcb->mss, &pcb->local_ip, &pcb->remote_ip);
@@ -802,7 +996,20 @@ tcp_process(struct tcp_pcb *pcb)
       } else {
         pcb->unacked = rseg->next;
       }
+#if LWIP_TCP_TFO
+      if (rseg->len > 0) {
+        /* the data in our SYN was acknowledged as well */
+        recv_acked = rseg->len;
+        pcb->snd_buf += recv_acked;
+      }
+#endif /* LWIP_TCP_TFO */
       tcp_seg_free(rseg);
+#if LWIP_TCP_TFO
+      if (pcb->unacked != NULL) {
+        /* the data split off our SYN was not acknowledged: send it now */
+        tcp_rexmit(pcb);
+      }
+#endif /* LWIP_TCP_TFO */
 
       /* If there's nothing left to acknowledge, stop the retransmit
          timer, otherwise reset it to start again */
@@ -842,20 +1049,26 @@ tcp_process(struct tcp_pcb *pcb)
       if (TCP_SEQ_BETWEEN(ackno, pcb->lastack+1, pcb->snd_nxt)) {
         pcb->state = ESTABLISHED;
         LWIP_DEBUGF(TCP_DEBUG, ("TCP connection established %"U16_F" -> %"U16_F".\n", inseg.tcphdr->src, inseg.tcphdr->dest));
+#if LWIP_TCP_TFO
+        /* not if already accepted when its Fast Open SYN arrived */
+        if (!(pcb->tfo_flags & TCP_TFO_ACCEPTED))
+#endif /* LWIP_TCP_TFO */
+        {
 #if LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG
 #if LWIP_CALLBACK_API
-        LWIP_ASSERT("pcb->listener->accept != NULL",
-          (pcb->listener == NULL) || (pcb->listener->accept != NULL));
+          LWIP_ASSERT("pcb->listener->accept != NULL",
+            (pcb->listener == NULL) || (pcb->listener->accept != NULL));
 #endif
-        if (pcb->listener == NULL) {
-          /* listen pcb might be closed by now */
-          err = ERR_VAL;
-        } else
+          if (pcb->listener == NULL) {
+            /* listen pcb might be closed by now */
+            err = ERR_VAL;
+          } else
 #endif /* LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG */
-        {
-          tcp_backlog_accepted(pcb);
-          /* Call the accept function. */
-          TCP_EVENT_ACCEPT(pcb->listener, pcb, pcb->callback_arg, ERR_OK, err);
+          {
+            tcp_backlog_accepted(pcb);
+            /* Call the accept function. */
+            TCP_EVENT_ACCEPT(pcb->listener, pcb, pcb->callback_arg, ERR_OK, err);
+          }
         }
         if (err != ERR_OK) {
           /* If the accept function returns with an error, we abort
@@ -890,8 +1103,10 @@ tcp_process(struct tcp_pcb *pcb)
         tcp_rst(ackno, seqno + tcplen, ip_current_dest_addr(),
           ip_current_src_addr(), tcphdr->dest, tcphdr->src);
       }
-    } else if ((flags & TCP_SYN) && (seqno == pcb->rcv_nxt - 1)) {
-      /* Looks like another copy of the SYN - retransmit our SYN-ACK */
+    } else if ((flags & TCP_SYN) && (seqno == pcb->snd_wl1 + 1)) {
+      /* Looks like another copy of the SYN - retransmit our SYN-ACK
+         (rcv_nxt may include data accepted from a Fast Open SYN, but until
+         the handshake completes, snd_wl1 holds the SYN's seqno - 1) */
       tcp_rexmit(pcb);
     }
     break;
@@ -1000,6 +1215,272 @@ tcp_oos_insert_segment(struct tcp_seg *cseg, struct tcp_seg *next)
 }
 #endif /* TCP_QUEUE_OOSEQ */
 
+#if LWIP_TCP_ECN
+/**
+ * Receiver side of ECN: called for every segment carrying data. Sets up the
+ * ECE echo when the IP header carries a CE mark and stops echoing once the
+ * sender confirms the reduction with CWR.
+ *
+ * With DCTCP, ECE reflects exactly the CE state of the data being acked: when
+ * the state changes, a pending delayed ACK is sent first with the old state.
+ */
+static void
+tcp_ecn_input_data(struct tcp_pcb *pcb)
+{
+  u8_t ce = (u8_t)((ip_current_header_tos() & IP_ECN_MASK) == IP_ECN_CE);
+
+  if (!(pcb->flags & TF_ECN)) {
+    return;
+  }
+#if LWIP_TCP_DCTCP
+  if (ce != ((pcb->flags & TF_ECN_CE_RCVD) ? 1 : 0)) {
+    if (pcb->flags & TF_ACK_DELAY) {
+      tcp_send_empty_ack(pcb);
+    }
+    if (ce) {
+      pcb->flags |= (tcpflags_t)(TF_ECN_CE_RCVD | TF_ECN_SND_ECE);
+    } else {
+      pcb->flags &= (tcpflags_t)~(TF_ECN_CE_RCVD | TF_ECN_SND_ECE);
+    }
+    tcp_ack_now(pcb);
+  }
+#else /* LWIP_TCP_DCTCP */
+  if (TCPH_ECN_FLAGS(tcphdr) & TCP_CWR) {
+    pcb->flags &= (tcpflags_t)~TF_ECN_SND_ECE;
+  }
+  if (ce) {
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_ecn_input_data: CE received, echoing ECE\n"));
+    pcb->flags |= TF_ECN_SND_ECE;
+  }
+#endif /* LWIP_TCP_DCTCP */
+}
+
+/**
+ * Sender side of ECN: called for every ACK that acknowledges new data.
+ * Reduces cwnd at most once per window of data when ECE is set.
+ *
+ * @param pcb the tcp_pcb the ACK arrived for
+ * @param acked number of bytes acknowledged by this ACK
+ * @return 1 if the congestion window was reduced, 0 otherwise
+ */
+static u8_t
+tcp_ecn_input_ack(struct tcp_pcb *pcb, u32_t acked)
+{
+  u8_t ece;
+  tcpwnd_size_t new_cwnd;
+
+  if (!(pcb->flags & TF_ECN)) {
+    return 0;
+  }
+  ece = (u8_t)((TCPH_ECN_FLAGS(tcphdr) & TCP_ECE) != 0);
+
+#if LWIP_TCP_DCTCP
+  pcb->dctcp_acked += acked;
+  if (ece) {
+    pcb->dctcp_ce_acked += acked;
+  }
+  if (TCP_SEQ_GEQ(ackno, pcb->dctcp_next_seq)) {
+    /* One observation window completed:
+       alpha = (1 - g) * alpha + g * F, F = marked bytes / acked bytes */
+    u32_t f = 0;
+    while (pcb->dctcp_ce_acked > (0xffffffffUL >> TCP_DCTCP_ALPHA_SHIFT)) {
+      pcb->dctcp_ce_acked >>= 1;
+      pcb->dctcp_acked >>= 1;
+    }
+    if (pcb->dctcp_acked > 0) {
+      f = (pcb->dctcp_ce_acked << TCP_DCTCP_ALPHA_SHIFT) / pcb->dctcp_acked;
+    }
+    pcb->dctcp_alpha = pcb->dctcp_alpha - (pcb->dctcp_alpha >> TCP_DCTCP_SHIFT_G) +
+                       (f >> TCP_DCTCP_SHIFT_G);
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_ecn_input_ack: dctcp alpha %"U32_F"\n", pcb->dctcp_alpha));
+    pcb->dctcp_acked = 0;
+    pcb->dctcp_ce_acked = 0;
+    pcb->dctcp_next_seq = pcb->snd_nxt;
+  }
+#else /* LWIP_TCP_DCTCP */
+  LWIP_UNUSED_ARG(acked);
+#endif /* LWIP_TCP_DCTCP */
+
+  if (!ece || TCP_SEQ_LEQ(ackno, pcb->ecn_recover)) {
+    /* no congestion signalled or already reduced for this window */
+    return 0;
+  }
+
+#if LWIP_TCP_DCTCP
+  /* cwnd = cwnd * (1 - alpha / 2) */
+  if (pcb->cwnd < (0xffffffffUL >> (TCP_DCTCP_ALPHA_SHIFT + 1))) {
+    new_cwnd = (tcpwnd_size_t)(pcb->cwnd -
+               (((u32_t)pcb->cwnd * pcb->dctcp_alpha) >> (TCP_DCTCP_ALPHA_SHIFT + 1)));
+  } else {
+    new_cwnd = (tcpwnd_size_t)(pcb->cwnd -
+               ((u32_t)(pcb->cwnd >> (TCP_DCTCP_ALPHA_SHIFT + 1)) * pcb->dctcp_alpha));
+  }
+#else /* LWIP_TCP_DCTCP */
+  new_cwnd = pcb->cwnd >> 1;
+#endif /* LWIP_TCP_DCTCP */
+  if (new_cwnd < (tcpwnd_size_t)(pcb->mss << 1)) {
+    new_cwnd = (tcpwnd_size_t)(pcb->mss << 1);
+  }
+  pcb->ssthresh = new_cwnd;
+  pcb->cwnd = new_cwnd;
+  pcb->ecn_recover = pcb->snd_nxt;
+  pcb->flags |= TF_ECN_SND_CWR;
+  LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_ecn_input_ack: ECE, cwnd %"TCPWNDSIZE_F
+                               " ssthresh %"TCPWNDSIZE_F"\n", pcb->cwnd, pcb->ssthresh));
+  return 1;
+}
+#endif /* LWIP_TCP_ECN */
+
+#if LWIP_TCP_RACK
+/**
+ * RACK: record that a segment was delivered (RFC 8985 6.2). For segments that
+ * were not retransmitted, the time since they were sent is an RTT sample.
+ *
+ * @param pcb the tcp_pcb the segment belongs to
+ * @param seg the delivered segment
+ * @param sample 1 if the segment was cumulatively acked (take an RTT sample),
+ *               0 if its delivery is only inferred from a duplicate ACK
+ */
+static void
+tcp_rack_deliver(struct tcp_pcb *pcb, struct tcp_seg *seg, u8_t sample)
+{
+  u32_t rtt = sys_now() - seg->xmit_ts;
+  u32_t end_seq = lwip_ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg);
+
+  if (seg->flags & TF_SEG_REXMIT) {
+    if (!(pcb->rack_flags & TCP_RACK_RTT_VALID) || (rtt < pcb->rack_min_rtt)) {
+      /* too fast for this transmission: the original one was delivered */
+      if (sample && (pcb->rack_flags & TCP_RACK_TLP_INFLIGHT)) {
+        /* ...so the tail loss probe did not repair a loss */
+        pcb->rack_flags &= (u8_t)~TCP_RACK_TLP_REXMIT;
+      }
+      return;
+    }
+  } else if (sample) {
+    if (!(pcb->rack_flags & TCP_RACK_RTT_VALID)) {
+      pcb->rack_min_rtt = rtt;
+      pcb->rack_srtt = rtt;
+      pcb->rack_flags |= TCP_RACK_RTT_VALID;
+    } else {
+      pcb->rack_min_rtt = LWIP_MIN(pcb->rack_min_rtt, rtt);
+      /* srtt = 7/8 srtt + 1/8 rtt */
+      pcb->rack_srtt = pcb->rack_srtt - (pcb->rack_srtt >> 3) + (rtt >> 3);
+    }
+  }
+
+  if (!(pcb->rack_flags & TCP_RACK_DELIVERED) ||
+      ((s32_t)(seg->xmit_ts - pcb->rack_xmit_ts) > 0) ||
+      ((seg->xmit_ts == pcb->rack_xmit_ts) && TCP_SEQ_GT(end_seq, pcb->rack_end_seq))) {
+    pcb->rack_xmit_ts = seg->xmit_ts;
+    pcb->rack_end_seq = end_seq;
+    pcb->rack_rtt = rtt;
+    pcb->rack_flags |= TCP_RACK_DELIVERED;
+  }
+}
+
+/**
+ * RACK loss detection (RFC 8985 6.2 step 5): the first unacked segment is
+ * lost if a segment sent after it has been delivered and more than the RTT
+ * of that segment plus a reordering window has passed since it was sent.
+ * Without SACK only the first unacked segment can be identified, so a loss
+ * starts fast retransmit just like the third duplicate ACK does. If the
+ * segment is not overdue yet, the reordering timer is started instead.
+ *
+ * A single duplicate ACK is no proof of loss without SACK: it may just as
+ * well be caused by reordering. As with Early Retransmit (RFC 5827), the
+ * usual threshold of 3 duplicate ACKs is only lowered when fewer segments
+ * follow the first unacked one, so RACK mainly adds the reordering window
+ * to small flights where dupthresh can never be reached.
+ *
+ * @param pcb the tcp_pcb to check
+ * @return 1 if a loss was detected and the retransmission queued, 0 otherwise
+ */
+u8_t
+tcp_rack_detect_loss(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg = pcb->unacked;
+  struct tcp_seg *next;
+  u32_t end_seq;
+  s32_t remaining;
+  u8_t dupthresh = 0;
+
+  pcb->rack_flags &= (u8_t)~TCP_RACK_REO_TIMER;
+  if ((seg == NULL) || (pcb->flags & TF_INFR) ||
+      ((pcb->rack_flags & (TCP_RACK_RTT_VALID | TCP_RACK_DELIVERED)) !=
+       (TCP_RACK_RTT_VALID | TCP_RACK_DELIVERED))) {
+    return 0;
+  }
+  end_seq = lwip_ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg);
+  if (((s32_t)(seg->xmit_ts - pcb->rack_xmit_ts) > 0) ||
+      ((pcb->rack_xmit_ts == seg->xmit_ts) && TCP_SEQ_GEQ(end_seq, pcb->rack_end_seq))) {
+    /* not sent before the most recently delivered segment */
+    return 0;
+  }
+  for (next = seg->next; (next != NULL) && (dupthresh < 3); next = next->next) {
+    dupthresh++;
+  }
+  if (pcb->dupacks < dupthresh) {
+    /* maybe just reordered */
+    return 0;
+  }
+
+  /* reordering window: a quarter of the minimum RTT */
+  remaining = (s32_t)(seg->xmit_ts + pcb->rack_rtt +
+                      LWIP_MAX(pcb->rack_min_rtt >> 2, TCP_RACK_REO_WND_MIN) - sys_now());
+  if (remaining > 0) {
+    pcb->rack_timer = sys_now() + (u32_t)remaining;
+    pcb->rack_flags = (u8_t)((pcb->rack_flags & ~TCP_RACK_TLP_TIMER) | TCP_RACK_REO_TIMER);
+    return 0;
+  }
+  LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_rack_detect_loss: %"U32_F" lost\n",
+                             lwip_ntohl(seg->tcphdr->seqno)));
+  tcp_rexmit_fast(pcb);
+  return 1;
+}
+
+/**
+ * RACK-TLP processing of an ACK, after the acked segments have been removed.
+ *
+ * @param pcb the tcp_pcb the ACK arrived for
+ * @param dupack 1 if the ACK was a duplicate ACK
+ */
+static void
+tcp_rack_input_ack(struct tcp_pcb *pcb, int dupack)
+{
+  if (dupack && (pcb->unacked != NULL)) {
+    /* the n-th duplicate ACK reports delivery of (at least) the n-th
+       segment after the first unacked one */
+    struct tcp_seg *seg = pcb->unacked;
+    u8_t n;
+    for (n = 0; (n < pcb->dupacks) && (seg->next != NULL); n++) {
+      seg = seg->next;
+    }
+    if (seg != pcb->unacked) {
+      tcp_rack_deliver(pcb, seg, 0);
+    }
+  }
+
+  if ((pcb->rack_flags & TCP_RACK_TLP_INFLIGHT) && TCP_SEQ_GEQ(pcb->lastack, pcb->rack_tlp_high_seq)) {
+    /* probe episode over: without DSACK, a retransmitted probe that was
+       acked is taken to have repaired a loss (RFC 8985 7.4.2) */
+    if ((pcb->rack_flags & TCP_RACK_TLP_REXMIT) && !(pcb->flags & TF_INFR)) {
+      pcb->ssthresh = LWIP_MAX(pcb->cwnd >> 1, (tcpwnd_size_t)(2 * pcb->mss));
+      pcb->cwnd = pcb->ssthresh;
+      LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_rack_input_ack: loss repaired by probe, cwnd %"TCPWNDSIZE_F"\n",
+                                   pcb->cwnd));
+    }
+    pcb->rack_flags &= (u8_t)~(TCP_RACK_TLP_INFLIGHT | TCP_RACK_TLP_REXMIT);
+  }
+
+  if (pcb->unacked == NULL) {
+    pcb->rack_flags &= (u8_t)~(TCP_RACK_REO_TIMER | TCP_RACK_TLP_TIMER);
+  } else if (!tcp_rack_detect_loss(pcb) && (recv_acked > 0)) {
+    /* forward progress: restart the probe timer */
+    tcp_rack_arm_tlp(pcb);
+  }
+}
+#endif /* LWIP_TCP_RACK */
+
 /**
  * Called by tcp_process. Checks if the given segment is an ACK for outstanding
  * data, and if so frees the memory of the buffered data. Next, it places the
@@ -1028,6 +1509,9 @@ tcp_receive(struct tcp_pcb *pcb)
   u32_t ooseq_blen;
   u16_t ooseq_qlen;
 #endif /* TCP_OOSEQ_MAX_BYTES || TCP_OOSEQ_MAX_PBUFS */
+#if LWIP_TCP_ECN
+  u8_t ecn_reduced;
+#endif /* LWIP_TCP_ECN */
 
   LWIP_ASSERT("tcp_receive: wrong state", pcb->state >= ESTABLISHED);
 
@@ -1138,12 +1622,21 @@ tcp_receive(struct tcp_pcb *pcb)
       /* Reset the retransmission time-out. */
       pcb->rto = (pcb->sa >> 3) + pcb->sv;
 
+#if LWIP_TCP_ECN
+      ecn_reduced = tcp_ecn_input_ack(pcb, ackno - pcb->lastack);
+#endif /* LWIP_TCP_ECN */
+
       /* Reset the fast retransmit variables. */
       pcb->dupacks = 0;
       pcb->lastack = ackno;
 
       /* Update the congestion control variables (cwnd and
          ssthresh). */
+#if LWIP_TCP_ECN
+      if (ecn_reduced) {
+        /* the window was just reduced because of ECE, don't grow it again */
+      } else
+#endif /* LWIP_TCP_ECN */
       if (pcb->state >= ESTABLISHED) {
         if (pcb->cwnd < pcb->ssthresh) {
           if ((tcpwnd_size_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
@@ -1183,6 +1676,9 @@ tcp_receive(struct tcp_pcb *pcb)
 
         pcb->snd_queuelen -= pbuf_clen(next->p);
         recv_acked += next->len;
+#if LWIP_TCP_RACK
+        tcp_rack_deliver(pcb, next, 1);
+#endif /* LWIP_TCP_RACK */
         tcp_seg_free(next);
 
         LWIP_DEBUGF(TCP_QLEN_DEBUG, ("%"TCPWNDSIZE_F" (after freeing unacked)\n", (tcpwnd_size_t)pcb->snd_queuelen));
@@ -1246,6 +1742,15 @@ tcp_receive(struct tcp_pcb *pcb)
       }
     }
     pcb->snd_buf += recv_acked;
+#if LWIP_TCP_RACK
+    tcp_rack_input_ack(pcb, found_dupack);
+#endif /* LWIP_TCP_RACK */
+#if LWIP_TCP_INFO
+    if (recv_acked > 0) {
+      tcp_info_acked(pcb, recv_acked);
+    }
+    tcp_info_update_limit(pcb);
+#endif /* LWIP_TCP_INFO */
     /* End of ACK for new data processing. */
 
     LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_receive: pcb->rttest %"U32_F" rtseq %"U32_F" ackno %"U32_F"\n",
@@ -1308,6 +1813,10 @@ tcp_receive(struct tcp_pcb *pcb)
     once.
     */
 
+#if LWIP_TCP_ECN
+    tcp_ecn_input_data(pcb);
+#endif /* LWIP_TCP_ECN */
+
     /* First, we check if we must trim the first edge. We have to do
        this if the sequence number of the incoming segment is less
        than rcv_nxt, and the sequence number plus the length of the
@@ -1460,6 +1969,9 @@ tcp_receive(struct tcp_pcb *pcb)
 #endif /* TCP_QUEUE_OOSEQ */
 
         pcb->rcv_nxt = seqno + tcplen;
+#if LWIP_TCP_INFO
+        pcb->info_bytes_received += inseg.len;
+#endif /* LWIP_TCP_INFO */
 
         /* Update the receiver's (our) window. */
         LWIP_ASSERT("tcp_receive: tcplen > rcv_wnd\n", pcb->rcv_wnd >= tcplen);
@@ -1498,6 +2010,9 @@ tcp_receive(struct tcp_pcb *pcb)
           seqno = pcb->ooseq->tcphdr->seqno;
 
           pcb->rcv_nxt += TCP_TCPLEN(cseg);
+#if LWIP_TCP_INFO
+          pcb->info_bytes_received += cseg->len;
+#endif /* LWIP_TCP_INFO */
           LWIP_ASSERT("tcp_receive: ooseq tcplen > rcv_wnd\n",
                       pcb->rcv_wnd >= TCP_TCPLEN(cseg));
           pcb->rcv_wnd -= TCP_TCPLEN(cseg);
@@ -1544,6 +2059,10 @@ tcp_receive(struct tcp_pcb *pcb)
       } else {
         /* We get here if the incoming segment is out-of-sequence. */
         tcp_send_empty_ack(pcb);
+#if LWIP_TCP_ACK_POLICY
+        /* acknowledge the data filling the hole without delay */
+        pcb->quickack = TCP_QUICKACK_SEGS;
+#endif /* LWIP_TCP_ACK_POLICY */
 #if TCP_QUEUE_OOSEQ
         /* We queue the segment on the ->ooseq queue. */
         if (pcb->ooseq == NULL) {
@@ -1734,6 +2253,10 @@ tcp_parseopt(struct tcp_pcb *pcb)
   u32_t tsval;
 #endif
 
+#if LWIP_TCP_TFO
+  tcp_tfo_rcvd = 0;
+#endif /* LWIP_TCP_TFO */
+
   /* Parse the TCP MSS option, if present. */
   if (tcphdr_optlen != 0) {
     for (tcp_optidx = 0; tcp_optidx < tcphdr_optlen; ) {
@@ -1811,6 +2334,28 @@ tcp_parseopt(struct tcp_pcb *pcb)
         tcp_optidx += LWIP_TCP_OPT_LEN_TS - 6;
         break;
 #endif
+#if LWIP_TCP_TFO
+      case LWIP_TCP_OPT_TFO:
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: TFO\n"));
+        data = tcp_getoptbyte();
+        if (data < 2 || (tcp_optidx - 2 + data) > tcphdr_optlen) {
+          /* Bad length */
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+          return;
+        }
+        /* an empty option is a cookie request, cookies are 4..16 bytes, even length */
+        tcp_tfo_rcvd = 1;
+        tcp_tfo_rcvd_len = 0;
+        data -= 2;
+        if ((data >= 4) && (data <= TCP_TFO_COOKIE_MAX_LEN) && ((data & 1) == 0)) {
+          for (tcp_tfo_rcvd_len = 0; tcp_tfo_rcvd_len < data; tcp_tfo_rcvd_len++) {
+            tcp_tfo_rcvd_cookie[tcp_tfo_rcvd_len] = tcp_getoptbyte();
+          }
+        } else {
+          tcp_optidx += data;
+        }
+        break;
+#endif /* LWIP_TCP_TFO */
       default:
         LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: other\n"));
         data = tcp_getoptbyte();
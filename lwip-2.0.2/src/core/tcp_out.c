@@ -52,7 +52,10 @@
 #include "lwip/stats.h"
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
-#if LWIP_TCP_TIMESTAMPS
+#if LWIP_IPV4_FIB
+#include "lwip/ip4_fib.h"
+#endif /* LWIP_IPV4_FIB */
+#if LWIP_TCP_TIMESTAMPS || LWIP_TCP_RACK || LWIP_TCP_INFO
 #include "lwip/sys.h"
 #endif
 
@@ -84,6 +87,17 @@
 #endif
 #endif
 
+#if LWIP_CHECKSUM_OFFLOAD
+/** Leave the checksum of segment 'p' (starting with the TCP header) to
+ * the netif driver if 'netif' wants that (checksum field at offset 16) */
+#define TCP_CHECKSUM_OFFLOAD(netif, p, src, dest) do { \
+  if (NETIF_CHECKSUM_PARTIAL_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP, NETIF_CHECKSUM_PARTIAL_TCP)) { \
+    ip_chksum_pseudo_offload(p, IP_PROTO_TCP, (p)->tot_len, 16, src, dest); \
+  } } while(0)
+#else /* LWIP_CHECKSUM_OFFLOAD */
+#define TCP_CHECKSUM_OFFLOAD(netif, p, src, dest)
+#endif /* LWIP_CHECKSUM_OFFLOAD */
+
 #if TCP_OVERSIZE
 /** The size of segment pbufs created when TCP_OVERSIZE is enabled */
 #ifndef TCP_OVERSIZE_CALC_LENGTH
@@ -94,6 +108,28 @@
 /* Forward declarations.*/
 static err_t tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif);
 
+#if LWIP_IPV4_FIB
+/** Find the netif to send on for a connection. IPv4 connections reuse
+ * the netif found last time unless the forwarding table or a netif changed
+ * since, so steady-state output skips the route lookup.
+ */
+static struct netif *
+tcp_route(struct tcp_pcb *pcb)
+{
+  if (IP_IS_V4(&pcb->remote_ip)) {
+    if ((pcb->rt_netif == NULL) || (pcb->rt_gen != ip4_fib_gen) ||
+        !netif_is_up(pcb->rt_netif) || !netif_is_link_up(pcb->rt_netif)) {
+      pcb->rt_netif = ip_route(&pcb->local_ip, &pcb->remote_ip);
+      pcb->rt_gen = ip4_fib_gen;
+    }
+    return pcb->rt_netif;
+  }
+  return ip_route(&pcb->local_ip, &pcb->remote_ip);
+}
+#else /* LWIP_IPV4_FIB */
+#define tcp_route(pcb) ip_route(&(pcb)->local_ip, &(pcb)->remote_ip)
+#endif /* LWIP_IPV4_FIB */
+
 /** Allocate a pbuf and create a tcphdr at p->payload, used for output
  * functions other than the default tcp_output -> tcp_output_segment
  * (e.g. tcp_send_empty_ack, etc.)
@@ -119,6 +155,11 @@ tcp_output_alloc_header(struct tcp_pcb *pcb, u16_t optlen, u16_t datalen,
     tcphdr->seqno = seqno_be;
     tcphdr->ackno = lwip_htonl(pcb->rcv_nxt);
     TCPH_HDRLEN_FLAGS_SET(tcphdr, (5 + optlen / 4), TCP_ACK);
+#if LWIP_TCP_ECN
+    if (pcb->flags & TF_ECN_SND_ECE) {
+      TCPH_SET_FLAG(tcphdr, TCP_ECE);
+    }
+#endif /* LWIP_TCP_ECN */
     tcphdr->wnd = lwip_htons(TCPWND_MIN16(RCV_WND_SCALE(pcb, pcb->rcv_ann_wnd)));
     tcphdr->chksum = 0;
     tcphdr->urgp = 0;
@@ -173,7 +214,7 @@ static struct tcp_seg *
 tcp_create_segment(struct tcp_pcb *pcb, struct pbuf *p, u8_t flags, u32_t seqno, u8_t optflags)
 {
   struct tcp_seg *seg;
-  u8_t optlen = LWIP_TCP_OPT_LENGTH(optflags);
+  u8_t optlen = LWIP_TCP_OPT_LENGTH_SEGMENT(optflags, pcb);
 
   if ((seg = (struct tcp_seg *)memp_malloc(MEMP_TCP_SEG)) == NULL) {
     LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_create_segment: no memory.\n"));
@@ -325,6 +366,15 @@ tcp_write_checks(struct tcp_pcb *pcb, u16_t len)
     return ERR_MEM;
   }
 
+#if MEMP_PRESSURE
+  /* under memory pressure, low-priority connections may not queue more data */
+  if (memp_pressure_active && (pcb->prio < TCP_PRIO_NORMAL)) {
+    LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_WARNING, ("tcp_write: paused by memory pressure\n"));
+    TCP_STATS_INC(tcp.memerr);
+    return ERR_MEM;
+  }
+#endif /* MEMP_PRESSURE */
+
   LWIP_DEBUGF(TCP_QLEN_DEBUG, ("tcp_write: queuelen: %"TCPWNDSIZE_F"\n", (tcpwnd_size_t)pcb->snd_queuelen));
 
   /* If total number of pbufs on the unsent/unacked queues exceeds the
@@ -451,7 +501,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
          last_unsent = last_unsent->next);
 
     /* Usable space at the end of the last unsent segment */
-    unsent_optlen = LWIP_TCP_OPT_LENGTH(last_unsent->flags);
+    unsent_optlen = LWIP_TCP_OPT_LENGTH_SEGMENT(last_unsent->flags, pcb);
     LWIP_ASSERT("mss_local is too small", mss_local >= last_unsent->len + unsent_optlen);
     space = mss_local - (last_unsent->len + unsent_optlen);
 
@@ -813,6 +863,11 @@ tcp_enqueue_flags(struct tcp_pcb *pcb, u8_t flags)
       optflags |= TF_SEG_OPTS_WND_SCALE;
     }
 #endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_TFO
+    if (pcb->tfo_flags & TCP_TFO_OPT) {
+      optflags |= TF_SEG_OPTS_TFO;
+    }
+#endif /* LWIP_TCP_TFO */
   }
 #if LWIP_TCP_TIMESTAMPS
   if ((pcb->flags & TF_TIMESTAMP)) {
@@ -821,7 +876,7 @@ tcp_enqueue_flags(struct tcp_pcb *pcb, u8_t flags)
     optflags |= TF_SEG_OPTS_TS;
   }
 #endif /* LWIP_TCP_TIMESTAMPS */
-  optlen = LWIP_TCP_OPT_LENGTH(optflags);
+  optlen = LWIP_TCP_OPT_LENGTH_SEGMENT(optflags, pcb);
 
   /* Allocate pbuf with room for TCP header + options */
   if ((p = pbuf_alloc(PBUF_TRANSPORT, optlen, PBUF_RAM)) == NULL) {
@@ -953,7 +1008,7 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
   }
 #endif
 
-  netif = ip_route(&pcb->local_ip, &pcb->remote_ip);
+  netif = tcp_route(pcb);
   if (netif == NULL) {
     err = ERR_RTE;
   } else {
@@ -962,6 +1017,7 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
       tcphdr->chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
         &pcb->local_ip, &pcb->remote_ip);
     }
+    TCP_CHECKSUM_OFFLOAD(netif, p, &pcb->local_ip, &pcb->remote_ip);
 #endif
     NETIF_SET_HWADDRHINT(netif, &(pcb->addr_hint));
     err = ip_output_if(p, &pcb->local_ip, &pcb->remote_ip,
@@ -976,11 +1032,154 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
   } else {
     /* remove ACK flags from the PCB, as we sent an empty ACK now */
     pcb->flags &= ~(TF_ACK_DELAY | TF_ACK_NOW);
+    tcp_ack_sent(pcb);
   }
 
   return err;
 }
 
+#if LWIP_TCP_TFO
+/**
+ * Fast Open client: fold the first data segment queued behind a not yet sent
+ * SYN into the SYN itself, so that the data goes out with the cookie.
+ *
+ * @param pcb the tcp_pcb in state SYN_SENT
+ */
+static void
+tcp_tfo_merge_syn(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *syn = pcb->unsent;
+  struct tcp_seg *data, *seg;
+  struct pbuf *p;
+  u8_t optlen;
+  u16_t clen;
+#if TCP_CHECKSUM_ON_COPY
+  u16_t chksum = 0;
+#endif /* TCP_CHECKSUM_ON_COPY */
+
+  if (!(pcb->tfo_flags & TCP_TFO_OPT) || (pcb->tfo_cookie_len == 0) ||
+      (pcb->tfo_flags & TCP_TFO_SYN_DATA) || (pcb->unacked != NULL) || (pcb->nrtx != 0) ||
+      (syn == NULL) || !(TCPH_FLAGS(syn->tcphdr) & TCP_SYN) || (syn->len != 0)) {
+    return;
+  }
+  data = syn->next;
+  if ((data == NULL) || (data->len == 0) || (TCPH_FLAGS(data->tcphdr) & TCP_FIN)) {
+    return;
+  }
+
+  optlen = LWIP_TCP_OPT_LENGTH_SEGMENT(syn->flags, pcb);
+  p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)(optlen + data->len), PBUF_RAM);
+  if (p == NULL) {
+    LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_tfo_merge_syn: no memory, sending SYN without data\n"));
+    return;
+  }
+#if TCP_CHECKSUM_ON_COPY
+  pbuf_copy_partial_chksum(data->p, (u8_t *)p->payload + optlen, data->len,
+                           (u16_t)(TCPH_HDRLEN(data->tcphdr) * 4), &chksum);
+#else /* TCP_CHECKSUM_ON_COPY */
+  pbuf_copy_partial(data->p, (u8_t *)p->payload + optlen, data->len,
+                    (u16_t)(TCPH_HDRLEN(data->tcphdr) * 4));
+#endif /* TCP_CHECKSUM_ON_COPY */
+  seg = tcp_create_segment(pcb, p, (u8_t)(TCPH_FLAGS(syn->tcphdr) | TCPH_ECN_FLAGS(syn->tcphdr)),
+                           lwip_ntohl(syn->tcphdr->seqno), syn->flags);
+  if (seg == NULL) {
+    return;
+  }
+#if TCP_CHECKSUM_ON_COPY
+  tcp_seg_add_chksum(chksum, seg->len, &seg->chksum, &seg->chksum_swapped);
+  seg->flags |= TF_SEG_DATA_CHECKSUMMED;
+#endif /* TCP_CHECKSUM_ON_COPY */
+  LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_tfo_merge_syn: sending %"U16_F" bytes in the SYN\n", seg->len));
+
+  clen = (u16_t)(pbuf_clen(syn->p) + pbuf_clen(data->p));
+  seg->next = data->next;
+  pcb->unsent = seg;
+#if TCP_OVERSIZE
+  if (seg->next == NULL) {
+    /* the merged segment has no room to extend */
+    pcb->unsent_oversize = 0;
+  }
+#endif /* TCP_OVERSIZE */
+  pcb->snd_queuelen = (u16_t)(pcb->snd_queuelen - clen + pbuf_clen(seg->p));
+  tcp_seg_free(syn);
+  tcp_seg_free(data);
+
+  pcb->tfo_flags |= TCP_TFO_SYN_DATA;
+  /* the initial cwnd of 1 in SYN_SENT would hold the data back */
+  if (pcb->cwnd < seg->len) {
+    pcb->cwnd = seg->len;
+  }
+}
+
+/**
+ * Fast Open client: move the data carried by a SYN into a segment of its own
+ * following the SYN. Used when the SYN needs to be retransmitted or when the
+ * server acknowledged the SYN but not its data.
+ *
+ * @param pcb the tcp_pcb in state SYN_SENT
+ * @param syn the SYN segment (on pcb->unacked or pcb->unsent)
+ * @return ERR_OK, or ERR_MEM if the new segment could not be allocated
+ */
+err_t
+tcp_tfo_split_syn(struct tcp_pcb *pcb, struct tcp_seg *syn)
+{
+  struct tcp_seg *seg;
+  struct pbuf *p;
+  u8_t optflags = 0;
+  u8_t optlen;
+  u16_t hdrlen;
+#if TCP_CHECKSUM_ON_COPY
+  u16_t chksum = 0;
+#endif /* TCP_CHECKSUM_ON_COPY */
+
+  if ((syn == NULL) || !(TCPH_FLAGS(syn->tcphdr) & TCP_SYN) || (syn->len == 0)) {
+    return ERR_OK;
+  }
+#if LWIP_TCP_TIMESTAMPS
+  if (pcb->flags & TF_TIMESTAMP) {
+    optflags |= TF_SEG_OPTS_TS;
+  }
+#endif /* LWIP_TCP_TIMESTAMPS */
+  optlen = LWIP_TCP_OPT_LENGTH(optflags);
+  /* a SYN sent before has its payload pointing to the IP/link headers:
+     the data starts behind the TCP header, wherever that is */
+  hdrlen = (u16_t)(((u8_t *)syn->tcphdr - (u8_t *)syn->p->payload) + TCPH_HDRLEN(syn->tcphdr) * 4);
+
+  p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)(optlen + syn->len), PBUF_RAM);
+  if (p == NULL) {
+    LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_tfo_split_syn: no memory\n"));
+    return ERR_MEM;
+  }
+#if TCP_CHECKSUM_ON_COPY
+  pbuf_copy_partial_chksum(syn->p, (u8_t *)p->payload + optlen, syn->len, hdrlen, &chksum);
+#else /* TCP_CHECKSUM_ON_COPY */
+  pbuf_copy_partial(syn->p, (u8_t *)p->payload + optlen, syn->len, hdrlen);
+#endif /* TCP_CHECKSUM_ON_COPY */
+  seg = tcp_create_segment(pcb, p, TCP_PSH, lwip_ntohl(syn->tcphdr->seqno) + 1, optflags);
+  if (seg == NULL) {
+    return ERR_MEM;
+  }
+#if TCP_CHECKSUM_ON_COPY
+  tcp_seg_add_chksum(chksum, seg->len, &seg->chksum, &seg->chksum_swapped);
+  seg->flags |= TF_SEG_DATA_CHECKSUMMED;
+#endif /* TCP_CHECKSUM_ON_COPY */
+  LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_tfo_split_syn: moving %"U16_F" bytes out of the SYN\n", seg->len));
+
+  pbuf_realloc(syn->p, hdrlen);
+  syn->len = 0;
+#if TCP_CHECKSUM_ON_COPY
+  syn->chksum = 0;
+  syn->chksum_swapped = 0;
+  syn->flags &= (u8_t)~TF_SEG_DATA_CHECKSUMMED;
+#endif /* TCP_CHECKSUM_ON_COPY */
+  seg->next = syn->next;
+  syn->next = seg;
+  pcb->snd_queuelen++;
+  pcb->tfo_flags &= (u8_t)~TCP_TFO_SYN_DATA;
+  return ERR_OK;
+}
+#endif /* LWIP_TCP_TFO */
+
 /**
  * @ingroup tcp_raw
  * Find out what we can send and send it
@@ -999,6 +1198,9 @@ tcp_output(struct tcp_pcb *pcb)
 #if TCP_CWND_DEBUG
   s16_t i = 0;
 #endif /* TCP_CWND_DEBUG */
+#if LWIP_TCP_RACK
+  u32_t rack_snd_nxt;
+#endif /* LWIP_TCP_RACK */
 
   /* pcb->state LISTEN not allowed here */
   LWIP_ASSERT("don't call tcp_output for listen-pcbs",
@@ -1012,6 +1214,15 @@ tcp_output(struct tcp_pcb *pcb)
     return ERR_OK;
   }
 
+#if LWIP_TCP_TFO
+  if (pcb->state == SYN_SENT) {
+    tcp_tfo_merge_syn(pcb);
+  }
+#endif /* LWIP_TCP_TFO */
+#if LWIP_TCP_RACK
+  rack_snd_nxt = pcb->snd_nxt;
+#endif /* LWIP_TCP_RACK */
+
   wnd = LWIP_MIN(pcb->snd_wnd, pcb->cwnd);
 
   seg = pcb->unsent;
@@ -1034,7 +1245,7 @@ tcp_output(struct tcp_pcb *pcb)
     for (; useg->next != NULL; useg = useg->next);
   }
 
-  netif = ip_route(&pcb->local_ip, &pcb->remote_ip);
+  netif = tcp_route(pcb);
   if (netif == NULL) {
     return ERR_RTE;
   }
@@ -1115,6 +1326,12 @@ tcp_output(struct tcp_pcb *pcb)
     if (pcb->state != SYN_SENT) {
       TCPH_SET_FLAG(seg->tcphdr, TCP_ACK);
     }
+#if LWIP_TCP_TFO
+    else if (!(TCPH_FLAGS(seg->tcphdr) & TCP_SYN)) {
+      /* data split off a Fast Open SYN waits for the handshake */
+      break;
+    }
+#endif /* LWIP_TCP_TFO */
 
 #if TCP_OVERSIZE_DBGCHECK
     seg->oversize_left = 0;
@@ -1128,6 +1345,7 @@ tcp_output(struct tcp_pcb *pcb)
     pcb->unsent = seg->next;
     if (pcb->state != SYN_SENT) {
       pcb->flags &= ~(TF_ACK_DELAY | TF_ACK_NOW);
+      tcp_ack_sent(pcb);
     }
     snd_nxt = lwip_ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg);
     if (TCP_SEQ_LT(pcb->snd_nxt, snd_nxt)) {
@@ -1173,6 +1391,15 @@ output_done:
     pcb->unsent_oversize = 0;
   }
 #endif /* TCP_OVERSIZE */
+#if LWIP_TCP_RACK
+  if (TCP_SEQ_GT(pcb->snd_nxt, rack_snd_nxt)) {
+    /* new data was sent: (re)start the tail loss probe timer */
+    tcp_rack_arm_tlp(pcb);
+  }
+#endif /* LWIP_TCP_RACK */
+#if LWIP_TCP_INFO
+  tcp_info_update_limit(pcb);
+#endif /* LWIP_TCP_INFO */
 
   pcb->flags &= ~TF_NAGLEMEMERR;
   return ERR_OK;
@@ -1191,6 +1418,11 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
   err_t err;
   u16_t len;
   u32_t *opts;
+  u8_t tos = pcb->tos;
+#if TCP_CHECKSUM_INCREMENTAL
+  u16_t chksum_prev;
+  u8_t chksum_reuse;
+#endif /* TCP_CHECKSUM_INCREMENTAL */
 
   if (seg->p->ref != 1) {
     /* This can happen if the pbuf of this segment is still referenced by the
@@ -1199,6 +1431,26 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
     return ERR_OK;
   }
 
+#if LWIP_TCP_RACK
+  if (TCP_SEQ_LT(lwip_ntohl(seg->tcphdr->seqno), pcb->snd_nxt)) {
+    seg->flags |= TF_SEG_REXMIT;
+  }
+  seg->xmit_ts = sys_now();
+#endif /* LWIP_TCP_RACK */
+#if LWIP_TCP_INFO
+  if (TCP_SEQ_LT(lwip_ntohl(seg->tcphdr->seqno), pcb->snd_nxt)) {
+    pcb->info_bytes_retrans += seg->len;
+    pcb->info_retrans++;
+  } else {
+    if (pcb->unacked == NULL) {
+      /* nothing in flight: start a new delivery rate interval */
+      pcb->info_rate_ts = sys_now();
+      pcb->info_rate_acked = 0;
+    }
+    pcb->info_bytes_sent += seg->len;
+  }
+#endif /* LWIP_TCP_INFO */
+
   /* The TCP header has already been constructed, but the ackno and
    wnd fields remain. */
   seg->tcphdr->ackno = lwip_htonl(pcb->rcv_nxt);
@@ -1217,6 +1469,24 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
 
   pcb->rcv_ann_right_edge = pcb->rcv_nxt + pcb->rcv_ann_wnd;
 
+#if LWIP_TCP_ECN
+  /* ECE/CWR on a SYN or SYN-ACK belong to the ECN negotiation, leave them alone */
+  if ((pcb->flags & TF_ECN) && !(TCPH_FLAGS(seg->tcphdr) & TCP_SYN)) {
+    TCPH_UNSET_FLAG(seg->tcphdr, TCP_ECE | TCP_CWR);
+    if (pcb->flags & TF_ECN_SND_ECE) {
+      TCPH_SET_FLAG(seg->tcphdr, TCP_ECE);
+    }
+    /* Only new data is sent ECN-capable, retransmissions are not (RFC 3168 6.1.5) */
+    if ((seg->len > 0) && TCP_SEQ_GEQ(lwip_ntohl(seg->tcphdr->seqno), pcb->snd_nxt)) {
+      tos = (u8_t)((tos & ~IP_ECN_MASK) | IP_ECN_ECT0);
+      if (pcb->flags & TF_ECN_SND_CWR) {
+        TCPH_SET_FLAG(seg->tcphdr, TCP_CWR);
+        pcb->flags &= ~TF_ECN_SND_CWR;
+      }
+    }
+  }
+#endif /* LWIP_TCP_ECN */
+
   /* Add any requested options.  NB MSS option is only set on SYN
      packets, so ignore it here */
   /* cast through void* to get rid of alignment warnings */
@@ -1245,6 +1515,20 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
     opts += 1;
   }
 #endif
+#if LWIP_TCP_TFO
+  if (seg->flags & TF_SEG_OPTS_TFO) {
+    u8_t *tfo_opt = (u8_t *)opts;
+    u8_t tfo_optlen = LWIP_TCP_OPT_LEN_TFO_OUT(pcb->tfo_cookie_len);
+    tfo_opt[0] = LWIP_TCP_OPT_NOP;
+    tfo_opt[1] = LWIP_TCP_OPT_NOP;
+    tfo_opt[2] = LWIP_TCP_OPT_TFO;
+    tfo_opt[3] = (u8_t)(2 + pcb->tfo_cookie_len);
+    MEMCPY(&tfo_opt[4], pcb->tfo_cookie, pcb->tfo_cookie_len);
+    /* pad to 32 bit with EOL */
+    memset(&tfo_opt[4 + pcb->tfo_cookie_len], LWIP_TCP_OPT_EOL, tfo_optlen - 4 - pcb->tfo_cookie_len);
+    opts += tfo_optlen / 4;
+  }
+#endif /* LWIP_TCP_TFO */
 
   /* Set retransmission timer running if it is not currently enabled
      This must be set before checking the route. */
@@ -1273,7 +1557,16 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
 
   seg->p->payload = seg->tcphdr;
 
+#if TCP_CHECKSUM_INCREMENTAL
+  /* the checksum sent last time can be reused if the data did not change */
+  chksum_reuse = (seg->flags & TF_SEG_CHKSUM_VALID) && (seg->hdr_chksum_len == seg->len);
+  chksum_prev = seg->tcphdr->chksum;
+  seg->flags &= (u8_t)~TF_SEG_CHKSUM_VALID;
+#endif /* TCP_CHECKSUM_INCREMENTAL */
   seg->tcphdr->chksum = 0;
+#if LWIP_CHECKSUM_OFFLOAD
+  seg->p->flags &= (u8_t)~PBUF_FLAG_CHKSUM_PARTIAL;
+#endif /* LWIP_CHECKSUM_OFFLOAD */
 #if CHECKSUM_GEN_TCP
   IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP) {
 #if TCP_CHECKSUM_ON_COPY
@@ -1306,16 +1599,29 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
     }
 #endif /* TCP_CHECKSUM_ON_COPY_SANITY_CHECK */
 #else /* TCP_CHECKSUM_ON_COPY */
-    seg->tcphdr->chksum = ip_chksum_pseudo(seg->p, IP_PROTO_TCP,
-      seg->p->tot_len, &pcb->local_ip, &pcb->remote_ip);
+    /* only the header and the pseudo header length can have changed */
+    u32_t hdr_acc = (u16_t)~inet_chksum(seg->tcphdr, TCPH_HDRLEN(seg->tcphdr) * 4);
+    hdr_acc += lwip_htons(seg->p->tot_len);
+    hdr_acc = FOLD_U32T(hdr_acc);
+    hdr_acc = FOLD_U32T(hdr_acc);
+    if (chksum_reuse) {
+      seg->tcphdr->chksum = inet_chksum_adjust(chksum_prev, seg->hdr_chksum, (u16_t)hdr_acc);
+    } else {
+      seg->tcphdr->chksum = ip_chksum_pseudo(seg->p, IP_PROTO_TCP,
+        seg->p->tot_len, &pcb->local_ip, &pcb->remote_ip);
+    }
+    seg->hdr_chksum = (u16_t)hdr_acc;
+    seg->hdr_chksum_len = seg->len;
+    seg->flags |= TF_SEG_CHKSUM_VALID;
 #endif /* TCP_CHECKSUM_ON_COPY */
   }
+  TCP_CHECKSUM_OFFLOAD(netif, seg->p, &pcb->local_ip, &pcb->remote_ip);
 #endif /* CHECKSUM_GEN_TCP */
   TCP_STATS_INC(tcp.xmit);
 
   NETIF_SET_HWADDRHINT(netif, &(pcb->addr_hint));
   err = ip_output_if(seg->p, &pcb->local_ip, &pcb->remote_ip, pcb->ttl,
-    pcb->tos, IP_PROTO_TCP, netif);
+    tos, IP_PROTO_TCP, netif);
   NETIF_SET_HWADDRHINT(netif, NULL);
   return err;
 }
@@ -1381,6 +1687,7 @@ tcp_rst(u32_t seqno, u32_t ackno,
       tcphdr->chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
                                         local_ip, remote_ip);
     }
+    TCP_CHECKSUM_OFFLOAD(netif, p, local_ip, remote_ip);
 #endif
     /* Send output with hardcoded TTL/HL since we have no access to the pcb */
     ip_output_if(p, local_ip, remote_ip, TCP_TTL, 0, IP_PROTO_TCP, netif);
@@ -1520,6 +1827,116 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
   }
 }
 
+#if LWIP_TCP_RACK
+/**
+ * Start the tail loss probe timer (RFC 8985 7.2) unless the reordering timer
+ * is running, a probe is already outstanding or we are in fast recovery.
+ *
+ * @param pcb the tcp_pcb to probe
+ */
+void
+tcp_rack_arm_tlp(struct tcp_pcb *pcb)
+{
+  u32_t pto, rto;
+
+  if (pcb->rack_flags & TCP_RACK_REO_TIMER) {
+    return;
+  }
+  pcb->rack_flags &= (u8_t)~TCP_RACK_TLP_TIMER;
+  if ((pcb->unacked == NULL) || (pcb->state < ESTABLISHED) ||
+      (pcb->flags & TF_INFR) || (pcb->rack_flags & TCP_RACK_TLP_INFLIGHT)) {
+    return;
+  }
+
+  if (pcb->rack_flags & TCP_RACK_RTT_VALID) {
+    pto = 2 * pcb->rack_srtt;
+    if (pcb->unacked->next == NULL) {
+      /* a single segment may sit in the receiver's delayed ACK timer */
+      pto += TCP_RACK_WCDELACKT;
+    }
+  } else {
+    pto = TCP_RACK_PTO_INIT;
+  }
+  rto = (u32_t)pcb->rto * TCP_SLOW_INTERVAL;
+  pto = LWIP_MIN(pto, rto);
+
+  pcb->rack_timer = sys_now() + pto;
+  pcb->rack_flags |= TCP_RACK_TLP_TIMER;
+  LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_rack_arm_tlp: probe in %"U32_F" ms\n", pto));
+}
+
+/**
+ * Send a tail loss probe: new data if the receive window allows it,
+ * otherwise a retransmission of the last segment sent.
+ *
+ * @param pcb the tcp_pcb to probe
+ */
+static void
+tcp_rack_send_tlp(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+  struct netif *netif;
+  u32_t snd_nxt = pcb->snd_nxt;
+
+  seg = pcb->unsent;
+  if ((seg != NULL) &&
+      (lwip_ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len <= pcb->snd_wnd)) {
+    /* the probe may exceed cwnd by one segment */
+    tcpwnd_size_t cwnd = pcb->cwnd;
+    pcb->cwnd = (tcpwnd_size_t)LWIP_MAX(cwnd, lwip_ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len);
+    pcb->rack_flags |= TCP_RACK_TLP_INFLIGHT;
+    tcp_output(pcb);
+    pcb->cwnd = cwnd;
+    if (TCP_SEQ_GT(pcb->snd_nxt, snd_nxt)) {
+      LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_rack_send_tlp: new data probe\n"));
+      pcb->rack_tlp_high_seq = pcb->snd_nxt;
+      return;
+    }
+    pcb->rack_flags &= (u8_t)~TCP_RACK_TLP_INFLIGHT;
+  }
+
+  /* retransmit the segment with the highest sequence number */
+  for (seg = pcb->unacked; seg->next != NULL; seg = seg->next);
+  netif = tcp_route(pcb);
+  if (netif == NULL) {
+    return;
+  }
+  LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_rack_send_tlp: retransmitting %"U32_F"\n",
+                              lwip_ntohl(seg->tcphdr->seqno)));
+  if (tcp_output_segment(seg, pcb, netif) == ERR_OK) {
+    /* Don't take any RTT measurements after retransmitting. */
+    pcb->rttest = 0;
+    pcb->rack_flags |= TCP_RACK_TLP_INFLIGHT | TCP_RACK_TLP_REXMIT;
+    pcb->rack_tlp_high_seq = pcb->snd_nxt;
+  }
+}
+
+/**
+ * Called by tcp_fasttmr() when the RACK reordering timer or the tail loss
+ * probe timer expired.
+ *
+ * @param pcb the tcp_pcb whose timer expired
+ */
+void
+tcp_rack_timeout(struct tcp_pcb *pcb)
+{
+  if (pcb->rack_flags & TCP_RACK_REO_TIMER) {
+    pcb->rack_flags &= (u8_t)~TCP_RACK_REO_TIMER;
+    if (tcp_rack_detect_loss(pcb)) {
+      tcp_output(pcb);
+    } else {
+      tcp_rack_arm_tlp(pcb);
+    }
+  } else if (pcb->rack_flags & TCP_RACK_TLP_TIMER) {
+    pcb->rack_flags &= (u8_t)~TCP_RACK_TLP_TIMER;
+    if ((pcb->unacked != NULL) && !(pcb->flags & TF_INFR) &&
+        !(pcb->rack_flags & TCP_RACK_TLP_INFLIGHT)) {
+      tcp_rack_send_tlp(pcb);
+    }
+  }
+}
+#endif /* LWIP_TCP_RACK */
+
 
 /**
  * Send keepalive packets to keep a connection active although
@@ -1549,7 +1966,7 @@ tcp_keepalive(struct tcp_pcb *pcb)
                 ("tcp_keepalive: could not allocate memory for pbuf\n"));
     return ERR_MEM;
   }
-  netif = ip_route(&pcb->local_ip, &pcb->remote_ip);
+  netif = tcp_route(pcb);
   if (netif == NULL) {
     err = ERR_RTE;
   } else {
@@ -1559,6 +1976,7 @@ tcp_keepalive(struct tcp_pcb *pcb)
       tcphdr->chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
         &pcb->local_ip, &pcb->remote_ip);
     }
+    TCP_CHECKSUM_OFFLOAD(netif, p, &pcb->local_ip, &pcb->remote_ip);
 #endif /* CHECKSUM_GEN_TCP */
     TCP_STATS_INC(tcp.xmit);
 
@@ -1643,7 +2061,7 @@ tcp_zero_window_probe(struct tcp_pcb *pcb)
     pcb->snd_nxt = snd_nxt;
   }
 
-  netif = ip_route(&pcb->local_ip, &pcb->remote_ip);
+  netif = tcp_route(pcb);
   if (netif == NULL) {
     err = ERR_RTE;
   } else {
@@ -1652,6 +2070,7 @@ tcp_zero_window_probe(struct tcp_pcb *pcb)
       tcphdr->chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
         &pcb->local_ip, &pcb->remote_ip);
     }
+    TCP_CHECKSUM_OFFLOAD(netif, p, &pcb->local_ip, &pcb->remote_ip);
 #endif
     TCP_STATS_INC(tcp.xmit);
 
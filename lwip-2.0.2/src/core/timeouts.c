@@ -104,6 +104,9 @@ const struct lwip_cyclic_timer lwip_cyclic_timers[] = {
   {MLD6_TMR_INTERVAL, HANDLER(mld6_tmr)},
 #endif /* LWIP_IPV6_MLD */
 #endif /* LWIP_IPV6 */
+#if MEMP_PRESSURE
+  {MEMP_PRESSURE_INTERVAL, HANDLER(memp_pressure_tmr)},
+#endif /* MEMP_PRESSURE */
 };
 
 #if LWIP_TIMERS && !LWIP_TIMERS_CUSTOM
@@ -80,6 +80,85 @@ static u16_t udp_port = UDP_LOCAL_PORT_RANGE_START;
 /* exported in udp.h (was static) */
 struct udp_pcb *udp_pcbs;
 
+#if UDP_PCB_HASH_SIZE
+#if (UDP_PCB_HASH_SIZE & (UDP_PCB_HASH_SIZE - 1)) != 0
+#error UDP_PCB_HASH_SIZE must be a power of two
+#endif
+
+/** Unconnected pcbs of udp_pcbs hashed on their local port */
+static struct udp_pcb *udp_bound_hash[UDP_PCB_HASH_SIZE];
+/** Connected pcbs of udp_pcbs hashed on their local and remote port */
+static struct udp_pcb *udp_connected_hash[UDP_PCB_HASH_SIZE];
+/** list_seq of the pcb put on udp_pcbs last */
+static u32_t udp_list_seq;
+
+/** Whether pcb comes before other on udp_pcbs (it was put there later) */
+#define udp_pcb_precedes(pcb, other) ((s32_t)((pcb)->list_seq - (other)->list_seq) > 0)
+/** Record that pcb was just put at the front of udp_pcbs */
+#define udp_hash_stamp(pcb) ((pcb)->list_seq = ++udp_list_seq)
+
+/**
+ * Get the hash bucket for pcbs with a local port and (if connected) a
+ * remote port.
+ */
+static struct udp_pcb **
+udp_hash_bucket(u16_t local_port, u16_t remote_port, u8_t connected)
+{
+  u32_t h = local_port;
+
+  if (connected) {
+    h |= (u32_t)remote_port << 16;
+  }
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  if (connected) {
+    return &udp_connected_hash[h & (UDP_PCB_HASH_SIZE - 1)];
+  }
+  return &udp_bound_hash[h & (UDP_PCB_HASH_SIZE - 1)];
+}
+
+#define udp_pcb_bucket(pcb) udp_hash_bucket((pcb)->local_port, (pcb)->remote_port, \
+                                            (u8_t)(((pcb)->flags & UDP_FLAGS_CONNECTED) != 0))
+
+/**
+ * Add a pcb to the hash bucket for its current ports.
+ * Buckets are not kept in udp_pcbs order: udp_input() compares list_seq
+ * to pick the same pcb as a walk of udp_pcbs would.
+ */
+static void
+udp_hash_add(struct udp_pcb *pcb)
+{
+  struct udp_pcb **pp = udp_pcb_bucket(pcb);
+
+  pcb->hash_next = *pp;
+  *pp = pcb;
+}
+
+/**
+ * Remove a pcb from the hash bucket for its current ports.
+ *
+ * @return 1 if the pcb was hashed (i.e. it is on udp_pcbs), 0 otherwise
+ */
+static u8_t
+udp_hash_remove(struct udp_pcb *pcb)
+{
+  struct udp_pcb **pp;
+
+  for (pp = udp_pcb_bucket(pcb); *pp != NULL; pp = &(*pp)->hash_next) {
+    if (*pp == pcb) {
+      *pp = pcb->hash_next;
+      return 1;
+    }
+  }
+  return 0;
+}
+#else /* UDP_PCB_HASH_SIZE */
+#define udp_hash_stamp(pcb)
+#define udp_hash_add(pcb)
+#define udp_hash_remove(pcb)
+#endif /* UDP_PCB_HASH_SIZE */
+
 /**
  * Initialize this module.
  */
@@ -169,6 +248,71 @@ udp_input_local_match(struct udp_pcb *pcb, struct netif *inp, u8_t broadcast)
   return 0;
 }
 
+#if LWIP_SO_REUSEPORT
+/**
+ * Pick the member of the SO_REUSEPORT group of an unconnected pcb that gets
+ * the current datagram.
+ *
+ * @param pcb the first unconnected pcb matching the datagram
+ * @param src source port of the datagram
+ * @return the group member with the highest weight for the datagram source
+ */
+static struct udp_pcb *
+udp_reuseport_select(struct udp_pcb *pcb, u16_t src)
+{
+  struct udp_pcb *ipcb, *best = pcb;
+  u32_t weight, best_weight = ip_reuseport_weight(pcb, ip_current_src_addr(), src);
+
+#if UDP_PCB_HASH_SIZE
+  for (ipcb = *udp_hash_bucket(pcb->local_port, 0, 0); ipcb != NULL; ipcb = ipcb->hash_next) {
+#else /* UDP_PCB_HASH_SIZE */
+  for (ipcb = udp_pcbs; ipcb != NULL; ipcb = ipcb->next) {
+#endif /* UDP_PCB_HASH_SIZE */
+    if ((ipcb != pcb) && (ipcb->local_port == pcb->local_port) &&
+        ((ipcb->flags & UDP_FLAGS_CONNECTED) == 0) &&
+        ip_get_option(ipcb, SOF_REUSEPORT) &&
+        ip_addr_cmp(&ipcb->local_ip, &pcb->local_ip)) {
+      weight = ip_reuseport_weight(ipcb, ip_current_src_addr(), src);
+      if (weight > best_weight) {
+        best = ipcb;
+        best_weight = weight;
+      }
+    }
+  }
+  return best;
+}
+#endif /* LWIP_SO_REUSEPORT */
+
+#if UDP_PCB_HASH_SIZE
+/**
+ * Check if an unconnected pcb matching the current datagram should get it
+ * instead of the one picked so far, in the same way as the walk of udp_pcbs
+ * in udp_input() without hashing.
+ *
+ * @param pcb the unconnected pcb that matches the datagram
+ * @param uncon_pcb the matching pcb picked so far (may be NULL)
+ * @return 1 if pcb gets the datagram instead, 0 otherwise
+ */
+static u8_t
+udp_hash_uncon_better(struct udp_pcb *pcb, struct udp_pcb *uncon_pcb)
+{
+  if (uncon_pcb == NULL) {
+    return 1;
+  }
+#if SO_REUSE
+  /* the walk prefers specific IPs over catch-all: it keeps the first
+     catch-all pcb on the list, but the last specific one */
+  if (!ip_addr_isany(&pcb->local_ip)) {
+    return (u8_t)(ip_addr_isany(&uncon_pcb->local_ip) || udp_pcb_precedes(uncon_pcb, pcb));
+  }
+  if (!ip_addr_isany(&uncon_pcb->local_ip)) {
+    return 0;
+  }
+#endif /* SO_REUSE */
+  return (u8_t)udp_pcb_precedes(pcb, uncon_pcb);
+}
+#endif /* UDP_PCB_HASH_SIZE */
+
 /**
  * Process an incoming UDP datagram.
  *
@@ -185,8 +329,12 @@ void
 udp_input(struct pbuf *p, struct netif *inp)
 {
   struct udp_hdr *udphdr;
-  struct udp_pcb *pcb, *prev;
+  struct udp_pcb *pcb;
   struct udp_pcb *uncon_pcb;
+#if UDP_PCB_HASH_SIZE
+  struct udp_pcb *ipcb;
+  struct udp_pcb **bucket;
+#endif /* UDP_PCB_HASH_SIZE */
   u16_t src, dest;
   u8_t broadcast;
   u8_t for_us = 0;
@@ -230,8 +378,37 @@ udp_input(struct pbuf *p, struct netif *inp)
   LWIP_DEBUGF(UDP_DEBUG, (", %"U16_F")\n", lwip_ntohs(udphdr->src)));
 
   pcb = NULL;
-  prev = NULL;
   uncon_pcb = NULL;
+#if UDP_PCB_HASH_SIZE
+  /* Only the pcbs hashed like the datagram can match: connected pcbs are
+   * preferred, if none matches, the unconnected pcb a walk of udp_pcbs would
+   * pick gets the datagram. Buckets are not in list order, so every member is
+   * checked and list_seq decides. */
+  bucket = udp_hash_bucket(dest, src, 1);
+  for (ipcb = *bucket; ipcb != NULL; ipcb = ipcb->hash_next) {
+    if ((ipcb->local_port == dest) && (ipcb->remote_port == src) &&
+        (udp_input_local_match(ipcb, inp, broadcast) != 0) &&
+        (ip_addr_isany_val(ipcb->remote_ip) ||
+        ip_addr_cmp(&ipcb->remote_ip, ip_current_src_addr())) &&
+        ((pcb == NULL) || udp_pcb_precedes(ipcb, pcb))) {
+      pcb = ipcb;
+    }
+  }
+  if (pcb != NULL) {
+    if (pcb == *bucket) {
+      UDP_STATS_INC(udp.cachehit);
+    }
+  } else {
+    bucket = udp_hash_bucket(dest, 0, 0);
+    for (ipcb = *bucket; ipcb != NULL; ipcb = ipcb->hash_next) {
+      if ((ipcb->local_port == dest) &&
+          (udp_input_local_match(ipcb, inp, broadcast) != 0) &&
+          udp_hash_uncon_better(ipcb, uncon_pcb)) {
+        uncon_pcb = ipcb;
+      }
+    }
+  }
+#else /* UDP_PCB_HASH_SIZE */
   /* Iterate through the UDP pcb list for a matching pcb.
    * 'Perfect match' pcbs (connected to the remote port & ip address) are
    * preferred. If no perfect match is found, the first unconnected pcb that
@@ -262,25 +439,27 @@ udp_input(struct pbuf *p, struct netif *inp)
       if ((pcb->remote_port == src) &&
           (ip_addr_isany_val(pcb->remote_ip) ||
           ip_addr_cmp(&pcb->remote_ip, ip_current_src_addr()))) {
-        /* the first fully matching PCB */
-        if (prev != NULL) {
-          /* move the pcb to the front of udp_pcbs so that is
-             found faster next time */
-          prev->next = pcb->next;
-          pcb->next = udp_pcbs;
-          udp_pcbs = pcb;
-        } else {
+        /* the first fully matching PCB; it is not moved to the front of
+           udp_pcbs, as that would change which unconnected pcb wins once
+           it is disconnected (and the hashed lookup does not reorder) */
+        if (pcb == udp_pcbs) {
           UDP_STATS_INC(udp.cachehit);
         }
         break;
       }
     }
-
-    prev = pcb;
   }
+#endif /* UDP_PCB_HASH_SIZE */
   /* no fully matching pcb found? then look for an unconnected pcb */
   if (pcb == NULL) {
     pcb = uncon_pcb;
+#if LWIP_SO_REUSEPORT
+    /* unicast datagrams are spread over the group of the pcb */
+    if ((pcb != NULL) && ip_get_option(pcb, SOF_REUSEPORT) &&
+        !broadcast && !ip_addr_ismulticast(ip_current_dest_addr())) {
+      pcb = udp_reuseport_select(pcb, src);
+    }
+#endif /* LWIP_SO_REUSEPORT */
   }
 
   /* Check checksum if this is a match or if it was directed at us. */
@@ -326,7 +505,8 @@ udp_input(struct pbuf *p, struct netif *inp)
       } else
 #endif /* LWIP_UDPLITE */
       {
-        if (udphdr->chksum != 0) {
+        /* no checksum sent or already verified by the netif driver? */
+        if ((udphdr->chksum != 0) && !PBUF_CHKSUM_VERIFIED(p)) {
           if (ip_chksum_pseudo(p, IP_PROTO_UDP, p->tot_len,
                                ip_current_src_addr(),
                                ip_current_dest_addr()) != 0) {
@@ -736,6 +916,10 @@ udp_sendto_if_src_chksum(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *d
   udphdr->dest = lwip_htons(dst_port);
   /* in UDP, 0 checksum means 'no checksum' */
   udphdr->chksum = 0x0000;
+#if LWIP_CHECKSUM_OFFLOAD
+  /* p may have been sent before */
+  q->flags &= (u8_t)~PBUF_FLAG_CHKSUM_PARTIAL;
+#endif /* LWIP_CHECKSUM_OFFLOAD */
 
   /* Multicast Loop? */
 #if (LWIP_IPV4 && LWIP_MULTICAST_TX_OPTIONS) || (LWIP_IPV6 && LWIP_IPV6_MLD)
@@ -825,6 +1009,13 @@ udp_sendto_if_src_chksum(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *d
         udphdr->chksum = udpchksum;
       }
     }
+#if LWIP_CHECKSUM_OFFLOAD
+    if (NETIF_CHECKSUM_PARTIAL_ENABLED(netif, NETIF_CHECKSUM_GEN_UDP, NETIF_CHECKSUM_PARTIAL_UDP) &&
+        (IP_IS_V6(dst_ip) || (pcb->flags & UDP_FLAGS_NOCHKSUM) == 0)) {
+      /* leave the checksum to the netif driver (field at offset 6) */
+      ip_chksum_pseudo_offload(q, IP_PROTO_UDP, q->tot_len, 6, src_ip, dst_ip);
+    }
+#endif /* LWIP_CHECKSUM_OFFLOAD */
 #endif /* CHECKSUM_GEN_UDP */
     ip_proto = IP_PROTO_UDP;
   }
@@ -923,11 +1114,15 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
       if (pcb != ipcb) {
       /* By default, we don't allow to bind to a port that any other udp
          PCB is already bound to, unless *all* PCBs with that port have tha
-         REUSEADDR flag set. */
+         REUSEADDR flag set (or all have REUSEPORT set). */
 #if SO_REUSE
         if (!ip_get_option(pcb, SOF_REUSEADDR) ||
             !ip_get_option(ipcb, SOF_REUSEADDR))
 #endif /* SO_REUSE */
+#if LWIP_SO_REUSEPORT
+        if (!ip_get_option(pcb, SOF_REUSEPORT) ||
+            !ip_get_option(ipcb, SOF_REUSEPORT))
+#endif /* LWIP_SO_REUSEPORT */
         {
           /* port matches that of PCB in list and REUSEADDR not set -> reject */
           if ((ipcb->local_port == port) &&
@@ -945,6 +1140,9 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
 
   ip_addr_set_ipaddr(&pcb->local_ip, ipaddr);
 
+  if (rebind != 0) {
+    udp_hash_remove(pcb);
+  }
   pcb->local_port = port;
   mib2_udp_bind(pcb);
   /* pcb not active yet? */
@@ -952,7 +1150,9 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
     /* place the PCB on the active list if not already there */
     pcb->next = udp_pcbs;
     udp_pcbs = pcb;
+    udp_hash_stamp(pcb);
   }
+  udp_hash_add(pcb);
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("udp_bind: bound to "));
   ip_addr_debug_print(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, &pcb->local_ip);
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, (", port %"U16_F")\n", pcb->local_port));
@@ -993,6 +1193,7 @@ udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
     }
   }
 
+  udp_hash_remove(pcb);
   ip_addr_set_ipaddr(&pcb->remote_ip, ipaddr);
   pcb->remote_port = port;
   pcb->flags |= UDP_FLAGS_CONNECTED;
@@ -1005,13 +1206,17 @@ udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
   /* Insert UDP PCB into the list of active UDP PCBs. */
   for (ipcb = udp_pcbs; ipcb != NULL; ipcb = ipcb->next) {
     if (pcb == ipcb) {
-      /* already on the list, just return */
-      return ERR_OK;
+      /* already on the list */
+      break;
     }
   }
-  /* PCB not yet on the list, add PCB now */
-  pcb->next = udp_pcbs;
-  udp_pcbs = pcb;
+  if (ipcb == NULL) {
+    /* PCB not yet on the list, add PCB now */
+    pcb->next = udp_pcbs;
+    udp_pcbs = pcb;
+    udp_hash_stamp(pcb);
+  }
+  udp_hash_add(pcb);
   return ERR_OK;
 }
 
@@ -1024,6 +1229,10 @@ udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
 void
 udp_disconnect(struct udp_pcb *pcb)
 {
+#if UDP_PCB_HASH_SIZE
+  u8_t hashed = udp_hash_remove(pcb);
+#endif /* UDP_PCB_HASH_SIZE */
+
   /* reset remote address association */
 #if LWIP_IPV4 && LWIP_IPV6
   if (IP_IS_ANY_TYPE_VAL(pcb->local_ip)) {
@@ -1037,6 +1246,11 @@ udp_disconnect(struct udp_pcb *pcb)
   pcb->remote_port = 0;
   /* mark PCB as unconnected */
   pcb->flags &= ~UDP_FLAGS_CONNECTED;
+#if UDP_PCB_HASH_SIZE
+  if (hashed) {
+    udp_hash_add(pcb);
+  }
+#endif /* UDP_PCB_HASH_SIZE */
 }
 
 /**
@@ -1072,6 +1286,7 @@ udp_remove(struct udp_pcb *pcb)
   struct udp_pcb *pcb2;
 
   mib2_udp_unbind(pcb);
+  udp_hash_remove(pcb);
   /* pcb to be removed is first in list? */
   if (udp_pcbs == pcb) {
     /* make list start at 2nd pcb */
@@ -122,6 +122,7 @@ typedef uint16_t  u16_t;
 typedef int16_t   s16_t;
 typedef uint32_t  u32_t;
 typedef int32_t   s32_t;
+typedef uint64_t  u64_t;
 typedef uintptr_t mem_ptr_t;
 #endif
 
@@ -229,6 +230,44 @@ typedef uintptr_t mem_ptr_t;
 #define LWIP_MEM_ALIGN(addr) ((void *)(((mem_ptr_t)(addr) + MEM_ALIGNMENT - 1) & ~(mem_ptr_t)(MEM_ALIGNMENT-1)))
 #endif
 
+/** Storage class for variables that each thread has its own copy of
+ * (used by MEMP_MAGAZINE). Define this to e.g. _Thread_local or
+ * __declspec(thread) if your compiler does not support gcc's __thread.
+ */
+#ifndef LWIP_THREAD_LOCAL
+#define LWIP_THREAD_LOCAL __thread
+#endif
+
+/** Lock-free operations on plain integer variables (used by MEMP_MAGAZINE to
+ * keep MEMP_STATS without SYS_ARCH_PROTECT). LWIP_ATOMIC_ADD adds n to *ptr
+ * and returns the new value; LWIP_ATOMIC_CAS stores desired in *ptr if it
+ * equals *expected and returns nonzero, else it loads *ptr into *expected
+ * and returns 0. Define these in arch/cc.h if your compiler does not support
+ * gcc's __atomic builtins.
+ */
+#ifndef LWIP_ATOMIC_ADD
+#define LWIP_ATOMIC_ADD(ptr, n) __atomic_add_fetch((ptr), (n), __ATOMIC_RELAXED)
+#endif
+#ifndef LWIP_ATOMIC_CAS
+#define LWIP_ATOMIC_CAS(ptr, expected, desired) \
+  __atomic_compare_exchange_n((ptr), (expected), (desired), 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#endif
+
+/** Type of pbuf->ref with PBUF_ATOMIC_REF. lwIP itself is compiled as C11
+ * and changes ref with <stdatomic.h> operations on an _Atomic u16_t. Code
+ * including pbuf.h as C++ or pre-C11 C sees a plain u16_t of the same size
+ * (lock-free 16-bit atomics are required) and must only change ref through
+ * pbuf_ref() and pbuf_free(). Define this in arch/cc.h if your compilers
+ * need something else.
+ */
+#ifndef LWIP_PBUF_REF_T
+#if defined __cplusplus || !defined __STDC_VERSION__ || (__STDC_VERSION__ < 201112L) || defined __STDC_NO_ATOMICS__
+#define LWIP_PBUF_REF_T u16_t
+#else
+#define LWIP_PBUF_REF_T _Atomic u16_t
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -75,10 +75,13 @@ struct etharp_q_entry {
 
 #define etharp_init() /* Compatibility define, no init needed. */
 void etharp_tmr(void);
-s8_t etharp_find_addr(struct netif *netif, const ip4_addr_t *ipaddr,
+s16_t etharp_find_addr(struct netif *netif, const ip4_addr_t *ipaddr,
          struct eth_addr **eth_ret, const ip4_addr_t **ip_ret);
-u8_t etharp_get_entry(u8_t i, ip4_addr_t **ipaddr, struct netif **netif, struct eth_addr **eth_ret);
+u8_t etharp_get_entry(u16_t i, ip4_addr_t **ipaddr, struct netif **netif, struct eth_addr **eth_ret);
 err_t etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr);
+#if IP_FORWARD && IP_FORWARD_FLOW_CACHE_SIZE && LWIP_NETIF_HWADDRHINT
+err_t etharp_output_to_arp_index(struct netif *netif, struct pbuf *q, u16_t arp_idx);
+#endif /* IP_FORWARD && IP_FORWARD_FLOW_CACHE_SIZE && LWIP_NETIF_HWADDRHINT */
 err_t etharp_query(struct netif *netif, const ip4_addr_t *ipaddr, struct pbuf *q);
 err_t etharp_request(struct netif *netif, const ip4_addr_t *ipaddr);
 /** For Ethernet network interfaces, we might want to send "gratuitous ARP";
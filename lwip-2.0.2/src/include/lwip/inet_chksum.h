@@ -58,7 +58,11 @@
 # ifndef LWIP_CHKSUM_COPY
 #  define LWIP_CHKSUM_COPY(dst, src, len) lwip_chksum_copy(dst, src, len)
 #  ifndef LWIP_CHKSUM_COPY_ALGORITHM
-#   define LWIP_CHKSUM_COPY_ALGORITHM 1
+#   if defined LWIP_CHKSUM_ALGORITHM && (LWIP_CHKSUM_ALGORITHM == 4)
+#    define LWIP_CHKSUM_COPY_ALGORITHM 2
+#   else
+#    define LWIP_CHKSUM_COPY_ALGORITHM 1
+#   endif
 #  endif /* LWIP_CHKSUM_COPY_ALGORITHM */
 # else /* LWIP_CHKSUM_COPY */
 #  define LWIP_CHKSUM_COPY_ALGORITHM 0
@@ -73,6 +77,8 @@ extern "C" {
 
 u16_t inet_chksum(const void *dataptr, u16_t len);
 u16_t inet_chksum_pbuf(struct pbuf *p);
+u16_t inet_chksum_adjust(u16_t chksum, u16_t old_val, u16_t new_val);
+u16_t inet_chksum_adjust32(u16_t chksum, u32_t old_val, u32_t new_val);
 #if LWIP_CHKSUM_COPY_ALGORITHM
 u16_t lwip_chksum_copy(void *dst, const void *src, u16_t len);
 #endif /* LWIP_CHKSUM_COPY_ALGORITHM */
@@ -97,6 +103,12 @@ u16_t ip_chksum_pseudo(struct pbuf *p, u8_t proto, u16_t proto_len,
 u16_t ip_chksum_pseudo_partial(struct pbuf *p, u8_t proto, u16_t proto_len,
        u16_t chksum_len, const ip_addr_t *src, const ip_addr_t *dest);
 
+#if LWIP_CHECKSUM_OFFLOAD
+void ip_chksum_pseudo_offload(struct pbuf *p, u8_t proto, u16_t proto_len,
+       u16_t chksum_offset, const ip_addr_t *src, const ip_addr_t *dest);
+void inet_chksum_offload_finish(struct pbuf *p);
+#endif /* LWIP_CHECKSUM_OFFLOAD */
+
 #ifdef __cplusplus
 }
 #endif
@@ -64,7 +64,7 @@ extern "C" {
 #endif
 
 #if LWIP_NETIF_HWADDRHINT
-#define IP_PCB_ADDRHINT ;u8_t addr_hint
+#define IP_PCB_ADDRHINT ;u16_t addr_hint
 #else
 #define IP_PCB_ADDRHINT
 #endif /* LWIP_NETIF_HWADDRHINT */
@@ -97,9 +97,10 @@ struct ip_pcb {
 #define SOF_REUSEADDR     0x04U  /* allow local address reuse */
 #define SOF_KEEPALIVE     0x08U  /* keep connections alive */
 #define SOF_BROADCAST     0x20U  /* permit to send and to receive broadcast messages (see IP_SOF_BROADCAST option) */
+#define SOF_REUSEPORT     0x40U  /* share local address and port with a load-balanced group (see LWIP_SO_REUSEPORT) */
 
 /* These flags are inherited (e.g. from a listen-pcb to a connection-pcb): */
-#define SOF_INHERITED   (SOF_REUSEADDR|SOF_KEEPALIVE)
+#define SOF_INHERITED   (SOF_REUSEADDR|SOF_KEEPALIVE|SOF_REUSEPORT)
 
 /** Global variables of this module, kept in a struct for efficient access using base+index. */
 struct ip_globals
@@ -161,6 +162,10 @@ extern struct ip_globals ip_data;
 #define ip_current_header_proto() (ip_current_is_v6() ? \
                                    IP6H_NEXTH(ip6_current_header()) :\
                                    IPH_PROTO(ip4_current_header()))
+/** Get the TOS/traffic class byte (including the ECN bits) */
+#define ip_current_header_tos()   (ip_current_is_v6() ? \
+                                   IP6H_TC(ip6_current_header()) :\
+                                   IPH_TOS(ip4_current_header()))
 /** Get the transport layer header */
 #define ip_next_header_ptr()     ((const void*)((ip_current_is_v6() ? \
   (const u8_t*)ip6_current_header() : (const u8_t*)ip4_current_header())  + ip_current_header_tot_len()))
@@ -180,6 +185,8 @@ extern struct ip_globals ip_data;
 #define ip_current_is_v6()        0
 /** Get the transport layer protocol */
 #define ip_current_header_proto() IPH_PROTO(ip4_current_header())
+/** Get the TOS byte (including the ECN bits) */
+#define ip_current_header_tos()   IPH_TOS(ip4_current_header())
 /** Get the transport layer header */
 #define ip_next_header_ptr()     ((const void*)((const u8_t*)ip4_current_header() + ip_current_header_tot_len()))
 /** Source IP4 address of current_header */
@@ -197,6 +204,8 @@ extern struct ip_globals ip_data;
 #define ip_current_is_v6()        1
 /** Get the transport layer protocol */
 #define ip_current_header_proto() IP6H_NEXTH(ip6_current_header())
+/** Get the traffic class byte (including the ECN bits) */
+#define ip_current_header_tos()   IP6H_TC(ip6_current_header())
 /** Get the transport layer header */
 #define ip_next_header_ptr()     ((const void*)((const u8_t*)ip6_current_header()))
 /** Source IP6 address of current_header */
@@ -310,6 +319,10 @@ err_t ip_input(struct pbuf *p, struct netif *inp);
   (ipaddr) = ip_netif_get_local_ip(netif, dest); \
 }while(0)
 
+#if LWIP_SO_REUSEPORT
+u32_t ip_reuseport_weight(const void *pcb, const ip_addr_t *remote_ip, u16_t remote_port);
+#endif /* LWIP_SO_REUSEPORT */
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,89 @@
+/**
+ * @file
+ * IPv4 forwarding table (longest prefix match)
+ */
+
+/*
+ * Copyright (c) 2026 The lwIP contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_HDR_IP4_FIB_H
+#define LWIP_HDR_IP4_FIB_H
+
+#include "lwip/opt.h"
+
+#if LWIP_IPV4 && LWIP_IPV4_FIB /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/err.h"
+#include "lwip/netif.h"
+#include "lwip/ip4_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The node holds a route (branch nodes only have children) */
+#define IP4_FIB_FLAG_ROUTE      0x01U
+/** The route was derived from a netif address (not added by ip4_fib_add()) */
+#define IP4_FIB_FLAG_CONNECTED  0x02U
+
+/** A node of the forwarding table trie.
+ * This is exported because memp needs to know the size.
+ */
+struct ip4_fib_entry {
+  /** children for the bit following the prefix being 0 or 1 */
+  struct ip4_fib_entry *child[2];
+  /** network prefix in host byte order, bits after prefix_len are 0 */
+  u32_t prefix;
+  /** next-hop gateway, IP4_ADDR_ANY for on-link routes */
+  ip4_addr_t gw;
+  /** the netif to send on */
+  struct netif *netif;
+  u8_t prefix_len;
+  u8_t flags;
+};
+
+/** Incremented whenever a route, a netif address or netif state changes:
+ * compare against a saved copy to validate cached routing decisions. */
+extern u32_t ip4_fib_gen;
+#define ip4_fib_invalidate() (ip4_fib_gen++)
+
+err_t ip4_fib_add(const ip4_addr_t *prefix, u8_t prefix_len, const ip4_addr_t *gw, struct netif *netif);
+err_t ip4_fib_remove(const ip4_addr_t *prefix, u8_t prefix_len);
+struct ip4_fib_entry *ip4_fib_lookup(const ip4_addr_t *dest);
+const ip4_addr_t *ip4_fib_gateway(struct netif *netif, const ip4_addr_t *dest);
+void ip4_fib_netif_update(struct netif *netif);
+void ip4_fib_netif_remove(struct netif *netif);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_IPV4 && LWIP_IPV4_FIB */
+
+#endif /* LWIP_HDR_IP4_FIB_H */
@@ -65,6 +65,12 @@ struct ip_reassdata {
   u16_t datagram_len;
   u8_t flags;
   u8_t timer;
+#if IP_REASS_HASH_SIZE
+  /** fragment with the highest offset received so far */
+  struct pbuf *p_last;
+  /** number of payload bytes received so far */
+  u16_t recvd_len;
+#endif /* IP_REASS_HASH_SIZE */
 };
 
 void ip_reass_init(void);
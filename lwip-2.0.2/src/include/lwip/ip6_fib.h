@@ -0,0 +1,76 @@
+/**
+ * @file
+ * IPv6 static routes (longest prefix match)
+ */
+
+/*
+ * Copyright (c) 2026 The lwIP contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_HDR_IP6_FIB_H
+#define LWIP_HDR_IP6_FIB_H
+
+#include "lwip/opt.h"
+
+#if LWIP_IPV6 && LWIP_IPV6_FIB /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/err.h"
+#include "lwip/netif.h"
+#include "lwip/ip6_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A node of the IPv6 route trie.
+ * This is exported because memp needs to know the size.
+ */
+struct ip6_fib_entry {
+  /** children for the bit following the prefix being 0 or 1 */
+  struct ip6_fib_entry *child[2];
+  /** network prefix, bits after prefix_len are 0 */
+  ip6_addr_t prefix;
+  /** next-hop router, IP6_ADDR_ANY for on-link routes */
+  ip6_addr_t gw;
+  /** the netif to send on, NULL for branch nodes */
+  struct netif *netif;
+  u8_t prefix_len;
+};
+
+err_t ip6_fib_add(const ip6_addr_t *prefix, u8_t prefix_len, const ip6_addr_t *gw, struct netif *netif);
+err_t ip6_fib_remove(const ip6_addr_t *prefix, u8_t prefix_len);
+struct ip6_fib_entry *ip6_fib_lookup(const ip6_addr_t *dest);
+void ip6_fib_netif_remove(struct netif *netif);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_IPV6 && LWIP_IPV6_FIB */
+
+#endif /* LWIP_HDR_IP6_FIB_H */
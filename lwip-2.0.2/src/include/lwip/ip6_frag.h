@@ -85,6 +85,18 @@ struct ip6_reassdata {
   u16_t datagram_len;
   u8_t nexth;
   u8_t timer;
+#if IP_REASS_HASH_SIZE
+  /** fragment with the highest offset received so far */
+  struct pbuf *p_last;
+  /** number of payload bytes received so far */
+  u16_t recvd_len;
+  /** hash bucket of the datagram */
+  u16_t bucket;
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  /** quota bucket of the source */
+  u16_t src_bucket;
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
 };
 
 #define ip6_reass_init() /* Compatibility define */
@@ -60,7 +60,7 @@ typedef u16_t mem_size_t;
 /* MEM_SIZE would have to be aligned, but using 64000 here instead of
  * 65535 leaves some room for alignment...
  */
-#if MEM_SIZE > 64000L
+#if MEM_SIZE > 64000L || MEM_ARENA
 typedef u32_t mem_size_t;
 #define MEM_SIZE_F U32_F
 #else
@@ -69,12 +69,27 @@ typedef u16_t mem_size_t;
 #endif /* MEM_SIZE > 64000 */
 #endif
 
+#if MEM_USE_SLAB
+/** Block sizes of the MEM_USE_SLAB size classes, ascending. Only classes of up
+ * to half a page (MEM_SLAB_PAGE_SIZE) are used. */
+#define MEM_SLAB_CLASSES(X) X(16) X(24) X(32) X(48) X(64) X(96) X(128) X(192) \
+  X(256) X(384) X(512) X(768) X(1024) X(1536) X(2048) X(3072) X(4096)
+#define MEM_SLAB_CLASS_USED(size) + ((2 * (size)) <= MEM_SLAB_PAGE_SIZE)
+/** Number of size classes used with this MEM_SLAB_PAGE_SIZE */
+#define MEM_SLAB_NUM_CLASSES (0 MEM_SLAB_CLASSES(MEM_SLAB_CLASS_USED))
+#endif /* MEM_USE_SLAB */
+
 void  mem_init(void);
 void *mem_trim(void *mem, mem_size_t size);
 void *mem_malloc(mem_size_t size);
 void *mem_calloc(mem_size_t count, mem_size_t size);
 void  mem_free(void *mem);
 
+#if MEM_ARENA
+void *mem_arena_alloc(size_t size);
+void  mem_set_size(mem_size_t size);
+#endif /* MEM_ARENA */
+
 #ifdef __cplusplus
 }
 #endif
@@ -62,7 +62,13 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
  * @ingroup mempool
  * Declare prototype for private memory pool if it is used in multiple files
  */
+#if MEM_ARENA && !MEMP_MEM_MALLOC
+/* MEM_ARENA: the descriptor is writable so that memp_init_pool() can set the
+ * base address and memp_set_num() the number of elements */
+#define LWIP_MEMPOOL_PROTOTYPE(name) extern struct memp_desc memp_ ## name
+#else /* MEM_ARENA && !MEMP_MEM_MALLOC */
 #define LWIP_MEMPOOL_PROTOTYPE(name) extern const struct memp_desc memp_ ## name
+#endif /* MEM_ARENA && !MEMP_MEM_MALLOC */
 
 #if MEMP_MEM_MALLOC
 
@@ -74,6 +80,22 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
     LWIP_MEM_ALIGN_SIZE(size) \
   };
 
+#elif MEM_ARENA
+
+#define LWIP_MEMPOOL_DECLARE(name,num,size,desc) \
+  LWIP_MEMPOOL_DECLARE_STATS_INSTANCE(memp_stats_ ## name) \
+    \
+  static struct memp *memp_tab_ ## name; \
+    \
+  struct memp_desc memp_ ## name = { \
+    DECLARE_LWIP_MEMPOOL_DESC(desc) \
+    LWIP_MEMPOOL_DECLARE_STATS_REFERENCE(memp_stats_ ## name) \
+    LWIP_MEM_ALIGN_SIZE(size), \
+    (num), \
+    NULL, \
+    &memp_tab_ ## name \
+  };
+
 #else /* MEMP_MEM_MALLOC */
 
 /**
@@ -138,6 +160,10 @@ struct memp_malloc_helper
 
 void  memp_init(void);
 
+#if MEM_ARENA && !MEMP_MEM_MALLOC
+void  memp_set_num(memp_t type, u32_t num);
+#endif /* MEM_ARENA && !MEMP_MEM_MALLOC */
+
 #if MEMP_OVERFLOW_CHECK
 void *memp_malloc_fn(memp_t type, const char* file, const int line);
 #define memp_malloc(t) memp_malloc_fn((t), __FILE__, __LINE__)
@@ -145,6 +171,30 @@ void *memp_malloc_fn(memp_t type, const char* file, const int line);
 void *memp_malloc(memp_t type);
 #endif
 void  memp_free(memp_t type, void *mem);
+#if MEMP_MAGAZINE
+void  memp_magazine_flush(void);
+#endif /* MEMP_MAGAZINE */
+
+#if MEMP_PRESSURE
+/** Highest memory pressure level: a watched pool is at its high watermark */
+#define MEMP_PRESSURE_MAX 100
+
+/** Function prototype for the memory pressure callback: 'type' is the
+ * fullest watched pool, 'level' the new pressure level */
+typedef void (*memp_pressure_fn)(memp_t type, u8_t level);
+
+extern u8_t memp_pressure_level;
+extern u8_t memp_pressure_active;
+
+/** x reduced in proportion to the current pressure level */
+#define MEMP_PRESSURE_SCALE(x) ((x) - (x) / MEMP_PRESSURE_MAX * memp_pressure_level - \
+                                (x) % MEMP_PRESSURE_MAX * memp_pressure_level / MEMP_PRESSURE_MAX)
+
+void  memp_set_watermarks(memp_t type, mem_size_t low, mem_size_t high);
+void  memp_pressure_set_callback(memp_pressure_fn fn);
+void  memp_pressure_update(void);
+void  memp_pressure_tmr(void);
+#endif /* MEMP_PRESSURE */
 
 #ifdef __cplusplus
 }
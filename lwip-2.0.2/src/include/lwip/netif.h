@@ -127,6 +127,9 @@ enum lwip_internal_netif_client_data_index
 #define NETIF_CHECKSUM_GEN_TCP      0x0004
 #define NETIF_CHECKSUM_GEN_ICMP     0x0008
 #define NETIF_CHECKSUM_GEN_ICMP6    0x0010
+/* with LWIP_CHECKSUM_OFFLOAD: driver completes the checksum if GEN_x is cleared */
+#define NETIF_CHECKSUM_PARTIAL_UDP  0x0020
+#define NETIF_CHECKSUM_PARTIAL_TCP  0x0040
 #define NETIF_CHECKSUM_CHECK_IP     0x0100
 #define NETIF_CHECKSUM_CHECK_UDP    0x0200
 #define NETIF_CHECKSUM_CHECK_TCP    0x0400
@@ -328,7 +331,7 @@ struct netif {
   netif_mld_mac_filter_fn mld_mac_filter;
 #endif /* LWIP_IPV6 && LWIP_IPV6_MLD */
 #if LWIP_NETIF_HWADDRHINT
-  u8_t *addr_hint;
+  u16_t *addr_hint;
 #endif /* LWIP_NETIF_HWADDRHINT */
 #if ENABLE_LOOPBACK
   /* List of packets to be queued for ourselves. */
@@ -349,6 +352,14 @@ struct netif {
 #define IF__NETIF_CHECKSUM_ENABLED(netif, chksumflag)
 #endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
 
+#if LWIP_CHECKSUM_CTRL_PER_NETIF && LWIP_CHECKSUM_OFFLOAD
+/** The netif wants partial checksums: 'partialflag' set and 'genflag' cleared */
+#define NETIF_CHECKSUM_PARTIAL_ENABLED(netif, genflag, partialflag) (((netif) != NULL) && \
+  (((netif)->chksum_flags & ((genflag) | (partialflag))) == (partialflag)))
+#else /* LWIP_CHECKSUM_CTRL_PER_NETIF && LWIP_CHECKSUM_OFFLOAD */
+#define NETIF_CHECKSUM_PARTIAL_ENABLED(netif, genflag, partialflag) 0
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF && LWIP_CHECKSUM_OFFLOAD */
+
 /** The list of network interfaces. */
 extern struct netif *netif_list;
 /** The default network interface. */
@@ -295,6 +295,67 @@
 #define MEM_USE_POOLS_TRY_BIGGER_POOL   0
 #endif
 
+/**
+ * MEM_USE_SLAB==1: Use a segregated size-class (slab) allocator for
+ * mem_malloc() instead of the first-fit heap. The heap (MEM_SIZE) is split
+ * into pages of MEM_SLAB_PAGE_SIZE bytes. Requests of up to half a page are
+ * served from pages dedicated to one of the size classes listed in
+ * MEM_SLAB_CLASSES (mem.h), bigger requests get a run of whole pages.
+ * Allocating and freeing small blocks takes constant time and a page returns
+ * to the common pool as soon as its last block is freed. Free pages are kept
+ * in runs on lists by length and freed pages are merged with their free
+ * neighbours, so a run is found without scanning the heap. With MEM_STATS,
+ * lwip_stats.mem_slab[] counts the blocks of each size class.
+ * This needs no lwippools.h, but it uses more memory than the heap for the
+ * same load: MEM_SIZE may have to be increased.
+ */
+#if !defined MEM_USE_SLAB || defined __DOXYGEN__
+#define MEM_USE_SLAB                    0
+#endif
+
+/**
+ * MEM_SLAB_PAGE_SIZE: the size of the pages the heap is split into with
+ * MEM_USE_SLAB. The biggest size class is half a page. Bigger pages waste
+ * less on big allocations but need a bigger MEM_SIZE (each size class in use
+ * holds at least one page). Must be a multiple of MEM_ALIGNMENT.
+ */
+#if !defined MEM_SLAB_PAGE_SIZE || defined __DOXYGEN__
+#define MEM_SLAB_PAGE_SIZE              1024
+#endif
+
+/**
+ * MEM_ARENA==1: Allocate the memory of the pools and of the heap at runtime
+ * instead of using static arrays. The number of elements of each pool can be
+ * changed with memp_set_num() and the heap size with mem_set_size() before
+ * lwip_init(); the values from lwipopts.h are the defaults. The memory is
+ * taken from an arena that gets chunks of MEM_ARENA_CHUNK_SIZE bytes from
+ * MEM_ARENA_ALLOC(), so a port can back it with huge pages and place it on
+ * the NUMA node of its network interface. Arena memory is never freed.
+ * With MEM_ARENA, mem_size_t is 32 bits and pools can hold more than 65535
+ * elements.
+ */
+#if !defined MEM_ARENA || defined __DOXYGEN__
+#define MEM_ARENA                       0
+#endif
+
+/**
+ * MEM_ARENA_CHUNK_SIZE: the arena gets memory from the port in multiples of
+ * this size. Use the huge page size of the system (e.g. 2 MB) when the port
+ * backs the arena with huge pages.
+ */
+#if !defined MEM_ARENA_CHUNK_SIZE || defined __DOXYGEN__
+#define MEM_ARENA_CHUNK_SIZE            (2 * 1024 * 1024)
+#endif
+
+/**
+ * MEM_ARENA_ALLOC(size): get 'size' bytes (a multiple of MEM_ARENA_CHUNK_SIZE)
+ * for the arena from the system. Return NULL if there is no memory.
+ * The default uses the C library.
+ */
+#if !defined MEM_ARENA_ALLOC || defined __DOXYGEN__
+#define MEM_ARENA_ALLOC(size)           malloc(size)
+#endif
+
 /**
  * MEMP_USE_CUSTOM_POOLS==1: whether to include a user file lwippools.h
  * that defines additional pools beyond the "standard" ones required
@@ -305,6 +366,81 @@
 #define MEMP_USE_CUSTOM_POOLS           0
 #endif
 
+/**
+ * MEMP_MAGAZINE==1: Put per-thread caches ("magazines") of free elements in
+ * front of the pools used by memp_malloc()/memp_free(). Most calls then work
+ * on the calling thread's cache; only refilling an empty or returning a full
+ * magazine (up to MEMP_MAGAZINE_SIZE elements at once) walks the pool's
+ * free list. A magazine holds at most an eighth of its pool, so a thread
+ * caches at most a quarter of each pool; pools of fewer than 8 elements are
+ * not cached. When a thread finds a pool empty, the other threads give
+ * their cached elements of that pool back at their next memp_malloc() or
+ * memp_free().
+ * ATTENTION:
+ * - memp_malloc()/memp_free() must not be called from interrupt context
+ *   (e.g. no PBUF_POOL allocation in a netif driver's RX interrupt).
+ * - threads must call memp_magazine_flush() before they exit.
+ * - with MEMP_STATS, 'used' only counts elements handed out (not the ones
+ *   cached in magazines). It is kept exact with LWIP_ATOMIC_ADD and
+ *   LWIP_ATOMIC_CAS instead of SYS_ARCH_PROTECT.
+ * Variables are made thread-local with LWIP_THREAD_LOCAL (see arch.h).
+ * Private pools (LWIP_MEMPOOL_ALLOC) are not cached.
+ */
+#if !defined MEMP_MAGAZINE || defined __DOXYGEN__
+#define MEMP_MAGAZINE                   0
+#endif
+
+/**
+ * MEMP_MAGAZINE_SIZE: maximum number of elements in one magazine (MEMP_MAGAZINE).
+ */
+#if !defined MEMP_MAGAZINE_SIZE || defined __DOXYGEN__
+#define MEMP_MAGAZINE_SIZE              8
+#endif
+
+/**
+ * MEMP_PRESSURE==1: Watch the fill level of the pools between a low and a
+ * high watermark and degrade gracefully instead of dropping everything when
+ * a pool runs dry. The pressure level rises from 0 at the low watermark to
+ * 100 at the high watermark of the fullest watched pool. Under pressure:
+ * - TCP opens receive windows only in proportion to the free pressure range
+ * - whenever the level rises, queued out-of-sequence TCP segments are freed
+ *   from the tail of every queue, in proportion to the level (this replaces
+ *   pbuf_free_ooseq() freeing one whole queue when PBUF_POOL is empty)
+ * - between crossing a high watermark and all pools falling back below
+ *   their low watermark, tcp_write() refuses data on connections with a
+ *   priority below TCP_PRIO_NORMAL
+ * - a callback set with memp_pressure_set_callback() is called whenever the
+ *   level changes.
+ * Requires MEMP_STATS (the 'used' counters are the fill level).
+ */
+#if !defined MEMP_PRESSURE || defined __DOXYGEN__
+#define MEMP_PRESSURE                   0
+#endif
+
+/**
+ * MEMP_PRESSURE_LOWAT: default low watermark in percent of a pool (MEMP_PRESSURE).
+ * Only pools holding packet data (PBUF_POOL, PBUF, TCP_SEG) are watched by
+ * default; use memp_set_watermarks() to change that.
+ */
+#if !defined MEMP_PRESSURE_LOWAT || defined __DOXYGEN__
+#define MEMP_PRESSURE_LOWAT             70
+#endif
+
+/**
+ * MEMP_PRESSURE_HIWAT: default high watermark in percent of a pool (MEMP_PRESSURE).
+ */
+#if !defined MEMP_PRESSURE_HIWAT || defined __DOXYGEN__
+#define MEMP_PRESSURE_HIWAT             90
+#endif
+
+/**
+ * MEMP_PRESSURE_INTERVAL: interval in milliseconds at which the pressure
+ * level is updated (MEMP_PRESSURE).
+ */
+#if !defined MEMP_PRESSURE_INTERVAL || defined __DOXYGEN__
+#define MEMP_PRESSURE_INTERVAL          100
+#endif
+
 /**
  * Set this to 1 if you want to free PBUF_RAM pbufs (or call mem_free()) from
  * interrupt context (or another context that doesn't allow waiting for a
@@ -398,6 +534,15 @@
 #define MEMP_NUM_REASSDATA              5
 #endif
 
+/**
+ * MEMP_NUM_IP4_FIB_NODE: the number of nodes in the IPv4 forwarding table
+ * (requires LWIP_IPV4_FIB). Every route (including the connected route of
+ * each netif) takes one node and may need one additional branch node.
+ */
+#if !defined MEMP_NUM_IP4_FIB_NODE || defined __DOXYGEN__
+#define MEMP_NUM_IP4_FIB_NODE           16
+#endif
+
 /**
  * MEMP_NUM_FRAG_PBUF: the number of IP fragments simultaneously sent
  * (fragments, not whole packets!).
@@ -435,7 +580,7 @@
  * The formula expects settings to be either '0' or '1'.
  */
 #if !defined MEMP_NUM_SYS_TIMEOUT || defined __DOXYGEN__
-#define MEMP_NUM_SYS_TIMEOUT            (LWIP_TCP + IP_REASSEMBLY + LWIP_ARP + (2*LWIP_DHCP) + LWIP_AUTOIP + LWIP_IGMP + LWIP_DNS + (PPP_SUPPORT*6*MEMP_NUM_PPP_PCB) + (LWIP_IPV6 ? (1 + LWIP_IPV6_REASS + LWIP_IPV6_MLD) : 0))
+#define MEMP_NUM_SYS_TIMEOUT            (LWIP_TCP * (1 + LWIP_TCP_ACK_POLICY) + IP_REASSEMBLY + LWIP_ARP + (2*LWIP_DHCP) + LWIP_AUTOIP + LWIP_IGMP + LWIP_DNS + (PPP_SUPPORT*6*MEMP_NUM_PPP_PCB) + (LWIP_IPV6 ? (1 + LWIP_IPV6_REASS + LWIP_IPV6_MLD) : 0) + MEMP_PRESSURE)
 #endif
 
 /**
@@ -543,12 +688,24 @@
 #endif
 
 /**
- * ARP_TABLE_SIZE: Number of active MAC-IP address pairs cached.
+ * ARP_TABLE_SIZE: Number of active MAC-IP address pairs cached
+ * (up to 127, or up to 32767 with ETHARP_TABLE_HASH_SIZE).
  */
 #if !defined ARP_TABLE_SIZE || defined __DOXYGEN__
 #define ARP_TABLE_SIZE                  10
 #endif
 
+/**
+ * ETHARP_TABLE_HASH_SIZE: number of hash buckets (a power of two) for the ARP
+ * table. Entries are then found by hashing the IP address, dynamic entries
+ * are recycled in least-recently-used order and etharp_tmr() only visits the
+ * entries in use, so tables with thousands of entries stay cheap.
+ * 0 searches the table linearly, which is fine for small tables.
+ */
+#if !defined ETHARP_TABLE_HASH_SIZE || defined __DOXYGEN__
+#define ETHARP_TABLE_HASH_SIZE          0
+#endif
+
 /** the time an ARP entry stays valid after its last update,
  *  for ARP_TMR_INTERVAL = 1000, this is
  *  (60 * 5) seconds = 5 minutes.
@@ -675,6 +832,8 @@
 #define IP_REASSEMBLY                   0
 #undef IP_FRAG
 #define IP_FRAG                         0
+#undef LWIP_IPV4_FIB
+#define LWIP_IPV4_FIB                   0
 #endif /* !LWIP_IPV4 */
 
 /**
@@ -705,6 +864,30 @@
 #define IP_REASS_MAX_PBUFS              10
 #endif
 
+/**
+ * IP_REASS_HASH_SIZE: Number of hash buckets (a power of two) the IPv4 and
+ * IPv6 datagrams being reassembled are spread over, keyed on source,
+ * destination, ID (and protocol for IPv4). Completion is tracked by counting
+ * the received bytes instead of walking all fragments, and in-order fragments
+ * are appended in constant time. 0 keeps the single list, which is fine for
+ * a few datagrams.
+ */
+#if !defined IP_REASS_HASH_SIZE || defined __DOXYGEN__
+#define IP_REASS_HASH_SIZE              0
+#endif
+
+/**
+ * IP_REASS_MAX_PBUFS_PER_SRC: Maximum amount of pbufs waiting to be
+ * reassembled per source address and IP version (requires IP_REASS_HASH_SIZE).
+ * Sources hashing into the same bucket share their quota. Fragments exceeding
+ * the quota are dropped, so one peer cannot use up IP_REASS_MAX_PBUFS, which
+ * can then be raised to allow many concurrent large datagrams. 0 means no
+ * quota.
+ */
+#if !defined IP_REASS_MAX_PBUFS_PER_SRC || defined __DOXYGEN__
+#define IP_REASS_MAX_PBUFS_PER_SRC      0
+#endif
+
 /**
  * IP_DEFAULT_TTL: Default value for Time-To-Live used by transport layers.
  */
@@ -740,6 +923,31 @@
 #define IP_FORWARD_ALLOW_TX_ON_RX_NETIF 0
 #endif
 
+/**
+ * LWIP_IPV4_FIB==1: route IPv4 packets through a longest-prefix-match
+ * forwarding table (a path-compressed binary trie) instead of scanning
+ * netif_list. The subnets of all netifs are entered as connected routes
+ * automatically; static routes with a next-hop gateway can be added via
+ * ip4_fib_add(). TCP connections cache their route until the table or a
+ * netif changes.
+ */
+#if !defined LWIP_IPV4_FIB || defined __DOXYGEN__
+#define LWIP_IPV4_FIB                   0
+#endif
+
+/**
+ * IP_FORWARD_FLOW_CACHE_SIZE: Number of entries (a power of two) of the
+ * direct-mapped cache of forwarding decisions keyed on source and destination
+ * address (requires IP_FORWARD and LWIP_IPV4_FIB). A hit skips the route
+ * lookup; with LWIP_NETIF_HWADDRHINT, Ethernet netifs also skip the next-hop
+ * and ARP lookup and send straight to the cached ARP entry. Entries are
+ * revalidated against ip4_fib_gen and the ARP table on every use.
+ * 0 disables the cache.
+ */
+#if !defined IP_FORWARD_FLOW_CACHE_SIZE || defined __DOXYGEN__
+#define IP_FORWARD_FLOW_CACHE_SIZE      0
+#endif
+
 /**
  * LWIP_RANDOMIZE_INITIAL_LOCAL_PORTS==1: randomize the local port for the first
  * local TCP/UDP pcb (default==0). This can prevent creating predictable port
@@ -1105,6 +1313,17 @@
 #define UDP_TTL                         (IP_DEFAULT_TTL)
 #endif
 
+/**
+ * UDP_PCB_HASH_SIZE: Number of hash buckets (a power of two) udp_input()
+ * looks up pcbs in, instead of walking all of udp_pcbs. Unconnected pcbs are
+ * hashed on their local port, connected pcbs on their local and remote port,
+ * and connected pcbs take precedence as before. 0 keeps the list walk, which
+ * is fine for a few pcbs.
+ */
+#if !defined UDP_PCB_HASH_SIZE || defined __DOXYGEN__
+#define UDP_PCB_HASH_SIZE               0
+#endif
+
 /**
  * LWIP_NETBUF_RECVINFO==1: append destination addr and port to every netbuf.
  */
@@ -1329,6 +1548,117 @@
 #define LWIP_WND_SCALE                  0
 #define TCP_RCV_SCALE                   0
 #endif
+
+/**
+ * LWIP_TCP_ECN==1: support Explicit Congestion Notification (RFC 3168).
+ * ECN is requested on active opens and accepted on passive opens when the
+ * peer asks for it. New data is sent ECT(0), CE marks are echoed back via
+ * ECE and the sender reacts to ECE with one window reduction per RTT.
+ */
+#if !defined LWIP_TCP_ECN || defined __DOXYGEN__
+#define LWIP_TCP_ECN                    0
+#endif
+
+/**
+ * LWIP_TCP_DCTCP==1: use the DCTCP congestion controller (RFC 8257) on
+ * ECN-capable connections instead of classic ECN halving. The receiver
+ * echoes the exact CE state and the sender reduces cwnd in proportion to
+ * the fraction of marked bytes. Only useful inside a data center where all
+ * switches do ECN marking with a shallow threshold. Requires LWIP_TCP_ECN.
+ */
+#if !defined LWIP_TCP_DCTCP || defined __DOXYGEN__
+#define LWIP_TCP_DCTCP                  0
+#endif
+
+/**
+ * TCP_DCTCP_SHIFT_G: DCTCP estimation gain g as a shift count (g = 1/2^n).
+ */
+#if !defined TCP_DCTCP_SHIFT_G || defined __DOXYGEN__
+#define TCP_DCTCP_SHIFT_G               4
+#endif
+
+/**
+ * LWIP_TCP_TFO==1: support TCP Fast Open (RFC 7413).
+ * Clients enable it per pcb with tcp_fastopen_enable() before tcp_connect():
+ * the first connect to a server requests a cookie, later connects send the
+ * SYN together with the first segment written by the application.
+ * Listeners hand out cookies and accept data in SYNs carrying a valid cookie,
+ * calling the accept and recv callbacks before the handshake completes. Note
+ * that data in a SYN may be duplicated by the network: only use this for
+ * idempotent requests.
+ */
+#if !defined LWIP_TCP_TFO || defined __DOXYGEN__
+#define LWIP_TCP_TFO                    0
+#endif
+
+/**
+ * TCP_TFO_COOKIE_CACHE_SIZE: number of server cookies remembered by clients.
+ * The least recently used entry is replaced when the cache is full.
+ */
+#if !defined TCP_TFO_COOKIE_CACHE_SIZE || defined __DOXYGEN__
+#define TCP_TFO_COOKIE_CACHE_SIZE       8
+#endif
+
+/**
+ * LWIP_TCP_RACK==1: time-based loss detection (RACK) and Tail Loss Probes
+ * (RFC 8985). Every segment remembers when it was last sent: a segment is
+ * deemed lost once a segment sent after it was delivered and more than an
+ * RTT plus a reordering window has passed, and a probe is sent after about
+ * two RTTs without ACKs so that a lost tail does not have to wait for the
+ * RTO. lwIP has no SACK, so each duplicate ACK is taken to report delivery
+ * of the next segment after the first unacked one, and a loss still needs
+ * 3 duplicate ACKs unless fewer segments are in flight (RFC 5827). The
+ * timers are driven by tcp_fasttmr() and hence have TCP_TMR_INTERVAL
+ * resolution.
+ */
+#if !defined LWIP_TCP_RACK || defined __DOXYGEN__
+#define LWIP_TCP_RACK                   0
+#endif
+
+/**
+ * LWIP_TCP_INFO==1: keep per-connection statistics (bytes sent, acked and
+ * received, retransmissions, time spent limited by the receive window, the
+ * congestion window or the application, delivery rate) and export them with
+ * tcp_get_info() and tcp_info_foreach().
+ */
+#if !defined LWIP_TCP_INFO || defined __DOXYGEN__
+#define LWIP_TCP_INFO                   0
+#endif
+
+/**
+ * LWIP_TCP_ACK_POLICY==1: replace the "every second segment or next
+ * tcp_fasttmr()" delayed ACK with a configurable policy: ACK at least every
+ * TCP_ACK_EVERY_SEGS segments, send a delayed ACK TCP_DELACK_TIMEOUT ms after
+ * the first unacknowledged segment (using a sys_timeout() when LWIP_TIMERS is
+ * enabled, tcp_fasttmr() otherwise), and ACK the first TCP_QUICKACK_SEGS
+ * segments of a connection and of the data following out-of-order segments
+ * immediately.
+ */
+#if !defined LWIP_TCP_ACK_POLICY || defined __DOXYGEN__
+#define LWIP_TCP_ACK_POLICY             0
+#endif
+
+/**
+ * TCP_ACK_EVERY_SEGS: send an ACK at least every this many received segments.
+ */
+#if !defined TCP_ACK_EVERY_SEGS || defined __DOXYGEN__
+#define TCP_ACK_EVERY_SEGS              2
+#endif
+
+/**
+ * TCP_DELACK_TIMEOUT: maximum time in milliseconds an ACK is delayed.
+ */
+#if !defined TCP_DELACK_TIMEOUT || defined __DOXYGEN__
+#define TCP_DELACK_TIMEOUT              40
+#endif
+
+/**
+ * TCP_QUICKACK_SEGS: number of segments acknowledged immediately at the start
+ * of a connection and after out-of-order data was received.
+ */
+#if !defined TCP_QUICKACK_SEGS || defined __DOXYGEN__
+#define TCP_QUICKACK_SEGS               8
+#endif
 /**
  * @}
  */
@@ -1372,6 +1702,84 @@
 #if !defined PBUF_POOL_BUFSIZE || defined __DOXYGEN__
 #define PBUF_POOL_BUFSIZE               LWIP_MEM_ALIGN_SIZE(TCP_MSS+40+PBUF_LINK_ENCAPSULATION_HLEN+PBUF_LINK_HLEN)
 #endif
+
+/**
+ * PBUF_POOL_CLASSES==1: Back PBUF_POOL pbufs with several pools of different
+ * buffer sizes. Next to the PBUF_POOL pool (PBUF_POOL_SIZE buffers of
+ * PBUF_POOL_BUFSIZE bytes), there are a small, a jumbo and a huge pool, each
+ * of which is left out if its number of buffers is 0.
+ * pbuf_alloc(PBUF_POOL) takes each buffer of a chain from the smallest pool
+ * that holds the remaining length and still has a free buffer, and uses the
+ * biggest pool that has one if none is big enough. Big frames then need
+ * shorter chains. As callers may fill a PBUF_POOL pbuf up to
+ * PBUF_POOL_BUFSIZE, only pbuf_alloc_bestfit() uses the small pool, so
+ * small frames (e.g. ACKs) don't occupy a full size buffer.
+ */
+#if !defined PBUF_POOL_CLASSES || defined __DOXYGEN__
+#define PBUF_POOL_CLASSES               0
+#endif
+
+/**
+ * PBUF_POOL_SMALL_SIZE: the number of buffers in the small pbuf pool
+ * (PBUF_POOL_CLASSES only, used by pbuf_alloc_bestfit()).
+ */
+#if !defined PBUF_POOL_SMALL_SIZE || defined __DOXYGEN__
+#define PBUF_POOL_SMALL_SIZE            0
+#endif
+
+/**
+ * PBUF_POOL_SMALL_BUFSIZE: the size of each pbuf in the small pbuf pool. It
+ * must be bigger than the space reserved for protocol headers.
+ */
+#if !defined PBUF_POOL_SMALL_BUFSIZE || defined __DOXYGEN__
+#define PBUF_POOL_SMALL_BUFSIZE         256
+#endif
+
+/**
+ * PBUF_POOL_JUMBO_SIZE: the number of buffers in the jumbo pbuf pool
+ * (PBUF_POOL_CLASSES only).
+ */
+#if !defined PBUF_POOL_JUMBO_SIZE || defined __DOXYGEN__
+#define PBUF_POOL_JUMBO_SIZE            0
+#endif
+
+/**
+ * PBUF_POOL_JUMBO_BUFSIZE: the size of each pbuf in the jumbo pbuf pool. The
+ * default holds a 9000 byte jumbo frame including the link header.
+ */
+#if !defined PBUF_POOL_JUMBO_BUFSIZE || defined __DOXYGEN__
+#define PBUF_POOL_JUMBO_BUFSIZE         LWIP_MEM_ALIGN_SIZE(9000+PBUF_LINK_ENCAPSULATION_HLEN+PBUF_LINK_HLEN)
+#endif
+
+/**
+ * PBUF_POOL_HUGE_SIZE: the number of buffers in the huge pbuf pool
+ * (PBUF_POOL_CLASSES only), e.g. for frames aggregated by the driver.
+ */
+#if !defined PBUF_POOL_HUGE_SIZE || defined __DOXYGEN__
+#define PBUF_POOL_HUGE_SIZE             0
+#endif
+
+/**
+ * PBUF_POOL_HUGE_BUFSIZE: the size of each pbuf in the huge pbuf pool. The
+ * pbuf and its buffer must fit into a 16-bit pool element size.
+ */
+#if !defined PBUF_POOL_HUGE_BUFSIZE || defined __DOXYGEN__
+#define PBUF_POOL_HUGE_BUFSIZE          64000
+#endif
+
+/**
+ * PBUF_ATOMIC_REF==1: Change the pbuf reference count with lock-free C11
+ * atomics instead of SYS_ARCH_PROTECT, so pbufs can be referenced and freed
+ * from application threads without taking the stack lock. While the caller
+ * holds the only reference, no atomic read-modify-write is needed.
+ * Requires a C11 compiler providing <stdatomic.h> for lwIP itself; other
+ * code (e.g. C++) may include pbuf.h, see LWIP_PBUF_REF_T in arch.h.
+ * Freeing the last reference returns the pbuf to its pool, which still
+ * needs SYS_ARCH_PROTECT (or MEMP_MAGAZINE) when done from another thread.
+ */
+#if !defined PBUF_ATOMIC_REF || defined __DOXYGEN__
+#define PBUF_ATOMIC_REF                 0
+#endif
 /**
  * @}
  */
@@ -1847,6 +2255,17 @@
 #define SO_REUSE_RXTOALL                0
 #endif
 
+/**
+ * LWIP_SO_REUSEPORT==1: Enable SO_REUSEPORT option. UDP pcbs and TCP
+ * listeners that all set it may bind to the same local address and port,
+ * forming a group that shares the incoming traffic: every remote address
+ * and port is mapped to one member by rendezvous hashing, so it keeps going
+ * to the same member, and members joining or leaving only move their share.
+ */
+#if !defined LWIP_SO_REUSEPORT || defined __DOXYGEN__
+#define LWIP_SO_REUSEPORT               0
+#endif
+
 /**
  * LWIP_FIONREAD_LINUXMODE==0 (default): ioctl/FIONREAD returns the amount of
  * pending data in the network buffer. This is the way windows does it. It's
@@ -2132,6 +2551,23 @@
 #if !defined LWIP_CHECKSUM_ON_COPY || defined __DOXYGEN__
 #define LWIP_CHECKSUM_ON_COPY           0
 #endif
+
+/**
+ * LWIP_CHECKSUM_OFFLOAD==1: Per-pbuf checksum offload state.
+ * - RX: a netif driver that verified the IPv4 header and TCP/UDP checksum of a
+ *   received packet (not a fragment) sets PBUF_FLAG_CHKSUM_VERIFIED before
+ *   passing it to netif->input(). ip4_input, udp_input and tcp_input then
+ *   skip their software checks.
+ * - TX: if LWIP_CHECKSUM_CTRL_PER_NETIF is enabled too, a netif with
+ *   NETIF_CHECKSUM_PARTIAL_UDP/TCP set and NETIF_CHECKSUM_GEN_UDP/TCP cleared
+ *   gets UDP and TCP data packets with only the pseudo header sum in the
+ *   checksum field and PBUF_FLAG_CHKSUM_PARTIAL set. The driver (or hardware)
+ *   must store the checksum of the data from p->csum_start to the end at
+ *   p->csum_start + p->csum_offset (see inet_chksum_offload_finish()).
+ */
+#if !defined LWIP_CHECKSUM_OFFLOAD || defined __DOXYGEN__
+#define LWIP_CHECKSUM_OFFLOAD           0
+#endif
 /**
  * @}
  */
@@ -2167,6 +2603,25 @@
 #define LWIP_IPV6_FORWARD               0
 #endif
 
+/**
+ * LWIP_IPV6_FIB==1: support static IPv6 routes (optionally via a next-hop
+ * router), kept in a longest-prefix-match trie and added via ip6_fib_add().
+ * Routes more specific than /64 take precedence over on-link subnets, less
+ * specific ones over routers learned from router advertisements.
+ */
+#if !defined LWIP_IPV6_FIB || defined __DOXYGEN__
+#define LWIP_IPV6_FIB                   0
+#endif
+
+/**
+ * MEMP_NUM_IP6_FIB_NODE: the number of nodes in the IPv6 route trie
+ * (requires LWIP_IPV6_FIB). Every route takes one node and may need one
+ * additional branch node.
+ */
+#if !defined MEMP_NUM_IP6_FIB_NODE || defined __DOXYGEN__
+#define MEMP_NUM_IP6_FIB_NODE           8
+#endif
+
 /**
  * LWIP_IPV6_FRAG==1: Fragment outgoing IPv6 packets that are too big.
  */
@@ -2283,20 +2738,54 @@
 #define MEMP_NUM_ND6_QUEUE              20
 #endif
 
+/**
+ * LWIP_ND6_QUEUE_LEN: The maximum number of packets which may be queued for
+ * each unresolved neighbor (requires LWIP_ND6_QUEUEING). Old packets are
+ * dropped, new packets are queued. 0 means only MEMP_NUM_ND6_QUEUE limits
+ * the queues.
+ */
+#if !defined LWIP_ND6_QUEUE_LEN || defined __DOXYGEN__
+#define LWIP_ND6_QUEUE_LEN              0
+#endif
+
 /**
  * LWIP_ND6_NUM_NEIGHBORS: Number of entries in IPv6 neighbor cache
+ * (up to 127, or up to 32767 with LWIP_ND6_NEIGHBOR_HASH_SIZE)
  */
 #if !defined LWIP_ND6_NUM_NEIGHBORS || defined __DOXYGEN__
 #define LWIP_ND6_NUM_NEIGHBORS          10
 #endif
 
+/**
+ * LWIP_ND6_NEIGHBOR_HASH_SIZE: number of hash buckets (a power of two) for
+ * the IPv6 neighbor cache. Entries are then found by hashing the address,
+ * recycled in least-recently-used order, and nd6_tmr() only visits the
+ * entries whose state timer expires (using a timer wheel) instead of the
+ * whole cache. 0 searches and sweeps the cache linearly.
+ */
+#if !defined LWIP_ND6_NEIGHBOR_HASH_SIZE || defined __DOXYGEN__
+#define LWIP_ND6_NEIGHBOR_HASH_SIZE     0
+#endif
+
 /**
  * LWIP_ND6_NUM_DESTINATIONS: number of entries in IPv6 destination cache
+ * (up to 127, or up to 32767 with LWIP_ND6_DESTINATION_HASH_SIZE)
  */
 #if !defined LWIP_ND6_NUM_DESTINATIONS || defined __DOXYGEN__
 #define LWIP_ND6_NUM_DESTINATIONS       10
 #endif
 
+/**
+ * LWIP_ND6_DESTINATION_HASH_SIZE: number of hash buckets (a power of two) for
+ * the IPv6 destination cache. Entries are then found by hashing the
+ * destination address and recycled in least-recently-used order, so lookups
+ * stay constant time for caches with thousands of destinations.
+ * 0 searches the cache linearly, which is fine for small caches.
+ */
+#if !defined LWIP_ND6_DESTINATION_HASH_SIZE || defined __DOXYGEN__
+#define LWIP_ND6_DESTINATION_HASH_SIZE  0
+#endif
+
 /**
  * LWIP_ND6_NUM_PREFIXES: number of entries in IPv6 on-link prefixes cache
  */
@@ -2445,6 +2934,20 @@
 #define LWIP_HOOK_TCP_ISN(local_ip, local_port, remote_ip, remote_port)
 #endif
 
+/**
+ * LWIP_HOOK_TCP_TFO_COOKIE:
+ * Hook for generation of TCP Fast Open cookies on listeners (@ref LWIP_TCP_TFO).
+ * The default generator is a keyed hash that is cheap but not a cryptographic
+ * MAC; RFC 7413 recommends AES-128 keyed with a periodically changed secret.\n
+ * Signature: void my_hook_tcp_tfo_cookie(const ip_addr_t* remote_ip, u8_t* cookie);
+ * Arguments:
+ * - remote_ip: pointer to the client IP address
+ * - cookie: buffer of 8 bytes to fill with the cookie for that client
+ */
+#ifdef __DOXYGEN__
+#define LWIP_HOOK_TCP_TFO_COOKIE(remote_ip, cookie)
+#endif
+
 /**
  * LWIP_HOOK_IP4_INPUT(pbuf, input_netif):
  * - called from ip_input() (IPv4)
@@ -137,6 +137,18 @@ typedef enum {
 #define PBUF_FLAG_LLMCAST   0x10U
 /** indicates this pbuf includes a TCP FIN flag */
 #define PBUF_FLAG_TCP_FIN   0x20U
+/** indicates the netif driver has verified the checksums of this packet
+    (LWIP_CHECKSUM_OFFLOAD) */
+#define PBUF_FLAG_CHKSUM_VERIFIED 0x40U
+/** indicates the transport checksum of this packet is left to the netif
+    driver, see csum_start/csum_offset (LWIP_CHECKSUM_OFFLOAD) */
+#define PBUF_FLAG_CHKSUM_PARTIAL  0x80U
+
+#if LWIP_CHECKSUM_OFFLOAD
+#define PBUF_CHKSUM_VERIFIED(p) (((p)->flags & PBUF_FLAG_CHKSUM_VERIFIED) != 0)
+#else /* LWIP_CHECKSUM_OFFLOAD */
+#define PBUF_CHKSUM_VERIFIED(p) 0
+#endif /* LWIP_CHECKSUM_OFFLOAD */
 
 /** Main packet buffer struct */
 struct pbuf {
@@ -169,7 +181,24 @@ struct pbuf {
    * that refer to this pbuf. This can be pointers from an application,
    * the stack itself, or pbuf->next pointers from a chain.
    */
+#if PBUF_ATOMIC_REF
+  LWIP_PBUF_REF_T ref;
+#else /* PBUF_ATOMIC_REF */
   u16_t ref;
+#endif /* PBUF_ATOMIC_REF */
+
+#if PBUF_POOL_CLASSES
+  /** for PBUF_POOL: memp_t of the pool this pbuf was taken from */
+  u8_t pool;
+#endif /* PBUF_POOL_CLASSES */
+
+#if LWIP_CHECKSUM_OFFLOAD
+  /** for PBUF_FLAG_CHKSUM_PARTIAL: offset from payload where checksumming
+   * starts (kept up to date by pbuf_header) */
+  u16_t csum_start;
+  /** for PBUF_FLAG_CHKSUM_PARTIAL: offset of the checksum field from csum_start */
+  u16_t csum_offset;
+#endif /* LWIP_CHECKSUM_OFFLOAD */
 };
 
 
@@ -221,6 +250,9 @@ void pbuf_free_ooseq(void);
 #define pbuf_init()
 
 struct pbuf *pbuf_alloc(pbuf_layer l, u16_t length, pbuf_type type);
+#if PBUF_POOL_CLASSES
+struct pbuf *pbuf_alloc_bestfit(pbuf_layer l, u16_t length);
+#endif /* PBUF_POOL_CLASSES */
 #if LWIP_SUPPORT_CUSTOM_PBUF
 struct pbuf *pbuf_alloced_custom(pbuf_layer l, u16_t length, pbuf_type type,
                                  struct pbuf_custom *p, void *payload_mem,
@@ -244,6 +276,8 @@ struct pbuf *pbuf_coalesce(struct pbuf *p, pbuf_layer layer);
 #if LWIP_CHECKSUM_ON_COPY
 err_t pbuf_fill_chksum(struct pbuf *p, u16_t start_offset, const void *dataptr,
                        u16_t len, u16_t *chksum);
+u16_t pbuf_copy_partial_chksum(const struct pbuf *buf, void *dataptr, u16_t len,
+                               u16_t offset, u16_t *chksum);
 #endif /* LWIP_CHECKSUM_ON_COPY */
 #if LWIP_TCP && TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
 void pbuf_split_64k(struct pbuf *p, struct pbuf **rest);
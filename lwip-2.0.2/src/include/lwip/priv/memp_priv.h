@@ -142,9 +142,13 @@ struct memp_desc {
 
 #if !MEMP_MEM_MALLOC
   /** Number of elements */
+#if MEM_ARENA
+  u32_t num;
+#else /* MEM_ARENA */
   u16_t num;
+#endif /* MEM_ARENA */
 
-  /** Base address */
+  /** Base address (MEM_ARENA: allocated by memp_init_pool()) */
   u8_t *base;
 
   /** First free element of each pool. Elements form a linked list. */
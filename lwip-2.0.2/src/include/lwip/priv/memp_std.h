@@ -55,6 +55,9 @@ LWIP_MEMPOOL(TCP_SEG,        MEMP_NUM_TCP_SEG,         sizeof(struct tcp_seg),
 #if LWIP_IPV4 && IP_REASSEMBLY
 LWIP_MEMPOOL(REASSDATA,      MEMP_NUM_REASSDATA,       sizeof(struct ip_reassdata),   "REASSDATA")
 #endif /* LWIP_IPV4 && IP_REASSEMBLY */
+#if LWIP_IPV4 && LWIP_IPV4_FIB
+LWIP_MEMPOOL(IP4_FIB_NODE,   MEMP_NUM_IP4_FIB_NODE,    sizeof(struct ip4_fib_entry),  "IP4_FIB_NODE")
+#endif /* LWIP_IPV4 && LWIP_IPV4_FIB */
 #if (IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF) || (LWIP_IPV6 && LWIP_IPV6_FRAG)
 LWIP_MEMPOOL(FRAG_PBUF,      MEMP_NUM_FRAG_PBUF,       sizeof(struct pbuf_custom_ref),"FRAG_PBUF")
 #endif /* IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF || (LWIP_IPV6 && LWIP_IPV6_FRAG) */
@@ -105,6 +108,9 @@ LWIP_MEMPOOL(LOCALHOSTLIST,  MEMP_NUM_LOCALHOSTLIST,   LOCALHOSTLIST_ELEM_SIZE,
 #if LWIP_IPV6 && LWIP_ND6_QUEUEING
 LWIP_MEMPOOL(ND6_QUEUE,      MEMP_NUM_ND6_QUEUE,       sizeof(struct nd6_q_entry), "ND6_QUEUE")
 #endif /* LWIP_IPV6 && LWIP_ND6_QUEUEING */
+#if LWIP_IPV6 && LWIP_IPV6_FIB
+LWIP_MEMPOOL(IP6_FIB_NODE,   MEMP_NUM_IP6_FIB_NODE,    sizeof(struct ip6_fib_entry),  "IP6_FIB_NODE")
+#endif /* LWIP_IPV6 && LWIP_IPV6_FIB */
 
 #if LWIP_IPV6 && LWIP_IPV6_REASS
 LWIP_MEMPOOL(IP6_REASSDATA,      MEMP_NUM_REASSDATA,       sizeof(struct ip6_reassdata),   "IP6_REASSDATA")
@@ -125,6 +131,15 @@ LWIP_MEMPOOL(MLD6_GROUP,     MEMP_NUM_MLD6_GROUP,      sizeof(struct mld_group),
  */
 LWIP_PBUF_MEMPOOL(PBUF,      MEMP_NUM_PBUF,            0,                             "PBUF_REF/ROM")
 LWIP_PBUF_MEMPOOL(PBUF_POOL, PBUF_POOL_SIZE,           PBUF_POOL_BUFSIZE,             "PBUF_POOL")
+#if PBUF_POOL_CLASSES && PBUF_POOL_SMALL_SIZE
+LWIP_PBUF_MEMPOOL(PBUF_POOL_SMALL, PBUF_POOL_SMALL_SIZE, PBUF_POOL_SMALL_BUFSIZE,     "PBUF_POOL_SMALL")
+#endif /* PBUF_POOL_CLASSES && PBUF_POOL_SMALL_SIZE */
+#if PBUF_POOL_CLASSES && PBUF_POOL_JUMBO_SIZE
+LWIP_PBUF_MEMPOOL(PBUF_POOL_JUMBO, PBUF_POOL_JUMBO_SIZE, PBUF_POOL_JUMBO_BUFSIZE,     "PBUF_POOL_JUMBO")
+#endif /* PBUF_POOL_CLASSES && PBUF_POOL_JUMBO_SIZE */
+#if PBUF_POOL_CLASSES && PBUF_POOL_HUGE_SIZE
+LWIP_PBUF_MEMPOOL(PBUF_POOL_HUGE, PBUF_POOL_HUGE_SIZE,  PBUF_POOL_HUGE_BUFSIZE,       "PBUF_POOL_HUGE")
+#endif /* PBUF_POOL_CLASSES && PBUF_POOL_HUGE_SIZE */
 
 
 /*
@@ -88,6 +88,18 @@ struct nd6_neighbor_cache_entry {
     u32_t probes_sent;
     u32_t stale_time;     /* ticks (ND6_TMR_INTERVAL) */
   } counter;
+#if LWIP_ND6_NEIGHBOR_HASH_SIZE
+  /* nd6_tmr() tick at which the state timer of this entry expires */
+  u32_t timer_expire;
+  /* entry index + 1 (0: none) of the next entry in the hash bucket
+     (or in the free list), and of the neighbours in the LRU list and in
+     the timer wheel slot */
+  u16_t hash_next;
+  u16_t lru_prev;
+  u16_t lru_next;
+  u16_t timer_prev;
+  u16_t timer_next;
+#endif /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
 };
 
 struct nd6_destination_cache_entry {
@@ -95,6 +107,13 @@ struct nd6_destination_cache_entry {
   ip6_addr_t next_hop_addr;
   u16_t pmtu;
   u32_t age;
+#if LWIP_ND6_DESTINATION_HASH_SIZE
+  /* entry index + 1 (0: none) of the next entry in the hash bucket
+     (or in the free list), and of the neighbours in the LRU list */
+  u16_t hash_next;
+  u16_t lru_prev;
+  u16_t lru_next;
+#endif /* LWIP_ND6_DESTINATION_HASH_SIZE */
 };
 
 struct nd6_prefix_list_entry {
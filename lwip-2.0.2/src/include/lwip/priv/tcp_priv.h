@@ -149,6 +149,23 @@ err_t            tcp_process_refused_data(struct tcp_pcb *pcb);
 
 #define  TCP_MAXIDLE              TCP_KEEPCNT_DEFAULT * TCP_KEEPINTVL_DEFAULT  /* Maximum KEEPALIVE probe time */
 
+#if LWIP_TCP_DCTCP
+/* DCTCP alpha is kept as a fixed point fraction of this value (RFC 8257) */
+#define TCP_DCTCP_ALPHA_SHIFT 10
+#define TCP_DCTCP_ALPHA_MAX   (1UL << TCP_DCTCP_ALPHA_SHIFT)
+#endif /* LWIP_TCP_DCTCP */
+
+#if LWIP_TCP_RACK
+/* Tail loss probe timeout without RTT sample, in milliseconds (RFC 8985 7.2) */
+#define TCP_RACK_PTO_INIT     1000
+/* Extra probe delay when a single segment is outstanding, covering a
+   delayed ACK at the receiver (WCDelAckT) */
+#define TCP_RACK_WCDELACKT    200
+/* Lower bound of the reordering window in milliseconds: with very small
+   RTTs, a single duplicate ACK must not trigger a retransmission at once */
+#define TCP_RACK_REO_WND_MIN  10
+#endif /* LWIP_TCP_RACK */
+
 #define TCP_TCPLEN(seg) ((seg)->len + (((TCPH_FLAGS((seg)->tcphdr) & (TCP_FIN | TCP_SYN)) != 0) ? 1U : 0U))
 
 /** Flags used on input processing, not on pcb->flags
@@ -244,6 +261,10 @@ err_t            tcp_process_refused_data(struct tcp_pcb *pcb);
 /** Don't generate checksum on copy if CHECKSUM_GEN_TCP is disabled */
 #define TCP_CHECKSUM_ON_COPY  (LWIP_CHECKSUM_ON_COPY && CHECKSUM_GEN_TCP)
 
+/** Without checksum on copy, keep the header sum of the last checksum sent so
+ * that retransmissions only need to sum the header again */
+#define TCP_CHECKSUM_INCREMENTAL (CHECKSUM_GEN_TCP && !TCP_CHECKSUM_ON_COPY)
+
 /* This structure represents a TCP segment on the unsent, unacked and ooseq queues */
 struct tcp_seg {
   struct tcp_seg *next;    /* used when putting segments on a queue */
@@ -258,12 +279,22 @@ struct tcp_seg {
   u16_t chksum;
   u8_t  chksum_swapped;
 #endif /* TCP_CHECKSUM_ON_COPY */
+#if TCP_CHECKSUM_INCREMENTAL
+  u16_t hdr_chksum;        /* sum of header and TCP length when last sent */
+  u16_t hdr_chksum_len;    /* value of 'len' when last sent */
+#endif /* TCP_CHECKSUM_INCREMENTAL */
   u8_t  flags;
 #define TF_SEG_OPTS_MSS         (u8_t)0x01U /* Include MSS option. */
 #define TF_SEG_OPTS_TS          (u8_t)0x02U /* Include timestamp option. */
 #define TF_SEG_DATA_CHECKSUMMED (u8_t)0x04U /* ALL data (not the header) is
                                                checksummed into 'chksum' */
 #define TF_SEG_OPTS_WND_SCALE   (u8_t)0x08U /* Include WND SCALE option */
+#define TF_SEG_OPTS_TFO         (u8_t)0x10U /* Include Fast Open option */
+#define TF_SEG_CHKSUM_VALID     (u8_t)0x40U /* tcphdr->chksum matches 'hdr_chksum' */
+#if LWIP_TCP_RACK
+#define TF_SEG_REXMIT           (u8_t)0x20U /* Segment has been retransmitted */
+  u32_t xmit_ts;           /* sys_now() when last sent */
+#endif /* LWIP_TCP_RACK */
   struct tcp_hdr *tcphdr;  /* the TCP header */
 };
 
@@ -272,6 +303,7 @@ struct tcp_seg {
 #define LWIP_TCP_OPT_MSS        2
 #define LWIP_TCP_OPT_WS         3
 #define LWIP_TCP_OPT_TS         8
+#define LWIP_TCP_OPT_TFO        34
 
 #define LWIP_TCP_OPT_LEN_MSS    4
 #if LWIP_TCP_TIMESTAMPS
@@ -292,6 +324,20 @@ struct tcp_seg {
   (flags & TF_SEG_OPTS_TS        ? LWIP_TCP_OPT_LEN_TS_OUT : 0) + \
   (flags & TF_SEG_OPTS_WND_SCALE ? LWIP_TCP_OPT_LEN_WS_OUT : 0)
 
+#if LWIP_TCP_TFO
+/* Fast Open option: 2 NOPs, kind, length, cookie, padded to 32 bit */
+#define LWIP_TCP_OPT_LEN_TFO_OUT(cookie_len) ((4 + (cookie_len) + 3) & ~3)
+/** Option length of a segment, including the Fast Open option whose length
+ * depends on the cookie stored in the pcb */
+#define LWIP_TCP_OPT_LENGTH_SEGMENT(flags, pcb) \
+  ((LWIP_TCP_OPT_LENGTH(flags)) + \
+   ((flags) & TF_SEG_OPTS_TFO ? LWIP_TCP_OPT_LEN_TFO_OUT((pcb)->tfo_cookie_len) : 0))
+/** Length of the cookies generated by our listeners */
+#define TCP_TFO_COOKIE_LEN 8
+#else /* LWIP_TCP_TFO */
+#define LWIP_TCP_OPT_LENGTH_SEGMENT(flags, pcb) (LWIP_TCP_OPT_LENGTH(flags))
+#endif /* LWIP_TCP_TFO */
+
 /** This returns a TCP header option for MSS in an u32_t */
 #define TCP_BUILD_MSS_OPTION(mss) lwip_htonl(0x02040000 | ((mss) & 0xFFFF))
 
@@ -430,6 +476,19 @@ void tcp_segs_free(struct tcp_seg *seg);
 void tcp_seg_free(struct tcp_seg *seg);
 struct tcp_seg *tcp_seg_copy(struct tcp_seg *seg);
 
+#if MEMP_PRESSURE
+void tcp_memp_pressure(u8_t prev_level);
+#if TCP_QUEUE_OOSEQ
+void tcp_trim_ooseq(u8_t level);
+#endif /* TCP_QUEUE_OOSEQ */
+#endif /* MEMP_PRESSURE */
+
+#if LWIP_TCP_ACK_POLICY
+void tcp_ack_delayed(struct tcp_pcb *pcb);
+#define tcp_ack(pcb) tcp_ack_delayed(pcb)
+/* an ACK was sent, start counting segments again */
+#define tcp_ack_sent(pcb) ((pcb)->delack_segs = 0)
+#else /* LWIP_TCP_ACK_POLICY */
 #define tcp_ack(pcb)                               \
   do {                                             \
     if((pcb)->flags & TF_ACK_DELAY) {              \
@@ -440,6 +499,8 @@ struct tcp_seg *tcp_seg_copy(struct tcp_seg *seg);
       (pcb)->flags |= TF_ACK_DELAY;                \
     }                                              \
   } while (0)
+#define tcp_ack_sent(pcb)
+#endif /* LWIP_TCP_ACK_POLICY */
 
 #define tcp_ack_now(pcb)                           \
   do {                                             \
@@ -457,6 +518,29 @@ void tcp_rst(u32_t seqno, u32_t ackno,
 
 u32_t tcp_next_iss(struct tcp_pcb *pcb);
 
+#if LWIP_TCP_TFO
+void  tcp_tfo_cookie_gen(const ip_addr_t *addr, u8_t *cookie);
+u8_t  tcp_tfo_cookie_get(const ip_addr_t *addr, u8_t *cookie);
+void  tcp_tfo_cookie_set(const ip_addr_t *addr, const u8_t *cookie, u8_t len);
+err_t tcp_tfo_split_syn(struct tcp_pcb *pcb, struct tcp_seg *syn);
+#endif /* LWIP_TCP_TFO */
+
+#if LWIP_TCP_INFO
+/* what limited sending, for pcb->info_limit */
+#define TCP_INFO_LIMIT_IDLE 0
+#define TCP_INFO_LIMIT_APP  1
+#define TCP_INFO_LIMIT_CWND 2
+#define TCP_INFO_LIMIT_RWND 3
+void  tcp_info_update_limit(struct tcp_pcb *pcb);
+void  tcp_info_acked(struct tcp_pcb *pcb, u32_t acked);
+#endif /* LWIP_TCP_INFO */
+
+#if LWIP_TCP_RACK
+u8_t  tcp_rack_detect_loss(struct tcp_pcb *pcb);
+void  tcp_rack_arm_tlp(struct tcp_pcb *pcb);
+void  tcp_rack_timeout(struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_RACK */
+
 err_t tcp_keepalive(struct tcp_pcb *pcb);
 err_t tcp_zero_window_probe(struct tcp_pcb *pcb);
 void  tcp_trigger_input_pcb_close(void);
@@ -266,6 +266,10 @@ struct stats_ {
   /** Heap */
   struct stats_mem mem;
 #endif
+#if MEM_STATS && MEM_USE_SLAB
+  /** Heap size classes (in blocks) */
+  struct stats_mem mem_slab[MEM_SLAB_NUM_CLASSES];
+#endif
 #if MEMP_STATS
   /** Internal memory pools */
   struct stats_mem *memp[MEMP_MAX];
@@ -391,12 +395,26 @@ void stats_init(void);
 #define MEM_STATS_INC_USED(x, y) STATS_INC_USED(mem, y)
 #define MEM_STATS_DEC_USED(x, y) lwip_stats.mem.x -= y
 #define MEM_STATS_DISPLAY() stats_display_mem(&lwip_stats.mem, "HEAP")
+#if MEM_USE_SLAB
+#define MEM_SLAB_STATS_INC(x, i) STATS_INC(mem_slab[i].x)
+#define MEM_SLAB_STATS_INC_USED(i) STATS_INC_USED(mem_slab[i], 1)
+#define MEM_SLAB_STATS_DEC_USED(i) STATS_DEC(mem_slab[i].used)
+#define MEM_SLAB_STATS_ADD_AVAIL(i, y) lwip_stats.mem_slab[i].avail += (y)
+#define MEM_SLAB_STATS_SUB_AVAIL(i, y) lwip_stats.mem_slab[i].avail -= (y)
+#define MEM_SLAB_STATS_DISPLAY(i) stats_display_mem(&lwip_stats.mem_slab[i], lwip_stats.mem_slab[i].name)
+#endif
 #else
 #define MEM_STATS_AVAIL(x, y)
 #define MEM_STATS_INC(x)
 #define MEM_STATS_INC_USED(x, y)
 #define MEM_STATS_DEC_USED(x, y)
 #define MEM_STATS_DISPLAY()
+#define MEM_SLAB_STATS_INC(x, i)
+#define MEM_SLAB_STATS_INC_USED(i)
+#define MEM_SLAB_STATS_DEC_USED(i)
+#define MEM_SLAB_STATS_ADD_AVAIL(i, y)
+#define MEM_SLAB_STATS_SUB_AVAIL(i, y)
+#define MEM_SLAB_STATS_DISPLAY(i)
 #endif
 
  #if MEMP_STATS
@@ -145,12 +145,17 @@ typedef u32_t tcpwnd_size_t;
 typedef u16_t tcpwnd_size_t;
 #endif
 
-#if LWIP_WND_SCALE || TCP_LISTEN_BACKLOG || LWIP_TCP_TIMESTAMPS
+#if LWIP_WND_SCALE || TCP_LISTEN_BACKLOG || LWIP_TCP_TIMESTAMPS || LWIP_TCP_ECN
 typedef u16_t tcpflags_t;
 #else
 typedef u8_t tcpflags_t;
 #endif
 
+#if LWIP_TCP_TFO
+/** Maximum Fast Open cookie length accepted from a server (RFC 7413: 4..16) */
+#define TCP_TFO_COOKIE_MAX_LEN 16
+#endif /* LWIP_TCP_TFO */
+
 enum tcp_state {
   CLOSED      = 0,
   LISTEN      = 1,
@@ -223,6 +228,12 @@ struct tcp_pcb {
 #endif
 #if LWIP_TCP_TIMESTAMPS
 #define TF_TIMESTAMP   0x0400U   /* Timestamp option enabled */
+#endif
+#if LWIP_TCP_ECN
+#define TF_ECN         0x0800U /* ECN negotiated on this connection */
+#define TF_ECN_SND_ECE 0x1000U /* Set ECE on outgoing segments */
+#define TF_ECN_SND_CWR 0x2000U /* Set CWR on the next new data segment */
+#define TF_ECN_CE_RCVD 0x4000U /* DCTCP receiver: last data segment was CE marked */
 #endif
 
   /* the rest of the fields are in host byte order
@@ -327,6 +338,87 @@ struct tcp_pcb {
   u8_t snd_scale;
   u8_t rcv_scale;
 #endif
+
+#if LWIP_TCP_ECN
+  /* snd_nxt at the last ECN window reduction (one reduction per window) */
+  u32_t ecn_recover;
+#if LWIP_TCP_DCTCP
+  /* fraction of CE marked bytes, scaled to TCP_DCTCP_ALPHA_MAX */
+  u32_t dctcp_alpha;
+  /* bytes acked / acked with ECE in the current observation window */
+  u32_t dctcp_acked;
+  u32_t dctcp_ce_acked;
+  /* end of the current observation window */
+  u32_t dctcp_next_seq;
+#endif /* LWIP_TCP_DCTCP */
+#endif /* LWIP_TCP_ECN */
+
+#if LWIP_TCP_TFO
+  u8_t tfo_flags;
+#define TCP_TFO_ENABLE     0x01U /* Client: use Fast Open on tcp_connect */
+#define TCP_TFO_OPT        0x02U /* Send the Fast Open option on our SYN or SYN-ACK */
+#define TCP_TFO_SYN_DATA   0x04U /* Client: our SYN carries data */
+#define TCP_TFO_ACCEPTED   0x08U /* Server: accepted before the handshake completed */
+  /* cookie sent in the Fast Open option (length 0 = cookie request) */
+  u8_t tfo_cookie_len;
+  u8_t tfo_cookie[TCP_TFO_COOKIE_MAX_LEN];
+#endif /* LWIP_TCP_TFO */
+
+#if LWIP_TCP_RACK
+  /* send time (sys_now()), end and RTT of the most recently sent segment
+     known to be delivered */
+  u32_t rack_xmit_ts;
+  u32_t rack_end_seq;
+  u32_t rack_rtt;
+  /* RTT estimates in milliseconds from per-segment send times */
+  u32_t rack_min_rtt;
+  u32_t rack_srtt;
+  /* expiry (sys_now()) of the reordering or tail loss probe timer */
+  u32_t rack_timer;
+  /* snd_nxt when the tail loss probe was sent */
+  u32_t rack_tlp_high_seq;
+  u8_t rack_flags;
+#define TCP_RACK_RTT_VALID     0x01U /* rack_min_rtt and rack_srtt are set */
+#define TCP_RACK_DELIVERED     0x02U /* rack_xmit_ts/rack_end_seq are set */
+#define TCP_RACK_REO_TIMER     0x04U /* rack_timer is the reordering timer */
+#define TCP_RACK_TLP_TIMER     0x08U /* rack_timer is the probe timer */
+#define TCP_RACK_TLP_INFLIGHT  0x10U /* a probe is outstanding */
+#define TCP_RACK_TLP_REXMIT    0x20U /* the outstanding probe is a retransmission */
+#endif /* LWIP_TCP_RACK */
+
+#if LWIP_TCP_INFO
+  /* per-connection statistics, see tcp_get_info() (wrapping counters) */
+  u32_t info_bytes_sent;
+  u32_t info_bytes_retrans;
+  u32_t info_bytes_acked;
+  u32_t info_bytes_received;
+  u32_t info_retrans;
+  /* time (ms) spent with data outstanding, by what limited sending */
+  u32_t info_app_limited;
+  u32_t info_cwnd_limited;
+  u32_t info_rwnd_limited;
+  u32_t info_limit_ts;
+  /* delivery rate sampling: start of the interval and bytes acked since */
+  u32_t info_rate_ts;
+  u32_t info_rate_acked;
+  u32_t info_delivery_rate;
+  u8_t info_limit;
+#endif /* LWIP_TCP_INFO */
+
+#if LWIP_TCP_ACK_POLICY
+  /* segments received since the last ACK was sent */
+  u8_t delack_segs;
+  /* segments still to be acknowledged immediately */
+  u8_t quickack;
+  /* sys_now() when the delayed ACK is due */
+  u32_t delack_due;
+#endif /* LWIP_TCP_ACK_POLICY */
+
+#if LWIP_IPV4_FIB
+  /* cached output netif, valid while rt_gen equals ip4_fib_gen */
+  struct netif *rt_netif;
+  u32_t rt_gen;
+#endif /* LWIP_IPV4_FIB */
 };
 
 #if LWIP_EVENT_API
@@ -374,6 +466,13 @@ void             tcp_poll    (struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interv
 #define          tcp_nagle_enable(pcb)    ((pcb)->flags = (tcpflags_t)((pcb)->flags & ~TF_NODELAY))
 /** @ingroup tcp_raw */
 #define          tcp_nagle_disabled(pcb)  (((pcb)->flags & TF_NODELAY) != 0)
+#if LWIP_TCP_TFO
+/** @ingroup tcp_raw
+ * Use TCP Fast Open for the next tcp_connect() on this pcb. If a cookie for
+ * the server is cached, the SYN is held back until tcp_write()/tcp_output()
+ * so that it can carry the first segment (or until the next fast timer). */
+#define          tcp_fastopen_enable(pcb) ((pcb)->tfo_flags |= TCP_TFO_ENABLE)
+#endif /* LWIP_TCP_TFO */
 
 #if TCP_LISTEN_BACKLOG
 #define          tcp_backlog_set(pcb, new_backlog) do { \
@@ -418,6 +517,55 @@ void             tcp_setprio (struct tcp_pcb *pcb, u8_t prio);
 
 err_t            tcp_output  (struct tcp_pcb *pcb);
 
+#if LWIP_TCP_INFO
+/** @ingroup tcp_raw
+ * Per-connection statistics filled in by tcp_get_info().
+ * Byte counters are 32 bit and wrap around. */
+struct tcp_info_lwip {
+  /** enum tcp_state */
+  u8_t  state;
+  /** duplicate ACKs received in a row */
+  u8_t  dupacks;
+  /** retransmission timeouts in a row */
+  u8_t  nrtx;
+  u16_t mss;
+  /** smoothed RTT, RTT variation and retransmission timeout in milliseconds */
+  u32_t srtt;
+  u32_t rttvar;
+  u32_t rto;
+  u32_t cwnd;
+  u32_t ssthresh;
+  u32_t snd_wnd;
+  u32_t rcv_wnd;
+  /** bytes sent but not yet acknowledged */
+  u32_t bytes_in_flight;
+  /** new data sent, data retransmitted, acked by the peer and received in order */
+  u32_t bytes_sent;
+  u32_t bytes_retrans;
+  u32_t bytes_acked;
+  u32_t bytes_received;
+  /** segments retransmitted */
+  u32_t retransmits;
+  /** out-of-sequence segments and bytes queued */
+  u16_t ooseq_segs;
+  u32_t ooseq_bytes;
+  /** milliseconds with data outstanding during which sending was limited by
+      the application (nothing queued), the congestion window or the peer's
+      receive window */
+  u32_t app_limited;
+  u32_t cwnd_limited;
+  u32_t rwnd_limited;
+  /** bytes acknowledged per second, measured over about one RTT */
+  u32_t delivery_rate;
+};
+
+/** Function prototype for tcp_info_foreach() callbacks */
+typedef void (*tcp_info_fn)(void *arg, struct tcp_pcb *pcb, const struct tcp_info_lwip *info);
+
+err_t            tcp_get_info(struct tcp_pcb *pcb, struct tcp_info_lwip *info);
+void             tcp_info_foreach(tcp_info_fn fn, void *arg);
+#endif /* LWIP_TCP_INFO */
+
 
 const char* tcp_debug_state_str(enum tcp_state s);
 
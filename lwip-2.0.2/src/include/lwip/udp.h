@@ -85,6 +85,12 @@ struct udp_pcb {
 /* Protocol specific PCB members */
 
   struct udp_pcb *next;
+#if UDP_PCB_HASH_SIZE
+  /** next pcb in the same hash bucket */
+  struct udp_pcb *hash_next;
+  /** when the pcb was put on udp_pcbs, to tell the list order in a bucket */
+  u32_t list_seq;
+#endif /* UDP_PCB_HASH_SIZE */
 
   u8_t flags;
   /** ports are in host byte order */
@@ -32,6 +32,7 @@
 
 #define  ECHO_SERVER      1
 #define  TCP_CLIENT       2
+#define  PBUF_REF_STRESS  3
 #define  TEST_ID          TCP_CLIENT
 
 err_t net_init(char *ifname);
@@ -40,7 +41,13 @@ pthread_t start_netif(void);
 struct netif* get_netif(void);
 int lwip_linux_check_port(u16_t port);
 int get_if_address(const char *ifname, uint32_t *ip, uint32_t *mask, uint8_t *mac);
+#if MEM_ARENA
+void linux_arena_init(const char *ifname);
+#endif
 
 err_t create_echo_server(void);
 err_t tcp_client(const ip_addr_t *ip_addr, u16_t port);
+#if PBUF_ATOMIC_REF
+err_t pbuf_ref_stress(void);
+#endif
 #endif /* LWIP_2_0_2_TEST_LINUX_LWIP_H_ */
@@ -46,6 +46,12 @@
 #define LWIP_NETCONN                    0
 #define LWIP_SOCKET                     0
 
+/* 64-bit/SIMD checksum, kernel picked at runtime; sum data while copying it */
+#define LWIP_CHKSUM_ALGORITHM           4
+#define LWIP_CHECKSUM_ON_COPY           1
+/* the port checks RX checksums while copying frames (PBUF_FLAG_CHKSUM_VERIFIED) */
+#define LWIP_CHECKSUM_OFFLOAD           1
+
 /* Enable DHCP to test it, disable UDP checksum to easier inject packets */
 #define LWIP_DHCP                       0
 
@@ -59,6 +65,28 @@
 #define TCP_RCV_SCALE                   0
 #define PBUF_POOL_SIZE                  400 /* pbuf tests need ~200KByte */
 
+/* RX pbufs from best-fit pools: small frames (ACKs) and frames coalesced by the host */
+#define PBUF_POOL_CLASSES               1
+#define PBUF_POOL_SMALL_SIZE            256
+#define PBUF_POOL_HUGE_SIZE             8
+
+/* RX pbufs are handed to and freed by application threads */
+#define PBUF_ATOMIC_REF                 1
+
+/* Per-thread caches in front of the pools: the capture thread allocates RX
+ * pbufs that application threads free */
+#define MEMP_MAGAZINE                   1
+
+/* Shrink windows and trim ooseq queues before the pbuf pools run dry */
+#define MEMP_PRESSURE                   1
+
+/* Pools and heap allocated at lwip_init() from huge pages on the NIC's NUMA
+ * node (src/arch/arena.c); LWIP_PBUF_POOL_SIZE/LWIP_MEM_SIZE resize them */
+#define MEM_ARENA                       1
+#include <stddef.h>
+void *linux_arena_alloc(size_t size);
+#define MEM_ARENA_ALLOC(size)           linux_arena_alloc(size)
+
 /* Enable IGMP and MDNS for MDNS tests */
 //#define LWIP_IGMP                       1
 //#define LWIP_MDNS_RESPONDER             1
@@ -26,6 +26,12 @@ int main(void)
 {
   pthread_t thread;
 
+#if TEST_ID == PBUF_REF_STRESS
+  /* needs no network interface */
+  lwip_init();
+  return (pbuf_ref_stress() == ERR_OK) ? 0 : 1;
+#endif
+
 	if(net_init(NULL) != ERR_OK)
 	{
 		printf("Failed to initialize netif!\n");
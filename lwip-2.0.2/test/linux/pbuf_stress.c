@@ -0,0 +1,127 @@
+/*
+ * pbuf_stress.c
+ *
+ *  Stress test for PBUF_ATOMIC_REF: several threads reference and free
+ *  the same pbufs at the same time, the reference counts must come out
+ *  exact.
+ */
+#include "lwip.h"
+
+#if PBUF_ATOMIC_REF
+
+#define PBUF_STRESS_THREADS   4
+#define PBUF_STRESS_PBUFS     8
+#define PBUF_STRESS_ROUNDS    10000000
+
+static struct pbuf *stress_pbufs[PBUF_STRESS_PBUFS];
+/* the threads wait for stress_go: 1 to run, -1 if not all of them could be
+   created */
+static pthread_mutex_t stress_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stress_start = PTHREAD_COND_INITIALIZER;
+static int stress_go;
+
+static void *pbuf_stress_thread(void *arg)
+{
+  int n = (int)(size_t)arg;
+  int i, rounds;
+
+  /* let all threads run into each other */
+  pthread_mutex_lock(&stress_lock);
+  while (stress_go == 0)
+  {
+    pthread_cond_wait(&stress_start, &stress_lock);
+  }
+  rounds = (stress_go > 0) ? PBUF_STRESS_ROUNDS : 0;
+  pthread_mutex_unlock(&stress_lock);
+  for (i = 0; i < rounds; i++)
+  {
+    struct pbuf *p = stress_pbufs[(i + n) % PBUF_STRESS_PBUFS];
+    pbuf_ref(p);
+    pbuf_ref(p);
+    pbuf_free(p);
+    pbuf_free(p);
+  }
+
+  /* drop the references the main thread handed over: as the main thread
+     keeps its own, none of them goes back to the heap here */
+  for (i = 0; i < PBUF_STRESS_PBUFS; i++)
+  {
+    pbuf_free(stress_pbufs[i]);
+  }
+  return NULL;
+}
+
+err_t pbuf_ref_stress(void)
+{
+  pthread_t threads[PBUF_STRESS_THREADS];
+  err_t err = ERR_OK;
+  int i, t, created;
+
+  for (i = 0; i < PBUF_STRESS_PBUFS; i++)
+  {
+    stress_pbufs[i] = pbuf_alloc(PBUF_RAW, 64, PBUF_RAM);
+    if (stress_pbufs[i] == NULL)
+    {
+      printf("pbuf_ref_stress: out of memory\n");
+      while (i-- > 0)
+      {
+        pbuf_free(stress_pbufs[i]);
+      }
+      return ERR_MEM;
+    }
+    /* one reference for each thread */
+    for (t = 0; t < PBUF_STRESS_THREADS; t++)
+    {
+      pbuf_ref(stress_pbufs[i]);
+    }
+  }
+
+  stress_go = 0;
+  for (created = 0; created < PBUF_STRESS_THREADS; created++)
+  {
+    if (pthread_create(&threads[created], NULL, pbuf_stress_thread, (void *)(size_t)created) != 0)
+    {
+      printf("pbuf_ref_stress: could only create %d threads\n", created);
+      break;
+    }
+  }
+  pthread_mutex_lock(&stress_lock);
+  stress_go = (created == PBUF_STRESS_THREADS) ? 1 : -1;
+  pthread_cond_broadcast(&stress_start);
+  pthread_mutex_unlock(&stress_lock);
+  for (t = 0; t < created; t++)
+  {
+    pthread_join(threads[t], NULL);
+  }
+
+  if (created < PBUF_STRESS_THREADS)
+  {
+    /* drop the references of the threads that do not exist, and our own */
+    for (i = 0; i < PBUF_STRESS_PBUFS; i++)
+    {
+      for (t = created; t <= PBUF_STRESS_THREADS; t++)
+      {
+        pbuf_free(stress_pbufs[i]);
+      }
+    }
+    printf("pbuf_ref_stress: FAILED\n");
+    return ERR_MEM;
+  }
+
+  for (i = 0; i < PBUF_STRESS_PBUFS; i++)
+  {
+    if (stress_pbufs[i]->ref != 1)
+    {
+      printf("pbuf_ref_stress: pbuf %d has ref %d instead of 1\n", i, (int)stress_pbufs[i]->ref);
+      err = ERR_VAL;
+    }
+    else if (pbuf_free(stress_pbufs[i]) != 1)
+    {
+      err = ERR_VAL;
+    }
+  }
+  printf("pbuf_ref_stress: %s\n", (err == ERR_OK) ? "passed" : "FAILED");
+  return err;
+}
+
+#endif /* PBUF_ATOMIC_REF */
@@ -0,0 +1,12 @@
+#include "lwip/opt.h"
+#include "lwip/sys.h"
+
+#include "sys_arch.h"
+
+u32_t lwip_sys_now;
+
+u32_t
+sys_now(void)
+{
+  return lwip_sys_now;
+}
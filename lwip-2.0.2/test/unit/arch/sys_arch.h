@@ -0,0 +1,10 @@
+#ifndef LWIP_HDR_TEST_SYS_ARCH_H
+#define LWIP_HDR_TEST_SYS_ARCH_H
+
+#include "lwip/arch.h"
+
+/* Unit tests run on a fake clock: sys_now() returns this value, which is only
+   ever changed by the tests themselves. */
+extern u32_t lwip_sys_now;
+
+#endif /* LWIP_HDR_TEST_SYS_ARCH_H */
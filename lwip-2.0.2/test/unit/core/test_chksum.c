@@ -0,0 +1,203 @@
+#include "test_chksum.h"
+
+#include "lwip/inet_chksum.h"
+#include "lwip/pbuf.h"
+#include "lwip/def.h"
+
+/* Setups/teardown functions */
+
+static void
+chksum_setup(void)
+{
+}
+
+static void
+chksum_teardown(void)
+{
+}
+
+
+#define TESTBUFSIZE 4200
+static u8_t testbuf[TESTBUFSIZE];
+
+/** Fill testbuf with pseudo-random data (or a constant if fill >= 0) */
+static void
+fill_testbuf(int fill)
+{
+  u32_t seed = 0x12345678UL;
+  size_t i;
+  for (i = 0; i < sizeof(testbuf); i++) {
+    seed = seed * 1103515245UL + 12345UL;
+    testbuf[i] = (fill >= 0) ? (u8_t)fill : (u8_t)(seed >> 16);
+  }
+}
+
+/** Reference checksum: byte-wise sum in network order, like algorithm #1 */
+static u16_t
+ref_chksum(const u8_t *data, int len)
+{
+  u32_t acc = 0;
+  int i;
+  for (i = 0; i + 1 < len; i += 2) {
+    acc += ((u32_t)data[i] << 8) | data[i + 1];
+  }
+  if (len & 1) {
+    acc += (u32_t)data[len - 1] << 8;
+  }
+  while (acc >> 16) {
+    acc = (acc >> 16) + (acc & 0xffffUL);
+  }
+  return (u16_t)~lwip_htons((u16_t)acc);
+}
+
+static void
+check_chksum_range(void)
+{
+  int offset, len;
+  for (offset = 0; offset < 16; offset++) {
+    for (len = 0; len < 300; len++) {
+      u16_t chksum = inet_chksum(&testbuf[offset], (u16_t)len);
+      fail_unless(chksum == ref_chksum(&testbuf[offset], len),
+        "offset %d len %d: %04X", offset, len, chksum);
+    }
+    for (len = 300; len + offset <= TESTBUFSIZE; len += 61) {
+      u16_t chksum = inet_chksum(&testbuf[offset], (u16_t)len);
+      fail_unless(chksum == ref_chksum(&testbuf[offset], len),
+        "offset %d len %d: %04X", offset, len, chksum);
+    }
+  }
+}
+
+/* Test functions */
+
+/** Compare inet_chksum against the reference for all alignments and many lengths */
+START_TEST(test_chksum_alignment)
+{
+  LWIP_UNUSED_ARG(_i);
+
+  fill_testbuf(-1);
+  check_chksum_range();
+  /* all ones maximizes carries, all zeros must not turn into 0xffff */
+  fill_testbuf(0xff);
+  check_chksum_range();
+  fill_testbuf(0);
+  check_chksum_range();
+}
+END_TEST
+
+/** inet_chksum_pbuf over a chain with odd-sized pbufs equals the flat checksum */
+START_TEST(test_chksum_pbuf_chain)
+{
+  static const u16_t lens[] = { 1, 77, 256, 3, 1460, 2, 999 };
+  struct pbuf *p = NULL, *q;
+  u16_t off = 0, tot = 0;
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  fill_testbuf(-1);
+  for (i = 0; i < sizeof(lens)/sizeof(lens[0]); i++) {
+    q = pbuf_alloc(PBUF_RAW, lens[i], PBUF_RAM);
+    fail_unless(q != NULL);
+    if (q == NULL) {
+      break;
+    }
+    MEMCPY(q->payload, &testbuf[tot], lens[i]);
+    tot = (u16_t)(tot + lens[i]);
+    if (p == NULL) {
+      p = q;
+    } else {
+      pbuf_cat(p, q);
+    }
+  }
+  fail_unless(p != NULL);
+  fail_unless(p->tot_len == tot);
+  fail_unless(inet_chksum_pbuf(p) == ref_chksum(testbuf, tot));
+
+  /* same for every start offset into the first pbufs */
+  for (off = 0; off < 80; off++) {
+    fail_unless(inet_chksum_pbuf(p) == ref_chksum(&testbuf[off], tot - off),
+      "offset %d", off);
+    pbuf_header(p, -1);
+    if (p->len == 0) {
+      q = p->next;
+      pbuf_ref(q);
+      pbuf_free(p);
+      p = q;
+    }
+  }
+  pbuf_free(p);
+}
+END_TEST
+
+/** LWIP_CHKSUM_COPY copies like MEMCPY and returns the same sum as LWIP_CHKSUM */
+START_TEST(test_chksum_copy)
+{
+#if LWIP_CHECKSUM_ON_COPY
+  static u8_t dstbuf[TESTBUFSIZE];
+  int src_off, dst_off, len;
+  LWIP_UNUSED_ARG(_i);
+
+  fill_testbuf(-1);
+  for (src_off = 0; src_off < 8; src_off++) {
+    for (dst_off = 0; dst_off < 8; dst_off++) {
+      for (len = 0; len + 8 <= TESTBUFSIZE; len += (len < 300) ? 1 : 97) {
+        u16_t chksum, sum;
+        memset(dstbuf, 0xa5, sizeof(dstbuf));
+        chksum = LWIP_CHKSUM_COPY(&dstbuf[dst_off], &testbuf[src_off], (u16_t)len);
+        fail_unless(memcmp(&dstbuf[dst_off], &testbuf[src_off], len) == 0);
+        /* nothing written beyond the end */
+        fail_unless(dstbuf[dst_off + len] == 0xa5);
+        sum = (u16_t)~chksum;
+        fail_unless(sum == ref_chksum(&testbuf[src_off], len),
+          "src %d dst %d len %d", src_off, dst_off, len);
+      }
+    }
+  }
+#else /* LWIP_CHECKSUM_ON_COPY */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_CHECKSUM_ON_COPY */
+}
+END_TEST
+
+/** inet_chksum_adjust/inet_chksum_adjust32 keep a header checksum valid */
+START_TEST(test_chksum_adjust)
+{
+  u16_t hdr[10];
+  u16_t old_val;
+  u32_t old_val32, new_val32;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  fill_testbuf(-1);
+  MEMCPY(hdr, testbuf, sizeof(hdr));
+  hdr[5] = 0;
+  hdr[5] = inet_chksum(hdr, sizeof(hdr));
+  for (i = 0; i < 1000; i++) {
+    /* 16-bit field, including changes to and from 0 and 0xffff */
+    old_val = hdr[i % 5];
+    hdr[i % 5] = (i & 1) ? (u16_t)(i * 40503U) : ((i & 2) ? 0 : 0xffff);
+    hdr[5] = inet_chksum_adjust(hdr[5], old_val, hdr[i % 5]);
+    fail_unless(inet_chksum(hdr, sizeof(hdr)) == 0, "16-bit step %d", i);
+
+    /* 32-bit field */
+    MEMCPY(&old_val32, &hdr[6], sizeof(old_val32));
+    new_val32 = old_val32 * 2654435761UL + (u32_t)i;
+    MEMCPY(&hdr[6], &new_val32, sizeof(new_val32));
+    hdr[5] = inet_chksum_adjust32(hdr[5], old_val32, new_val32);
+    fail_unless(inet_chksum(hdr, sizeof(hdr)) == 0, "32-bit step %d", i);
+  }
+}
+END_TEST
+
+/** Create the suite including all tests for this module */
+Suite *
+chksum_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_chksum_alignment),
+    TESTFUNC(test_chksum_pbuf_chain),
+    TESTFUNC(test_chksum_copy),
+    TESTFUNC(test_chksum_adjust)
+  };
+  return create_suite("CHKSUM", tests, sizeof(tests)/sizeof(testfunc), chksum_setup, chksum_teardown);
+}
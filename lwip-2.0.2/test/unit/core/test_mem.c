@@ -1,7 +1,9 @@
 #include "test_mem.h"
 
 #include "lwip/mem.h"
+#include "lwip/memp.h"
 #include "lwip/stats.h"
+#include "lwip/def.h"
 
 #if !LWIP_STATS || !MEM_STATS
 #error "This tests needs MEM-statistics enabled"
@@ -10,6 +12,11 @@
 #error "This test needs DNS turned off (as it mallocs on init)"
 #endif
 
+#if MEM_ARENA && !MEMP_MEM_MALLOC
+#define TEST_ARENA_POOL_NUM 4
+LWIP_MEMPOOL_DECLARE(TEST_ARENA, TEST_ARENA_POOL_NUM, 24, "TEST_ARENA")
+#endif /* MEM_ARENA && !MEMP_MEM_MALLOC */
+
 /* Setups/teardown functions */
 
 static void
@@ -109,13 +116,305 @@ START_TEST(test_mem_random)
 }
 END_TEST
 
+/** Check size classes, page reuse and runs of pages of MEM_USE_SLAB */
+START_TEST(test_mem_slab)
+{
+#if MEM_USE_SLAB
+  u8_t *p1, *p2, *p3, *big;
+  void *pages[MEM_SIZE / MEM_SLAB_PAGE_SIZE];
+  int cls, num, i;
+  STAT_COUNTER err;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(lwip_stats.mem.used == 0);
+
+  /* two blocks of one size class share a page */
+  p1 = (u8_t *)mem_malloc(20);
+  fail_unless(p1 != NULL);
+  for (cls = 0; (cls < MEM_SLAB_NUM_CLASSES) && (lwip_stats.mem_slab[cls].used == 0); cls++);
+  fail_unless(cls < MEM_SLAB_NUM_CLASSES);
+  fail_unless(lwip_stats.mem_slab[cls].used == 1);
+  fail_unless(lwip_stats.mem_slab[cls].avail * lwip_stats.mem.used <= MEM_SLAB_PAGE_SIZE);
+  fail_unless(lwip_stats.mem.used >= 20);
+  p2 = (u8_t *)mem_malloc(17);
+  fail_unless(p2 == p1 + lwip_stats.mem.used / 2);
+  fail_unless(lwip_stats.mem_slab[cls].used == 2);
+
+  /* freed blocks are reused first */
+  mem_free(p1);
+  p3 = (u8_t *)mem_malloc(20);
+  fail_unless(p3 == p1);
+  /* and the page is released with its last block */
+  mem_free(p2);
+  mem_free(p3);
+  fail_unless(lwip_stats.mem_slab[cls].used == 0);
+  fail_unless(lwip_stats.mem_slab[cls].avail == 0);
+
+  /* big blocks get whole pages, trimming gives them back */
+  big = (u8_t *)mem_malloc(2 * MEM_SLAB_PAGE_SIZE + 1);
+  fail_unless(big != NULL);
+  fail_unless(lwip_stats.mem.used == 3 * MEM_SLAB_PAGE_SIZE);
+  fail_unless(mem_trim(big, 3 * MEM_SLAB_PAGE_SIZE + 1) == NULL);
+  fail_unless(mem_trim(big, MEM_SLAB_PAGE_SIZE) == big);
+  fail_unless(lwip_stats.mem.used == MEM_SLAB_PAGE_SIZE);
+  mem_free(big);
+  fail_unless(lwip_stats.mem.used == 0);
+
+  /* freed pages are merged with free neighbours into longer runs */
+  for (i = 0; i < 4; i++) {
+    pages[i] = mem_malloc(MEM_SLAB_PAGE_SIZE);
+    fail_unless(pages[i] != NULL);
+  }
+  mem_free(pages[1]);
+  mem_free(pages[2]);
+  big = (u8_t *)mem_malloc(2 * MEM_SLAB_PAGE_SIZE);
+  fail_unless(big == pages[1]);
+  mem_free(big);
+  mem_free(pages[0]);
+  mem_free(pages[3]);
+  fail_unless(lwip_stats.mem.used == 0);
+  big = (u8_t *)mem_malloc(lwip_stats.mem.avail);
+  fail_unless(big != NULL);
+  mem_free(big);
+
+  /* no size class can allocate if all pages are in use... */
+  num = 0;
+  while ((num < (int)(sizeof(pages) / sizeof(pages[0]))) &&
+         ((pages[num] = mem_malloc(MEM_SLAB_PAGE_SIZE)) != NULL)) {
+    num++;
+  }
+  fail_unless(num == (int)(lwip_stats.mem.avail / MEM_SLAB_PAGE_SIZE));
+  fail_unless(mem_malloc(MEM_SLAB_PAGE_SIZE) == NULL);
+  err = lwip_stats.mem_slab[cls].err;
+  fail_unless(mem_malloc(20) == NULL);
+  fail_unless(lwip_stats.mem_slab[cls].err == err + 1);
+  /* ...until a page is freed */
+  mem_free(pages[num / 2]);
+  p1 = (u8_t *)mem_malloc(20);
+  fail_unless(p1 == pages[num / 2]);
+  mem_free(p1);
+  for (i = 0; i < num; i++) {
+    if (i != num / 2) {
+      mem_free(pages[i]);
+    }
+  }
+  fail_unless(lwip_stats.mem.used == 0);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* MEM_USE_SLAB */
+}
+END_TEST
+
+#if MEMP_MAGAZINE
+/** Number of elements on the free list of a pool (not cached in magazines) */
+static u32_t
+memp_free_list_len(memp_t type)
+{
+  struct memp *memp;
+  u32_t cnt = 0;
+
+  for (memp = *memp_pools[type]->tab; memp != NULL; memp = memp->next) {
+    cnt++;
+  }
+  return cnt;
+}
+#endif /* MEMP_MAGAZINE */
+
+/** Check that memp_malloc/memp_free only go to the pool a magazine at a time */
+START_TEST(test_memp_magazine)
+{
+#if MEMP_MAGAZINE
+  void *p[3 * MEMP_MAGAZINE_SIZE];
+  void *p1;
+  mem_size_t used;
+  u32_t avail, mag_size;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  memp_magazine_flush();
+  used = MEMP_STATS_GET(used, MEMP_PBUF_POOL);
+  avail = memp_free_list_len(MEMP_PBUF_POOL);
+  mag_size = LWIP_MIN(MEMP_MAGAZINE_SIZE, memp_pools[MEMP_PBUF_POOL]->num / 8);
+  fail_unless(mag_size > 0);
+
+  /* the first allocation fetches a whole magazine, but only counts one */
+  p1 = memp_malloc(MEMP_PBUF_POOL);
+  fail_unless(p1 != NULL);
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == used + 1);
+  fail_unless(memp_free_list_len(MEMP_PBUF_POOL) == avail - mag_size);
+  /* freeing and allocating again stays in the magazine */
+  memp_free(MEMP_PBUF_POOL, p1);
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == used);
+  fail_unless(memp_malloc(MEMP_PBUF_POOL) == p1);
+  fail_unless(memp_free_list_len(MEMP_PBUF_POOL) == avail - mag_size);
+  memp_free(MEMP_PBUF_POOL, p1);
+
+  for (i = 0; i < 3 * (int)mag_size; i++) {
+    p[i] = memp_malloc(MEMP_PBUF_POOL);
+    fail_unless(p[i] != NULL);
+  }
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == used + 3 * mag_size);
+  /* at most two magazines stay cached */
+  for (i = 0; i < 3 * (int)mag_size; i++) {
+    memp_free(MEMP_PBUF_POOL, p[i]);
+  }
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == used);
+  fail_unless(memp_free_list_len(MEMP_PBUF_POOL) >= avail - 2 * mag_size);
+
+  memp_magazine_flush();
+  fail_unless(memp_free_list_len(MEMP_PBUF_POOL) == avail);
+
+  /* pools of less than 8 elements are not cached */
+  fail_unless(memp_pools[MEMP_UDP_PCB]->num < 8);
+  avail = memp_free_list_len(MEMP_UDP_PCB);
+  p1 = memp_malloc(MEMP_UDP_PCB);
+  fail_unless(p1 != NULL);
+  fail_unless(memp_free_list_len(MEMP_UDP_PCB) == avail - 1);
+  memp_free(MEMP_UDP_PCB, p1);
+  fail_unless(memp_free_list_len(MEMP_UDP_PCB) == avail);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* MEMP_MAGAZINE */
+}
+END_TEST
+
+#if MEMP_PRESSURE
+static memp_t pressure_cb_type;
+static u8_t pressure_cb_level;
+static int pressure_cb_calls;
+
+static void
+test_memp_pressure_cb(memp_t type, u8_t level)
+{
+  pressure_cb_type = type;
+  pressure_cb_level = level;
+  pressure_cb_calls++;
+}
+#endif /* MEMP_PRESSURE */
+
+/** Check pressure levels, hysteresis and callback between the watermarks of a pool */
+START_TEST(test_memp_pressure)
+{
+#if MEMP_PRESSURE
+  void *p[6];
+  mem_size_t used;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  used = MEMP_STATS_GET(used, MEMP_PBUF);
+  fail_unless(used + 6 <= MEMP_NUM_PBUF);
+  memp_set_watermarks(MEMP_PBUF, (mem_size_t)(used + 2), (mem_size_t)(used + 6));
+  memp_pressure_set_callback(test_memp_pressure_cb);
+  pressure_cb_calls = 0;
+  memp_pressure_update();
+  fail_unless(memp_pressure_level == 0);
+  fail_unless(!memp_pressure_active);
+  fail_unless(pressure_cb_calls == 0);
+
+  /* the level rises linearly between the watermarks */
+  for (i = 0; i < 3; i++) {
+    p[i] = memp_malloc(MEMP_PBUF);
+    fail_unless(p[i] != NULL);
+  }
+  memp_pressure_update();
+  fail_unless(memp_pressure_level == MEMP_PRESSURE_MAX / 4);
+  fail_unless(!memp_pressure_active);
+  fail_unless(pressure_cb_calls == 1);
+  fail_unless(pressure_cb_type == MEMP_PBUF);
+  fail_unless(pressure_cb_level == MEMP_PRESSURE_MAX / 4);
+
+  for (; i < 6; i++) {
+    p[i] = memp_malloc(MEMP_PBUF);
+    fail_unless(p[i] != NULL);
+  }
+  memp_pressure_update();
+  fail_unless(memp_pressure_level == MEMP_PRESSURE_MAX);
+  fail_unless(memp_pressure_active);
+  fail_unless(pressure_cb_calls == 2);
+  /* no change, no callback */
+  memp_pressure_update();
+  fail_unless(pressure_cb_calls == 2);
+
+  /* pressure stays active until the pool is back at the low watermark */
+  memp_free(MEMP_PBUF, p[--i]);
+  memp_free(MEMP_PBUF, p[--i]);
+  memp_free(MEMP_PBUF, p[--i]);
+  memp_pressure_update();
+  fail_unless(memp_pressure_level == MEMP_PRESSURE_MAX / 4);
+  fail_unless(memp_pressure_active);
+  while (i > 0) {
+    memp_free(MEMP_PBUF, p[--i]);
+  }
+  memp_pressure_update();
+  fail_unless(memp_pressure_level == 0);
+  fail_unless(!memp_pressure_active);
+  fail_unless(pressure_cb_calls == 4);
+  fail_unless(pressure_cb_level == 0);
+
+  memp_pressure_set_callback(NULL);
+  memp_set_watermarks(MEMP_PBUF, (mem_size_t)(MEMP_NUM_PBUF * MEMP_PRESSURE_LOWAT / 100),
+    (mem_size_t)(MEMP_NUM_PBUF * MEMP_PRESSURE_HIWAT / 100));
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* MEMP_PRESSURE */
+}
+END_TEST
+
+/** Check arena allocations and a private pool set up from the arena */
+START_TEST(test_mem_arena)
+{
+#if MEM_ARENA && !MEMP_MEM_MALLOC
+  u8_t *a, *b, *big, *base;
+  void *p[TEST_ARENA_POOL_NUM];
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  a = (u8_t *)mem_arena_alloc(1);
+  b = (u8_t *)mem_arena_alloc(10);
+  fail_unless(a != NULL);
+  fail_unless(b != NULL);
+  fail_unless(((mem_ptr_t)a % MEM_ALIGNMENT) == 0);
+  fail_unless(((mem_ptr_t)b % MEM_ALIGNMENT) == 0);
+  fail_unless((b >= a + LWIP_MEM_ALIGN_SIZE(1)) || (b + LWIP_MEM_ALIGN_SIZE(10) <= a));
+  /* requests bigger than a chunk get their own chunk */
+  big = (u8_t *)mem_arena_alloc(MEM_ARENA_CHUNK_SIZE + 1);
+  fail_unless(big != NULL);
+  fail_unless(((mem_ptr_t)big % MEM_ALIGNMENT) == 0);
+  memset(big, 0xAA, MEM_ARENA_CHUNK_SIZE + 1);
+
+  /* a private pool gets its memory when it is first initialized */
+  fail_unless(memp_TEST_ARENA.base == NULL);
+  LWIP_MEMPOOL_INIT(TEST_ARENA);
+  base = memp_TEST_ARENA.base;
+  fail_unless(base != NULL);
+  for (i = 0; i < TEST_ARENA_POOL_NUM; i++) {
+    p[i] = LWIP_MEMPOOL_ALLOC(TEST_ARENA);
+    fail_unless(p[i] != NULL);
+  }
+  fail_unless(LWIP_MEMPOOL_ALLOC(TEST_ARENA) == NULL);
+  for (i = 0; i < TEST_ARENA_POOL_NUM; i++) {
+    LWIP_MEMPOOL_FREE(TEST_ARENA, p[i]);
+  }
+  /* initializing again keeps the memory */
+  LWIP_MEMPOOL_INIT(TEST_ARENA);
+  fail_unless(memp_TEST_ARENA.base == base);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* MEM_ARENA && !MEMP_MEM_MALLOC */
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 mem_suite(void)
 {
   testfunc tests[] = {
     TESTFUNC(test_mem_one),
-    TESTFUNC(test_mem_random)
+    TESTFUNC(test_mem_random),
+    TESTFUNC(test_mem_slab),
+    TESTFUNC(test_memp_magazine),
+    TESTFUNC(test_memp_pressure),
+    TESTFUNC(test_mem_arena)
   };
   return create_suite("MEM", tests, sizeof(tests)/sizeof(testfunc), mem_setup, mem_teardown);
 }
@@ -1,7 +1,9 @@
 #include "test_pbuf.h"
 
 #include "lwip/pbuf.h"
+#include "lwip/memp.h"
 #include "lwip/stats.h"
+#include "lwip/inet_chksum.h"
 
 #if !LWIP_STATS || !MEM_STATS ||!MEMP_STATS
 #error "This tests needs MEM- and MEMP-statistics enabled"
@@ -224,6 +226,169 @@ START_TEST(test_pbuf_get_put_at_edge)
 }
 END_TEST
 
+/* Check that pbuf_copy_partial_chksum() copies like pbuf_copy_partial() and
+ * sums the copied data, whatever the offset into a chain of odd pbufs */
+START_TEST(test_pbuf_copy_partial_chksum)
+{
+#if LWIP_CHECKSUM_ON_COPY
+  static const u16_t lens[] = { 7, 13, 30 };
+  struct pbuf *p = NULL, *q;
+  u8_t ref[64], out[64 + 1];
+  u16_t offset, len, copied, chksum, sum;
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < LWIP_ARRAYSIZE(lens); i++) {
+    q = pbuf_alloc(PBUF_RAW, lens[i], PBUF_RAM);
+    fail_unless(q != NULL);
+    if (p == NULL) {
+      p = q;
+    } else {
+      pbuf_cat(p, q);
+    }
+  }
+  for (i = 0; i < p->tot_len; i++) {
+    pbuf_put_at(p, (u16_t)i, (u8_t)(i * 37 + 11));
+  }
+
+  for (offset = 0; offset < 24; offset++) {
+    for (len = 1; offset + len <= p->tot_len; len += 5) {
+      fail_unless(pbuf_copy_partial(p, ref, len, offset) == len);
+      /* odd destination, and a start value that must be kept */
+      chksum = 0x1234;
+      copied = pbuf_copy_partial_chksum(p, out + 1, len, offset, &chksum);
+      fail_unless(copied == len);
+      fail_unless(memcmp(out + 1, ref, len) == 0);
+      fail_unless(FOLD_U32T(0x1234UL + (u16_t)~inet_chksum(ref, len)) == chksum,
+                  "offset %d len %d", offset, len);
+    }
+  }
+  /* copying past the end stops at the end */
+  chksum = 0;
+  fail_unless(pbuf_copy_partial_chksum(p, out, 64, 40, &chksum) == p->tot_len - 40);
+  sum = (u16_t)~inet_chksum(out, (u16_t)(p->tot_len - 40));
+  fail_unless(sum == chksum);
+  pbuf_free(p);
+#else /* LWIP_CHECKSUM_ON_COPY */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_CHECKSUM_ON_COPY */
+}
+END_TEST
+
+/* Check that PBUF_POOL pbufs are taken from the best fitting pool and
+ * fall back to the other pools when that one is empty */
+START_TEST(test_pbuf_pool_classes)
+{
+#if PBUF_POOL_CLASSES && PBUF_POOL_SMALL_SIZE
+  struct pbuf *p, *q;
+  struct pbuf *small[PBUF_POOL_SMALL_SIZE];
+  u16_t len, pool_used;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  /* earlier tests may still hold PBUF_POOL pbufs */
+  pool_used = MEMP_STATS_GET(used, MEMP_PBUF_POOL);
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL_SMALL) == 0);
+
+  /* a small frame fits into one small buffer */
+  p = pbuf_alloc_bestfit(PBUF_RAW, 64);
+  fail_unless(p != NULL);
+  fail_unless(p->next == NULL);
+  fail_unless(p->type == PBUF_POOL);
+  fail_unless(p->pool == MEMP_PBUF_POOL_SMALL);
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL_SMALL) == 1);
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == pool_used);
+  pbuf_free(p);
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL_SMALL) == 0);
+
+  /* pbuf_alloc() never returns less than PBUF_POOL_BUFSIZE: callers
+     (e.g. pppos) fill PBUF_POOL pbufs up to that size */
+  p = pbuf_alloc(PBUF_RAW, 0, PBUF_POOL);
+  fail_unless(p != NULL);
+  fail_unless(p->pool == MEMP_PBUF_POOL);
+  pbuf_free(p);
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL_SMALL) == 0);
+
+  /* the header offset counts as well */
+  p = pbuf_alloc_bestfit(PBUF_TRANSPORT, PBUF_POOL_SMALL_BUFSIZE - 8);
+  fail_unless(p != NULL);
+  fail_unless(p->next == NULL);
+  fail_unless(p->pool == MEMP_PBUF_POOL);
+  pbuf_free(p);
+
+  /* a chain takes its tail from the pool fitting the rest */
+  len = (u16_t)(LWIP_MEM_ALIGN_SIZE(PBUF_POOL_BUFSIZE) + 32);
+  p = pbuf_alloc_bestfit(PBUF_RAW, len);
+  fail_unless(p != NULL);
+  q = p->next;
+  fail_unless(q != NULL);
+  fail_unless(q->next == NULL);
+  fail_unless(p->pool == MEMP_PBUF_POOL);
+  fail_unless(q->pool == MEMP_PBUF_POOL_SMALL);
+  fail_unless(q->len == 32);
+  pbuf_free(p);
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL_SMALL) == 0);
+  /* ... but not with pbuf_alloc() */
+  p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+  fail_unless(p != NULL);
+  fail_unless(p->next != NULL);
+  fail_unless(p->next->pool == MEMP_PBUF_POOL);
+  pbuf_free(p);
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL_SMALL) == 0);
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == pool_used);
+
+  /* with the small pool empty, small frames use a bigger pool */
+  for (i = 0; i < PBUF_POOL_SMALL_SIZE; i++) {
+    small[i] = (struct pbuf *)memp_malloc(MEMP_PBUF_POOL_SMALL);
+    fail_unless(small[i] != NULL);
+  }
+  p = pbuf_alloc_bestfit(PBUF_RAW, 64);
+  fail_unless(p != NULL);
+  fail_unless(p->pool == MEMP_PBUF_POOL);
+  pbuf_free(p);
+  for (i = 0; i < PBUF_POOL_SMALL_SIZE; i++) {
+    memp_free(MEMP_PBUF_POOL_SMALL, small[i]);
+  }
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL_SMALL) == 0);
+  fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == pool_used);
+#else /* PBUF_POOL_CLASSES && PBUF_POOL_SMALL_SIZE */
+  LWIP_UNUSED_ARG(_i);
+#endif /* PBUF_POOL_CLASSES && PBUF_POOL_SMALL_SIZE */
+}
+END_TEST
+
+/* Check reference counting on shared pbufs and chains, on both the
+ * single-owner and the atomic path */
+START_TEST(test_pbuf_ref_count)
+{
+  struct pbuf *p, *q;
+  LWIP_UNUSED_ARG(_i);
+
+  p = pbuf_alloc(PBUF_RAW, 16, PBUF_RAM);
+  fail_unless(p != NULL);
+  q = pbuf_alloc(PBUF_RAW, 16, PBUF_RAM);
+  fail_unless(q != NULL);
+  fail_unless(p->ref == 1);
+
+  /* 1 -> 2 (single owner), 2 -> 3 (shared) */
+  pbuf_ref(p);
+  fail_unless(p->ref == 2);
+  pbuf_ref(p);
+  fail_unless(p->ref == 3);
+  fail_unless(pbuf_free(p) == 0);
+  fail_unless(p->ref == 2);
+  fail_unless(pbuf_free(p) == 0);
+  fail_unless(p->ref == 1);
+
+  /* the chain holds a reference to q: freeing the head stops at q */
+  pbuf_chain(p, q);
+  fail_unless(q->ref == 2);
+  fail_unless(pbuf_free(p) == 1);
+  fail_unless(q->ref == 1);
+  fail_unless(pbuf_free(q) == 1);
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 pbuf_suite(void)
@@ -233,7 +398,10 @@ pbuf_suite(void)
     TESTFUNC(test_pbuf_split_64k_on_small_pbufs),
     TESTFUNC(test_pbuf_queueing_bigger_than_64k),
     TESTFUNC(test_pbuf_take_at_edge),
-    TESTFUNC(test_pbuf_get_put_at_edge)
+    TESTFUNC(test_pbuf_get_put_at_edge),
+    TESTFUNC(test_pbuf_copy_partial_chksum),
+    TESTFUNC(test_pbuf_pool_classes),
+    TESTFUNC(test_pbuf_ref_count)
   };
   return create_suite("PBUF", tests, sizeof(tests)/sizeof(testfunc), pbuf_setup, pbuf_teardown);
 }
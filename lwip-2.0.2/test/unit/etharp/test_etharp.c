@@ -257,13 +257,79 @@ START_TEST(test_etharp_table)
 }
 END_TEST
 
+/** Check that a full table recycles the least recently used entry */
+START_TEST(test_etharp_lru)
+{
+#if ETHARP_TABLE_HASH_SIZE
+  s16_t idx;
+  const ip4_addr_t *unused_ipaddr;
+  struct eth_addr *unused_ethaddr;
+  struct udp_pcb* pcb;
+  ip4_addr_t adrs[ARP_TABLE_SIZE + 1];
+  ip_addr_t dst;
+  struct pbuf *p;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  pcb = udp_new();
+  fail_unless(pcb != NULL);
+  for(i = 0; i < ARP_TABLE_SIZE + 1; i++) {
+    IP4_ADDR(&adrs[i], 192,168,1,i+2);
+  }
+  /* fill ARP-table with dynamic entries */
+  for(i = 0; i < ARP_TABLE_SIZE; i++) {
+    p = pbuf_alloc(PBUF_TRANSPORT, 10, PBUF_RAM);
+    fail_unless(p != NULL);
+    ip_addr_copy_from_ip4(dst, adrs[i]);
+    fail_unless(udp_sendto(pcb, p, &dst, 123) == ERR_OK);
+    pbuf_free(p);
+    create_arp_response(&adrs[i]);
+  }
+
+  /* sending to the oldest entry makes it the most recently used one */
+  linkoutput_ctr = 0;
+  p = pbuf_alloc(PBUF_TRANSPORT, 10, PBUF_RAM);
+  fail_unless(p != NULL);
+  ip_addr_copy_from_ip4(dst, adrs[0]);
+  fail_unless(udp_sendto(pcb, p, &dst, 123) == ERR_OK);
+  fail_unless(linkoutput_ctr == 1);
+  pbuf_free(p);
+
+  /* a new address recycles the second oldest entry */
+  idx = etharp_find_addr(NULL, &adrs[1], &unused_ethaddr, &unused_ipaddr);
+  fail_unless(idx >= 0);
+  p = pbuf_alloc(PBUF_TRANSPORT, 10, PBUF_RAM);
+  fail_unless(p != NULL);
+  ip_addr_copy_from_ip4(dst, adrs[ARP_TABLE_SIZE]);
+  fail_unless(udp_sendto(pcb, p, &dst, 123) == ERR_OK);
+  pbuf_free(p);
+  create_arp_response(&adrs[ARP_TABLE_SIZE]);
+  fail_unless(etharp_find_addr(NULL, &adrs[ARP_TABLE_SIZE], &unused_ethaddr, &unused_ipaddr) == idx);
+  fail_unless(etharp_find_addr(NULL, &adrs[1], &unused_ethaddr, &unused_ipaddr) == -1);
+  fail_unless(etharp_find_addr(NULL, &adrs[0], &unused_ethaddr, &unused_ipaddr) >= 0);
+
+  /* all dynamic entries time out */
+  for(i = 0; i < ARP_MAXAGE; i++) {
+    etharp_tmr();
+  }
+  for(i = 0; i < ARP_TABLE_SIZE + 1; i++) {
+    fail_unless(etharp_find_addr(NULL, &adrs[i], &unused_ethaddr, &unused_ipaddr) == -1);
+  }
+  udp_remove(pcb);
+#else /* ETHARP_TABLE_HASH_SIZE */
+  LWIP_UNUSED_ARG(_i);
+#endif /* ETHARP_TABLE_HASH_SIZE */
+}
+END_TEST
+
 
 /** Create the suite including all tests for this module */
 Suite *
 etharp_suite(void)
 {
   testfunc tests[] = {
-    TESTFUNC(test_etharp_table)
+    TESTFUNC(test_etharp_table),
+    TESTFUNC(test_etharp_lru)
   };
   return create_suite("ETHARP", tests, sizeof(tests)/sizeof(testfunc), etharp_setup, etharp_teardown);
 }
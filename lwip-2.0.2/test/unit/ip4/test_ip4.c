@@ -0,0 +1,568 @@
+#include "test_ip4.h"
+#include "../ip_frag_helper.h"
+
+#include "lwip/ip4.h"
+#include "lwip/etharp.h"
+#include "netif/ethernet.h"
+#include "lwip/ip4_fib.h"
+#include "lwip/ip4_frag.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/netif.h"
+#include "lwip/stats.h"
+#include "lwip/udp.h"
+
+#if !LWIP_STATS || !MEMP_STATS
+#error "This tests needs MEMP-statistics enabled"
+#endif
+
+#if LWIP_IPV4_FIB
+static struct netif test_netif1, test_netif2;
+static int output_ctr1, output_ctr2, linkoutput_ctr;
+static struct eth_addr linkoutput_dest;
+
+/* Helper functions */
+static err_t
+test_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  LWIP_UNUSED_ARG(ipaddr);
+  fail_unless(p->len >= IP_HLEN);
+  fail_unless(inet_chksum(p->payload, IP_HLEN) == 0);
+  if (netif == &test_netif1) {
+    output_ctr1++;
+  } else {
+    output_ctr2++;
+  }
+  return ERR_OK;
+}
+
+static err_t
+test_netif_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  LWIP_UNUSED_ARG(netif);
+  linkoutput_ctr++;
+  fail_unless(p->len >= SIZEOF_ETH_HDR);
+  memcpy(&linkoutput_dest, p->payload, sizeof(linkoutput_dest));
+  return ERR_OK;
+}
+
+static err_t
+test_netif_init(struct netif *netif)
+{
+  fail_unless(netif != NULL);
+  netif->output = test_netif_output;
+  netif->linkoutput = test_netif_linkoutput;
+  netif->mtu = 1500;
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+static void
+test_netifs_add(void)
+{
+  ip4_addr_t addr, netmask, gw;
+
+  IP4_ADDR(&addr, 192, 168, 1, 1);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  IP4_ADDR(&gw, 192, 168, 1, 254);
+  fail_unless(netif_add(&test_netif1, &addr, &netmask, &gw, NULL, test_netif_init, NULL) == &test_netif1);
+  netif_set_up(&test_netif1);
+  netif_set_default(&test_netif1);
+
+  IP4_ADDR(&addr, 10, 0, 0, 1);
+  IP4_ADDR(&netmask, 255, 255, 0, 0);
+  IP4_ADDR(&gw, 10, 0, 0, 254);
+  fail_unless(netif_add(&test_netif2, &addr, &netmask, &gw, NULL, test_netif_init, NULL) == &test_netif2);
+  netif_set_up(&test_netif2);
+}
+
+static struct netif *
+test_route(u8_t a, u8_t b, u8_t c, u8_t d)
+{
+  ip4_addr_t dest;
+  IP4_ADDR(&dest, a, b, c, d);
+  return ip4_route(&dest);
+}
+
+#if IP_FORWARD
+/* Pass a UDP packet from 192.168.1.5 to 'dest' to ip4_input() on netif1 */
+static void
+test_forward(const ip4_addr_t *dest)
+{
+  struct pbuf *p;
+  struct ip_hdr *iphdr;
+  ip4_addr_t src;
+
+  p = pbuf_alloc(PBUF_LINK, IP_HLEN + 8, PBUF_RAM);
+  fail_unless(p != NULL);
+  iphdr = (struct ip_hdr *)p->payload;
+  memset(p->payload, 0, p->len);
+  IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+  IPH_LEN_SET(iphdr, lwip_htons(IP_HLEN + 8));
+  IPH_TTL_SET(iphdr, 64);
+  IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+  IP4_ADDR(&src, 192, 168, 1, 5);
+  ip4_addr_copy(iphdr->src, src);
+  ip4_addr_copy(iphdr->dest, *dest);
+  IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+  ip4_input(p, &test_netif1);
+}
+#endif /* IP_FORWARD */
+#endif /* LWIP_IPV4_FIB */
+
+#if IP_REASSEMBLY
+/* Create a fragment of 'len' bytes at 'offset' of UDP datagram 'id' sent by
+   10.0.0.'src', payload bytes are their offset in the datagram */
+static struct pbuf *
+test_fragment(u8_t src, u16_t id, u16_t offset, u16_t len, int more)
+{
+  struct pbuf *p;
+  struct ip_hdr *iphdr;
+  ip4_addr_t addr;
+  u16_t i;
+
+  p = pbuf_alloc(PBUF_RAW, IP_HLEN + len, PBUF_RAM);
+  fail_unless(p != NULL);
+  iphdr = (struct ip_hdr *)p->payload;
+  memset(iphdr, 0, IP_HLEN);
+  IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+  IPH_LEN_SET(iphdr, lwip_htons(IP_HLEN + len));
+  IPH_ID_SET(iphdr, lwip_htons(id));
+  IPH_OFFSET_SET(iphdr, lwip_htons((offset / 8) | (more ? IP_MF : 0)));
+  IPH_TTL_SET(iphdr, 64);
+  IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+  IP4_ADDR(&addr, 10, 0, 0, src);
+  ip4_addr_copy(iphdr->src, addr);
+  IP4_ADDR(&addr, 10, 0, 0, 1);
+  ip4_addr_copy(iphdr->dest, addr);
+  for (i = 0; i < len; i++) {
+    ((u8_t *)p->payload)[IP_HLEN + i] = (u8_t)(offset + i);
+  }
+  return p;
+}
+
+static void
+test_check_datagram(struct pbuf *p, u16_t len)
+{
+  fail_unless(p != NULL);
+  if (p != NULL) {
+    fail_unless(IPH_LEN((struct ip_hdr *)p->payload) == lwip_htons(IP_HLEN + len));
+    test_frag_check_payload(p, IP_HLEN, len);
+    pbuf_free(p);
+  }
+}
+
+#if IP_FRAG
+/* Check the header of a fragment sent and feed a copy to reassembly */
+static err_t
+test_frag_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(ipaddr);
+
+  fail_unless(p->len >= IP_HLEN);
+  fail_unless(inet_chksum(p->payload, IP_HLEN) == 0);
+  test_frag_reassemble(p, ip4_reass);
+  return ERR_OK;
+}
+#endif /* IP_FRAG */
+#endif /* IP_REASSEMBLY */
+
+/* Setups/teardown functions */
+
+static void
+ip4_setup(void)
+{
+}
+
+static void
+ip4_teardown(void)
+{
+#if LWIP_IPV4_FIB
+  netif_remove(&test_netif1);
+  netif_remove(&test_netif2);
+#endif /* LWIP_IPV4_FIB */
+}
+
+
+/* Test functions */
+
+/** Check longest prefix matching over connected and static routes */
+START_TEST(test_ip4_fib_route)
+{
+#if LWIP_IPV4_FIB
+  ip4_addr_t prefix, gw;
+  u32_t gen;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netifs_add();
+  /* one node per subnet plus the branch node above them */
+  fail_unless(MEMP_STATS_GET(used, MEMP_IP4_FIB_NODE) == 3);
+
+  /* connected routes and the default netif */
+  fail_unless(test_route(192, 168, 1, 7) == &test_netif1);
+  fail_unless(test_route(10, 0, 200, 7) == &test_netif2);
+  fail_unless(test_route(10, 1, 0, 7) == &test_netif1);
+  fail_unless(test_route(8, 8, 8, 8) == &test_netif1);
+
+  /* static routes: the most specific one wins */
+  gen = ip4_fib_gen;
+  IP4_ADDR(&prefix, 10, 0, 0, 0);
+  IP4_ADDR(&gw, 10, 0, 0, 254);
+  fail_unless(ip4_fib_add(&prefix, 8, &gw, &test_netif2) == ERR_OK);
+  fail_unless(ip4_fib_gen != gen);
+  IP4_ADDR(&prefix, 10, 0, 7, 0);
+  IP4_ADDR(&gw, 192, 168, 1, 254);
+  fail_unless(ip4_fib_add(&prefix, 24, &gw, &test_netif1) == ERR_OK);
+  IP4_ADDR(&prefix, 8, 8, 8, 8);
+  fail_unless(ip4_fib_add(&prefix, 32, &gw, &test_netif1) == ERR_OK);
+  fail_unless(test_route(10, 1, 0, 7) == &test_netif2);
+  fail_unless(test_route(10, 0, 200, 7) == &test_netif2);
+  fail_unless(test_route(10, 0, 7, 7) == &test_netif1);
+  fail_unless(test_route(8, 8, 8, 8) == &test_netif1);
+  fail_unless(test_route(8, 8, 8, 9) == &test_netif1);
+
+  /* a route over a netif that is down is skipped */
+  netif_set_down(&test_netif1);
+  fail_unless(test_route(10, 0, 7, 7) == &test_netif2);
+  netif_set_up(&test_netif1);
+  fail_unless(test_route(10, 0, 7, 7) == &test_netif1);
+
+  /* removing routes falls back to less specific ones */
+  IP4_ADDR(&prefix, 10, 0, 7, 0);
+  fail_unless(ip4_fib_remove(&prefix, 24) == ERR_OK);
+  fail_unless(ip4_fib_remove(&prefix, 24) == ERR_VAL);
+  fail_unless(test_route(10, 0, 7, 7) == &test_netif2);
+  IP4_ADDR(&prefix, 10, 0, 0, 0);
+  fail_unless(ip4_fib_remove(&prefix, 8) == ERR_OK);
+  fail_unless(test_route(10, 1, 0, 7) == &test_netif1);
+
+  /* removing a netif removes its routes */
+  netif_remove(&test_netif1);
+  fail_unless(test_route(8, 8, 8, 8) == NULL);
+  fail_unless(test_route(10, 0, 7, 7) == &test_netif2);
+  netif_remove(&test_netif2);
+  fail_unless(MEMP_STATS_GET(used, MEMP_IP4_FIB_NODE) == 0);
+#else /* LWIP_IPV4_FIB */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV4_FIB */
+}
+END_TEST
+
+/** Check the next hop used for off-link destinations and address changes */
+START_TEST(test_ip4_fib_gateway)
+{
+#if LWIP_IPV4_FIB
+  ip4_addr_t prefix, gw, dest, addr;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netifs_add();
+  IP4_ADDR(&prefix, 172, 16, 0, 0);
+  IP4_ADDR(&gw, 10, 0, 0, 99);
+  fail_unless(ip4_fib_add(&prefix, 12, &gw, &test_netif2) == ERR_OK);
+  IP4_ADDR(&prefix, 172, 31, 0, 0);
+  fail_unless(ip4_fib_add(&prefix, 16, NULL, &test_netif2) == ERR_OK);
+
+  IP4_ADDR(&dest, 172, 17, 1, 1);
+  fail_unless(ip4_route(&dest) == &test_netif2);
+  fail_unless(ip4_addr_cmp(ip4_fib_gateway(&test_netif2, &dest), &gw));
+  /* on-link route */
+  IP4_ADDR(&dest, 172, 31, 1, 1);
+  fail_unless(ip4_fib_gateway(&test_netif2, &dest) == &dest);
+  /* the default route uses the gateway of the netif */
+  IP4_ADDR(&dest, 8, 8, 8, 8);
+  fail_unless(ip4_fib_gateway(&test_netif1, &dest) == NULL);
+
+  /* changing the subnet of a netif moves its connected route */
+  IP4_ADDR(&addr, 10, 0, 0, 1);
+  IP4_ADDR(&dest, 10, 0, 200, 1);
+  fail_unless(ip4_route(&dest) == &test_netif2);
+  IP4_ADDR(&addr, 255, 255, 255, 0);
+  netif_set_netmask(&test_netif2, &addr);
+  fail_unless(ip4_route(&dest) == &test_netif1);
+  IP4_ADDR(&dest, 10, 0, 0, 200);
+  fail_unless(ip4_route(&dest) == &test_netif2);
+#else /* LWIP_IPV4_FIB */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV4_FIB */
+}
+END_TEST
+
+/** Check that forwarding follows route, netif and ARP changes */
+START_TEST(test_ip4_forward)
+{
+#if LWIP_IPV4_FIB && IP_FORWARD
+  ip4_addr_t prefix, gw, dest;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netifs_add();
+  output_ctr1 = output_ctr2 = 0;
+  IP4_ADDR(&dest, 172, 16, 1, 1);
+  test_forward(&dest);
+  fail_unless((output_ctr1 == 0) && (output_ctr2 == 0));
+
+  /* a new route is used at once, the TTL update keeps the checksum valid */
+  IP4_ADDR(&prefix, 172, 16, 0, 0);
+  IP4_ADDR(&gw, 10, 0, 0, 99);
+  fail_unless(ip4_fib_add(&prefix, 16, &gw, &test_netif2) == ERR_OK);
+  test_forward(&dest);
+  test_forward(&dest);
+  fail_unless((output_ctr1 == 0) && (output_ctr2 == 2));
+
+  /* packets are not bounced back to netif1 */
+  IP4_ADDR(&prefix, 172, 16, 1, 0);
+  fail_unless(ip4_fib_add(&prefix, 24, NULL, &test_netif1) == ERR_OK);
+  test_forward(&dest);
+  fail_unless((output_ctr1 == 0) && (output_ctr2 == 2));
+  fail_unless(ip4_fib_remove(&prefix, 24) == ERR_OK);
+  test_forward(&dest);
+  fail_unless(output_ctr2 == 3);
+
+  /* nothing is sent on a netif that went down */
+  netif_set_down(&test_netif2);
+  test_forward(&dest);
+  fail_unless(output_ctr2 == 3);
+  netif_set_up(&test_netif2);
+  test_forward(&dest);
+  fail_unless(output_ctr2 == 4);
+
+#if LWIP_ARP && ETHARP_SUPPORT_STATIC_ENTRIES
+  {
+    struct eth_addr mac = {{0x02, 0x00, 0x00, 0x00, 0x00, 0x99}};
+    struct eth_addr other_mac = {{0x02, 0x00, 0x00, 0x00, 0x00, 0x50}};
+    struct eth_addr *ethaddr;
+    const ip4_addr_t *ipaddr;
+    ip4_addr_t other;
+    s16_t idx;
+
+    IP4_ADDR(&other, 10, 0, 0, 50);
+
+    /* Ethernet netifs send to the MAC address of the next hop */
+    test_netif2.output = etharp_output;
+    test_netif2.flags |= NETIF_FLAG_ETHARP;
+    linkoutput_ctr = 0;
+    fail_unless(etharp_add_static_entry(&gw, &mac) == ERR_OK);
+    test_forward(&dest);
+    test_forward(&dest);
+    fail_unless(linkoutput_ctr == 2);
+    fail_unless(memcmp(&linkoutput_dest, &mac, sizeof(mac)) == 0);
+
+    /* once the entry is gone, the next hop is resolved again */
+    fail_unless(etharp_remove_static_entry(&gw) == ERR_OK);
+    test_forward(&dest);
+    fail_unless(linkoutput_ctr == 3);
+    fail_unless(memcmp(&linkoutput_dest, &ethbroadcast, sizeof(mac)) == 0);
+    etharp_cleanup_netif(&test_netif2);
+
+    /* the ARP entry of the next hop is recycled for another address: the
+       flow must not keep sending to it */
+    fail_unless(etharp_add_static_entry(&gw, &mac) == ERR_OK);
+    test_forward(&dest);
+    fail_unless(linkoutput_ctr == 4);
+    fail_unless(memcmp(&linkoutput_dest, &mac, sizeof(mac)) == 0);
+    idx = etharp_find_addr(&test_netif2, &gw, &ethaddr, &ipaddr);
+    fail_unless(idx >= 0);
+    fail_unless(etharp_remove_static_entry(&gw) == ERR_OK);
+    fail_unless(etharp_add_static_entry(&other, &other_mac) == ERR_OK);
+    fail_unless(etharp_find_addr(&test_netif2, &other, &ethaddr, &ipaddr) == idx);
+    test_forward(&dest);
+    fail_unless(linkoutput_ctr == 5);
+    fail_unless(memcmp(&linkoutput_dest, &ethbroadcast, sizeof(mac)) == 0);
+    test_forward(&dest);
+    fail_unless(memcmp(&linkoutput_dest, &other_mac, sizeof(mac)) != 0);
+
+    /* once the next hop is known again, packets go there */
+    fail_unless(etharp_add_static_entry(&gw, &mac) == ERR_OK);
+    test_forward(&dest);
+    fail_unless(memcmp(&linkoutput_dest, &mac, sizeof(mac)) == 0);
+    fail_unless(etharp_remove_static_entry(&gw) == ERR_OK);
+    fail_unless(etharp_remove_static_entry(&other) == ERR_OK);
+    etharp_cleanup_netif(&test_netif2);
+  }
+#endif /* LWIP_ARP && ETHARP_SUPPORT_STATIC_ENTRIES */
+  fail_unless(output_ctr1 == 0);
+#else /* LWIP_IPV4_FIB && IP_FORWARD */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV4_FIB && IP_FORWARD */
+}
+END_TEST
+
+/** Check reassembly of interleaved datagrams and the per-source quota */
+START_TEST(test_ip4_reass)
+{
+#if IP_REASSEMBLY
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  /* two interleaved datagrams of one source, one of them out of order */
+  fail_unless(ip4_reass(test_fragment(2, 1, 16, 8, 0)) == NULL);
+  fail_unless(ip4_reass(test_fragment(2, 2, 0, 16, 1)) == NULL);
+  fail_unless(ip4_reass(test_fragment(2, 1, 0, 8, 1)) == NULL);
+  /* duplicates are dropped */
+  fail_unless(ip4_reass(test_fragment(2, 1, 0, 8, 1)) == NULL);
+  fail_unless(ip4_reass(test_fragment(2, 2, 16, 16, 1)) == NULL);
+  fail_unless(MEMP_STATS_GET(used, MEMP_REASSDATA) == 2);
+  test_check_datagram(ip4_reass(test_fragment(2, 1, 8, 8, 1)), 24);
+  test_check_datagram(ip4_reass(test_fragment(2, 2, 32, 4, 0)), 36);
+  fail_unless(MEMP_STATS_GET(used, MEMP_REASSDATA) == 0);
+
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  /* a source over its quota cannot complete its datagram... */
+  for (i = 0; i < IP_REASS_MAX_PBUFS_PER_SRC; i++) {
+    fail_unless(ip4_reass(test_fragment(3, 1, (u16_t)(i * 8), 8, 1)) == NULL);
+  }
+  fail_unless(ip4_reass(test_fragment(3, 1, (u16_t)(i * 8), 8, 0)) == NULL);
+  /* ...but does not keep other sources (with another quota bucket) from
+     reassembling */
+  fail_unless(ip4_reass(test_fragment(5, 1, 8, 8, 0)) == NULL);
+  test_check_datagram(ip4_reass(test_fragment(5, 1, 0, 8, 1)), 16);
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+
+  /* incomplete datagrams time out */
+  for (i = 0; i <= IP_REASS_MAXAGE; i++) {
+    ip_reass_tmr();
+  }
+  fail_unless(MEMP_STATS_GET(used, MEMP_REASSDATA) == 0);
+#else /* IP_REASSEMBLY */
+  LWIP_UNUSED_ARG(_i);
+#endif /* IP_REASSEMBLY */
+}
+END_TEST
+
+/** Check that fragments sent reassemble to the original datagram */
+START_TEST(test_ip4_frag)
+{
+#if IP_REASSEMBLY && IP_FRAG
+  struct netif netif;
+  struct pbuf *p;
+  ip4_addr_t dest;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&netif, 0, sizeof(netif));
+  netif.output = test_frag_output;
+  netif.mtu = IP_HLEN + 56;
+  NETIF_SET_CHECKSUM_CTRL(&netif, NETIF_CHECKSUM_ENABLE_ALL);
+  test_frag_reset();
+  IP4_ADDR(&dest, 10, 0, 0, 1);
+
+  p = test_fragment(2, 9, 0, 200, 0);
+  IPH_CHKSUM_SET((struct ip_hdr *)p->payload, inet_chksum(p->payload, IP_HLEN));
+  fail_unless(ip4_frag(p, &netif, &dest) == ERR_OK);
+  pbuf_free(p);
+  fail_unless(frag_ctr == 4);
+  test_check_datagram(frag_reassembled, 200);
+#if !LWIP_NETIF_TX_SINGLE_PBUF
+  fail_unless(MEMP_STATS_GET(used, MEMP_FRAG_PBUF) == 0);
+#endif /* !LWIP_NETIF_TX_SINGLE_PBUF */
+#else /* IP_REASSEMBLY && IP_FRAG */
+  LWIP_UNUSED_ARG(_i);
+#endif /* IP_REASSEMBLY && IP_FRAG */
+}
+END_TEST
+
+/** A transport checksum left to the netif is completed before fragmenting */
+START_TEST(test_ip4_frag_chksum_partial)
+{
+#if IP_REASSEMBLY && IP_FRAG && LWIP_CHECKSUM_OFFLOAD
+  struct netif netif;
+  struct pbuf *p;
+  ip_addr_t src, dest;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&netif, 0, sizeof(netif));
+  netif.output = test_frag_output;
+  netif.mtu = IP_HLEN + 56;
+  NETIF_SET_CHECKSUM_CTRL(&netif, NETIF_CHECKSUM_ENABLE_ALL);
+  test_frag_reset();
+  IP_ADDR4(&src, 10, 0, 0, 2);
+  IP_ADDR4(&dest, 10, 0, 0, 1);
+
+  p = test_fragment(2, 10, 0, 200, 0);
+  fail_unless(pbuf_header(p, -IP_HLEN) == 0);
+  ip_chksum_pseudo_offload(p, IP_PROTO_UDP, 200, 6, &src, &dest);
+  fail_unless(pbuf_header(p, IP_HLEN) == 0);
+  fail_unless(p->csum_start == IP_HLEN);
+  IPH_CHKSUM_SET((struct ip_hdr *)p->payload, inet_chksum(p->payload, IP_HLEN));
+  fail_unless(ip4_frag(p, &netif, ip_2_ip4(&dest)) == ERR_OK);
+  fail_unless((p->flags & PBUF_FLAG_CHKSUM_PARTIAL) == 0);
+  pbuf_free(p);
+  fail_unless(frag_ctr == 4);
+
+  p = frag_reassembled;
+  fail_unless(p != NULL);
+  if (p != NULL) {
+    fail_unless(pbuf_header(p, -IP_HLEN) == 0);
+    fail_unless(ip_chksum_pseudo(p, IP_PROTO_UDP, p->tot_len, &src, &dest) == 0);
+    pbuf_free(p);
+  }
+#else /* IP_REASSEMBLY && IP_FRAG && LWIP_CHECKSUM_OFFLOAD */
+  LWIP_UNUSED_ARG(_i);
+#endif /* IP_REASSEMBLY && IP_FRAG && LWIP_CHECKSUM_OFFLOAD */
+}
+END_TEST
+
+/** A header checksum verified by the netif driver is not checked again */
+START_TEST(test_ip4_chksum_verified)
+{
+#if LWIP_IPV4_FIB && LWIP_CHECKSUM_OFFLOAD && CHECKSUM_CHECK_IP
+  struct pbuf *p;
+  struct ip_hdr *iphdr;
+  ip4_addr_t src;
+  u16_t chkerr, udp_recv;
+  int verified;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netifs_add();
+  for (verified = 0; verified < 2; verified++) {
+    chkerr = lwip_stats.ip.chkerr;
+    udp_recv = lwip_stats.udp.recv;
+
+    /* a UDP packet to netif1 with a wrong header checksum */
+    p = pbuf_alloc(PBUF_LINK, IP_HLEN + UDP_HLEN, PBUF_RAM);
+    fail_unless(p != NULL);
+    iphdr = (struct ip_hdr *)p->payload;
+    memset(p->payload, 0, p->len);
+    IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+    IPH_LEN_SET(iphdr, lwip_htons(IP_HLEN + UDP_HLEN));
+    IPH_TTL_SET(iphdr, 64);
+    IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+    IP4_ADDR(&src, 192, 168, 1, 5);
+    ip4_addr_copy(iphdr->src, src);
+    ip4_addr_copy(iphdr->dest, *netif_ip4_addr(&test_netif1));
+    IPH_CHKSUM_SET(iphdr, (u16_t)(inet_chksum(iphdr, IP_HLEN) ^ 0x1234));
+    ((u8_t *)p->payload)[IP_HLEN + 5] = UDP_HLEN;
+    if (verified) {
+      p->flags |= PBUF_FLAG_CHKSUM_VERIFIED;
+    }
+    ip4_input(p, &test_netif1);
+
+    if (verified) {
+      fail_unless(lwip_stats.ip.chkerr == chkerr);
+      fail_unless(lwip_stats.udp.recv == udp_recv + 1);
+    } else {
+      fail_unless(lwip_stats.ip.chkerr == chkerr + 1);
+      fail_unless(lwip_stats.udp.recv == udp_recv);
+    }
+  }
+#else /* LWIP_IPV4_FIB && LWIP_CHECKSUM_OFFLOAD && CHECKSUM_CHECK_IP */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV4_FIB && LWIP_CHECKSUM_OFFLOAD && CHECKSUM_CHECK_IP */
+}
+END_TEST
+
+
+/** Create the suite including all tests for this module */
+Suite *
+ip4_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_ip4_fib_route),
+    TESTFUNC(test_ip4_fib_gateway),
+    TESTFUNC(test_ip4_forward),
+    TESTFUNC(test_ip4_reass),
+    TESTFUNC(test_ip4_frag),
+    TESTFUNC(test_ip4_frag_chksum_partial),
+    TESTFUNC(test_ip4_chksum_verified)
+  };
+  return create_suite("IP4", tests, sizeof(tests)/sizeof(testfunc), ip4_setup, ip4_teardown);
+}
@@ -0,0 +1,390 @@
+#include "test_ip6.h"
+#include "../ip_frag_helper.h"
+
+#include "lwip/ip.h"
+#include "lwip/ip6.h"
+#include "lwip/ip6_fib.h"
+#include "lwip/ip6_frag.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/nd6.h"
+#include "lwip/netif.h"
+#include "lwip/stats.h"
+
+#if !LWIP_STATS || !MEMP_STATS
+#error "This tests needs MEMP-statistics enabled"
+#endif
+
+#if LWIP_IPV6
+static struct netif test_netif1, test_netif2;
+static int output_ctr;
+
+/* Helper functions */
+static err_t
+test_netif_output_ip6(struct netif *netif, struct pbuf *p, const ip6_addr_t *ipaddr)
+{
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(p);
+  LWIP_UNUSED_ARG(ipaddr);
+  output_ctr++;
+  return ERR_OK;
+}
+
+static err_t
+test_netif_init(struct netif *netif)
+{
+  fail_unless(netif != NULL);
+  netif->output_ip6 = test_netif_output_ip6;
+  netif->mtu = 1500;
+  netif->hwaddr_len = 6;
+  netif->flags = NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+static void
+test_netif_add(struct netif *netif, u32_t subnet)
+{
+  ip6_addr_t addr;
+
+  fail_unless(netif_add(netif, NULL, NULL, NULL, NULL, test_netif_init, NULL) == netif);
+  IP6_ADDR(&addr, PP_HTONL(0x20010db8), PP_HTONL(subnet), 0, PP_HTONL(1));
+  netif_ip6_addr_set(netif, 0, &addr);
+  netif_ip6_addr_set_state(netif, 0, IP6_ADDR_VALID);
+  netif_set_up(netif);
+#if LWIP_IPV6_SEND_ROUTER_SOLICIT
+  /* keep router solicitations out of the output counts */
+  netif->rs_count = 0;
+#endif /* LWIP_IPV6_SEND_ROUTER_SOLICIT */
+}
+
+#if LWIP_IPV6_FRAG && LWIP_IPV6_REASS
+/* Check the headers of a fragment and pass it to ip6_reass() the way
+   ip6_input() would */
+static struct pbuf *
+test_reass_ip6(struct pbuf *p)
+{
+  struct ip6_hdr *ip6hdr = (struct ip6_hdr *)p->payload;
+
+  fail_unless(IP6H_NEXTH(ip6hdr) == IP6_NEXTH_FRAGMENT);
+  fail_unless(IP6H_PLEN(ip6hdr) == p->tot_len - IP6_HLEN);
+
+  ip_data.current_ip6_header = ip6hdr;
+  ip_addr_copy_from_ip6(ip_data.current_iphdr_src, ip6hdr->src);
+  ip_addr_copy_from_ip6(ip_data.current_iphdr_dest, ip6hdr->dest);
+  pbuf_header(p, -IP6_HLEN);
+  p = ip6_reass(p);
+  memset(&ip_data, 0, sizeof(ip_data));
+  return p;
+}
+
+/* Feed a copy of every fragment sent to reassembly */
+static err_t
+test_frag_output_ip6(struct netif *netif, struct pbuf *p, const ip6_addr_t *ipaddr)
+{
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(ipaddr);
+
+  test_frag_reassemble(p, test_reass_ip6);
+  return ERR_OK;
+}
+
+/* Create a UDP datagram of 'len' bytes, payload bytes are their offset */
+static struct pbuf *
+test_datagram_ip6(const ip6_addr_t *src, const ip6_addr_t *dest, u16_t len)
+{
+  struct ip6_hdr *ip6hdr;
+  struct pbuf *p;
+  u16_t i;
+
+  p = pbuf_alloc(PBUF_RAW, IP6_HLEN + len, PBUF_RAM);
+  fail_unless(p != NULL);
+  ip6hdr = (struct ip6_hdr *)p->payload;
+  memset(ip6hdr, 0, IP6_HLEN);
+  IP6H_VTCFL_SET(ip6hdr, 6, 0, 0);
+  IP6H_PLEN_SET(ip6hdr, len);
+  IP6H_NEXTH_SET(ip6hdr, IP6_NEXTH_UDP);
+  IP6H_HOPLIM_SET(ip6hdr, 64);
+  ip6_addr_copy(ip6hdr->src, *src);
+  ip6_addr_copy(ip6hdr->dest, *dest);
+  for (i = 0; i < len; i++) {
+    ((u8_t *)p->payload)[IP6_HLEN + i] = (u8_t)i;
+  }
+  return p;
+}
+#endif /* LWIP_IPV6_FRAG && LWIP_IPV6_REASS */
+
+static struct netif *
+test_route(u32_t subnet, u32_t host)
+{
+  ip6_addr_t dest;
+  IP6_ADDR(&dest, PP_HTONL(0x20010db8), PP_HTONL(subnet), 0, PP_HTONL(host));
+  return ip6_route(IP6_ADDR_ANY6, &dest);
+}
+#endif /* LWIP_IPV6 */
+
+/* Setups/teardown functions */
+
+static void
+ip6_setup(void)
+{
+}
+
+static void
+ip6_teardown(void)
+{
+#if LWIP_IPV6
+  nd6_cleanup_netif(&test_netif1);
+  nd6_cleanup_netif(&test_netif2);
+  netif_remove(&test_netif1);
+  netif_remove(&test_netif2);
+#endif /* LWIP_IPV6 */
+}
+
+
+/* Test functions */
+
+/** Check longest prefix matching of static routes against on-link subnets */
+START_TEST(test_ip6_fib_route)
+{
+#if LWIP_IPV6 && LWIP_IPV6_FIB
+  ip6_addr_t prefix, gw;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netif_add(&test_netif1, 0x00010000);
+  test_netif_add(&test_netif2, 0x00020000);
+  fail_unless(test_route(0x00010000, 7) == &test_netif1);
+  fail_unless(test_route(0x00020000, 7) == &test_netif2);
+
+  /* a /48 reached through a router on netif2 */
+  IP6_ADDR(&prefix, PP_HTONL(0x20010db8), PP_HTONL(0x00030000), 0, 0);
+  IP6_ADDR(&gw, PP_HTONL(0x20010db8), PP_HTONL(0x00020000), 0, PP_HTONL(0xfe));
+  fail_unless(ip6_fib_add(&prefix, 48, &gw, &test_netif2) == ERR_OK);
+  fail_unless(test_route(0x0003abcd, 7) == &test_netif2);
+  /* a /32 covering everything is less specific than the on-link subnets */
+  IP6_ADDR(&prefix, PP_HTONL(0x20010db8), 0, 0, 0);
+  fail_unless(ip6_fib_add(&prefix, 32, &gw, &test_netif2) == ERR_OK);
+  fail_unless(test_route(0x00010000, 7) == &test_netif1);
+  fail_unless(test_route(0x00040000, 7) == &test_netif2);
+  /* a host route overrides the on-link subnet */
+  IP6_ADDR(&prefix, PP_HTONL(0x20010db8), PP_HTONL(0x00010000), 0, PP_HTONL(9));
+  fail_unless(ip6_fib_add(&prefix, 128, &gw, &test_netif2) == ERR_OK);
+  fail_unless(test_route(0x00010000, 9) == &test_netif2);
+  fail_unless(test_route(0x00010000, 8) == &test_netif1);
+  fail_unless(ip6_fib_lookup(&prefix)->prefix_len == 128);
+
+  /* a route over a netif that is down is skipped */
+  netif_set_down(&test_netif2);
+  fail_unless(ip6_fib_lookup(&prefix) == NULL);
+  netif_set_up(&test_netif2);
+
+  /* removing routes falls back to less specific ones */
+  fail_unless(ip6_fib_remove(&prefix, 128) == ERR_OK);
+  fail_unless(ip6_fib_remove(&prefix, 128) == ERR_VAL);
+  fail_unless(test_route(0x00010000, 9) == &test_netif1);
+  IP6_ADDR(&prefix, PP_HTONL(0x20010db8), PP_HTONL(0x00030000), 0, 0);
+  fail_unless(ip6_fib_remove(&prefix, 48) == ERR_OK);
+  fail_unless(ip6_fib_lookup(&prefix)->prefix_len == 32);
+
+  /* removing a netif removes its routes */
+  netif_remove(&test_netif2);
+  fail_unless(ip6_fib_lookup(&prefix) == NULL);
+  fail_unless(MEMP_STATS_GET(used, MEMP_IP6_FIB_NODE) == 0);
+#else /* LWIP_IPV6 && LWIP_IPV6_FIB */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV6 && LWIP_IPV6_FIB */
+}
+END_TEST
+
+/** Check that the destination cache recycles the least recently used entry */
+START_TEST(test_ip6_dest_cache)
+{
+#if LWIP_IPV6 && LWIP_ND6_DESTINATION_HASH_SIZE
+  ip6_addr_t dest;
+  const u8_t *hwaddr;
+  struct pbuf *p;
+  u32_t host;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netif_add(&test_netif1, 0x00010000);
+  nd6_clear_destination_cache();
+  p = pbuf_alloc(PBUF_IP, 8, PBUF_RAM);
+  fail_unless(p != NULL);
+
+  /* fill the cache, then look up the first destination again */
+  for (host = 1; host <= LWIP_ND6_NUM_DESTINATIONS + 2; host++) {
+    IP6_ADDR(&dest, PP_HTONL(0x20010db8), PP_HTONL(0x00010000), 0, lwip_htonl(host));
+    nd6_get_next_hop_addr_or_queue(&test_netif1, p, &dest, &hwaddr);
+    if (host == LWIP_ND6_NUM_DESTINATIONS) {
+      IP6_ADDR(&dest, PP_HTONL(0x20010db8), PP_HTONL(0x00010000), 0, PP_HTONL(1));
+      nd6_get_next_hop_addr_or_queue(&test_netif1, p, &dest, &hwaddr);
+    }
+  }
+  pbuf_free(p);
+
+  /* cached entries keep the old MTU, evicted ones report the netif MTU */
+  test_netif1.mtu = 1280;
+  for (host = 1; host <= LWIP_ND6_NUM_DESTINATIONS + 2; host++) {
+    IP6_ADDR(&dest, PP_HTONL(0x20010db8), PP_HTONL(0x00010000), 0, lwip_htonl(host));
+    if ((host == 2) || (host == 3)) {
+      fail_unless(nd6_get_destination_mtu(&dest, &test_netif1) == 1280);
+    } else {
+      fail_unless(nd6_get_destination_mtu(&dest, &test_netif1) == 1500);
+    }
+  }
+  nd6_clear_destination_cache();
+  IP6_ADDR(&dest, PP_HTONL(0x20010db8), PP_HTONL(0x00010000), 0, PP_HTONL(1));
+  fail_unless(nd6_get_destination_mtu(&dest, &test_netif1) == 1280);
+#else /* LWIP_IPV6 && LWIP_ND6_DESTINATION_HASH_SIZE */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV6 && LWIP_ND6_DESTINATION_HASH_SIZE */
+}
+END_TEST
+
+/** Check neighbor cache recycling, queue limits and probe timeouts */
+START_TEST(test_ip6_neighbor_cache)
+{
+#if LWIP_IPV6 && LWIP_ND6_QUEUEING
+  ip6_addr_t dest;
+  const u8_t *hwaddr;
+  struct pbuf *p;
+  u32_t host;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netif_add(&test_netif1, 0x00010000);
+  nd6_clear_destination_cache();
+  p = pbuf_alloc(PBUF_IP, 8, PBUF_RAM);
+  fail_unless(p != NULL);
+  output_ctr = 0;
+
+  /* queue more packets than allowed for the first neighbor */
+  IP6_ADDR(&dest, PP_HTONL(0x20010db8), PP_HTONL(0x00010000), 0, PP_HTONL(1));
+  for (i = 0; i < 3; i++) {
+    fail_unless(nd6_get_next_hop_addr_or_queue(&test_netif1, p, &dest, &hwaddr) == ERR_OK);
+  }
+  fail_unless(output_ctr == 1);
+#if LWIP_ND6_QUEUE_LEN
+  fail_unless(MEMP_STATS_GET(used, MEMP_ND6_QUEUE) == LWIP_ND6_QUEUE_LEN);
+#endif /* LWIP_ND6_QUEUE_LEN */
+
+  /* one more neighbor than fits recycles an entry and its queue */
+  for (host = 2; host <= LWIP_ND6_NUM_NEIGHBORS + 1; host++) {
+    IP6_ADDR(&dest, PP_HTONL(0x20010db8), PP_HTONL(0x00010000), 0, lwip_htonl(host));
+    fail_unless(nd6_get_next_hop_addr_or_queue(&test_netif1, p, &dest, &hwaddr) == ERR_OK);
+  }
+  pbuf_free(p);
+  fail_unless(output_ctr == LWIP_ND6_NUM_NEIGHBORS + 1);
+#if LWIP_ND6_NEIGHBOR_HASH_SIZE
+  /* the least recently used one is the first neighbor */
+  fail_unless(MEMP_STATS_GET(used, MEMP_ND6_QUEUE) == LWIP_ND6_NUM_NEIGHBORS);
+#endif /* LWIP_ND6_NEIGHBOR_HASH_SIZE */
+
+  /* unanswered neighbors are probed until they time out */
+  output_ctr = 0;
+  for (i = 0; i < LWIP_ND6_MAX_MULTICAST_SOLICIT; i++) {
+    nd6_tmr();
+  }
+  fail_unless(output_ctr == (LWIP_ND6_MAX_MULTICAST_SOLICIT - 1) * LWIP_ND6_NUM_NEIGHBORS);
+  fail_unless(MEMP_STATS_GET(used, MEMP_ND6_QUEUE) == 0);
+#else /* LWIP_IPV6 && LWIP_ND6_QUEUEING */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV6 && LWIP_ND6_QUEUEING */
+}
+END_TEST
+
+/** Check that fragments sent reassemble to the original datagram */
+START_TEST(test_ip6_frag)
+{
+#if LWIP_IPV6 && LWIP_IPV6_FRAG && LWIP_IPV6_REASS
+  struct netif netif;
+  ip6_addr_t src, dest;
+  struct pbuf *p;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&netif, 0, sizeof(netif));
+  netif.output_ip6 = test_frag_output_ip6;
+  netif.mtu = IP6_HLEN + IP6_FRAG_HLEN + 56;
+  test_frag_reset();
+  IP6_ADDR(&src, PP_HTONL(0x20010db8), PP_HTONL(0x00010000), 0, PP_HTONL(2));
+  IP6_ADDR(&dest, PP_HTONL(0x20010db8), PP_HTONL(0x00010000), 0, PP_HTONL(1));
+
+  p = test_datagram_ip6(&src, &dest, 200);
+  fail_unless(ip6_frag(p, &netif, &dest) == ERR_OK);
+  /* the datagram sent is left untouched */
+  fail_unless(p->tot_len == IP6_HLEN + 200);
+  fail_unless(IP6H_NEXTH((struct ip6_hdr *)p->payload) == IP6_NEXTH_UDP);
+  pbuf_free(p);
+  fail_unless(frag_ctr == 4);
+
+  p = frag_reassembled;
+  fail_unless(p != NULL);
+  if (p != NULL) {
+    fail_unless(IP6H_PLEN((struct ip6_hdr *)p->payload) == IP6_FRAG_HLEN + 200);
+    fail_unless(pbuf_get_at(p, IP6_HLEN) == IP6_NEXTH_UDP);
+    test_frag_check_payload(p, IP6_HLEN + IP6_FRAG_HLEN, 200);
+    pbuf_free(p);
+  }
+  fail_unless(MEMP_STATS_GET(used, MEMP_IP6_REASSDATA) == 0);
+  fail_unless(MEMP_STATS_GET(used, MEMP_FRAG_PBUF) == 0);
+#else /* LWIP_IPV6 && LWIP_IPV6_FRAG && LWIP_IPV6_REASS */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV6 && LWIP_IPV6_FRAG && LWIP_IPV6_REASS */
+}
+END_TEST
+
+/** A transport checksum left to the netif is completed before fragmenting */
+START_TEST(test_ip6_frag_chksum_partial)
+{
+#if LWIP_IPV6 && LWIP_IPV6_FRAG && LWIP_IPV6_REASS && LWIP_CHECKSUM_OFFLOAD
+  struct netif netif;
+  ip6_addr_t src6, dest6;
+  ip_addr_t src, dest;
+  struct pbuf *p;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&netif, 0, sizeof(netif));
+  netif.output_ip6 = test_frag_output_ip6;
+  netif.mtu = IP6_HLEN + IP6_FRAG_HLEN + 56;
+  test_frag_reset();
+  IP6_ADDR(&src6, PP_HTONL(0x20010db8), PP_HTONL(0x00010000), 0, PP_HTONL(2));
+  IP6_ADDR(&dest6, PP_HTONL(0x20010db8), PP_HTONL(0x00010000), 0, PP_HTONL(1));
+  ip_addr_copy_from_ip6(src, src6);
+  ip_addr_copy_from_ip6(dest, dest6);
+
+  p = test_datagram_ip6(&src6, &dest6, 200);
+  fail_unless(pbuf_header(p, -IP6_HLEN) == 0);
+  ip_chksum_pseudo_offload(p, IP_PROTO_UDP, 200, 6, &src, &dest);
+  fail_unless(pbuf_header(p, IP6_HLEN) == 0);
+  fail_unless(p->csum_start == IP6_HLEN);
+  fail_unless(ip6_frag(p, &netif, &dest6) == ERR_OK);
+  fail_unless((p->flags & PBUF_FLAG_CHKSUM_PARTIAL) == 0);
+  pbuf_free(p);
+  fail_unless(frag_ctr == 4);
+
+  p = frag_reassembled;
+  fail_unless(p != NULL);
+  if (p != NULL) {
+    fail_unless(pbuf_header(p, -(IP6_HLEN + IP6_FRAG_HLEN)) == 0);
+    fail_unless(ip_chksum_pseudo(p, IP_PROTO_UDP, p->tot_len, &src, &dest) == 0);
+    pbuf_free(p);
+  }
+  fail_unless(MEMP_STATS_GET(used, MEMP_IP6_REASSDATA) == 0);
+#else /* LWIP_IPV6 && LWIP_IPV6_FRAG && LWIP_IPV6_REASS && LWIP_CHECKSUM_OFFLOAD */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV6 && LWIP_IPV6_FRAG && LWIP_IPV6_REASS && LWIP_CHECKSUM_OFFLOAD */
+}
+END_TEST
+
+
+/** Create the suite including all tests for this module */
+Suite *
+ip6_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_ip6_fib_route),
+    TESTFUNC(test_ip6_dest_cache),
+    TESTFUNC(test_ip6_neighbor_cache),
+    TESTFUNC(test_ip6_frag),
+    TESTFUNC(test_ip6_frag_chksum_partial)
+  };
+  return create_suite("IP6", tests, sizeof(tests)/sizeof(testfunc), ip6_setup, ip6_teardown);
+}
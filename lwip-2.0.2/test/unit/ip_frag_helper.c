@@ -0,0 +1,46 @@
+#include "ip_frag_helper.h"
+
+int frag_ctr;
+struct pbuf *frag_reassembled;
+
+/** Prepare for a new fragmentation test */
+void
+test_frag_reset(void)
+{
+  frag_ctr = 0;
+  frag_reassembled = NULL;
+}
+
+/** Count a fragment sent and pass a copy of it to 'reass' (the original is
+ * still owned by the fragmentation code) */
+void
+test_frag_reassemble(struct pbuf *p, test_frag_reass_fn reass)
+{
+  struct pbuf *q;
+
+  frag_ctr++;
+  q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+  fail_unless(q != NULL);
+  if (q == NULL) {
+    return;
+  }
+  fail_unless(pbuf_copy(q, p) == ERR_OK);
+  q = reass(q);
+  if (q != NULL) {
+    fail_unless(frag_reassembled == NULL);
+    frag_reassembled = q;
+  }
+}
+
+/** Check that the 'len' bytes at 'offset' of a reassembled datagram are
+ * their offset in the payload, as the fragmentation tests send them */
+void
+test_frag_check_payload(struct pbuf *p, u16_t offset, u16_t len)
+{
+  u16_t i;
+
+  fail_unless(p->tot_len == offset + len);
+  for (i = 0; i < len; i++) {
+    fail_unless(pbuf_get_at(p, (u16_t)(offset + i)) == (u8_t)i);
+  }
+}
@@ -0,0 +1,21 @@
+#ifndef LWIP_HDR_IP_FRAG_HELPER_H
+#define LWIP_HDR_IP_FRAG_HELPER_H
+
+#include "lwip_check.h"
+#include "lwip/pbuf.h"
+
+/* Fragmentation tests send fragments on a netif whose output function feeds
+   a copy of each one to reassembly: the datagram reassembled from them ends
+   up in frag_reassembled. */
+extern int frag_ctr;
+extern struct pbuf *frag_reassembled;
+
+/** Protocol part of the fixture: reassembles a fragment (a copy the callee
+ * owns) and returns the complete datagram or NULL */
+typedef struct pbuf *(*test_frag_reass_fn)(struct pbuf *p);
+
+void test_frag_reset(void);
+void test_frag_reassemble(struct pbuf *p, test_frag_reass_fn reass);
+void test_frag_check_payload(struct pbuf *p, u16_t offset, u16_t len);
+
+#endif
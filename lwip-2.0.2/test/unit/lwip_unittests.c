@@ -1,10 +1,13 @@
 #include "lwip_check.h"
 
+#include "ip4/test_ip4.h"
+#include "ip6/test_ip6.h"
 #include "udp/test_udp.h"
 #include "tcp/test_tcp.h"
 #include "tcp/test_tcp_oos.h"
 #include "core/test_mem.h"
 #include "core/test_pbuf.h"
+#include "core/test_chksum.h"
 #include "etharp/test_etharp.h"
 #include "dhcp/test_dhcp.h"
 #include "mdns/test_mdns.h"
@@ -37,11 +40,14 @@ int main(void)
   SRunner *sr;
   size_t i;
   suite_getter_fn* suites[] = {
+    ip4_suite,
+    ip6_suite,
     udp_suite,
     tcp_suite,
     tcp_oos_suite,
     mem_suite,
     pbuf_suite,
+    chksum_suite,
     etharp_suite,
     dhcp_suite,
     mdns_suite
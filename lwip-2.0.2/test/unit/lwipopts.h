@@ -32,6 +32,12 @@
 #ifndef LWIP_HDR_LWIPOPTS_H
 #define LWIP_HDR_LWIPOPTS_H
 
+/* The unit tests are built twice: LWIP_TESTCONFIG_ALT=1 selects the
+   alternative code paths that the default configuration leaves out. */
+#ifndef LWIP_TESTCONFIG_ALT
+#define LWIP_TESTCONFIG_ALT             0
+#endif
+
 /* Prevent having to link sys_arch.c (we don't test the API layers in unit tests) */
 #define NO_SYS                          1
 #define SYS_LIGHTWEIGHT_PROT            0
@@ -50,6 +56,45 @@
 #define LWIP_WND_SCALE                  1
 #define TCP_RCV_SCALE                   0
 #define PBUF_POOL_SIZE                  400 /* pbuf tests need ~200KByte */
+#define LWIP_TCP_ECN                    1
+#define LWIP_TCP_DCTCP                  LWIP_TESTCONFIG_ALT
+#define LWIP_TCP_TFO                    1
+#define TCP_LISTEN_BACKLOG              1
+#define LWIP_RAND()                     ((u32_t)rand())
+#define LWIP_TCP_RACK                   1
+#define LWIP_TCP_INFO                   1
+#define LWIP_TCP_ACK_POLICY             1
+#define LWIP_IPV4_FIB                   1
+#define IP_FORWARD                      1
+#define IP_FORWARD_FLOW_CACHE_SIZE      4
+/* the forwarding flow cache keeps ARP entry hints with LWIP_NETIF_HWADDRHINT */
+#define LWIP_NETIF_HWADDRHINT           (!LWIP_TESTCONFIG_ALT)
+#define UDP_PCB_HASH_SIZE               4
+#define LWIP_SO_REUSEPORT               1
+#define LWIP_CHKSUM_ALGORITHM           4
+/* without checksum on copy, TCP retransmissions checksum incrementally */
+#define LWIP_CHECKSUM_ON_COPY           (!LWIP_TESTCONFIG_ALT)
+#define TCP_CHECKSUM_ON_COPY_SANITY_CHECK 1
+#define TCP_CHECKSUM_ON_COPY_SANITY_CHECK_FAIL(msg) LWIP_ASSERT("checksum on copy mismatch", 0)
+#define LWIP_CHECKSUM_CTRL_PER_NETIF    1
+#define LWIP_CHECKSUM_OFFLOAD           1
+#define LWIP_IPV6_FIB                   1
+/* the alternative configuration keeps the first-fit heap and static pools */
+#define MEM_USE_SLAB                    (!LWIP_TESTCONFIG_ALT)
+#define MEM_ARENA                       (!LWIP_TESTCONFIG_ALT)
+#define LWIP_ND6_DESTINATION_HASH_SIZE  4
+#define LWIP_ND6_NEIGHBOR_HASH_SIZE     4
+#define LWIP_ND6_QUEUE_LEN              2
+#define IP_REASS_HASH_SIZE              4
+#define IP_REASS_MAX_PBUFS_PER_SRC      6
+#define LWIP_IPV6_FRAG                  1
+#define IPV6_FRAG_COPYHEADER            1
+#define PBUF_POOL_CLASSES               1
+#define PBUF_POOL_SMALL_SIZE            32
+#define PBUF_ATOMIC_REF                 1
+/* the alternative configuration keeps pbuf_free_ooseq() freeing whole queues */
+#define MEMP_PRESSURE                   (!LWIP_TESTCONFIG_ALT)
+#define MEMP_MAGAZINE                   (!LWIP_TESTCONFIG_ALT)
 
 /* Enable IGMP and MDNS for MDNS tests */
 #define LWIP_IGMP                       1
@@ -58,5 +103,9 @@
 
 /* Minimal changes to opt.h required for etharp unit tests: */
 #define ETHARP_SUPPORT_STATIC_ENTRIES   1
+#if !LWIP_TESTCONFIG_ALT
+/* the alternative configuration keeps the linear ARP table search */
+#define ETHARP_TABLE_HASH_SIZE          4
+#endif
 
 #endif /* LWIP_HDR_LWIPOPTS_H */
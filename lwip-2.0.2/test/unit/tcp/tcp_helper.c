@@ -3,8 +3,13 @@
 #include "lwip/priv/tcp_priv.h"
 #include "lwip/stats.h"
 #include "lwip/pbuf.h"
+#include "lwip/memp.h"
 #include "lwip/inet_chksum.h"
 #include "lwip/ip_addr.h"
+#include "lwip/prot/ip4.h"
+#if LWIP_IPV4_FIB
+#include "lwip/ip4_fib.h"
+#endif /* LWIP_IPV4_FIB */
 
 #if !LWIP_STATS || !TCP_STATS || !MEMP_STATS
 #error "This tests needs TCP- and MEMP-statistics enabled"
@@ -266,11 +271,37 @@ void test_tcp_input(struct pbuf *p, struct netif *inp)
   ip_data.current_ip4_header = NULL;
 }
 
+#if CHECKSUM_GEN_TCP
+/** Every segment sent must carry a valid TCP checksum (also after header
+ * fields were updated for a retransmission or once the netif completed it) */
+static void test_tcp_check_chksum(struct pbuf *p)
+{
+  struct pbuf *q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+  struct ip_hdr *iphdr;
+  ip4_addr_t src, dest;
+  EXPECT_RET(q != NULL);
+  EXPECT(pbuf_copy(q, p) == ERR_OK);
+#if LWIP_CHECKSUM_OFFLOAD
+  /* do what the driver would do for a checksum left to it */
+  inet_chksum_offload_finish(q);
+#endif /* LWIP_CHECKSUM_OFFLOAD */
+  iphdr = (struct ip_hdr *)q->payload;
+  ip4_addr_copy(src, iphdr->src);
+  ip4_addr_copy(dest, iphdr->dest);
+  pbuf_header(q, -(s16_t)(IPH_HL(iphdr) * 4));
+  EXPECT(inet_chksum_pseudo(q, IP_PROTO_TCP, q->tot_len, &src, &dest) == 0);
+  pbuf_free(q);
+}
+#endif /* CHECKSUM_GEN_TCP */
+
 static err_t test_tcp_netif_output(struct netif *netif, struct pbuf *p,
        const ip4_addr_t *ipaddr)
 {
   struct test_tcp_txcounters *txcounters = (struct test_tcp_txcounters*)netif->state;
   LWIP_UNUSED_ARG(ipaddr);
+#if CHECKSUM_GEN_TCP
+  test_tcp_check_chksum(p);
+#endif /* CHECKSUM_GEN_TCP */
   if (txcounters != NULL)
   {
     txcounters->num_tx_calls++;
@@ -302,13 +333,87 @@ void test_tcp_init_netif(struct netif *netif, struct test_tcp_txcounters *txcoun
   }
   netif->output = test_tcp_netif_output;
   netif->flags |= NETIF_FLAG_UP | NETIF_FLAG_LINK_UP;
+  NETIF_SET_CHECKSUM_CTRL(netif, NETIF_CHECKSUM_ENABLE_ALL);
   ip_addr_copy_from_ip4(netif->netmask, *ip_2_ip4(netmask));
   ip_addr_copy_from_ip4(netif->ip_addr, *ip_2_ip4(ip_addr));
   for (n = netif_list; n != NULL; n = n->next) {
     if (n == netif) {
-      return;
+      break;
+    }
+  }
+  if (n == NULL) {
+#if LWIP_IPV4_FIB
+    if (netif_list != NULL) {
+      /* the previous netif is dropped from the list */
+      ip4_fib_netif_remove(netif_list);
+    }
+#endif /* LWIP_IPV4_FIB */
+    netif->next = NULL;
+    netif_list = netif;
+  }
+#if LWIP_IPV4_FIB
+  ip4_fib_netif_update(netif);
+#endif /* LWIP_IPV4_FIB */
+}
+
+/** Forget the netif set up by test_tcp_init_netif() (which may be gone
+ * already, so it must not be accessed) */
+void test_tcp_remove_netifs(void)
+{
+  struct netif *n = netif_list;
+  netif_list = NULL;
+  netif_default = NULL;
+#if LWIP_IPV4_FIB
+  if (n != NULL) {
+    ip4_fib_netif_remove(n);
+  }
+#else /* LWIP_IPV4_FIB */
+  LWIP_UNUSED_ARG(n);
+#endif /* LWIP_IPV4_FIB */
+}
+
+/* PBUF_POOL elements held by test_tcp_fill_pbuf_pool() */
+static void *test_tcp_pool_elements[PBUF_POOL_SIZE];
+static int test_tcp_pool_num;
+
+/** Allocate or release PBUF_POOL elements held here until the pool has
+ * 'used' elements in use (or it is empty) */
+void test_tcp_fill_pbuf_pool(mem_size_t used)
+{
+  while ((MEMP_STATS_GET(used, MEMP_PBUF_POOL) < used) && (test_tcp_pool_num < PBUF_POOL_SIZE)) {
+    void *p = memp_malloc(MEMP_PBUF_POOL);
+    if (p == NULL) {
+      break;
     }
+    test_tcp_pool_elements[test_tcp_pool_num++] = p;
+  }
+  while ((MEMP_STATS_GET(used, MEMP_PBUF_POOL) > used) && (test_tcp_pool_num > 0)) {
+    memp_free(MEMP_PBUF_POOL, test_tcp_pool_elements[--test_tcp_pool_num]);
+  }
+}
+
+/** Release all PBUF_POOL elements held by test_tcp_fill_pbuf_pool() */
+void test_tcp_release_pbuf_pool(void)
+{
+  while (test_tcp_pool_num > 0) {
+    memp_free(MEMP_PBUF_POOL, test_tcp_pool_elements[--test_tcp_pool_num]);
+  }
+}
+
+#if MEMP_PRESSURE
+/** Fill PBUF_POOL up to the given pressure level between its default
+ * watermarks and run the memory pressure timer. Level 0 releases the fill. */
+void test_tcp_pbuf_pool_pressure(u8_t level)
+{
+  mem_size_t num = MEMP_STATS_GET(avail, MEMP_PBUF_POOL);
+  mem_size_t low = (mem_size_t)((u32_t)num * MEMP_PRESSURE_LOWAT / 100);
+  mem_size_t high = (mem_size_t)((u32_t)num * MEMP_PRESSURE_HIWAT / 100);
+
+  if (level == 0) {
+    test_tcp_release_pbuf_pool();
+  } else {
+    test_tcp_fill_pbuf_pool((mem_size_t)(low + (u32_t)(high - low) * level / MEMP_PRESSURE_MAX));
   }
-  netif->next = NULL;
-  netif_list = netif;
+  memp_pressure_tmr();
 }
+#endif /* MEMP_PRESSURE */
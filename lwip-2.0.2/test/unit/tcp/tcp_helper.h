@@ -47,6 +47,13 @@ void test_tcp_input(struct pbuf *p, struct netif *inp);
 
 void test_tcp_init_netif(struct netif *netif, struct test_tcp_txcounters *txcounters,
                          ip_addr_t *ip_addr, ip_addr_t *netmask);
+void test_tcp_remove_netifs(void);
+
+void test_tcp_fill_pbuf_pool(mem_size_t used);
+void test_tcp_release_pbuf_pool(void);
+#if MEMP_PRESSURE
+void test_tcp_pbuf_pool_pressure(u8_t level);
+#endif /* MEMP_PRESSURE */
 
 
 #endif
@@ -4,6 +4,8 @@
 #include "lwip/stats.h"
 #include "tcp_helper.h"
 #include "lwip/inet_chksum.h"
+#include "lwip/sys.h"
+#include "../arch/sys_arch.h"
 
 #ifdef _MSC_VER
 #pragma warning(disable: 4307) /* we explicitly wrap around TCP seqnos */
@@ -46,9 +48,9 @@ tcp_setup(void)
 static void
 tcp_teardown(void)
 {
-  netif_list = NULL;
-  netif_default = NULL;
+  test_tcp_remove_netifs();
   tcp_remove_all();
+  test_tcp_release_pbuf_pool();
 }
 
 
@@ -726,6 +728,1368 @@ START_TEST(test_tcp_tx_full_window_lost_from_unacked)
 }
 END_TEST
 
+/** Check ECN: CE marks are echoed via ECE until the peer sends CWR, new data
+ * is sent ECT(0) and an ECE from the peer halves cwnd and triggers CWR */
+START_TEST(test_tcp_ecn)
+{
+#if LWIP_TCP_ECN && !LWIP_TCP_DCTCP
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  char rxdata[] = {1, 2, 3, 4};
+  char txdata[] = {5, 6, 7, 8};
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  u8_t tos, tcpflags;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb, pretending ECN was negotiated */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+  pcb->mss = TCP_MSS;
+  pcb->cwnd = 8 * TCP_MSS;
+  pcb->flags |= TF_ECN;
+  pcb->ecn_recover = pcb->snd_nxt;
+
+  /* receive CE marked data: ECE must be echoed */
+  p = tcp_create_rx_segment(pcb, rxdata, sizeof(rxdata), 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  IPH_TOS_SET((struct ip_hdr*)p->payload, IP_ECN_CE);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(counters.recv_calls == 1);
+  EXPECT(pcb->flags & TF_ECN_SND_ECE);
+
+  /* send data: ECT(0) with ECE set */
+  memset(&txcounters, 0, sizeof(txcounters));
+  txcounters.copy_tx_packets = 1;
+  err = tcp_write(pcb, txdata, sizeof(txdata), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  txcounters.copy_tx_packets = 0;
+  EXPECT_RET(txcounters.num_tx_calls == 1);
+  EXPECT_RET(txcounters.tx_packets != NULL);
+  EXPECT(pbuf_copy_partial(txcounters.tx_packets, &tos, 1, 1) == 1);
+  EXPECT(pbuf_copy_partial(txcounters.tx_packets, &tcpflags, 1, IP_HLEN + 13) == 1);
+  EXPECT((tos & IP_ECN_MASK) == IP_ECN_ECT0);
+  EXPECT((tcpflags & (TCP_ECE | TCP_CWR)) == TCP_ECE);
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  /* ACK with ECE: cwnd is halved once and CWR is pending */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, sizeof(txdata), TCP_ACK | TCP_ECE);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->cwnd == 4 * TCP_MSS);
+  EXPECT(pcb->ssthresh == 4 * TCP_MSS);
+  EXPECT(pcb->flags & TF_ECN_SND_CWR);
+
+  /* the next new data segment carries CWR */
+  memset(&txcounters, 0, sizeof(txcounters));
+  txcounters.copy_tx_packets = 1;
+  err = tcp_write(pcb, txdata, sizeof(txdata), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  txcounters.copy_tx_packets = 0;
+  EXPECT_RET(txcounters.tx_packets != NULL);
+  EXPECT(pbuf_copy_partial(txcounters.tx_packets, &tcpflags, 1, IP_HLEN + 13) == 1);
+  EXPECT(tcpflags & TCP_CWR);
+  EXPECT(!(pcb->flags & TF_ECN_SND_CWR));
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  /* CWR from the peer stops the ECE echo */
+  p = tcp_create_rx_segment(pcb, rxdata, sizeof(rxdata), 0, sizeof(txdata), TCP_ACK | TCP_CWR);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(!(pcb->flags & TF_ECN_SND_ECE));
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_ECN && !LWIP_TCP_DCTCP */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_ECN && !LWIP_TCP_DCTCP */
+}
+END_TEST
+
+#if LWIP_TCP_ECN || LWIP_TCP_TFO
+static u8_t test_tcp_accepts;
+static struct tcp_pcb* test_tcp_accepted_pcb;
+
+static err_t
+test_tcp_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  test_tcp_accepts++;
+  test_tcp_accepted_pcb = newpcb;
+  return ERR_OK;
+}
+#endif /* LWIP_TCP_ECN || LWIP_TCP_TFO */
+
+/** ECN negotiation, active side: the SYN carries ECE|CWR and only a SYN-ACK
+ * with ECE alone enables ECN on the connection */
+START_TEST(test_tcp_ecn_handshake_client)
+{
+#if LWIP_TCP_ECN
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  char txdata[] = {1, 2, 3, 4};
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100;
+  u8_t tos, tcpflags;
+  int i;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* first round: ECN capable peer, second round: peer without ECN */
+  for (i = 0; i < 2; i++) {
+    pcb = test_tcp_new_counters_pcb(&counters);
+    EXPECT_RET(pcb != NULL);
+    memset(&txcounters, 0, sizeof(txcounters));
+    txcounters.copy_tx_packets = 1;
+    err = tcp_connect(pcb, &remote_ip, remote_port, NULL);
+    EXPECT_RET(err == ERR_OK);
+    txcounters.copy_tx_packets = 0;
+    EXPECT_RET(txcounters.num_tx_calls == 1);
+    EXPECT_RET(txcounters.tx_packets != NULL);
+    EXPECT(pbuf_copy_partial(txcounters.tx_packets, &tos, 1, 1) == 1);
+    EXPECT(pbuf_copy_partial(txcounters.tx_packets, &tcpflags, 1, IP_HLEN + 13) == 1);
+    /* the SYN itself must not be ECN capable */
+    EXPECT((tos & IP_ECN_MASK) == IP_ECN_NOT_ECT);
+    EXPECT((tcpflags & (TCP_SYN | TCP_ECE | TCP_CWR)) == (TCP_SYN | TCP_ECE | TCP_CWR));
+    pbuf_free(txcounters.tx_packets);
+    txcounters.tx_packets = NULL;
+
+    p = tcp_create_segment(&remote_ip, &local_ip, remote_port, pcb->local_port,
+                           NULL, 0, 0x1000, pcb->lastack + 1,
+                           (u8_t)(TCP_SYN | TCP_ACK | ((i == 0) ? TCP_ECE : 0)));
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    EXPECT_RET(pcb->state == ESTABLISHED);
+
+    /* data is sent ECT(0) only if ECN was negotiated */
+    memset(&txcounters, 0, sizeof(txcounters));
+    txcounters.copy_tx_packets = 1;
+    err = tcp_write(pcb, txdata, sizeof(txdata), TCP_WRITE_FLAG_COPY);
+    EXPECT_RET(err == ERR_OK);
+    err = tcp_output(pcb);
+    EXPECT_RET(err == ERR_OK);
+    txcounters.copy_tx_packets = 0;
+    EXPECT_RET(txcounters.num_tx_calls == 1);
+    EXPECT_RET(txcounters.tx_packets != NULL);
+    EXPECT(pbuf_copy_partial(txcounters.tx_packets, &tos, 1, 1) == 1);
+    if (i == 0) {
+      EXPECT(pcb->flags & TF_ECN);
+      EXPECT((tos & IP_ECN_MASK) == IP_ECN_ECT0);
+    } else {
+      EXPECT(!(pcb->flags & TF_ECN));
+      EXPECT((tos & IP_ECN_MASK) == IP_ECN_NOT_ECT);
+    }
+    pbuf_free(txcounters.tx_packets);
+    txcounters.tx_packets = NULL;
+
+    EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+    tcp_abort(pcb);
+    EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+  }
+#else /* LWIP_TCP_ECN */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_ECN */
+}
+END_TEST
+
+/** ECN negotiation, passive side: a SYN with ECE|CWR is answered with a
+ * SYN-ACK carrying ECE alone, a plain SYN gets a plain SYN-ACK */
+START_TEST(test_tcp_ecn_handshake_listen)
+{
+#if LWIP_TCP_ECN
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct tcp_pcb *lpcb, *pcb;
+  struct pbuf* p;
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  u8_t tcpflags;
+  int i;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  test_tcp_accepts = 0;
+
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  err = tcp_bind(pcb, &local_ip, local_port);
+  EXPECT_RET(err == ERR_OK);
+  lpcb = tcp_listen(pcb);
+  EXPECT_RET(lpcb != NULL);
+  tcp_accept(lpcb, test_tcp_accept);
+
+  /* first round: ECN setup SYN, second round: plain SYN */
+  for (i = 0; i < 2; i++) {
+    memset(&txcounters, 0, sizeof(txcounters));
+    txcounters.copy_tx_packets = 1;
+    p = tcp_create_segment(&remote_ip, &local_ip, (u16_t)(remote_port + i), local_port,
+                           NULL, 0, 0x1000, 0,
+                           (u8_t)(TCP_SYN | ((i == 0) ? (TCP_ECE | TCP_CWR) : 0)));
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    txcounters.copy_tx_packets = 0;
+    EXPECT_RET(txcounters.num_tx_calls == 1);
+    EXPECT_RET(txcounters.tx_packets != NULL);
+    EXPECT(pbuf_copy_partial(txcounters.tx_packets, &tcpflags, 1, IP_HLEN + 13) == 1);
+    pbuf_free(txcounters.tx_packets);
+    txcounters.tx_packets = NULL;
+    pcb = tcp_active_pcbs;
+    EXPECT_RET(pcb != NULL);
+    EXPECT_RET(pcb->state == SYN_RCVD);
+    if (i == 0) {
+      EXPECT((tcpflags & (TCP_SYN | TCP_ACK | TCP_ECE | TCP_CWR)) == (TCP_SYN | TCP_ACK | TCP_ECE));
+      EXPECT(pcb->flags & TF_ECN);
+    } else {
+      EXPECT((tcpflags & (TCP_SYN | TCP_ACK | TCP_ECE | TCP_CWR)) == (TCP_SYN | TCP_ACK));
+      EXPECT(!(pcb->flags & TF_ECN));
+    }
+
+    /* the final ACK of the handshake passes the new pcb to the application */
+    p = tcp_create_segment(&remote_ip, &local_ip, (u16_t)(remote_port + i), local_port,
+                           NULL, 0, 0x1001, pcb->snd_nxt, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    EXPECT_RET(pcb->state == ESTABLISHED);
+    EXPECT(test_tcp_accepts == i + 1);
+    EXPECT(test_tcp_accepted_pcb == pcb);
+    tcp_abort(pcb);
+  }
+
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+  tcp_close(lpcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB_LISTEN) == 0);
+#else /* LWIP_TCP_ECN */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_ECN */
+}
+END_TEST
+
+/** DCTCP: alpha follows the fraction of CE marked bytes per window of data
+ * and cwnd is reduced by alpha/2 at most once per window */
+START_TEST(test_tcp_dctcp)
+{
+#if LWIP_TCP_DCTCP
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  tcpwnd_size_t cwnd, ssthresh;
+  u32_t alpha;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb: ECN is negotiated by the handshake tests */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+  pcb->mss = TCP_MSS;
+  pcb->cwnd = 8 * TCP_MSS;
+  pcb->flags |= TF_ECN;
+  pcb->ecn_recover = pcb->snd_nxt;
+  pcb->dctcp_next_seq = pcb->snd_nxt;
+  EXPECT(pcb->dctcp_alpha == TCP_DCTCP_ALPHA_MAX);
+
+  err = tcp_write(pcb, tx_data, 4 * TCP_MSS, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(txcounters.num_tx_calls == 4);
+
+  /* fully marked window: alpha stays 1, cwnd is halved */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 2 * TCP_MSS, TCP_ACK | TCP_ECE);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->dctcp_alpha == TCP_DCTCP_ALPHA_MAX);
+  EXPECT(pcb->cwnd == 4 * TCP_MSS);
+  EXPECT(pcb->ssthresh == 4 * TCP_MSS);
+
+  /* unmarked window: alpha decays by g = 1/16, cwnd is not reduced */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 2 * TCP_MSS, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  alpha = TCP_DCTCP_ALPHA_MAX - (TCP_DCTCP_ALPHA_MAX >> TCP_DCTCP_SHIFT_G);
+  EXPECT(pcb->dctcp_alpha == alpha);
+  EXPECT(pcb->cwnd >= 4 * TCP_MSS);
+  EXPECT(pcb->unacked == NULL);
+
+  /* marked again: cwnd is reduced by alpha/2 only, not halved */
+  err = tcp_write(pcb, tx_data, 4 * TCP_MSS, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(txcounters.num_tx_calls == 8);
+  cwnd = pcb->cwnd;
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 2 * TCP_MSS, TCP_ACK | TCP_ECE);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  alpha = alpha - (alpha >> TCP_DCTCP_SHIFT_G) + (TCP_DCTCP_ALPHA_MAX >> TCP_DCTCP_SHIFT_G);
+  EXPECT(pcb->dctcp_alpha == alpha);
+  EXPECT(pcb->cwnd == cwnd - (((u32_t)cwnd * alpha) >> (TCP_DCTCP_ALPHA_SHIFT + 1)));
+  EXPECT(pcb->cwnd > cwnd / 2);
+
+  /* a second ECE for the same window does not reduce cwnd again */
+  cwnd = pcb->cwnd;
+  ssthresh = pcb->ssthresh;
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, TCP_MSS, TCP_ACK | TCP_ECE);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->ssthresh == ssthresh);
+  EXPECT(pcb->cwnd >= cwnd);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_DCTCP */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_DCTCP */
+}
+END_TEST
+
+/** Fast Open client: with a cached cookie, data written before the SYN is
+ * sent goes out in the SYN; data not acked by the SYN-ACK is resent */
+START_TEST(test_tcp_fastopen_client)
+{
+#if LWIP_TCP_TFO
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  char txdata[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  u8_t cookie[TCP_TFO_COOKIE_LEN] = {0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7};
+  u8_t opts[40];
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100;
+  u16_t optlen, i;
+  u8_t tcpflags, hdrlen;
+  u32_t iss;
+  int found;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+  tcp_tfo_cookie_set(&remote_ip, cookie, sizeof(cookie));
+
+  /* the SYN is held back until there is data */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_fastopen_enable(pcb);
+  err = tcp_connect(pcb, &remote_ip, remote_port, NULL);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(txcounters.num_tx_calls == 0);
+  err = tcp_write(pcb, txdata, sizeof(txdata), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  txcounters.copy_tx_packets = 1;
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  txcounters.copy_tx_packets = 0;
+  EXPECT_RET(txcounters.num_tx_calls == 1);
+  EXPECT_RET(txcounters.tx_packets != NULL);
+
+  /* SYN with the cookie option and the data */
+  EXPECT(pbuf_copy_partial(txcounters.tx_packets, &tcpflags, 1, IP_HLEN + 13) == 1);
+  EXPECT(tcpflags & TCP_SYN);
+  EXPECT(pbuf_copy_partial(txcounters.tx_packets, &hdrlen, 1, IP_HLEN + 12) == 1);
+  hdrlen = (u8_t)((hdrlen >> 4) * 4);
+  EXPECT(txcounters.tx_packets->tot_len == IP_HLEN + hdrlen + sizeof(txdata));
+  optlen = (u16_t)(hdrlen - TCP_HLEN);
+  EXPECT_RET(optlen <= sizeof(opts));
+  EXPECT(pbuf_copy_partial(txcounters.tx_packets, opts, optlen, IP_HLEN + TCP_HLEN) == optlen);
+  found = 0;
+  for (i = 0; (i + 2 + sizeof(cookie)) <= optlen; i++) {
+    if ((opts[i] == LWIP_TCP_OPT_TFO) && (opts[i + 1] == 2 + sizeof(cookie)) &&
+        !memcmp(&opts[i + 2], cookie, sizeof(cookie))) {
+      found = 1;
+    }
+  }
+  EXPECT(found);
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  /* SYN-ACK acking the SYN only: the data is sent again right away */
+  iss = pcb->lastack;
+  p = tcp_create_segment(&remote_ip, &local_ip, remote_port, pcb->local_port,
+                         NULL, 0, 0x1000, iss + 1, TCP_SYN | TCP_ACK);
+  EXPECT_RET(p != NULL);
+  txcounters.copy_tx_packets = 1;
+  test_tcp_input(p, &netif);
+  txcounters.copy_tx_packets = 0;
+  EXPECT_RET(pcb->state == ESTABLISHED);
+  EXPECT(pcb->unsent == NULL);
+  EXPECT_RET(pcb->unacked != NULL);
+  EXPECT(pcb->unacked->len == sizeof(txdata));
+  EXPECT(lwip_ntohl(pcb->unacked->tcphdr->seqno) == iss + 1);
+  EXPECT(txcounters.num_tx_calls == 2);
+  /* the data sent again is the data from the SYN */
+  EXPECT_RET(txcounters.tx_packets != NULL);
+  EXPECT(pbuf_copy_partial(txcounters.tx_packets, &hdrlen, 1, IP_HLEN + 12) == 1);
+  hdrlen = (u8_t)((hdrlen >> 4) * 4);
+  EXPECT(txcounters.tx_packets->tot_len == IP_HLEN + hdrlen + sizeof(txdata));
+  EXPECT(pbuf_memcmp(txcounters.tx_packets, (u16_t)(IP_HLEN + hdrlen), txdata, sizeof(txdata)) == 0);
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+  /* the server did not send a cookie: it is forgotten */
+  EXPECT(tcp_tfo_cookie_get(&remote_ip, cookie) == 0);
+
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, sizeof(txdata), TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(pcb->snd_buf == TCP_SND_BUF);
+  EXPECT(pcb->snd_queuelen == 0);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+
+  /* SYN with data timing out: the SYN is retransmitted without the data,
+     which follows once connected */
+  tcp_tfo_cookie_set(&remote_ip, cookie, sizeof(cookie));
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_fastopen_enable(pcb);
+  err = tcp_connect(pcb, &remote_ip, remote_port, NULL);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_write(pcb, txdata, sizeof(txdata), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(pcb->unacked != NULL);
+  EXPECT(pcb->unacked->len == sizeof(txdata));
+  memset(&txcounters, 0, sizeof(txcounters));
+  txcounters.copy_tx_packets = 1;
+  pcb->rtime = pcb->rto;
+  tcp_slowtmr();
+  txcounters.copy_tx_packets = 0;
+  EXPECT_RET(txcounters.num_tx_calls == 1);
+  EXPECT_RET(txcounters.tx_packets != NULL);
+  EXPECT(pbuf_copy_partial(txcounters.tx_packets, &tcpflags, 1, IP_HLEN + 13) == 1);
+  EXPECT(tcpflags & TCP_SYN);
+  EXPECT(pbuf_copy_partial(txcounters.tx_packets, &hdrlen, 1, IP_HLEN + 12) == 1);
+  hdrlen = (u8_t)((hdrlen >> 4) * 4);
+  EXPECT(hdrlen > TCP_HLEN);
+  EXPECT(txcounters.tx_packets->tot_len == IP_HLEN + hdrlen);
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  iss = pcb->lastack;
+  p = tcp_create_segment(&remote_ip, &local_ip, remote_port, pcb->local_port,
+                         NULL, 0, 0x1000, iss + 1, TCP_SYN | TCP_ACK);
+  EXPECT_RET(p != NULL);
+  memset(&txcounters, 0, sizeof(txcounters));
+  txcounters.copy_tx_packets = 1;
+  test_tcp_input(p, &netif);
+  txcounters.copy_tx_packets = 0;
+  EXPECT_RET(pcb->state == ESTABLISHED);
+  EXPECT_RET(txcounters.tx_packets != NULL);
+  EXPECT(pbuf_copy_partial(txcounters.tx_packets, &hdrlen, 1, IP_HLEN + 12) == 1);
+  hdrlen = (u8_t)((hdrlen >> 4) * 4);
+  EXPECT(txcounters.tx_packets->tot_len == IP_HLEN + hdrlen + sizeof(txdata));
+  EXPECT(pbuf_memcmp(txcounters.tx_packets, (u16_t)(IP_HLEN + hdrlen), txdata, sizeof(txdata)) == 0);
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_TFO */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_TFO */
+}
+END_TEST
+
+/** Fast Open server: a SYN with a valid cookie is accepted right away and
+ * the final ACK of the handshake must not accept the connection again */
+START_TEST(test_tcp_fastopen_listen)
+{
+#if LWIP_TCP_TFO
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct tcp_pcb *pcb;
+  struct tcp_pcb_listen *lpcb;
+  struct tcp_hdr *tcphdr;
+  struct pbuf* p;
+  u8_t syndata[12 + 4] = {LWIP_TCP_OPT_NOP, LWIP_TCP_OPT_NOP, LWIP_TCP_OPT_TFO, 2 + TCP_TFO_COOKIE_LEN};
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  test_tcp_accepts = 0;
+
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  err = tcp_bind(pcb, &local_ip, local_port);
+  EXPECT_RET(err == ERR_OK);
+  lpcb = (struct tcp_pcb_listen*)tcp_listen_with_backlog(pcb, 1);
+  EXPECT_RET(lpcb != NULL);
+  tcp_accept((struct tcp_pcb*)lpcb, test_tcp_accept);
+
+  /* SYN with a valid cookie option and 4 bytes of data: the options are
+     passed as data first and the header length is fixed up afterwards */
+  tcp_tfo_cookie_gen(&remote_ip, &syndata[4]);
+  syndata[12] = 1;
+  p = tcp_create_segment(&remote_ip, &local_ip, remote_port, local_port,
+                         syndata, sizeof(syndata), 0x1000, 0, TCP_SYN);
+  EXPECT_RET(p != NULL);
+  pbuf_header(p, -IP_HLEN);
+  tcphdr = (struct tcp_hdr*)p->payload;
+  TCPH_HDRLEN_SET(tcphdr, (TCP_HLEN + 12) / 4);
+  tcphdr->chksum = 0;
+  tcphdr->chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len, &remote_ip, &local_ip);
+  pbuf_header(p, IP_HLEN);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(test_tcp_accepts == 1);
+  pcb = test_tcp_accepted_pcb;
+  EXPECT_RET(pcb != NULL);
+  EXPECT(pcb->state == SYN_RCVD);
+  EXPECT(pcb->rcv_nxt == 0x1000 + 1 + 4);
+  EXPECT(lpcb->accepts_pending == 0);
+
+  /* a retransmitted SYN is answered with the SYN-ACK again */
+  memset(&txcounters, 0, sizeof(txcounters));
+  p = tcp_create_segment(&remote_ip, &local_ip, remote_port, local_port,
+                         syndata, sizeof(syndata), 0x1000, 0, TCP_SYN);
+  EXPECT_RET(p != NULL);
+  pbuf_header(p, -IP_HLEN);
+  tcphdr = (struct tcp_hdr*)p->payload;
+  TCPH_HDRLEN_SET(tcphdr, (TCP_HLEN + 12) / 4);
+  tcphdr->chksum = 0;
+  tcphdr->chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len, &remote_ip, &local_ip);
+  pbuf_header(p, IP_HLEN);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(pcb->state == SYN_RCVD);
+  EXPECT(pcb->rcv_nxt == 0x1000 + 1 + 4);
+  EXPECT(test_tcp_accepts == 1);
+
+  /* the handshake completes without a second accept */
+  p = tcp_create_segment(&remote_ip, &local_ip, remote_port, local_port,
+                         NULL, 0, 0x1000 + 1 + 4, pcb->snd_nxt, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(pcb->state == ESTABLISHED);
+  EXPECT(test_tcp_accepts == 1);
+  EXPECT(lpcb->accepts_pending == 0);
+
+  tcp_abort(pcb);
+  EXPECT(lpcb->accepts_pending == 0);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+  tcp_close((struct tcp_pcb*)lpcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB_LISTEN) == 0);
+#else /* LWIP_TCP_TFO */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_TFO */
+}
+END_TEST
+
+/** RACK-TLP: a lost tail is probed after about two RTTs, a single duplicate
+ * ACK is not taken for a loss while more segments are outstanding, and in
+ * a small flight the loss is detected after the reordering window */
+START_TEST(test_tcp_rack_tlp)
+{
+#if LWIP_TCP_RACK
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  char txdata[5 * TCP_MSS];
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  memset(txdata, 0x55, sizeof(txdata));
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb with an RTT estimate of 100 ms */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+  pcb->mss = TCP_MSS;
+  pcb->cwnd = 8 * TCP_MSS;
+  pcb->ssthresh = 8 * TCP_MSS;
+  pcb->rack_min_rtt = 100;
+  pcb->rack_srtt = 100;
+  pcb->rack_flags = TCP_RACK_RTT_VALID;
+
+  /* a single segment arms the probe timer for 2 * srtt + WCDelAckT */
+  err = tcp_write(pcb, txdata, 4, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(txcounters.num_tx_calls == 1);
+  EXPECT(pcb->rack_flags & TCP_RACK_TLP_TIMER);
+  EXPECT(pcb->rack_timer - lwip_sys_now == 2 * 100 + TCP_RACK_WCDELACKT);
+
+  /* nothing happens before the timer expires... */
+  lwip_sys_now += 2 * 100 + TCP_RACK_WCDELACKT - 1;
+  tcp_fasttmr();
+  EXPECT(txcounters.num_tx_calls == 1);
+
+  /* ...and on expiry, the tail is retransmitted */
+  lwip_sys_now++;
+  tcp_fasttmr();
+  EXPECT(txcounters.num_tx_calls == 2);
+  EXPECT((pcb->rack_flags & (TCP_RACK_TLP_INFLIGHT | TCP_RACK_TLP_REXMIT)) ==
+         (TCP_RACK_TLP_INFLIGHT | TCP_RACK_TLP_REXMIT));
+  EXPECT(!(pcb->rack_flags & TCP_RACK_TLP_TIMER));
+
+  /* an ACK arriving sooner than the minimum RTT is for the original
+     transmission: the episode ends without a window reduction */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 4, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(!(pcb->rack_flags & (TCP_RACK_TLP_INFLIGHT | TCP_RACK_TLP_TIMER)));
+  EXPECT(pcb->cwnd >= 8 * TCP_MSS);
+
+  /* five segments, the second one overtakes the first one in the network */
+  err = tcp_write(pcb, txdata, 5 * TCP_MSS, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(txcounters.num_tx_calls == 7);
+  lwip_sys_now += 100;
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->dupacks == 1);
+  EXPECT(!(pcb->rack_flags & TCP_RACK_REO_TIMER));
+
+  /* one duplicate ACK is not enough to retransmit, even once the first
+     segment is overdue... */
+  lwip_sys_now += 50;
+  tcp_fasttmr();
+  EXPECT(txcounters.num_tx_calls == 7);
+  EXPECT(!(pcb->flags & TF_INFR));
+
+  /* ...so the late segment does not cause a spurious retransmission */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 5 * TCP_MSS, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(txcounters.num_tx_calls == 7);
+  EXPECT(pcb->cwnd >= 8 * TCP_MSS);
+
+  /* two segments: the duplicate ACK for the second one is all there can
+     be, the first one is lost after the reordering window */
+  err = tcp_write(pcb, txdata, 2 * TCP_MSS, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(txcounters.num_tx_calls == 9);
+  lwip_sys_now += 100;
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->dupacks == 1);
+  EXPECT(pcb->rack_flags & TCP_RACK_REO_TIMER);
+  EXPECT(pcb->rack_timer - lwip_sys_now == 100 / 4);
+  EXPECT(txcounters.num_tx_calls == 9);
+
+  lwip_sys_now += 100 / 4;
+  tcp_fasttmr();
+  EXPECT(pcb->flags & TF_INFR);
+  EXPECT(txcounters.num_tx_calls == 10);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_RACK */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_RACK */
+}
+END_TEST
+
+#if LWIP_TCP_INFO
+static void
+test_tcp_info_count(void *arg, struct tcp_pcb *pcb, const struct tcp_info_lwip *info)
+{
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(info);
+  (*(int*)arg)++;
+}
+#endif /* LWIP_TCP_INFO */
+
+/** Per-connection statistics from tcp_get_info() and tcp_info_foreach() */
+START_TEST(test_tcp_info)
+{
+#if LWIP_TCP_INFO
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_info_lwip info;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  char data[] = {1, 2, 3, 4};
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  int num_pcbs = 0;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+  pcb->mss = TCP_MSS;
+  pcb->cwnd = 4 * TCP_MSS;
+
+  /* send and get acked, receive in order */
+  err = tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(tcp_get_info(pcb, &info) == ERR_OK);
+  EXPECT(info.bytes_in_flight == sizeof(data));
+  p = tcp_create_rx_segment(pcb, data, sizeof(data), 0, sizeof(data), TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(counters.recv_calls == 1);
+
+  /* out-of-sequence data is queued */
+  p = tcp_create_rx_segment(pcb, data, sizeof(data), 2 * sizeof(data), 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+
+  /* data retransmitted after a timeout */
+  err = tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  tcp_rexmit_rto(pcb);
+
+  EXPECT_RET(tcp_get_info(pcb, &info) == ERR_OK);
+  EXPECT(info.state == ESTABLISHED);
+  EXPECT(info.mss == TCP_MSS);
+  EXPECT(info.cwnd == pcb->cwnd);
+  EXPECT(info.bytes_sent == 2 * sizeof(data));
+  EXPECT(info.bytes_acked == sizeof(data));
+  EXPECT(info.bytes_received == sizeof(data));
+  EXPECT(info.bytes_retrans == sizeof(data));
+  EXPECT(info.retransmits == 1);
+  EXPECT(info.bytes_in_flight == sizeof(data));
+  EXPECT(info.ooseq_segs == 1);
+  EXPECT(info.ooseq_bytes == sizeof(data));
+
+  /* the iterator visits every connection */
+  tcp_info_foreach(test_tcp_info_count, &num_pcbs);
+  EXPECT(num_pcbs == 1);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_INFO */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_INFO */
+}
+END_TEST
+
+/** Check the ACK policy: quick ACKs at connection start and after
+ * out-of-order data, an ACK every TCP_ACK_EVERY_SEGS segments and delayed
+ * ACKs sent after TCP_DELACK_TIMEOUT */
+START_TEST(test_tcp_ack_policy)
+{
+#if LWIP_TCP_ACK_POLICY
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  char data[] = {1, 2, 3, 4};
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+  EXPECT(pcb->quickack == TCP_QUICKACK_SEGS);
+
+  /* the first segments are acknowledged immediately */
+  for (i = 0; i < TCP_QUICKACK_SEGS; i++) {
+    p = tcp_create_rx_segment(pcb, data, sizeof(data), 0, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    EXPECT_RET(txcounters.num_tx_calls == (u32_t)(i + 1));
+  }
+  EXPECT(pcb->quickack == 0);
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* then the ACK is held back until TCP_ACK_EVERY_SEGS segments arrived */
+  for (i = 1; i < TCP_ACK_EVERY_SEGS; i++) {
+    p = tcp_create_rx_segment(pcb, data, sizeof(data), 0, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    EXPECT_RET(txcounters.num_tx_calls == 0);
+    EXPECT(pcb->flags & TF_ACK_DELAY);
+  }
+  p = tcp_create_rx_segment(pcb, data, sizeof(data), 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(txcounters.num_tx_calls == 1);
+  EXPECT(!(pcb->flags & TF_ACK_DELAY));
+  EXPECT(pcb->delack_segs == 0);
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* a lone segment is acknowledged once the delayed ACK timeout expired */
+  p = tcp_create_rx_segment(pcb, data, sizeof(data), 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(txcounters.num_tx_calls == 0);
+  tcp_fasttmr();
+  EXPECT_RET(txcounters.num_tx_calls == 0);
+  pcb->delack_due -= TCP_DELACK_TIMEOUT + 1;
+  tcp_fasttmr();
+  EXPECT_RET(txcounters.num_tx_calls == 1);
+  EXPECT(!(pcb->flags & TF_ACK_DELAY));
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* out-of-order data is acknowledged at once and restarts quick-ACK mode */
+  p = tcp_create_rx_segment(pcb, data, sizeof(data), sizeof(data), 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(txcounters.num_tx_calls == 1);
+  EXPECT(pcb->quickack == TCP_QUICKACK_SEGS);
+  p = tcp_create_rx_segment(pcb, data, sizeof(data), 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(txcounters.num_tx_calls == 2);
+  EXPECT(pcb->quickack == TCP_QUICKACK_SEGS - 1);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_ACK_POLICY */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_ACK_POLICY */
+}
+END_TEST
+
+/** Without checksum on copy, a retransmission only sums its header again:
+ * check the checksum is right after the ACK and window fields changed */
+START_TEST(test_tcp_rexmit_chksum_incremental)
+{
+#if TCP_CHECKSUM_INCREMENTAL
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct tcp_seg* seg;
+  struct pbuf* p;
+  char data[] = {1, 2, 3, 4, 5, 6, 7};
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  u32_t ackno;
+  u16_t wnd, chksum;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+  pcb->mss = TCP_MSS;
+  pcb->cwnd = 4 * TCP_MSS;
+
+  /* the first transmission keeps the header sum */
+  err = tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(txcounters.num_tx_calls == 1);
+  seg = pcb->unacked;
+  EXPECT_RET(seg != NULL);
+  EXPECT(seg->flags & TF_SEG_CHKSUM_VALID);
+  ackno = seg->tcphdr->ackno;
+  wnd = seg->tcphdr->wnd;
+  chksum = seg->tcphdr->chksum;
+
+  /* data from the peer (not acking ours) changes the ACK and window fields,
+     half of it is read so that they do not change by the same amount */
+  p = tcp_create_rx_segment(pcb, tx_data, 2 * TCP_MSS, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(counters.recv_calls == 1);
+  tcp_recved(pcb, TCP_MSS);
+  tcp_fasttmr();
+
+  /* the retransmission is checked by the netif output of tcp_helper */
+  txcounters.num_tx_calls = 0;
+  tcp_rexmit_rto(pcb);
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT_RET(pcb->unacked == seg);
+  EXPECT(seg->flags & TF_SEG_CHKSUM_VALID);
+  EXPECT(seg->tcphdr->ackno != ackno);
+  EXPECT(seg->tcphdr->wnd != wnd);
+  EXPECT(seg->tcphdr->chksum != chksum);
+
+  /* once more, with the header unchanged */
+  chksum = seg->tcphdr->chksum;
+  tcp_rexmit_rto(pcb);
+  EXPECT(txcounters.num_tx_calls == 2);
+  EXPECT(seg->tcphdr->chksum == chksum);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* TCP_CHECKSUM_INCREMENTAL */
+  LWIP_UNUSED_ARG(_i);
+#endif /* TCP_CHECKSUM_INCREMENTAL */
+}
+END_TEST
+
+/** A netif with NETIF_CHECKSUM_PARTIAL_TCP gets the checksum to complete */
+START_TEST(test_tcp_chksum_partial)
+{
+#if LWIP_CHECKSUM_OFFLOAD && LWIP_CHECKSUM_CTRL_PER_NETIF && CHECKSUM_GEN_TCP
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  char data[] = {1, 2, 3, 4, 5, 6, 7};
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+  NETIF_SET_CHECKSUM_CTRL(&netif, (NETIF_CHECKSUM_ENABLE_ALL & ~NETIF_CHECKSUM_GEN_TCP) |
+    NETIF_CHECKSUM_PARTIAL_TCP);
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+  pcb->mss = TCP_MSS;
+  pcb->cwnd = 4 * TCP_MSS;
+
+  /* a data segment (the copy sent keeps the flags and offsets) */
+  txcounters.copy_tx_packets = 1;
+  err = tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(txcounters.num_tx_calls == 1);
+  EXPECT_RET(txcounters.tx_packets != NULL);
+  EXPECT(txcounters.tx_packets->flags & PBUF_FLAG_CHKSUM_PARTIAL);
+  EXPECT(txcounters.tx_packets->csum_start == IP_HLEN);
+  EXPECT(txcounters.tx_packets->csum_offset == 16);
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  /* an empty ACK */
+  p = tcp_create_rx_segment(pcb, data, sizeof(data), 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(counters.recv_calls == 1);
+  tcp_fasttmr();
+  EXPECT_RET(txcounters.num_tx_calls == 2);
+  EXPECT_RET(txcounters.tx_packets != NULL);
+  EXPECT(txcounters.tx_packets->flags & PBUF_FLAG_CHKSUM_PARTIAL);
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  /* retransmitted by a netif that wants the checksum generated */
+  NETIF_SET_CHECKSUM_CTRL(&netif, NETIF_CHECKSUM_ENABLE_ALL);
+  tcp_rexmit_rto(pcb);
+  EXPECT_RET(txcounters.num_tx_calls == 3);
+  EXPECT_RET(txcounters.tx_packets != NULL);
+  EXPECT((txcounters.tx_packets->flags & PBUF_FLAG_CHKSUM_PARTIAL) == 0);
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+  txcounters.copy_tx_packets = 0;
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_CHECKSUM_OFFLOAD && LWIP_CHECKSUM_CTRL_PER_NETIF && CHECKSUM_GEN_TCP */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_CHECKSUM_OFFLOAD && LWIP_CHECKSUM_CTRL_PER_NETIF && CHECKSUM_GEN_TCP */
+}
+END_TEST
+
+/** Checksums verified by the netif driver are not checked again */
+START_TEST(test_tcp_chksum_verified)
+{
+#if LWIP_CHECKSUM_OFFLOAD && CHECKSUM_CHECK_TCP
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  struct tcp_hdr* tcphdr;
+  char data[] = {1, 2, 3, 4, 5, 6, 7};
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  u16_t chkerr;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+
+  /* a wrong checksum is dropped... */
+  chkerr = lwip_stats.tcp.chkerr;
+  p = tcp_create_rx_segment(pcb, data, sizeof(data), 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  tcphdr = (struct tcp_hdr *)((u8_t *)p->payload + IP_HLEN);
+  tcphdr->chksum ^= PP_HTONS(0x1234);
+  test_tcp_input(p, &netif);
+  EXPECT(counters.recv_calls == 0);
+  EXPECT(lwip_stats.tcp.chkerr == chkerr + 1);
+
+  /* ...unless the driver claims to have checked it */
+  p = tcp_create_rx_segment(pcb, data, sizeof(data), 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  tcphdr = (struct tcp_hdr *)((u8_t *)p->payload + IP_HLEN);
+  tcphdr->chksum ^= PP_HTONS(0x1234);
+  p->flags |= PBUF_FLAG_CHKSUM_VERIFIED;
+  test_tcp_input(p, &netif);
+  EXPECT(counters.recv_calls == 1);
+  EXPECT(counters.recved_bytes == sizeof(data));
+  EXPECT(lwip_stats.tcp.chkerr == chkerr + 1);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_CHECKSUM_OFFLOAD && CHECKSUM_CHECK_TCP */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_CHECKSUM_OFFLOAD && CHECKSUM_CHECK_TCP */
+}
+END_TEST
+
+/** Check that the listeners of a SO_REUSEPORT group share connection
+ * requests and that every peer port keeps going to the same listener, and
+ * that members cannot connect to the same remote endpoint */
+START_TEST(test_tcp_reuseport)
+{
+#if LWIP_SO_REUSEPORT
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct tcp_pcb *pcb, *lpcbs[2], *cpcbs[2];
+  struct pbuf *p;
+  ip_addr_t remote_ip, local_ip, netmask;
+  int marks[2], ctr[2];
+  void *dest[16];
+  int i, j;
+  LWIP_UNUSED_ARG(_i);
+
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+
+  for (i = 0; i < 2; i++) {
+    pcb = tcp_new();
+    EXPECT_RET(pcb != NULL);
+    ip_set_option(pcb, SOF_REUSEPORT);
+    EXPECT(tcp_bind(pcb, IP_ADDR_ANY, 80) == ERR_OK);
+    lpcbs[i] = tcp_listen(pcb);
+    EXPECT_RET(lpcbs[i] != NULL);
+    tcp_arg(lpcbs[i], &marks[i]);
+    ctr[i] = 0;
+  }
+  /* a pcb without the option cannot join */
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(tcp_bind(pcb, IP_ADDR_ANY, 80) == ERR_USE);
+  tcp_abort(pcb);
+
+  for (j = 0; j < 32; j++) {
+    p = tcp_create_segment(&remote_ip, &local_ip, (u16_t)(0x100 + (j % 16)), 80,
+                           NULL, 0, 12345, 0, TCP_SYN);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    /* the new pcb inherits the argument of its listener */
+    pcb = tcp_active_pcbs;
+    EXPECT_RET((pcb != NULL) && (pcb->state == SYN_RCVD));
+    EXPECT_RET((pcb->callback_arg == &marks[0]) || (pcb->callback_arg == &marks[1]));
+    if (j < 16) {
+      dest[j] = pcb->callback_arg;
+      ctr[(pcb->callback_arg == &marks[0]) ? 0 : 1]++;
+    } else {
+      EXPECT(pcb->callback_arg == dest[j % 16]);
+    }
+    tcp_abort(pcb);
+  }
+  EXPECT((ctr[0] > 0) && (ctr[1] > 0));
+
+  for (i = 0; i < 2; i++) {
+    EXPECT(tcp_close(lpcbs[i]) == ERR_OK);
+  }
+
+  /* group members share the local port, but not a connection */
+  for (i = 0; i < 2; i++) {
+    cpcbs[i] = tcp_new();
+    EXPECT_RET(cpcbs[i] != NULL);
+    ip_set_option(cpcbs[i], SOF_REUSEPORT);
+    EXPECT(tcp_bind(cpcbs[i], &local_ip, 5000) == ERR_OK);
+  }
+  EXPECT(tcp_connect(cpcbs[0], &remote_ip, 80, NULL) == ERR_OK);
+  EXPECT(tcp_connect(cpcbs[1], &remote_ip, 80, NULL) == ERR_USE);
+  EXPECT(tcp_connect(cpcbs[1], &remote_ip, 81, NULL) == ERR_OK);
+  for (i = 0; i < 2; i++) {
+    tcp_abort(cpcbs[i]);
+  }
+#else /* LWIP_SO_REUSEPORT */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_SO_REUSEPORT */
+}
+END_TEST
+
+/** Memory pressure from a filling PBUF_POOL: the window advertised shrinks
+ * with the level and is announced in full once the pressure went away */
+START_TEST(test_tcp_pressure_wnd)
+{
+#if MEMP_PRESSURE
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  static char data[TCP_MSS];
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  u16_t wnd;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+  EXPECT_RET(memp_pressure_level == 0);
+
+  /* receive 8 MSS the application does not read (yet) */
+  for (i = 0; i < 8; i++) {
+    p = tcp_create_rx_segment(pcb, data, sizeof(data), 0, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+  }
+  EXPECT_RET(counters.recved_bytes == 8 * TCP_MSS);
+  tcp_ack_now(pcb);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(pcb->rcv_ann_wnd == TCP_WND - 8 * TCP_MSS);
+
+  /* at half the pressure range, only half the window is opened again */
+  test_tcp_pbuf_pool_pressure(MEMP_PRESSURE_MAX / 2);
+  EXPECT_RET(memp_pressure_level == MEMP_PRESSURE_MAX / 2);
+  memset(&txcounters, 0, sizeof(txcounters));
+  txcounters.copy_tx_packets = 1;
+  tcp_recved(pcb, 8 * TCP_MSS);
+  txcounters.copy_tx_packets = 0;
+  EXPECT_RET(txcounters.num_tx_calls == 1);
+  EXPECT_RET(txcounters.tx_packets != NULL);
+  EXPECT(pbuf_copy_partial(txcounters.tx_packets, &wnd, 2, IP_HLEN + 14) == 2);
+  EXPECT(lwip_ntohs(wnd) == TCP_WND / 2);
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  /* rising further does not send anything */
+  memset(&txcounters, 0, sizeof(txcounters));
+  test_tcp_pbuf_pool_pressure(MEMP_PRESSURE_MAX);
+  EXPECT(memp_pressure_level == MEMP_PRESSURE_MAX);
+  EXPECT(txcounters.num_tx_calls == 0);
+
+  /* the pressure going away sends a window update with the full window */
+  txcounters.copy_tx_packets = 1;
+  test_tcp_pbuf_pool_pressure(0);
+  txcounters.copy_tx_packets = 0;
+  EXPECT(memp_pressure_level == 0);
+  EXPECT_RET(txcounters.num_tx_calls == 1);
+  EXPECT_RET(txcounters.tx_packets != NULL);
+  EXPECT(pbuf_copy_partial(txcounters.tx_packets, &wnd, 2, IP_HLEN + 14) == 2);
+  EXPECT(lwip_ntohs(wnd) == TCP_WND);
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* MEMP_PRESSURE */
+  LWIP_UNUSED_ARG(_i);
+#endif /* MEMP_PRESSURE */
+}
+END_TEST
+
+/** Memory pressure from a filling PBUF_POOL: tcp_write() on a low-priority
+ * connection fails from the high watermark until the pool is back at the
+ * low watermark */
+START_TEST(test_tcp_pressure_write)
+{
+#if MEMP_PRESSURE
+  struct netif netif;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  char data[] = {1, 2, 3, 4};
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  IP_ADDR4(&local_ip,  192, 168,   1, 1);
+  IP_ADDR4(&remote_ip, 192, 168,   1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, NULL, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+  tcp_setprio(pcb, TCP_PRIO_MIN);
+
+  /* below the high watermark, data is accepted */
+  test_tcp_pbuf_pool_pressure(MEMP_PRESSURE_MAX / 2);
+  EXPECT(!memp_pressure_active);
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+
+  /* at the high watermark, it is refused */
+  test_tcp_pbuf_pool_pressure(MEMP_PRESSURE_MAX);
+  EXPECT(memp_pressure_active);
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_MEM);
+
+  /* ... also after falling back between the watermarks */
+  test_tcp_pbuf_pool_pressure(MEMP_PRESSURE_MAX / 2);
+  EXPECT(memp_pressure_active);
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_MEM);
+  /* connections of normal priority are not affected */
+  tcp_setprio(pcb, TCP_PRIO_NORMAL);
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+  tcp_setprio(pcb, TCP_PRIO_MIN);
+
+  /* accepted again once the pool is back at its low watermark */
+  test_tcp_pbuf_pool_pressure(0);
+  EXPECT(!memp_pressure_active);
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* MEMP_PRESSURE */
+  LWIP_UNUSED_ARG(_i);
+#endif /* MEMP_PRESSURE */
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 tcp_suite(void)
@@ -738,7 +2102,22 @@ tcp_suite(void)
     TESTFUNC(test_tcp_fast_rexmit_wraparound),
     TESTFUNC(test_tcp_rto_rexmit_wraparound),
     TESTFUNC(test_tcp_tx_full_window_lost_from_unacked),
-    TESTFUNC(test_tcp_tx_full_window_lost_from_unsent)
+    TESTFUNC(test_tcp_tx_full_window_lost_from_unsent),
+    TESTFUNC(test_tcp_ecn),
+    TESTFUNC(test_tcp_ecn_handshake_client),
+    TESTFUNC(test_tcp_ecn_handshake_listen),
+    TESTFUNC(test_tcp_dctcp),
+    TESTFUNC(test_tcp_fastopen_client),
+    TESTFUNC(test_tcp_fastopen_listen),
+    TESTFUNC(test_tcp_rack_tlp),
+    TESTFUNC(test_tcp_info),
+    TESTFUNC(test_tcp_ack_policy),
+    TESTFUNC(test_tcp_rexmit_chksum_incremental),
+    TESTFUNC(test_tcp_chksum_partial),
+    TESTFUNC(test_tcp_chksum_verified),
+    TESTFUNC(test_tcp_reuseport),
+    TESTFUNC(test_tcp_pressure_wnd),
+    TESTFUNC(test_tcp_pressure_write)
   };
   return create_suite("TCP", tests, sizeof(tests)/sizeof(testfunc), tcp_setup, tcp_teardown);
 }
@@ -129,8 +129,8 @@ static void
 tcp_oos_teardown(void)
 {
   tcp_remove_all();
-  netif_list = NULL;
-  netif_default = NULL;
+  test_tcp_remove_netifs();
+  test_tcp_release_pbuf_pool();
 }
 
 
@@ -805,6 +805,228 @@ START_TEST(test_tcp_recv_ooseq_max_pbufs)
 }
 END_TEST
 
+/** Check that memory pressure frees the tail of the ooseq queue in
+ * proportion to the pressure level */
+START_TEST(test_tcp_recv_ooseq_pressure_trim)
+{
+#if MEMP_PRESSURE
+  int i;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf *p;
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  struct netif netif;
+  char data[] = {1, 2, 3, 4};
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  memset(&netif, 0, sizeof(netif));
+  IP_ADDR4(&local_ip, 192, 168, 1, 1);
+  IP_ADDR4(&remote_ip, 192, 168, 1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, NULL, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+
+  /* queue 4 segments with holes in between: seqno 8, 16, 24, 32 */
+  for (i = 1; i <= 4; i++) {
+    p = tcp_create_rx_segment(pcb, data, sizeof(data), 8 * i, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+  }
+  EXPECT_RET(tcp_oos_count(pcb) == 4);
+  EXPECT(counters.recv_calls == 0);
+
+  /* at the maximum level, half of the queue is freed from the tail */
+  tcp_trim_ooseq(MEMP_PRESSURE_MAX);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 2);
+  EXPECT_OOSEQ(tcp_oos_seg_seqno(pcb, 0) == pcb->rcv_nxt + 8);
+  EXPECT_OOSEQ(tcp_oos_seg_seqno(pcb, 1) == pcb->rcv_nxt + 16);
+
+  /* a queue too short for a low level is left alone */
+  tcp_trim_ooseq(10);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 2);
+  tcp_trim_ooseq(MEMP_PRESSURE_MAX / 2);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 2);
+
+  /* at the maximum level, at least one segment is freed */
+  tcp_trim_ooseq(MEMP_PRESSURE_MAX);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 1);
+  EXPECT_OOSEQ(tcp_oos_seg_seqno(pcb, 0) == pcb->rcv_nxt + 8);
+  tcp_trim_ooseq(MEMP_PRESSURE_MAX);
+  EXPECT(pcb->ooseq == NULL);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_SEG) == 0);
+
+  /* make sure the pcb is freed */
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* MEMP_PRESSURE */
+  LWIP_UNUSED_ARG(_i);
+#endif /* MEMP_PRESSURE */
+}
+END_TEST
+
+/** Fill PBUF_POOL to drive the memory pressure timer: the ooseq queues are
+ * trimmed when the level rises, not again and again at a steady level */
+START_TEST(test_tcp_recv_ooseq_pressure_tmr)
+{
+#if MEMP_PRESSURE
+  int i;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf *p;
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  struct netif netif;
+  char data[] = {1, 2, 3, 4};
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  memset(&netif, 0, sizeof(netif));
+  IP_ADDR4(&local_ip, 192, 168, 1, 1);
+  IP_ADDR4(&remote_ip, 192, 168, 1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, NULL, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+
+  /* queue 8 segments with holes in between: seqno 8, 16, ..., 64 */
+  for (i = 1; i <= 8; i++) {
+    p = tcp_create_rx_segment(pcb, data, sizeof(data), 8 * i, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+  }
+  EXPECT_RET(tcp_oos_count(pcb) == 8);
+
+  /* a quarter of the queue at half the pressure range... */
+  test_tcp_pbuf_pool_pressure(MEMP_PRESSURE_MAX / 2);
+  EXPECT(memp_pressure_level == MEMP_PRESSURE_MAX / 2);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 6);
+  /* ...and nothing more while the level stays there */
+  for (i = 0; i < 4; i++) {
+    test_tcp_pbuf_pool_pressure(MEMP_PRESSURE_MAX / 2);
+    EXPECT_OOSEQ(tcp_oos_count(pcb) == 6);
+  }
+
+  /* rising to the maximum frees half of what is left, from the tail */
+  test_tcp_pbuf_pool_pressure(MEMP_PRESSURE_MAX);
+  EXPECT(memp_pressure_level == MEMP_PRESSURE_MAX);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 3);
+  EXPECT_OOSEQ(tcp_oos_seg_seqno(pcb, 0) == pcb->rcv_nxt + 8);
+  EXPECT_OOSEQ(tcp_oos_seg_seqno(pcb, 2) == pcb->rcv_nxt + 24);
+  test_tcp_pbuf_pool_pressure(MEMP_PRESSURE_MAX);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 3);
+
+  /* after the pressure went away, a new rise trims again, but a queue too
+     short for the level is left alone */
+  test_tcp_pbuf_pool_pressure(0);
+  EXPECT(memp_pressure_level == 0);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 3);
+  test_tcp_pbuf_pool_pressure(MEMP_PRESSURE_MAX / 2);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 3);
+  test_tcp_pbuf_pool_pressure(MEMP_PRESSURE_MAX);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 2);
+  test_tcp_pbuf_pool_pressure(0);
+  EXPECT(memp_pressure_level == 0);
+
+  /* make sure the pcb is freed */
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* MEMP_PRESSURE */
+  LWIP_UNUSED_ARG(_i);
+#endif /* MEMP_PRESSURE */
+}
+END_TEST
+
+/** PBUF_POOL running dry frees ooseq segments through pbuf_free_ooseq():
+ * half of every queue with MEMP_PRESSURE, one whole queue without */
+START_TEST(test_tcp_recv_ooseq_pool_empty)
+{
+#if PBUF_POOL_FREE_OOSEQ && NO_SYS
+  int i;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf *p;
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  struct netif netif;
+  char data[] = {1, 2, 3, 4};
+  LWIP_UNUSED_ARG(_i);
+
+  /* initialize local vars */
+  memset(&netif, 0, sizeof(netif));
+  IP_ADDR4(&local_ip, 192, 168, 1, 1);
+  IP_ADDR4(&remote_ip, 192, 168, 1, 2);
+  IP_ADDR4(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, NULL, &local_ip, &netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+
+  /* queue 4 segments with holes in between: seqno 8, 16, 24, 32 */
+  for (i = 1; i <= 4; i++) {
+    p = tcp_create_rx_segment(pcb, data, sizeof(data), 8 * i, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+  }
+  EXPECT_RET(tcp_oos_count(pcb) == 4);
+
+  /* empty the pool: the next pbuf_alloc() fails and asks for ooseq pbufs */
+  test_tcp_fill_pbuf_pool(MEMP_STATS_GET(avail, MEMP_PBUF_POOL));
+  EXPECT(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == MEMP_STATS_GET(avail, MEMP_PBUF_POOL));
+  EXPECT(!pbuf_free_ooseq_pending);
+  p = pbuf_alloc(PBUF_RAW, 1, PBUF_POOL);
+  EXPECT(p == NULL);
+  EXPECT(pbuf_free_ooseq_pending);
+
+  PBUF_CHECK_FREE_OOSEQ();
+  EXPECT(!pbuf_free_ooseq_pending);
+#if MEMP_PRESSURE
+  EXPECT(memp_pressure_level == MEMP_PRESSURE_MAX);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 2);
+  EXPECT_OOSEQ(tcp_oos_seg_seqno(pcb, 0) == pcb->rcv_nxt + 8);
+  EXPECT_OOSEQ(tcp_oos_seg_seqno(pcb, 1) == pcb->rcv_nxt + 16);
+#else /* MEMP_PRESSURE */
+  EXPECT(pcb->ooseq == NULL);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_SEG) == 0);
+#endif /* MEMP_PRESSURE */
+  /* the freed pbufs are available again */
+  p = pbuf_alloc(PBUF_RAW, 1, PBUF_POOL);
+  EXPECT(p != NULL);
+  if (p != NULL) {
+    pbuf_free(p);
+  }
+
+  test_tcp_release_pbuf_pool();
+#if MEMP_PRESSURE
+  memp_pressure_tmr();
+  EXPECT(memp_pressure_level == 0);
+#endif /* MEMP_PRESSURE */
+
+  /* make sure the pcb is freed */
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* PBUF_POOL_FREE_OOSEQ && NO_SYS */
+  LWIP_UNUSED_ARG(_i);
+#endif /* PBUF_POOL_FREE_OOSEQ && NO_SYS */
+}
+END_TEST
+
 static void
 check_rx_counters(struct tcp_pcb *pcb, struct test_tcp_counters *counters, u32_t exp_close_calls, u32_t exp_rx_calls,
                   u32_t exp_rx_bytes, u32_t exp_err_calls, int exp_oos_count, int exp_oos_len)
@@ -1028,6 +1250,9 @@ tcp_oos_suite(void)
     TESTFUNC(test_tcp_recv_ooseq_overrun_rxwin_edge),
     TESTFUNC(test_tcp_recv_ooseq_max_bytes),
     TESTFUNC(test_tcp_recv_ooseq_max_pbufs),
+    TESTFUNC(test_tcp_recv_ooseq_pressure_trim),
+    TESTFUNC(test_tcp_recv_ooseq_pressure_tmr),
+    TESTFUNC(test_tcp_recv_ooseq_pool_empty),
     TESTFUNC(test_tcp_recv_ooseq_double_FIN_0),
     TESTFUNC(test_tcp_recv_ooseq_double_FIN_1),
     TESTFUNC(test_tcp_recv_ooseq_double_FIN_2),
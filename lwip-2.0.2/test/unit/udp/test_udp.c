@@ -2,12 +2,120 @@
 
 #include "lwip/udp.h"
 #include "lwip/stats.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/ip4.h"
+#include "lwip/prot/udp.h"
 
 #if !LWIP_STATS || !UDP_STATS || !MEMP_STATS
 #error "This tests needs UDP- and MEMP-statistics enabled"
 #endif
 
+static struct netif test_netif;
+static struct udp_pcb *recv_pcb;
+static int recv_ctr;
+static struct pbuf *sent_p;
+
 /* Helper functions */
+static err_t
+test_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(ipaddr);
+  /* keep a copy of the last packet sent */
+  if (sent_p != NULL) {
+    pbuf_free(sent_p);
+  }
+  sent_p = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+  fail_unless(sent_p != NULL);
+  fail_unless(pbuf_copy(sent_p, p) == ERR_OK);
+  return ERR_OK;
+}
+
+static err_t
+test_netif_init(struct netif *netif)
+{
+  netif->output = test_netif_output;
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+static void
+test_netif_add(void)
+{
+  ip4_addr_t addr, netmask, gw;
+
+  IP4_ADDR(&addr, 192, 168, 0, 1);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  IP4_ADDR(&gw, 192, 168, 0, 254);
+  fail_unless(netif_add(&test_netif, &addr, &netmask, &gw, NULL, test_netif_init, NULL) == &test_netif);
+  netif_set_up(&test_netif);
+}
+
+static void
+test_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+  recv_pcb = pcb;
+  recv_ctr++;
+  pbuf_free(p);
+}
+
+/* Pass a datagram from 192.168.0.2:'src' to 192.168.0.1:'dest' with UDP
+   checksum 'chksum' and pbuf flags 'flags' to ip4_input() and return the pcb
+   that received it */
+static struct udp_pcb *
+test_udp_input_chksum(u16_t src, u16_t dest, u16_t chksum, u8_t flags)
+{
+  struct pbuf *p;
+  struct ip_hdr *iphdr;
+  struct udp_hdr *udphdr;
+  ip4_addr_t addr;
+
+  p = pbuf_alloc(PBUF_RAW, IP_HLEN + UDP_HLEN + 4, PBUF_RAM);
+  fail_unless(p != NULL);
+  memset(p->payload, 0, p->len);
+  iphdr = (struct ip_hdr *)p->payload;
+  IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+  IPH_LEN_SET(iphdr, lwip_htons(p->tot_len));
+  IPH_TTL_SET(iphdr, 64);
+  IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+  IP4_ADDR(&addr, 192, 168, 0, 2);
+  ip4_addr_copy(iphdr->src, addr);
+  IP4_ADDR(&addr, 192, 168, 0, 1);
+  ip4_addr_copy(iphdr->dest, addr);
+  IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+  udphdr = (struct udp_hdr *)((u8_t *)p->payload + IP_HLEN);
+  udphdr->src = lwip_htons(src);
+  udphdr->dest = lwip_htons(dest);
+  udphdr->len = lwip_htons(UDP_HLEN + 4);
+  udphdr->chksum = chksum;
+  p->flags |= flags;
+
+  recv_pcb = NULL;
+  ip4_input(p, &test_netif);
+  return recv_pcb;
+}
+
+/* Pass a datagram without UDP checksum, see test_udp_input_chksum() */
+static struct udp_pcb *
+test_udp_input(u16_t src, u16_t dest)
+{
+  return test_udp_input_chksum(src, dest, 0, 0);
+}
+
+static struct udp_pcb *
+test_udp_bind(const ip_addr_t *ipaddr, u16_t port)
+{
+  struct udp_pcb *pcb = udp_new();
+  fail_unless(pcb != NULL);
+  fail_unless(udp_bind(pcb, ipaddr, port) == ERR_OK);
+  udp_recv(pcb, test_recv, NULL);
+  return pcb;
+}
+
 static void
 udp_remove_all(void)
 {
@@ -34,6 +142,10 @@ static void
 udp_teardown(void)
 {
   udp_remove_all();
+  if (sent_p != NULL) {
+    pbuf_free(sent_p);
+    sent_p = NULL;
+  }
 }
 
 
@@ -56,6 +168,241 @@ START_TEST(test_udp_new_remove)
 }
 END_TEST
 
+/** Check that datagrams reach connected pcbs first, then unconnected ones */
+START_TEST(test_udp_demux)
+{
+#if LWIP_IPV4
+  struct udp_pcb *pcb_any, *pcb_conn, *pcbs[2];
+  ip_addr_t local, remote;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netif_add();
+  IP_ADDR4(&local, 192, 168, 0, 1);
+  IP_ADDR4(&remote, 192, 168, 0, 2);
+  recv_ctr = 0;
+
+  pcb_any = test_udp_bind(IP_ADDR_ANY, 5000);
+  pcb_conn = test_udp_bind(&local, 5000);
+  fail_unless(udp_connect(pcb_conn, &remote, 7000) == ERR_OK);
+  for (i = 0; i < 2; i++) {
+    pcbs[i] = test_udp_bind(IP_ADDR_ANY, (u16_t)(6000 + i));
+  }
+  for (i = 0; i < 2; i++) {
+    fail_unless(test_udp_input(7000, (u16_t)(6000 + i)) == pcbs[i]);
+  }
+  fail_unless(test_udp_input(7000, 5000) == pcb_conn);
+  fail_unless(test_udp_input(7000, 5000) == pcb_conn);
+  fail_unless(test_udp_input(7001, 5000) == pcb_any);
+  fail_unless(test_udp_input(7000, 5001) == NULL);
+
+  /* the connected pcb only gets datagrams from its new peer */
+  fail_unless(udp_connect(pcb_conn, &remote, 7002) == ERR_OK);
+  fail_unless(test_udp_input(7000, 5000) == pcb_any);
+  fail_unless(test_udp_input(7002, 5000) == pcb_conn);
+
+  /* disconnected, it is the first unconnected match */
+  udp_disconnect(pcb_conn);
+  fail_unless(test_udp_input(7000, 5000) == pcb_conn);
+  fail_unless(test_udp_input(7002, 5000) == pcb_conn);
+
+  /* rebinding moves it to another port */
+  fail_unless(udp_bind(pcb_conn, &local, 5001) == ERR_OK);
+  fail_unless(test_udp_input(7000, 5000) == pcb_any);
+  fail_unless(test_udp_input(7000, 5001) == pcb_conn);
+
+  udp_remove(pcb_conn);
+  fail_unless(test_udp_input(7000, 5001) == NULL);
+  udp_remove(pcbs[0]);
+  fail_unless(test_udp_input(7000, 6000) == NULL);
+  fail_unless(test_udp_input(7000, 6001) == pcbs[1]);
+  fail_unless(recv_ctr == 12);
+
+  netif_remove(&test_netif);
+#else /* LWIP_IPV4 */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV4 */
+}
+END_TEST
+
+/** Check that rebinding, connecting and disconnecting keep the udp_pcbs
+ * order: the first unconnected match on that list gets the datagram */
+START_TEST(test_udp_demux_order)
+{
+#if LWIP_IPV4
+  struct udp_pcb *pcb_any, *pcb_local;
+  ip_addr_t local, remote;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netif_add();
+  IP_ADDR4(&local, 192, 168, 0, 1);
+  IP_ADDR4(&remote, 192, 168, 0, 2);
+  recv_ctr = 0;
+
+  pcb_any = test_udp_bind(IP_ADDR_ANY, 5000);
+  pcb_local = test_udp_bind(&local, 5000);
+  /* pcb_local was bound last, so it comes first on udp_pcbs */
+  fail_unless(udp_pcbs == pcb_local);
+  fail_unless(test_udp_input(7000, 5000) == pcb_local);
+
+  fail_unless(udp_bind(pcb_any, IP_ADDR_ANY, 5000) == ERR_OK);
+  fail_unless(test_udp_input(7000, 5000) == pcb_local);
+
+  fail_unless(udp_connect(pcb_any, &remote, 7002) == ERR_OK);
+  fail_unless(test_udp_input(7002, 5000) == pcb_any);
+  udp_disconnect(pcb_any);
+  fail_unless(test_udp_input(7002, 5000) == pcb_local);
+  udp_disconnect(pcb_any);
+  fail_unless(test_udp_input(7000, 5000) == pcb_local);
+
+  udp_remove(pcb_local);
+  fail_unless(test_udp_input(7000, 5000) == pcb_any);
+  udp_remove(pcb_any);
+  fail_unless(recv_ctr == 6);
+
+  netif_remove(&test_netif);
+#else /* LWIP_IPV4 */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV4 */
+}
+END_TEST
+
+/** Check that a SO_REUSEPORT group spreads datagrams by their source */
+START_TEST(test_udp_reuseport)
+{
+#if LWIP_IPV4 && LWIP_SO_REUSEPORT
+  struct udp_pcb *pcbs[3], *pcb, *dest[32];
+  int i, j, ctr;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netif_add();
+  for (i = 0; i < 3; i++) {
+    pcbs[i] = udp_new();
+    fail_unless(pcbs[i] != NULL);
+    ip_set_option(pcbs[i], SOF_REUSEPORT);
+    fail_unless(udp_bind(pcbs[i], IP_ADDR_ANY, 5000) == ERR_OK);
+    udp_recv(pcbs[i], test_recv, NULL);
+  }
+  /* a pcb without the option cannot join */
+  pcb = udp_new();
+  fail_unless(pcb != NULL);
+  fail_unless(udp_bind(pcb, IP_ADDR_ANY, 5000) == ERR_USE);
+  udp_remove(pcb);
+
+  /* every member gets some sources, always the same ones */
+  for (j = 0; j < 32; j++) {
+    dest[j] = test_udp_input((u16_t)(7000 + j), 5000);
+    fail_unless(dest[j] != NULL);
+  }
+  for (i = 0; i < 3; i++) {
+    ctr = 0;
+    for (j = 0; j < 32; j++) {
+      if (dest[j] == pcbs[i]) {
+        ctr++;
+      }
+    }
+    fail_unless(ctr > 0);
+  }
+  for (j = 0; j < 32; j++) {
+    fail_unless(test_udp_input((u16_t)(7000 + j), 5000) == dest[j]);
+  }
+
+  /* a member leaving only moves its own sources */
+  udp_remove(pcbs[1]);
+  for (j = 0; j < 32; j++) {
+    pcb = test_udp_input((u16_t)(7000 + j), 5000);
+    if (dest[j] == pcbs[1]) {
+      fail_unless((pcb == pcbs[0]) || (pcb == pcbs[2]));
+    } else {
+      fail_unless(pcb == dest[j]);
+    }
+  }
+
+  netif_remove(&test_netif);
+#else /* LWIP_IPV4 && LWIP_SO_REUSEPORT */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV4 && LWIP_SO_REUSEPORT */
+}
+END_TEST
+
+/** Checksums verified by the netif driver are not checked again */
+START_TEST(test_udp_chksum_verified)
+{
+#if LWIP_IPV4 && LWIP_CHECKSUM_OFFLOAD && CHECKSUM_CHECK_UDP
+  struct udp_pcb *pcb;
+  u16_t drops;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netif_add();
+  pcb = test_udp_bind(IP4_ADDR_ANY, 5000);
+
+  /* a wrong checksum is dropped... */
+  drops = lwip_stats.udp.chkerr;
+  fail_unless(test_udp_input_chksum(7000, 5000, 0x1234, 0) == NULL);
+  fail_unless(lwip_stats.udp.chkerr == drops + 1);
+  /* ...unless the driver claims to have checked it */
+  fail_unless(test_udp_input_chksum(7000, 5000, 0x1234, PBUF_FLAG_CHKSUM_VERIFIED) == pcb);
+  fail_unless(lwip_stats.udp.chkerr == drops + 1);
+
+  netif_remove(&test_netif);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV4 && LWIP_CHECKSUM_OFFLOAD && CHECKSUM_CHECK_UDP */
+}
+END_TEST
+
+/** A netif with NETIF_CHECKSUM_PARTIAL_UDP gets the checksum to complete */
+START_TEST(test_udp_chksum_partial)
+{
+#if LWIP_IPV4 && LWIP_CHECKSUM_OFFLOAD && LWIP_CHECKSUM_CTRL_PER_NETIF && CHECKSUM_GEN_UDP
+  struct udp_pcb *pcb;
+  struct pbuf *p;
+  ip_addr_t dst;
+  const u8_t data[] = "partial checksum";
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netif_add();
+  pcb = test_udp_bind(IP4_ADDR_ANY, 5000);
+  IP_ADDR4(&dst, 192, 168, 0, 2);
+
+  for (i = 0; i < 2; i++) {
+    u16_t len = (u16_t)(sizeof(data) - i);
+    p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    fail_unless(p != NULL);
+    MEMCPY(p->payload, data, len);
+    NETIF_SET_CHECKSUM_CTRL(&test_netif, (NETIF_CHECKSUM_ENABLE_ALL & ~NETIF_CHECKSUM_GEN_UDP) |
+      NETIF_CHECKSUM_PARTIAL_UDP);
+    fail_unless(udp_sendto(pcb, p, &dst, 7000) == ERR_OK);
+    fail_unless(sent_p != NULL);
+    fail_unless((sent_p->flags & PBUF_FLAG_CHKSUM_PARTIAL) != 0);
+    fail_unless(sent_p->csum_start == IP_HLEN);
+    fail_unless(sent_p->csum_offset == 6);
+    inet_chksum_offload_finish(sent_p);
+    fail_unless((sent_p->flags & PBUF_FLAG_CHKSUM_PARTIAL) == 0);
+    fail_unless(pbuf_header(sent_p, -IP_HLEN) == 0);
+    fail_unless(ip_chksum_pseudo(sent_p, IP_PROTO_UDP, sent_p->tot_len,
+      &test_netif.ip_addr, &dst) == 0);
+
+    /* a stale partial state must not survive resending in software */
+    fail_unless((p->flags & PBUF_FLAG_CHKSUM_PARTIAL) != 0);
+    fail_unless(pbuf_header(p, -(IP_HLEN + UDP_HLEN)) == 0);
+    NETIF_SET_CHECKSUM_CTRL(&test_netif, NETIF_CHECKSUM_ENABLE_ALL);
+    fail_unless(udp_sendto(pcb, p, &dst, 7000) == ERR_OK);
+    fail_unless((sent_p->flags & PBUF_FLAG_CHKSUM_PARTIAL) == 0);
+    fail_unless(pbuf_header(sent_p, -IP_HLEN) == 0);
+    fail_unless(ip_chksum_pseudo(sent_p, IP_PROTO_UDP, sent_p->tot_len,
+      &test_netif.ip_addr, &dst) == 0);
+    pbuf_free(p);
+  }
+
+  netif_remove(&test_netif);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV4 && LWIP_CHECKSUM_OFFLOAD && LWIP_CHECKSUM_CTRL_PER_NETIF && CHECKSUM_GEN_UDP */
+}
+END_TEST
+
 
 /** Create the suite including all tests for this module */
 Suite *
@@ -63,6 +410,11 @@ udp_suite(void)
 {
   testfunc tests[] = {
     TESTFUNC(test_udp_new_remove),
+    TESTFUNC(test_udp_demux),
+    TESTFUNC(test_udp_demux_order),
+    TESTFUNC(test_udp_reuseport),
+    TESTFUNC(test_udp_chksum_verified),
+    TESTFUNC(test_udp_chksum_partial),
   };
   return create_suite("UDP", tests, sizeof(tests)/sizeof(testfunc), udp_setup, udp_teardown);
 }